@@ -0,0 +1,327 @@
+/*
+ * ambient_occlusion.cpp
+ * Oclusão ambiente pré-calculada nos tubos (raios curtos contra a BVH) - TP2 (3D)
+ */
+
+#include "ambient_occlusion.h"
+#include "globals.h"
+#include "utils.h"
+#include "mesh.h"
+#include "bvh.h"
+#include "parallel.h"
+#include "memstats.h"
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+AmbientOcclusion ambient_occlusion;
+bool ambient_occlusion_enabled = false;
+
+// Segmentos por lote paralelo: o orçamento do quadro é conferido entre lotes
+static const size_t AO_BATCH = 256;
+
+// ============================================================
+// AMOSTRAS E RAIOS
+// ============================================================
+
+// Posição e base local da amostra (n = normal, t1/t2 tangentes); raio de
+// exibição em radius. False para segmentos degenerados (sem amostras).
+static bool sampleFrame(size_t seg, int sample, Point3D& origin, Point3D& n, Point3D& t1, Point3D& t2,
+                        float& radius) {
+    const Point3D& p0 = points[lines[seg].p0];
+    const Point3D& p1 = points[lines[seg].p1];
+    Point3D dir = p1 - p0;
+    float length = dir.length();
+    if (length < 0.0001f) return false;
+    dir = dir * (1.0f / length);
+
+    Point3D u, v;
+    ringBasis(dir, u, v);
+    radius = getDisplayRadius(seg);
+
+    if (sample < 2 * AO_RING) {
+        int ring = sample / AO_RING;
+        float angle = 2.0f * (float)M_PI * (sample % AO_RING) / AO_RING;
+        float inset = std::min(radius, 0.5f * length);
+        n = u * cosf(angle) + v * sinf(angle);
+        t1 = dir;
+        t2 = crossProduct(n, dir);
+        origin = (ring == 0 ? p0 + dir * inset : p1 - dir * inset) + n * radius;
+    } else {
+        n = (sample == 2 * AO_RING) ? dir * -1.0f : dir;
+        t1 = u;
+        t2 = v;
+        origin = (sample == 2 * AO_RING) ? p0 : p1;
+    }
+    // Afasta a origem da própria superfície (o próprio segmento nunca é testado)
+    origin = origin + n * (1e-3f * radius);
+    return true;
+}
+
+// Inverso radical na base 2 (segunda coordenada de Hammersley)
+static float radicalInverse(uint32_t i) {
+    i = (i << 16) | (i >> 16);
+    i = ((i & 0x55555555u) << 1) | ((i & 0xAAAAAAAAu) >> 1);
+    i = ((i & 0x33333333u) << 2) | ((i & 0xCCCCCCCCu) >> 2);
+    i = ((i & 0x0F0F0F0Fu) << 4) | ((i & 0xF0F0F0F0u) >> 4);
+    i = ((i & 0x00FF00FFu) << 8) | ((i & 0xFF00FF00u) >> 8);
+    return (float)i * 2.3283064365386963e-10f;
+}
+
+// Giro do padrão de raios de cada amostra (hash inteiro), para que amostras
+// vizinhas não repitam as mesmas direções e o erro não forme faixas
+static float sampleRotation(size_t seg, int sample) {
+    uint32_t h = (uint32_t)(seg * AO_SAMPLES + sample) * 0x9E3779B1u;
+    h ^= h >> 15;
+    h *= 0x85EBCA77u;
+    h ^= h >> 13;
+    return (float)(h >> 8) * (1.0f / 16777216.0f);
+}
+
+// Raio i de `rays` com densidade proporcional ao cosseno em torno de n
+static Point3D rayDirection(int i, int rays, float rotation, const Point3D& n, const Point3D& t1,
+                            const Point3D& t2) {
+    float u1 = (i + 0.5f) / rays;
+    float u2 = radicalInverse((uint32_t)i) + rotation;
+    if (u2 >= 1.0f) u2 -= 1.0f;
+    float r = sqrtf(u1);
+    float phi = 2.0f * (float)M_PI * u2;
+    return t1 * (r * cosf(phi)) + t2 * (r * sinf(phi)) + n * sqrtf(std::max(0.0f, 1.0f - u1));
+}
+
+// ============================================================
+// TESTE DOS RAIOS
+// ============================================================
+
+// Eixo da cápsula com o que os testes precisam
+struct AOCapsule {
+    Point3D a;
+    Point3D d;        // b - a
+    float dd;         // |d|²
+    float radius;
+    Point3D center;   // Esfera envolvente: meio do eixo e raio² (L/2 + r)²
+    float bound2;
+};
+
+static AOCapsule makeCapsule(size_t s) {
+    AOCapsule c;
+    c.a = points[lines[s].p0];
+    c.d = points[lines[s].p1] - c.a;
+    c.dd = dotProduct(c.d, c.d);
+    c.radius = getDisplayRadius(s);
+    c.center = c.a + c.d * 0.5f;
+    float bound = 0.5f * sqrtf(c.dd) + c.radius;
+    c.bound2 = bound * bound;
+    return c;
+}
+
+static float pointAxisDistanceSq(const Point3D& p, const AOCapsule& c) {
+    float t = (c.dd > 1e-12f) ? std::max(0.0f, std::min(1.0f, dotProduct(p - c.a, c.d) / c.dd)) : 0.0f;
+    Point3D diff = p - (c.a + c.d * t);
+    return dotProduct(diff, diff);
+}
+
+// Menor distância² entre o trecho o + s·r (s em [0, 1]) e o eixo da
+// cápsula (segmento contra segmento, com as duas pontas limitadas)
+static float rayAxisDistanceSq(const Point3D& o, const Point3D& r, float rr, const AOCapsule& c) {
+    Point3D w = o - c.a;
+    float b = dotProduct(r, c.d);
+    float d1 = dotProduct(r, w);
+    float d2 = dotProduct(c.d, w);
+    float denom = rr * c.dd - b * b;
+    float s = (denom > 1e-12f) ? std::max(0.0f, std::min(1.0f, (b * d2 - c.dd * d1) / denom)) : 0.0f;
+    float t = (c.dd > 1e-12f) ? (b * s + d2) / c.dd : 0.0f;
+    if (t < 0.0f) {
+        t = 0.0f;
+        s = std::max(0.0f, std::min(1.0f, -d1 / rr));
+    } else if (t > 1.0f) {
+        t = 1.0f;
+        s = std::max(0.0f, std::min(1.0f, (b - d1) / rr));
+    }
+    Point3D diff = (o + r * s) - (c.a + c.d * t);
+    return dotProduct(diff, diff);
+}
+
+// Raios bloqueados da amostra: primeiro separa, de `pool`, as cápsulas a
+// até o alcance da origem; depois cada raio para na primeira que atravessa
+static int occludedRays(size_t seg, int sample, const std::vector<AOCapsule>& pool, std::vector<AOCapsule>& near,
+                        size_t& tests) {
+    Point3D origin, n, t1, t2;
+    float radius;
+    if (!sampleFrame(seg, sample, origin, n, t1, t2, radius)) return 0;
+    float reach = ambient_occlusion.reach * radius;
+
+    // Origem dentro de uma cápsula vizinha: todo raio começa bloqueado
+    int rays = ambient_occlusion.rays;
+    near.clear();
+    for (const AOCapsule& c : pool) {
+        float limit = c.radius + reach;
+        float dist2 = pointAxisDistanceSq(origin, c);
+        if (dist2 <= c.radius * c.radius) {
+            tests += near.size() + 1;
+            return rays;
+        }
+        if (dist2 <= limit * limit) near.push_back(c);
+    }
+    tests += near.size();
+    if (near.empty()) return 0;
+
+    float rotation = sampleRotation(seg, sample);
+    float rr = reach * reach;
+    int blocked = 0;
+    for (int i = 0; i < rays; i++) {
+        Point3D ray = rayDirection(i, rays, rotation, n, t1, t2) * reach;
+        for (const AOCapsule& c : near) {
+            // Esfera envolvente antes do teste exato (segmento contra segmento)
+            Point3D to_center = c.center - origin;
+            float s = std::max(0.0f, std::min(1.0f, dotProduct(to_center, ray) / rr));
+            Point3D gap = to_center - ray * s;
+            if (dotProduct(gap, gap) > c.bound2) continue;
+            if (rayAxisDistanceSq(origin, ray, rr, c) <= c.radius * c.radius) {
+                blocked++;
+                break;
+            }
+        }
+    }
+    return blocked;
+}
+
+int countOccludedRays(size_t segment, int sample) {
+    std::vector<AOCapsule> pool, near;
+    pool.reserve(lines.size());
+    for (size_t s = 0; s < lines.size(); s++) {
+        if (s != segment) pool.push_back(makeCapsule(s));
+    }
+    size_t tests = 0;
+    return occludedRays(segment, sample, pool, near, tests);
+}
+
+// Cápsulas com o raio de exibição e a BVH delas, só durante o cálculo. A
+// segment_bvh não serve aqui: as caixas dela cobrem também o raio fixo
+// médio, bem maior que o dos vasos finos, e trariam dezenas de vezes mais
+// candidatos
+static std::vector<AOCapsule> bake_capsules;
+static SegmentBVH bake_bvh;
+
+// Amostras de uma ponta do segmento (anel e tampa, todos a até √2 raios
+// dela): as cápsulas vêm da BVH numa caixa em volta da ponta, com o raio
+// mais o alcance de folga, e ficam só as cujo eixo passa a essa distância.
+// Nos segmentos longos isso evita trazer tudo o que está perto do meio,
+// onde não há amostras.
+static void bakeEnd(size_t seg, int end, std::vector<int>& candidates, std::vector<AOCapsule>& pool,
+                    std::vector<AOCapsule>& near, size_t& tests) {
+    const AOCapsule& self = bake_capsules[seg];
+    Point3D p = (end == 0) ? self.a : self.a + self.d;
+    float margin = self.radius * (1.42f + ambient_occlusion.reach);
+    float bmin[3] = {p.x - margin, p.y - margin, p.z - margin};
+    float bmax[3] = {p.x + margin, p.y + margin, p.z + margin};
+    collectSegmentsInBox(bake_bvh, bmin, bmax, candidates);
+
+    pool.clear();
+    for (int s : candidates) {
+        if ((size_t)s == seg) continue;
+        const AOCapsule& c = bake_capsules[s];
+        float limit = c.radius + margin;
+        if (pointAxisDistanceSq(p, c) <= limit * limit) pool.push_back(c);
+    }
+
+    unsigned char* dst = &ambient_occlusion.visibility[seg * AO_SAMPLES];
+    int rays = ambient_occlusion.rays;
+    for (int k = 0; k <= AO_RING; k++) {
+        int sample = (k < AO_RING) ? end * AO_RING + k : 2 * AO_RING + end;
+        int free_rays = rays - occludedRays(seg, sample, pool, near, tests);
+        dst[sample] = (unsigned char)((free_rays * 255 + rays / 2) / rays);
+    }
+}
+
+// ============================================================
+// CÁLCULO PROGRESSIVO
+// ============================================================
+
+static void releaseBakeState() {
+    std::vector<AOCapsule>().swap(bake_capsules);
+    bake_bvh.clear();
+    bake_bvh.nodes.shrink_to_fit();
+    bake_bvh.segment_ids.shrink_to_fit();
+    bake_bvh.segment_boxes.shrink_to_fit();
+}
+
+bool continueAmbientOcclusion(double budget_ms) {
+    AmbientOcclusion& ao = ambient_occlusion;
+    if (ao.valid) return true;
+
+    size_t n = lines.size();
+    if (ao.baked == 0 || ao.visibility.size() != n * AO_SAMPLES) {
+        ao.baked = 0;
+        ao.visibility.assign(n * AO_SAMPLES, 255);
+        ao.candidate_tests = 0;
+        ao.bake_ms = 0.0;
+        if (ao.rays < 1) ao.rays = 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    if (bake_capsules.size() != n) {
+        std::vector<float> capsule_radii(n);
+        bake_capsules.resize(n);
+        for (size_t s = 0; s < n; s++) {
+            bake_capsules[s] = makeCapsule(s);
+            capsule_radii[s] = bake_capsules[s].radius;
+        }
+        buildCapsuleBVH(bake_bvh, capsule_radii, 0.0f);
+    }
+    while (ao.baked < n) {
+        size_t first = ao.baked;
+        size_t count = std::min(AO_BATCH, n - first);
+        std::atomic<size_t> tests(0);
+        parallelFor(count, 16, [&](size_t a, size_t b) {
+            std::vector<int> candidates;
+            std::vector<AOCapsule> pool, near;
+            size_t local_tests = 0;
+            for (size_t i = a; i < b; i++) {
+                bakeEnd(first + i, 0, candidates, pool, near, local_tests);
+                bakeEnd(first + i, 1, candidates, pool, near, local_tests);
+            }
+            tests += local_tests;
+        });
+        ao.candidate_tests += tests.load();
+        ao.baked += count;
+
+        elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (budget_ms >= 0.0 && elapsed > budget_ms) break;
+    }
+    ao.bake_ms += elapsed;
+    ao.valid = ao.baked >= n;
+    if (ao.valid) releaseBakeState();
+    return ao.valid;
+}
+
+void invalidateAmbientOcclusion() {
+    ambient_occlusion.valid = false;
+    ambient_occlusion.baked = 0;
+    releaseBakeState();
+}
+
+float vertexVisibility(size_t segment, int sides, int k) {
+    const unsigned char* v = &ambient_occlusion.visibility[segment * AO_SAMPLES];
+    if (k < 2 * sides) {
+        const unsigned char* ring = v + (k / sides) * AO_RING;
+        float x = (float)(k % sides) * AO_RING / sides;
+        int i0 = (int)x;
+        float f = x - i0;
+        return ((1.0f - f) * ring[i0] + f * ring[(i0 + 1) % AO_RING]) * (1.0f / 255.0f);
+    }
+    return v[2 * AO_RING + (k <= 3 * sides ? 0 : 1)] * (1.0f / 255.0f);
+}
+
+void appendAmbientOcclusionMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Caches", "ambient_occlusion.visibility", ambient_occlusion.visibility);
+    addMemoryEntry(entries, "Caches", "ambient_occlusion.bake_capsules", bake_capsules);
+    addMemoryEntry(entries, "Caches", "ambient_occlusion.bake_bvh.nodes", bake_bvh.nodes);
+}
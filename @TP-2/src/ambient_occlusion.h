@@ -0,0 +1,63 @@
+/*
+ * ambient_occlusion.h
+ * Oclusão ambiente pré-calculada nos tubos (raios curtos contra a BVH) - TP2 (3D)
+ */
+
+#ifndef AMBIENT_OCCLUSION_H
+#define AMBIENT_OCCLUSION_H
+
+#include <vector>
+#include <cstddef>
+
+struct MemoryEntry;
+
+// Amostras de cada segmento, independentes da qualidade da malha:
+//   [0, AO_RING)             anel lateral perto de p0
+//   [AO_RING, 2·AO_RING)     anel lateral perto de p1
+//   2·AO_RING                tampa p0      2·AO_RING + 1     tampa p1
+// Os anéis ficam recuados min(raio, L/2) das pontas, nas direções
+// 2πj/AO_RING da mesma base de ringBasis usada na tesselação
+static const int AO_RING = 6;
+static const int AO_SAMPLES = 2 * AO_RING + 2;
+
+struct AmbientOcclusion {
+    bool valid;                               // Todas as amostras prontas
+    size_t baked;                             // Segmentos [0, baked) já calculados
+    int rays;                                 // Raios por amostra
+    float reach;                              // Alcance dos raios, em raios de exibição do segmento
+    std::vector<unsigned char> visibility;    // AO_SAMPLES por segmento: raios livres × 255
+    size_t candidate_tests;                   // Pares amostra × cápsula próxima testados
+    double bake_ms;                           // Tempo total do cálculo (somando os lotes)
+
+    AmbientOcclusion() : valid(false), baked(0), rays(12), reach(4.0f), candidate_tests(0), bake_ms(0.0) {}
+};
+
+extern AmbientOcclusion ambient_occlusion;
+extern bool ambient_occlusion_enabled;   // Fator aplicado à iluminação (tecla B)
+
+// Calcula a partir de `baked`, em lotes paralelos, até esgotar o orçamento
+// (budget_ms < 0: tudo de uma vez). Cada ponta do segmento pega da BVH das
+// cápsulas as que estão ao alcance das suas amostras; cada amostra fica com
+// as que alcança e lança `rays` raios distribuídos pelo cosseno no
+// hemisfério da normal. Um
+// raio é bloqueado se o trecho [0, alcance] passa dentro de alguma cápsula
+// (amostras enterradas em vasos vizinhos ficam totalmente ocluídas).
+// Retorna true quando todos os segmentos estão prontos.
+bool continueAmbientOcclusion(double budget_ms);
+
+// Chamada quando pontos, raios ou o raio de exibição mudam
+void invalidateAmbientOcclusion();
+
+// Raios bloqueados da amostra contra todos os outros segmentos, sem a BVH
+// (força bruta, para a conferência do --ao)
+int countOccludedRays(size_t segment, int sample);
+
+// Visibilidade (0 a 1) do vértice k de um bloco de malha com `sides` lados
+// (layout de tessellateSegment): os anéis interpolam entre as amostras
+// vizinhas pelo ângulo e as tampas usam a amostra da sua ponta
+float vertexVisibility(size_t segment, int sides, int k);
+
+// Amostras (--memstats)
+void appendAmbientOcclusionMemory(std::vector<MemoryEntry>& entries);
+
+#endif // AMBIENT_OCCLUSION_H
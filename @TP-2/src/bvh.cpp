@@ -0,0 +1,349 @@
+/*
+ * bvh.cpp
+ * Construção da BVH sobre os segmentos - TP2 (3D)
+ */
+
+#include "bvh.h"
+#include "globals.h"
+#include "utils.h"
+#include <algorithm>
+#include <cmath>
+
+SegmentBVH segment_bvh;
+
+// Máximo de segmentos por folha
+static const int BVH_LEAF_SIZE = 4;
+
+struct SegmentBounds {
+    float bmin[3];
+    float bmax[3];
+    float centroid[3];
+};
+
+static std::vector<SegmentBounds> seg_bounds;
+
+static int buildNode(SegmentBVH& bvh, int first, int count) {
+    int node_index = (int)bvh.nodes.size();
+    bvh.nodes.push_back(BVHNode());
+
+    BVHNode node;
+    node.first = first;
+    node.count = count;
+    node.left = -1;
+    node.right = -1;
+
+    // Caixa do nó e caixa dos centróides (para escolher o eixo de divisão)
+    float cmin[3] = {1e30f, 1e30f, 1e30f};
+    float cmax[3] = {-1e30f, -1e30f, -1e30f};
+    for (int k = 0; k < 3; k++) {
+        node.bmin[k] = 1e30f;
+        node.bmax[k] = -1e30f;
+    }
+    for (int i = first; i < first + count; i++) {
+        const SegmentBounds& b = seg_bounds[bvh.segment_ids[i]];
+        for (int k = 0; k < 3; k++) {
+            node.bmin[k] = std::min(node.bmin[k], b.bmin[k]);
+            node.bmax[k] = std::max(node.bmax[k], b.bmax[k]);
+            cmin[k] = std::min(cmin[k], b.centroid[k]);
+            cmax[k] = std::max(cmax[k], b.centroid[k]);
+        }
+    }
+
+    if (count > BVH_LEAF_SIZE) {
+        int axis = 0;
+        float extent = cmax[0] - cmin[0];
+        for (int k = 1; k < 3; k++) {
+            if (cmax[k] - cmin[k] > extent) {
+                extent = cmax[k] - cmin[k];
+                axis = k;
+            }
+        }
+
+        // Divisão pela mediana dos centróides no eixo mais longo
+        int mid = first + count / 2;
+        std::nth_element(bvh.segment_ids.begin() + first,
+                         bvh.segment_ids.begin() + mid,
+                         bvh.segment_ids.begin() + first + count,
+                         [axis](int a, int b) {
+                             return seg_bounds[a].centroid[axis] < seg_bounds[b].centroid[axis];
+                         });
+
+        node.left = buildNode(bvh, first, mid - first);
+        node.right = buildNode(bvh, mid, first + count - mid);
+    }
+
+    bvh.nodes[node_index] = node;
+    return node_index;
+}
+
+// A caixa de cada segmento usa o maior raio de exibição entre os modos
+// fixo e variável, para que a BVH não precise ser refeita ao trocar de modo
+static void segmentBox(size_t i, float fixed_display, float bmin[3], float bmax[3]) {
+    const Point3D& p0 = points[lines[i].p0];
+    const Point3D& p1 = points[lines[i].p1];
+    float r = std::max(scaleRadiusForDisplay(radii[i]), fixed_display);
+    bmin[0] = std::min(p0.x, p1.x) - r;
+    bmin[1] = std::min(p0.y, p1.y) - r;
+    bmin[2] = std::min(p0.z, p1.z) - r;
+    bmax[0] = std::max(p0.x, p1.x) + r;
+    bmax[1] = std::max(p0.y, p1.y) + r;
+    bmax[2] = std::max(p0.z, p1.z) + r;
+}
+
+// Partição sobre seg_bounds (já preenchido, um por segmento) e caixas
+// individuais na ordem das folhas (acesso contíguo na travessia)
+static void buildFromBounds(SegmentBVH& bvh) {
+    size_t n = seg_bounds.size();
+    bvh.segment_ids.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        SegmentBounds& b = seg_bounds[i];
+        for (int k = 0; k < 3; k++) {
+            b.centroid[k] = 0.5f * (b.bmin[k] + b.bmax[k]);
+        }
+        bvh.segment_ids[i] = (int)i;
+    }
+
+    bvh.nodes.reserve(2 * n / BVH_LEAF_SIZE + 1);
+    buildNode(bvh, 0, (int)n);
+
+    bvh.segment_boxes.resize(6 * n);
+    for (size_t i = 0; i < n; i++) {
+        const SegmentBounds& b = seg_bounds[bvh.segment_ids[i]];
+        float* dst = &bvh.segment_boxes[6 * i];
+        for (int k = 0; k < 3; k++) {
+            dst[k] = b.bmin[k];
+            dst[3 + k] = b.bmax[k];
+        }
+    }
+
+    seg_bounds.clear();
+    seg_bounds.shrink_to_fit();
+}
+
+void buildSegmentBVH() {
+    segment_bvh.clear();
+    if (lines.empty() || points.empty()) return;
+
+    float fixed_display = scaleRadiusForDisplay((radius_min + radius_max) / 2.0f);
+
+    size_t n = lines.size();
+    seg_bounds.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        segmentBox(i, fixed_display, seg_bounds[i].bmin, seg_bounds[i].bmax);
+    }
+    buildFromBounds(segment_bvh);
+}
+
+void buildCapsuleBVH(SegmentBVH& bvh, const std::vector<float>& capsule_radii, float margin) {
+    bvh.clear();
+    size_t n = lines.size();
+    if (n == 0 || points.empty() || capsule_radii.size() != n) return;
+
+    seg_bounds.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        const Point3D& p0 = points[lines[i].p0];
+        const Point3D& p1 = points[lines[i].p1];
+        float r = capsule_radii[i] + margin;
+        SegmentBounds& b = seg_bounds[i];
+        b.bmin[0] = std::min(p0.x, p1.x) - r;
+        b.bmin[1] = std::min(p0.y, p1.y) - r;
+        b.bmin[2] = std::min(p0.z, p1.z) - r;
+        b.bmax[0] = std::max(p0.x, p1.x) + r;
+        b.bmax[1] = std::max(p0.y, p1.y) + r;
+        b.bmax[2] = std::max(p0.z, p1.z) + r;
+    }
+    buildFromBounds(bvh);
+}
+
+void refitSegmentBVH() {
+    if (segment_bvh.nodes.empty() || segment_bvh.segment_ids.size() != lines.size()) {
+        buildSegmentBVH();
+        return;
+    }
+
+    float fixed_display = scaleRadiusForDisplay((radius_min + radius_max) / 2.0f);
+    size_t n = segment_bvh.segment_ids.size();
+    for (size_t i = 0; i < n; i++) {
+        float* dst = &segment_bvh.segment_boxes[6 * i];
+        segmentBox(segment_bvh.segment_ids[i], fixed_display, dst, dst + 3);
+    }
+
+    // Filhos são criados depois do pai (pré-ordem): de trás para frente, as
+    // caixas dos filhos já estão prontas quando o pai é visitado
+    for (size_t k = segment_bvh.nodes.size(); k-- > 0; ) {
+        BVHNode& node = segment_bvh.nodes[k];
+        for (int c = 0; c < 3; c++) {
+            node.bmin[c] = 1e30f;
+            node.bmax[c] = -1e30f;
+        }
+        if (node.isLeaf()) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                const float* box = &segment_bvh.segment_boxes[6 * i];
+                for (int c = 0; c < 3; c++) {
+                    node.bmin[c] = std::min(node.bmin[c], box[c]);
+                    node.bmax[c] = std::max(node.bmax[c], box[3 + c]);
+                }
+            }
+        } else {
+            const BVHNode& a = segment_bvh.nodes[node.left];
+            const BVHNode& b = segment_bvh.nodes[node.right];
+            for (int c = 0; c < 3; c++) {
+                node.bmin[c] = std::min(a.bmin[c], b.bmin[c]);
+                node.bmax[c] = std::max(a.bmax[c], b.bmax[c]);
+            }
+        }
+    }
+}
+
+// ============================================================
+// CONSULTA POR RAIO
+// ============================================================
+
+// Interseção raio x caixa (slabs); devolve a entrada em t_enter
+static bool rayBox(const float* bmin, const float* bmax, const float* o, const float* inv_d,
+                   float t_max, float& t_enter) {
+    float t0 = 0.0f, t1 = t_max;
+    for (int k = 0; k < 3; k++) {
+        float a = (bmin[k] - o[k]) * inv_d[k];
+        float b = (bmax[k] - o[k]) * inv_d[k];
+        if (a > b) std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+        if (t0 > t1) return false;
+    }
+    t_enter = t0;
+    return true;
+}
+
+// Ponto de maior aproximação entre o raio (t >= 0) e o eixo do segmento;
+// devolve a distância entre os dois pontos e o t correspondente no raio
+static float rayAxisDistance(const Point3D& o, const Point3D& d, const Point3D& a, const Point3D& b, float& t) {
+    Point3D d2 = b - a;
+    Point3D r = o - a;
+    float e = dotProduct(d2, d2);
+    float f = dotProduct(d2, r);
+    float c = dotProduct(d, r);
+    float bb = dotProduct(d, d2);
+    float u;
+    if (e < 1e-12f) {
+        u = 0.0f;
+        t = std::max(0.0f, -c);
+    } else {
+        float denom = e - bb * bb;
+        t = (denom > 1e-12f) ? std::max(0.0f, (bb * f - c * e) / denom) : 0.0f;
+        u = (bb * t + f) / e;
+        if (u < 0.0f) {
+            u = 0.0f;
+            t = std::max(0.0f, -c);
+        } else if (u > 1.0f) {
+            u = 1.0f;
+            t = std::max(0.0f, bb - c);
+        }
+    }
+    Point3D diff = (o + d * t) - (a + d2 * u);
+    return diff.length();
+}
+
+static inline bool boxesTouch(const float* amin, const float* amax, const float* bmin, const float* bmax) {
+    return amin[0] <= bmax[0] && bmin[0] <= amax[0] && amin[1] <= bmax[1] && bmin[1] <= amax[1] &&
+           amin[2] <= bmax[2] && bmin[2] <= amax[2];
+}
+
+void collectSegmentsInBox(const SegmentBVH& bvh, const float bmin[3], const float bmax[3], std::vector<int>& out) {
+    out.clear();
+    if (bvh.nodes.empty()) return;
+    std::vector<int> stack;
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const BVHNode& node = bvh.nodes[stack.back()];
+        stack.pop_back();
+        if (!boxesTouch(node.bmin, node.bmax, bmin, bmax)) continue;
+        if (!node.isLeaf()) {
+            stack.push_back(node.right);
+            stack.push_back(node.left);
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; i++) {
+            const float* box = &bvh.segment_boxes[6 * i];
+            if (boxesTouch(box, box + 3, bmin, bmax)) out.push_back(bvh.segment_ids[i]);
+        }
+    }
+}
+
+int raycastSegments(const Point3D& origin, const Point3D& dir, float* hit_t) {
+    if (segment_bvh.nodes.empty()) return -1;
+
+    float o[3] = {origin.x, origin.y, origin.z};
+    float dv[3] = {dir.x, dir.y, dir.z};
+    float inv_d[3];
+    for (int k = 0; k < 3; k++) {
+        inv_d[k] = (fabsf(dv[k]) > 1e-12f) ? 1.0f / dv[k] : (dv[k] >= 0.0f ? 1e30f : -1e30f);
+    }
+
+    int best = -1;
+    float best_t = 1e30f;
+    std::vector<int> stack;
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const BVHNode& node = segment_bvh.nodes[stack.back()];
+        stack.pop_back();
+        float t_enter;
+        if (!rayBox(node.bmin, node.bmax, o, inv_d, best_t, t_enter)) continue;
+
+        if (!node.isLeaf()) {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; i++) {
+            int s = segment_bvh.segment_ids[i];
+            float t;
+            float dist = rayAxisDistance(origin, dir, points[lines[s].p0], points[lines[s].p1], t);
+            if (dist <= getDisplayRadius(s) && t < best_t) {
+                best_t = t;
+                best = s;
+            }
+        }
+    }
+
+    if (hit_t) *hit_t = best_t;
+    return best;
+}
+
+void raycastAllSegments(const Point3D& origin, const Point3D& dir, std::vector<int>& segments,
+                        std::vector<float>& hit_t) {
+    segments.clear();
+    hit_t.clear();
+    if (segment_bvh.nodes.empty()) return;
+
+    float o[3] = {origin.x, origin.y, origin.z};
+    float dv[3] = {dir.x, dir.y, dir.z};
+    float inv_d[3];
+    for (int k = 0; k < 3; k++) {
+        inv_d[k] = (fabsf(dv[k]) > 1e-12f) ? 1.0f / dv[k] : (dv[k] >= 0.0f ? 1e30f : -1e30f);
+    }
+
+    std::vector<int> stack;
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const BVHNode& node = segment_bvh.nodes[stack.back()];
+        stack.pop_back();
+        float t_enter;
+        if (!rayBox(node.bmin, node.bmax, o, inv_d, 1e30f, t_enter)) continue;
+
+        if (!node.isLeaf()) {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; i++) {
+            int s = segment_bvh.segment_ids[i];
+            float t;
+            float dist = rayAxisDistance(origin, dir, points[lines[s].p0], points[lines[s].p1], t);
+            if (dist <= getDisplayRadius(s)) {
+                segments.push_back(s);
+                hit_t.push_back(t);
+            }
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * bvh.h
+ * Hierarquia de volumes envolventes (BVH) sobre os segmentos - TP2 (3D)
+ */
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+
+struct Point3D;
+
+// Nó da BVH: caixa alinhada aos eixos e intervalo [first, first+count)
+// em SegmentBVH::segment_ids. Nós internos têm left/right >= 0.
+struct BVHNode {
+    float bmin[3];
+    float bmax[3];
+    int first;
+    int count;
+    int left;
+    int right;
+
+    bool isLeaf() const { return left < 0; }
+};
+
+struct SegmentBVH {
+    std::vector<BVHNode> nodes;       // nodes[0] é a raiz
+    std::vector<int> segment_ids;     // segmentos agrupados por nó
+    std::vector<float> segment_boxes; // caixa de segment_ids[i]: 6 floats (min xyz, max xyz)
+
+    void clear() {
+        nodes.clear();
+        segment_ids.clear();
+        segment_boxes.clear();
+    }
+};
+
+extern SegmentBVH segment_bvh;
+
+// Constrói a BVH sobre as cápsulas dos segmentos (eixo + raio de exibição)
+void buildSegmentBVH();
+
+// Constrói em `bvh` uma BVH sobre as cápsulas de raio capsule_radii[s],
+// com as caixas aumentadas por margin (ver checkCollisions)
+void buildCapsuleBVH(SegmentBVH& bvh, const std::vector<float>& capsule_radii, float margin);
+
+// Recalcula as caixas mantendo a partição (mesmos segmentos, só os raios
+// mudaram): O(n), sem ordenar de novo
+void refitSegmentBVH();
+
+// Segmentos cujas caixas tocam a caixa [bmin, bmax] (ids em `out`, na
+// ordem das folhas)
+void collectSegmentsInBox(const SegmentBVH& bvh, const float bmin[3], const float bmax[3], std::vector<int>& out);
+
+// Primeiro segmento atingido pelo raio origin + t*dir (dir normalizado),
+// testando a cápsula com o raio de exibição atual. Retorna -1 se nenhum;
+// hit_t (opcional) recebe a distância até o ponto de maior aproximação.
+int raycastSegments(const Point3D& origin, const Point3D& dir, float* hit_t = nullptr);
+
+// Todos os segmentos atingidos pelo raio (mesmo teste de raycastSegments),
+// sem ordem: o segmento e a distância de maior aproximação no raio
+void raycastAllSegments(const Point3D& origin, const Point3D& dir, std::vector<int>& segments,
+                        std::vector<float>& hit_t);
+
+#endif // BVH_H
@@ -0,0 +1,277 @@
+/*
+ * collision.cpp
+ * Verificação de interseções e folga mínima entre os vasos - TP2 (3D)
+ */
+
+#include "collision.h"
+#include "globals.h"
+#include "utils.h"
+#include "bvh.h"
+#include "parallel.h"
+#include "tree_paths.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+CollisionReport collision_report;
+int collision_view = COLLISION_OFF;
+
+// Níveis da travessia expandidos antes do laço paralelo (no máximo)
+static const int COLLISION_SPLIT_ROUNDS = 12;
+
+// ============================================================
+// DISTÂNCIA ENTRE EIXOS
+// ============================================================
+
+static inline float dot3(const Point3D& a, const Point3D& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline float clamp01(float v) {
+    return std::min(1.0f, std::max(0.0f, v));
+}
+
+// Menor distância entre os segmentos p1-q1 e p2-q2 (Ericson, Real-Time
+// Collision Detection, 5.1.9), com os casos degenerados de comprimento zero
+static float segmentDistance(const Point3D& p1, const Point3D& q1, const Point3D& p2, const Point3D& q2) {
+    Point3D d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+    float a = dot3(d1, d1), e = dot3(d2, d2), f = dot3(d2, r);
+    float s, t;
+    if (a <= 1e-20f && e <= 1e-20f) {
+        s = t = 0.0f;
+    } else if (a <= 1e-20f) {
+        s = 0.0f;
+        t = clamp01(f / e);
+    } else {
+        float c = dot3(d1, r);
+        if (e <= 1e-20f) {
+            t = 0.0f;
+            s = clamp01(-c / a);
+        } else {
+            float b = dot3(d1, d2);
+            float denom = a * e - b * b;
+            s = (denom > 1e-20f) ? clamp01((b * f - c * e) / denom) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = clamp01(-c / a);
+            } else if (t > 1.0f) {
+                t = 1.0f;
+                s = clamp01((b - c) / a);
+            }
+        }
+    }
+    Point3D diff = (p1 + d1 * s) - (p2 + d2 * t);
+    return diff.length();
+}
+
+// ============================================================
+// VERIFICAÇÃO
+// ============================================================
+
+static inline bool boxesOverlap(const float* a, const float* b) {
+    return a[0] <= b[3] && b[0] <= a[3] && a[1] <= b[4] && b[1] <= a[4] && a[2] <= b[5] && b[2] <= a[5];
+}
+
+// Nós guardam bmin e bmax em arrays separados: compara cada eixo explicitamente
+static inline bool nodesOverlap(const BVHNode& a, const BVHNode& b) {
+    for (int k = 0; k < 3; k++) {
+        if (a.bmin[k] > b.bmax[k] || b.bmin[k] > a.bmax[k]) return false;
+    }
+    return true;
+}
+
+
+// Cápsula na ordem das folhas: extremidades, raio e índices dos pontos
+// juntos, lidos em sequência pelos testes de uma folha (em vez de saltar
+// por points/lines)
+struct Capsule {
+    Point3D p0;
+    Point3D p1;
+    float radius;
+    uint32_t i0, i1;  // Índices de p0/p1 em points
+};
+
+static inline bool shareEndpoint(const Capsule& a, const Capsule& b) {
+    return a.i0 == b.i0 || a.i0 == b.i1 || a.i1 == b.i0 || a.i1 == b.i1;
+}
+
+// Par de subárvores da BVH a testar (a == b: pares dentro da subárvore)
+struct CollisionTask {
+    int a;
+    int b;
+};
+
+// Resultado de uma tarefa do laço paralelo (juntados na ordem das tarefas)
+struct CollisionChunk {
+    std::vector<CollisionPair> pairs;
+    size_t candidates;
+    size_t adjacent;
+
+    CollisionChunk() : candidates(0), adjacent(0) {}
+};
+
+struct CollisionContext {
+    const SegmentBVH& bvh;
+    const std::vector<Capsule>& capsules;
+    float clearance;
+
+    CollisionContext(const SegmentBVH& b, const std::vector<Capsule>& c, float clr)
+        : bvh(b), capsules(c), clearance(clr) {}
+};
+
+// Teste exato de um par de posições (ordem das folhas)
+static void testCapsules(const CollisionContext& ctx, int i, int j, CollisionChunk& out) {
+    if (!boxesOverlap(&ctx.bvh.segment_boxes[6 * i], &ctx.bvh.segment_boxes[6 * j])) return;
+    const Capsule& ci = ctx.capsules[i];
+    const Capsule& cj = ctx.capsules[j];
+    if (shareEndpoint(ci, cj)) {
+        out.adjacent++;
+        return;
+    }
+    out.candidates++;
+    float gap = segmentDistance(ci.p0, ci.p1, cj.p0, cj.p1) - ci.radius - cj.radius;
+    if (gap < ctx.clearance) {
+        int s = ctx.bvh.segment_ids[i], t = ctx.bvh.segment_ids[j];
+        CollisionPair pair;
+        pair.a = std::min(s, t);
+        pair.b = std::max(s, t);
+        pair.gap = gap;
+        pair.path_segments = path_index.valid ? queryPath(s, t).segments : 0;
+        out.pairs.push_back(pair);
+    }
+}
+
+// Um passo da travessia dupla: folhas são testadas aqui, o resto vira
+// subtarefas (uma subárvore consigo mesma = as duas metades e o par entre
+// elas; um par de subárvores = o maior dividido ao meio)
+static void splitTask(const CollisionContext& ctx, const CollisionTask& task, std::vector<CollisionTask>& next,
+                      CollisionChunk& out) {
+    const BVHNode& na = ctx.bvh.nodes[task.a];
+    const BVHNode& nb = ctx.bvh.nodes[task.b];
+    if (task.a == task.b) {
+        if (na.isLeaf()) {
+            for (int i = na.first; i < na.first + na.count; i++) {
+                for (int j = i + 1; j < na.first + na.count; j++) testCapsules(ctx, i, j, out);
+            }
+            return;
+        }
+        CollisionTask left = {na.left, na.left}, right = {na.right, na.right}, cross = {na.left, na.right};
+        next.push_back(left);
+        next.push_back(right);
+        next.push_back(cross);
+        return;
+    }
+    if (!nodesOverlap(na, nb)) return;
+    if (na.isLeaf() && nb.isLeaf()) {
+        for (int i = na.first; i < na.first + na.count; i++) {
+            for (int j = nb.first; j < nb.first + nb.count; j++) testCapsules(ctx, i, j, out);
+        }
+        return;
+    }
+    bool split_a = !na.isLeaf() && (nb.isLeaf() || na.count >= nb.count);
+    const BVHNode& split = split_a ? na : nb;
+    int other = split_a ? task.b : task.a;
+    CollisionTask first = {split.left, other}, second = {split.right, other};
+    next.push_back(first);
+    next.push_back(second);
+}
+
+void checkCollisions(int radius_source, float radius_scale, float clearance, CollisionReport& report) {
+    auto start = std::chrono::steady_clock::now();
+    report = CollisionReport();
+    report.radius_source = radius_source;
+    report.radius_scale = radius_scale;
+    report.clearance = clearance;
+    size_t n = lines.size();
+    report.segment_class.assign(n, COLLISION_CLEAR);
+    if (n == 0) {
+        report.valid = true;
+        return;
+    }
+
+    std::vector<float> capsule_radii(n);
+    for (size_t s = 0; s < n; s++) {
+        capsule_radii[s] = (radius_source == COLLISION_FILE) ? radii[s] * radius_scale : getDisplayRadius(s);
+    }
+
+    // Caixas aumentadas pela metade da folga: duas cápsulas a menos de
+    // `clearance` uma da outra sempre têm caixas que se tocam
+    SegmentBVH bvh;
+    buildCapsuleBVH(bvh, capsule_radii, 0.5f * clearance);
+    std::vector<Capsule> capsules(n);
+    for (size_t i = 0; i < n; i++) {
+        int s = bvh.segment_ids[i];
+        capsules[i].i0 = lines[s].p0;
+        capsules[i].i1 = lines[s].p1;
+        capsules[i].p0 = points[lines[s].p0];
+        capsules[i].p1 = points[lines[s].p1];
+        capsules[i].radius = capsule_radii[s];
+    }
+    auto bvh_end = std::chrono::steady_clock::now();
+    report.bvh_ms = std::chrono::duration<double, std::milli>(bvh_end - start).count();
+
+    // Travessia dupla da BVH consigo mesma: cada par de cápsulas próximas
+    // é visitado uma vez. Os primeiros níveis são expandidos em sequência
+    // até haver tarefas para todas as threads; cada tarefa termina a sua
+    // parte da travessia sozinha.
+    CollisionContext ctx(bvh, capsules, clearance);
+    CollisionChunk top;
+    std::vector<CollisionTask> tasks(1), next;
+    tasks[0].a = tasks[0].b = 0;
+    size_t wanted = 64 * (size_t)parallelThreadCount();
+    for (int round = 0; round < COLLISION_SPLIT_ROUNDS && !tasks.empty() && tasks.size() < wanted; round++) {
+        next.clear();
+        for (const CollisionTask& task : tasks) splitTask(ctx, task, next, top);
+        tasks.swap(next);
+    }
+
+    std::vector<CollisionChunk> results(tasks.size());
+    parallelFor(tasks.size(), 1, [&](size_t first, size_t last) {
+        std::vector<CollisionTask> stack, children;
+        for (size_t k = first; k < last; k++) {
+            stack.assign(1, tasks[k]);
+            while (!stack.empty()) {
+                CollisionTask task = stack.back();
+                stack.pop_back();
+                children.clear();
+                splitTask(ctx, task, children, results[k]);
+                stack.insert(stack.end(), children.begin(), children.end());
+            }
+        }
+    });
+    results.push_back(top);
+
+    for (const CollisionChunk& c : results) {
+        report.candidates += c.candidates;
+        report.adjacent_skipped += c.adjacent;
+        report.pairs.insert(report.pairs.end(), c.pairs.begin(), c.pairs.end());
+    }
+    std::sort(report.pairs.begin(), report.pairs.end(), [](const CollisionPair& x, const CollisionPair& y) {
+        if (x.gap != y.gap) return x.gap < y.gap;
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+    for (const CollisionPair& p : report.pairs) {
+        unsigned char c = (p.gap < 0.0f) ? COLLISION_OVERLAP : COLLISION_CLEARANCE;
+        if (c == COLLISION_OVERLAP) report.overlaps++;
+        else report.clearance_violations++;
+        if (p.path_segments == 3) report.junction_pairs++;
+        report.segment_class[p.a] = std::max(report.segment_class[p.a], c);
+        report.segment_class[p.b] = std::max(report.segment_class[p.b], c);
+    }
+
+    report.valid = true;
+    report.check_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bvh_end).count();
+}
+
+void invalidateCollisions() {
+    collision_report.valid = false;
+}
+
+const char* collisionRadiusName(int radius_source) {
+    switch (radius_source) {
+        case COLLISION_DISPLAY: return "raio de exibição";
+        case COLLISION_FILE:    return "raio do arquivo";
+        default:                return "desligada";
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * collision.h
+ * Verificação de interseções e folga mínima entre os vasos - TP2 (3D)
+ */
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <vector>
+#include <cstddef>
+
+// Raio das cápsulas testadas
+enum CollisionRadius {
+    COLLISION_OFF = 0,      // Sem verificação nas cores (tecla X)
+    COLLISION_DISPLAY,      // Raio de exibição atual (o que aparece na tela)
+    COLLISION_FILE,         // Raio do arquivo, nas unidades das coordenadas
+    COLLISION_MODES
+};
+
+// Classe de cada segmento no resultado
+enum CollisionClass {
+    COLLISION_CLEAR = 0,    // Sem violação
+    COLLISION_CLEARANCE,    // Folga menor que a mínima, sem sobreposição
+    COLLISION_OVERLAP       // Cápsulas se sobrepõem
+};
+
+// Par de segmentos em violação (a < b); gap = distância entre os eixos
+// menos a soma dos raios (negativo = sobreposição)
+struct CollisionPair {
+    int a;
+    int b;
+    float gap;
+    int path_segments;  // Segmentos no caminho de a até b pela árvore (0 = árvores diferentes)
+};
+
+struct CollisionReport {
+    bool valid;
+    int radius_source;                    // CollisionRadius
+    float radius_scale;                   // Fator sobre o raio do arquivo (unidades)
+    float clearance;                      // Folga mínima exigida
+    std::vector<CollisionPair> pairs;     // Ordenados do pior gap para o melhor
+    std::vector<unsigned char> segment_class;  // CollisionClass de cada segmento
+    size_t overlaps;                      // Pares sobrepostos
+    size_t clearance_violations;          // Pares só abaixo da folga
+    size_t candidates;                    // Pares testados (caixas se tocam)
+    size_t adjacent_skipped;              // Pares com ponto em comum (pai/filho, irmãos)
+    size_t junction_pairs;                // Violações entre vizinhos de um segmento curto (caminho de 3)
+    double bvh_ms;
+    double check_ms;
+
+    CollisionReport() : valid(false), radius_source(COLLISION_DISPLAY), radius_scale(1.0f), clearance(0.0f), overlaps(0),
+                        clearance_violations(0), candidates(0), adjacent_skipped(0), junction_pairs(0),
+                        bvh_ms(0.0), check_ms(0.0) {}
+};
+
+extern CollisionReport collision_report;
+extern int collision_view;  // CollisionRadius das cores (tecla X)
+
+// Testa todos os pares de cápsulas próximas sem o custo O(n²): travessia
+// dupla da BVH das cápsulas consigo mesma (caixas aumentadas pela metade da
+// folga), dividida em tarefas paralelas, e o teste exato entre os eixos.
+// Pares que compartilham um ponto (pai/filho e irmãos na bifurcação) se
+// tocam por construção e ficam de fora; o caminho de cada violação pela
+// árvore vem do índice de caminhos (O(1)) e separa as junções com um
+// segmento mais curto que os raios (caminho de 3 segmentos) das interseções
+// entre ramos distantes. radius_scale converte o raio do arquivo para as
+// unidades das coordenadas (COLLISION_FILE).
+void checkCollisions(int radius_source, float radius_scale, float clearance, CollisionReport& report);
+
+// Chamada quando pontos, raios ou o raio de exibição mudam
+void invalidateCollisions();
+
+const char* collisionRadiusName(int radius_source);
+
+#endif // COLLISION_H
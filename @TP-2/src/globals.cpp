@@ -18,6 +18,11 @@ std::vector<Point3D> points;
 std::vector<Line3D> lines;
 std::vector<float> radii;
 
+// Estatísticas dos raios
+float radius_min = 0.0f;
+float radius_max = 0.0f;
+std::vector<int> segments_by_radius;
+
 // Câmera
 Camera camera;
 
@@ -35,6 +40,7 @@ bool lighting_enabled = true;
 // Transparência
 bool transparency_enabled = false;
 float transparency_alpha = 0.7f;
+int transparency_method = 0;  // 0=Blending, 1=OIT
 
 // Visualização incremental
 std::vector<std::string> growth_files;
@@ -52,7 +58,9 @@ float animation_timer = 0.0f;
 
 // Seleção
 int selected_segment = -1;
+int path_target_segment = -1;
 bool show_segment_info = false;
+int subtree_view_mode = SUBTREE_ALL;
 
 // Dimensões da janela
 int window_width = 800;
@@ -61,6 +69,13 @@ int window_height = 600;
 // Qualidade dos cilindros
 int cylinder_quality = 16;  // 16 lados para cilindros suaves (balance entre qualidade e performance)
 
+// Renderização progressiva
+bool interaction_active = false;
+int refine_count = 0x7fffffff;  // Qualidade total até a primeira interação
+
+// Invalidação seletiva
+unsigned int dirty_flags = DIRTY_GEOMETRY | DIRTY_HUD;
+
 // Escala dos dados
 float data_scale = 1.0f;  // Será calculada ao carregar o arquivo
 
@@ -9,6 +9,7 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cstdint>
 
 // ============================================================
 // ESTRUTURAS DE DADOS
@@ -44,10 +45,11 @@ struct Point3D {
     }
 };
 
+// Segmento: só os índices dos pontos (8 bytes). O raio fica na coluna
+// `radii`, na mesma ordem de `lines`.
 struct Line3D {
-    int p0, p1;  // índices dos pontos
-    float radius;
-    Line3D(int p0, int p1, float r = 0.5f) : p0(p0), p1(p1), radius(r) {}
+    uint32_t p0, p1;  // índices dos pontos
+    Line3D(uint32_t p0, uint32_t p1) : p0(p0), p1(p1) {}
 };
 
 // Estrutura para câmera
@@ -58,9 +60,12 @@ struct Camera {
     Point3D center;      // Centro de rotação
     Point3D eye;         // Posição do observador
     Point3D up;          // Vetor up
+    float fovy;          // Campo de visão vertical (graus)
+    float znear;         // Plano near
+    float zfar;          // Plano far
     
     Camera() : distance(10.0f), azimuth(45.0f), elevation(30.0f), 
-               center(0, 0, 0), up(0, 1, 0) {
+               center(0, 0, 0), up(0, 1, 0), fovy(45.0f), znear(0.1f), zfar(1000.0f) {
         updateEye();
     }
     
@@ -95,7 +100,12 @@ struct Light {
 
 extern std::vector<Point3D> points;      // Pontos da árvore
 extern std::vector<Line3D> lines;        // Segmentos da árvore
-extern std::vector<float> radii;         // Raios dos segmentos
+extern std::vector<float> radii;         // Raio de cada segmento (radii[i] é o de lines[i])
+
+// Estatísticas dos raios (calculadas ao carregar o arquivo)
+extern float radius_min;
+extern float radius_max;
+extern std::vector<int> segments_by_radius;  // Segmentos em ordem decrescente de raio
 
 // Câmera
 extern Camera camera;
@@ -114,6 +124,7 @@ extern bool lighting_enabled;
 // Transparência
 extern bool transparency_enabled;
 extern float transparency_alpha;
+extern int transparency_method;  // 0=Blending, 1=OIT (weighted blended)
 
 // Visualização incremental - arquivos parciais
 extern std::vector<std::string> growth_files;
@@ -132,6 +143,17 @@ extern float animation_timer;
 // Seleção de segmento
 extern int selected_segment;
 extern bool show_segment_info;
+extern int path_target_segment;  // Segundo segmento (Shift+clique): caminho até selected_segment
+
+// Exibição da subárvore do segmento selecionado (intervalo contíguo no
+// layout em profundidade, ver topology.h)
+enum SubtreeViewMode {
+    SUBTREE_ALL = 0,    // Árvore inteira
+    SUBTREE_ISOLATE,    // Só a subárvore
+    SUBTREE_HIDE,       // Árvore sem a subárvore
+    SUBTREE_HIGHLIGHT   // Árvore inteira com a subárvore destacada
+};
+extern int subtree_view_mode;
 
 // Dimensões da janela
 extern int window_width;
@@ -140,6 +162,20 @@ extern int window_height;
 // Qualidade da renderização de cilindros
 extern int cylinder_quality;  // Número de lados do cilindro
 
+// Renderização progressiva durante a interação
+extern bool interaction_active;  // Entrada do usuário em andamento (arrasto/zoom)
+extern int refine_count;         // Segmentos (em ordem de raio) já em qualidade total
+
+// Invalidação seletiva do estado retido (ver requestRedraw em interface.h)
+enum DirtyFlags {
+    DIRTY_CAMERA   = 1 << 0,  // Olho/projeção: especular, peso do OIT, culling
+    DIRTY_LIGHTING = 1 << 1,  // Modo de iluminação/transparência: cores dos vértices
+    DIRTY_GEOMETRY = 1 << 2,  // Dados ou raio de exibição: malhas dos tubos
+    DIRTY_HUD      = 1 << 3,  // Apenas o texto da tela
+    DIRTY_RADII    = 1 << 4   // Só os raios mudaram (mesma topologia): posições e cores
+};
+extern unsigned int dirty_flags;
+
 // Escala dos dados (calculada uma vez ao carregar)
 extern float data_scale;  // Escala máxima dos dados (para normalização visual)
 
@@ -0,0 +1,305 @@
+/*
+ * growth_diff.cpp
+ * Diferença entre dois passos de crescimento (junção por hash) - TP2 (3D)
+ */
+
+#include "growth_diff.h"
+#include "globals.h"
+#include "utils.h"
+#include "topology.h"
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+GrowthDiff growth_diff;
+bool diff_view_enabled = false;
+
+// Bits por eixo das chaves dos pontos (63 bits no total)
+static const int DIFF_KEY_BITS = 21;
+
+// Diferença relativa a partir da qual o raio conta como alterado
+// (os arquivos CCO têm 7 casas decimais)
+static const float RADIUS_TOLERANCE = 1e-5f;
+
+// ============================================================
+// CHAVES DOS PONTOS
+// ============================================================
+
+// Grade comum aos dois passos: o mesmo ponto nos dois arquivos cai no mesmo
+// nó da grade, mesmo com índices diferentes
+struct KeyGrid {
+    float origin[3];
+    float inv_cell[3];
+};
+
+static void makeKeyGrid(const std::vector<Point3D>& a, const std::vector<Point3D>& b, KeyGrid& grid) {
+    float bmin[3] = {1e30f, 1e30f, 1e30f};
+    float bmax[3] = {-1e30f, -1e30f, -1e30f};
+    for (const std::vector<Point3D>* set : {&a, &b}) {
+        for (const Point3D& p : *set) {
+            bmin[0] = std::min(bmin[0], p.x); bmax[0] = std::max(bmax[0], p.x);
+            bmin[1] = std::min(bmin[1], p.y); bmax[1] = std::max(bmax[1], p.y);
+            bmin[2] = std::min(bmin[2], p.z); bmax[2] = std::max(bmax[2], p.z);
+        }
+    }
+    const float levels = (float)((1u << DIFF_KEY_BITS) - 1);
+    for (int k = 0; k < 3; k++) {
+        float extent = std::max(bmax[k] - bmin[k], 1e-6f);
+        grid.origin[k] = bmin[k];
+        grid.inv_cell[k] = levels / extent;
+    }
+}
+
+// Nó da grade mais próximo, com os três eixos empacotados em 63 bits
+static uint64_t pointKey(const Point3D& p, const KeyGrid& grid) {
+    const float levels = (float)((1u << DIFF_KEY_BITS) - 1);
+    float c[3] = {p.x, p.y, p.z};
+    uint64_t key = 0;
+    for (int k = 0; k < 3; k++) {
+        float t = (c[k] - grid.origin[k]) * grid.inv_cell[k] + 0.5f;
+        t = std::min(levels, std::max(0.0f, t));
+        key |= (uint64_t)t << (DIFF_KEY_BITS * k);
+    }
+    return key;
+}
+
+// ============================================================
+// JUNÇÃO E CLASSIFICAÇÃO
+// ============================================================
+
+// Segmento atual que liga os pontos a e b (busca no CSR de a), ou -1
+static int findSegment(int a, int b) {
+    for (int k = topology.node_offsets[a]; k < topology.node_offsets[a + 1]; k++) {
+        int s = topology.node_segments[k];
+        int other = ((int)lines[s].p0 == a) ? (int)lines[s].p1 : (int)lines[s].p0;
+        if (other == b) return s;
+    }
+    return -1;
+}
+
+// Um segmento do passo base que sumiu foi dividido se, no passo atual, o
+// caminho que sobe de `distal` até `proximal` só passa por pontos novos:
+// os segmentos desse caminho são os pedaços. Com `placed` (estado inicial da
+// transição), os pedaços herdam o raio do segmento original e os pontos
+// internos do caminho partem da projeção na reta entre as extremidades.
+static bool markSplitChain(int distal, int proximal, const std::vector<int>& arriving,
+                           const std::vector<unsigned char>& is_base_point,
+                           float piece_radius, std::vector<unsigned char>* placed) {
+    int s = arriving[distal];
+    size_t length = 0;
+    for (int t = s; t >= 0 && length <= lines.size(); t = topology.parent[t], length++) {
+        int p = topology.proximal_node[t];
+        if (p == proximal) {
+            const Point3D& a = points[proximal];
+            Point3D ab = points[distal] - a;
+            float inv_len2 = 1.0f / std::max(dotProduct(ab, ab), 1e-12f);
+            for (int u = s; ; u = topology.parent[u]) {
+                if (growth_diff.change[u] == CHANGE_NEW) growth_diff.change[u] = CHANGE_SPLIT;
+                if (placed) {
+                    growth_diff.start_radii[u] = piece_radius;
+                    int q = topology.proximal_node[u];
+                    if (u != t && !(*placed)[q]) {
+                        float k = std::min(1.0f, std::max(0.0f, dotProduct(points[q] - a, ab) * inv_len2));
+                        growth_diff.start_points[q] = a + ab * k;
+                        (*placed)[q] = 1;
+                    }
+                }
+                if (u == t) break;
+            }
+            return true;
+        }
+        if (is_base_point[p]) return false;
+    }
+    return false;
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool computeGrowthDiff(const std::string& base_file) {
+    invalidateGrowthDiff();
+    if (lines.empty() || topology.node_offsets.size() != points.size() + 1) {
+        std::cerr << "Erro: nenhum passo carregado para comparar" << std::endl;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Point3D> base_points;
+    std::vector<Line3D> base_lines;
+    std::vector<float> base_radii;
+    if (!parseVTKFile3D(base_file, base_points, base_lines, base_radii)) {
+        return false;
+    }
+    double parse_ms = elapsedMs(start);
+
+    if (!computeGrowthDiffFrom(base_points, base_lines, base_radii, nullptr, base_file)) {
+        return false;
+    }
+    growth_diff.parse_ms = parse_ms;
+    return true;
+}
+
+bool computeGrowthDiffFrom(const std::vector<Point3D>& base_points, const std::vector<Line3D>& base_lines,
+                           const std::vector<float>& base_radii, const std::vector<float>* base_display_radii,
+                           const std::string& label) {
+    invalidateGrowthDiff();
+    if (lines.empty() || topology.node_offsets.size() != points.size() + 1) {
+        std::cerr << "Erro: nenhum passo carregado para comparar" << std::endl;
+        return false;
+    }
+    if (base_radii.size() != base_lines.size() ||
+        (base_display_radii && base_display_radii->size() != base_lines.size())) {
+        std::cerr << "Erro: raios do passo base inconsistentes" << std::endl;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    KeyGrid grid;
+    makeKeyGrid(points, base_points, grid);
+
+    // Tabela hash: chave quantizada -> ponto atual; cada ponto do passo base
+    // é procurado uma vez
+    std::unordered_map<uint64_t, int> current_by_key;
+    current_by_key.reserve(points.size());
+    for (size_t i = 0; i < points.size(); i++) {
+        current_by_key.insert(std::make_pair(pointKey(points[i], grid), (int)i));
+    }
+    std::vector<int> base_to_current(base_points.size(), -1);
+    std::vector<unsigned char> is_base_point(points.size(), 0);
+    for (size_t i = 0; i < base_points.size(); i++) {
+        auto it = current_by_key.find(pointKey(base_points[i], grid));
+        if (it != current_by_key.end()) {
+            base_to_current[i] = it->second;
+            is_base_point[it->second] = 1;
+        }
+    }
+
+    // Estado inicial: pontos do passo base ficam onde estavam
+    size_t n = lines.size();
+    bool with_start = (base_display_radii != nullptr);
+    std::vector<unsigned char> placed;
+    if (with_start) {
+        growth_diff.start_points = points;
+        growth_diff.start_radii.assign(n, 0.0f);
+        placed = is_base_point;
+    } else {
+        growth_diff.start_points.clear();
+        growth_diff.start_radii.clear();
+    }
+
+    // Segmentos do passo base com as duas extremidades presentes e ligadas
+    // no passo atual: iguais ou com raio alterado
+    growth_diff.change.assign(n, CHANGE_NEW);
+    std::vector<int> removed;
+    for (size_t b = 0; b < base_lines.size(); b++) {
+        int ca = (base_lines[b].p0 < base_points.size()) ? base_to_current[base_lines[b].p0] : -1;
+        int cb = (base_lines[b].p1 < base_points.size()) ? base_to_current[base_lines[b].p1] : -1;
+        int s = (ca >= 0 && cb >= 0) ? findSegment(ca, cb) : -1;
+        if (s < 0 || growth_diff.change[s] != CHANGE_NEW) {
+            removed.push_back((int)b);
+            continue;
+        }
+        float r0 = base_radii[b], r1 = radii[s];
+        bool same = fabsf(r1 - r0) <= RADIUS_TOLERANCE * std::max(fabsf(r0), fabsf(r1));
+        growth_diff.change[s] = same ? CHANGE_UNCHANGED : CHANGE_RESIZED;
+        if (with_start) growth_diff.start_radii[s] = (*base_display_radii)[b];
+    }
+
+    // Segmentos que sumiram: procura os pedaços entre as mesmas extremidades
+    std::vector<int> arriving(points.size(), -1);
+    for (size_t s = 0; s < n; s++) {
+        arriving[topology.distal_node[s]] = (int)s;
+    }
+    size_t split_sources = 0;
+    for (int b : removed) {
+        int ca = (base_lines[b].p0 < base_points.size()) ? base_to_current[base_lines[b].p0] : -1;
+        int cb = (base_lines[b].p1 < base_points.size()) ? base_to_current[base_lines[b].p1] : -1;
+        if (ca < 0 || cb < 0) continue;
+        float piece_radius = with_start ? (*base_display_radii)[b] : 0.0f;
+        std::vector<unsigned char>* chain_placed = with_start ? &placed : nullptr;
+        if (markSplitChain(cb, ca, arriving, is_base_point, piece_radius, chain_placed) ||
+            markSplitChain(ca, cb, arriving, is_base_point, piece_radius, chain_placed)) {
+            split_sources++;
+        }
+    }
+
+    // Pontos ainda sem posição inicial são de ramos novos: brotam do ponto
+    // proximal, já posicionado (generation_order visita o pai antes do filho)
+    if (with_start && topology.generation_order.size() == n) {
+        for (int s : topology.generation_order) {
+            int p = topology.proximal_node[s];
+            int d = topology.distal_node[s];
+            placed[p] = 1;
+            if (placed[d]) continue;
+            growth_diff.start_points[d] = growth_diff.start_points[p];
+            placed[d] = 1;
+        }
+    }
+
+    std::fill(growth_diff.counts, growth_diff.counts + CHANGE_CLASSES, 0);
+    for (unsigned char c : growth_diff.change) {
+        growth_diff.counts[c]++;
+    }
+    growth_diff.base_segments = base_lines.size();
+    growth_diff.removed = removed.size();
+    growth_diff.base_file = label;
+    growth_diff.parse_ms = 0.0;
+    growth_diff.join_ms = elapsedMs(start);
+    growth_diff.valid = true;
+
+    std::cout << "Diferença para " << (label.empty() ? std::string("árvore vazia") : getFilename(label)) << ": "
+              << growth_diff.counts[CHANGE_UNCHANGED] << " iguais, "
+              << growth_diff.counts[CHANGE_RESIZED] << " com raio alterado, "
+              << growth_diff.counts[CHANGE_SPLIT] << " divididos (de " << split_sources << "), "
+              << growth_diff.counts[CHANGE_NEW] << " novos; "
+              << growth_diff.removed << " segmentos do passo base sem par" << std::endl;
+    return true;
+}
+
+bool computeGrowthDiffWithPrevious() {
+    if (current_growth_index > 0 && current_growth_index < (int)growth_files.size()) {
+        return computeGrowthDiff(growth_files[current_growth_index - 1]);
+    }
+
+    // Primeiro passo (ou arquivo sem série): comparado com a árvore vazia
+    growth_diff.change.assign(lines.size(), CHANGE_NEW);
+    std::fill(growth_diff.counts, growth_diff.counts + CHANGE_CLASSES, 0);
+    growth_diff.counts[CHANGE_NEW] = lines.size();
+    growth_diff.base_segments = 0;
+    growth_diff.removed = 0;
+    growth_diff.base_file.clear();
+    growth_diff.start_points.clear();
+    growth_diff.start_radii.clear();
+    growth_diff.parse_ms = growth_diff.join_ms = 0.0;
+    growth_diff.valid = true;
+    return true;
+}
+
+void invalidateGrowthDiff() {
+    growth_diff.valid = false;
+}
+
+// ============================================================
+// NOMES E CORES
+// ============================================================
+
+const char* changeClassName(int change) {
+    switch (change) {
+        case CHANGE_UNCHANGED: return "iguais";
+        case CHANGE_RESIZED: return "raio alterado";
+        case CHANGE_SPLIT: return "divididos";
+        default: return "novos";
+    }
+}
+
+void getChangeClassColor(int change, float& r, float& g, float& b) {
+    switch (change) {
+        case CHANGE_UNCHANGED: r = 0.55f; g = 0.55f; b = 0.55f; break;  // Cinza
+        case CHANGE_RESIZED:   r = 1.0f;  g = 0.75f; b = 0.1f;  break;  // Amarelo
+        case CHANGE_SPLIT:     r = 0.2f;  g = 0.5f;  b = 1.0f;  break;  // Azul
+        default:               r = 1.0f;  g = 0.15f; b = 0.15f; break;  // Vermelho
+    }
+}
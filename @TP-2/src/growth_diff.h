@@ -0,0 +1,71 @@
+/*
+ * growth_diff.h
+ * Diferença entre dois passos de crescimento (junção por hash) - TP2 (3D)
+ */
+
+#ifndef GROWTH_DIFF_H
+#define GROWTH_DIFF_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "globals.h"
+
+// Classe de cada segmento do passo atual em relação ao passo base
+enum SegmentChange {
+    CHANGE_UNCHANGED = 0,  // Mesmas extremidades e mesmo raio
+    CHANGE_RESIZED   = 1,  // Mesmas extremidades, raio diferente
+    CHANGE_SPLIT     = 2,  // Pedaço de um segmento do passo base dividido por bifurcações novas
+    CHANGE_NEW       = 3,  // Sem correspondente no passo base
+    CHANGE_CLASSES   = 4
+};
+
+struct GrowthDiff {
+    bool valid;
+    std::string base_file;
+    std::vector<unsigned char> change;  // SegmentChange de cada segmento de `lines`
+    size_t counts[CHANGE_CLASSES];
+    size_t base_segments;
+    size_t removed;                     // Segmentos do passo base sem par no atual
+    double parse_ms;                    // Leitura do passo base
+    double join_ms;                     // Chaves, junção e classificação
+
+    // Estado inicial da transição animada (só com raios de exibição do passo
+    // base, ver computeGrowthDiffFrom): onde cada ponto e cada segmento atual
+    // estavam no passo base
+    std::vector<Point3D> start_points;  // Um por ponto de `points`
+    std::vector<float> start_radii;     // Raio de exibição por segmento (0 = novo)
+
+    GrowthDiff() : valid(false), counts(), base_segments(0), removed(0), parse_ms(0.0), join_ms(0.0) {}
+};
+
+extern GrowthDiff growth_diff;
+extern bool diff_view_enabled;  // Cores por classe de mudança (tecla G)
+
+// Compara `lines`/`radii` (passo carregado) com o arquivo base. As
+// extremidades dos dois passos viram chaves quantizadas na caixa envolvente
+// comum e os segmentos são casados por uma tabela hash, em O(n).
+bool computeGrowthDiff(const std::string& base_file);
+
+// Mesmo, com o passo base já em memória (a animação guarda uma cópia do
+// passo anterior em vez de reler o arquivo). Com base_display_radii (raio de
+// exibição de cada segmento base, como foi desenhado) também calcula
+// start_points/start_radii: segmentos casados partem da forma antiga, pedaços
+// de uma divisão partem da reta do segmento original e segmentos novos
+// brotam do ponto de bifurcação com raio zero. `label` identifica a base nas
+// mensagens (vazio = árvore vazia).
+bool computeGrowthDiffFrom(const std::vector<Point3D>& base_points, const std::vector<Line3D>& base_lines,
+                           const std::vector<float>& base_radii, const std::vector<float>* base_display_radii,
+                           const std::string& label);
+
+// Mesmo, usando o passo anterior da série (growth_files); no primeiro passo
+// todos os segmentos são novos
+bool computeGrowthDiffWithPrevious();
+
+// Chamada a cada carga: a diferença vale só para os dados atuais
+void invalidateGrowthDiff();
+
+const char* changeClassName(int change);
+void getChangeClassColor(int change, float& r, float& g, float& b);
+
+#endif // GROWTH_DIFF_H
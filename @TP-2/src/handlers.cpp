@@ -13,15 +13,66 @@
 #include "globals.h"
 #include "interface.h"
 #include "utils.h"
+#include "occlusion.h"
+#include "bvh.h"
+#include "topology.h"
+#include "spatial_order.h"
+#include "growth_diff.h"
+#include "morphometry.h"
+#include "tree_paths.h"
+#include "collision.h"
+#include "territories.h"
+#include "voxelizer.h"
+#include "ambient_occlusion.h"
+#include "shadow_map.h"
+#include "range_filter.h"
 #include <iostream>
 #include <algorithm>
 #include <cstdlib>
+#include <cmath>
+
+// Raio que sai do olho passando pelo pixel (x, y) da janela
+static int pickSegmentAt(int x, int y) {
+    Point3D f = camera.center - camera.eye;
+    f.normalize();
+    Point3D side = crossProduct(f, camera.up);
+    side.normalize();
+    Point3D up = crossProduct(side, f);
+    
+    float aspect = (float)window_width / (float)std::max(1, window_height);
+    float tan_half = tanf(camera.fovy * 0.5f * 3.14159265358979323846f / 180.0f);
+    float nx = 2.0f * (x + 0.5f) / std::max(1, window_width) - 1.0f;
+    float ny = 1.0f - 2.0f * (y + 0.5f) / std::max(1, window_height);
+    
+    Point3D dir = f + side * (nx * tan_half * aspect) + up * (ny * tan_half);
+    dir.normalize();
+    return raycastSegments(camera.eye, dir);
+}
+
+static const char* subtreeModeName(int mode) {
+    switch (mode) {
+        case SUBTREE_ISOLATE: return "isolada";
+        case SUBTREE_HIDE: return "oculta";
+        case SUBTREE_HIGHLIGHT: return "destacada";
+        default: return "normal";
+    }
+}
 
 // Variáveis para controle do mouse
 static int last_mouse_x = 0;
 static int last_mouse_y = 0;
 static bool mouse_left_pressed = false;
 
+static int press_mouse_x = 0;
+static int press_mouse_y = 0;
+
+// Limite do filtro arrastado com Ctrl (0 = inferior, 1 = superior, -1 = nenhum)
+static int filter_drag_bound = -1;
+
+// Movimento acumulado entre quadros (vários eventos = um único redesenho)
+static int pending_dx = 0;
+static int pending_dy = 0;
+
 void keyboard(unsigned char key, int, int) {
     float step = 5.0f;
     
@@ -35,6 +86,8 @@ void keyboard(unsigned char key, int, int) {
             std::cout << ">>> W pressionado - Distância ANTES: " << camera.distance << std::endl;
             camera.distance = std::max(0.05f, camera.distance * 0.9f);  // Reduzir 10%
             camera.updateEye();
+            notifyInteraction();
+            requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
             std::cout << ">>> W pressionado - Distância DEPOIS: " << camera.distance << std::endl;
             break;
         case 's':
@@ -43,6 +96,8 @@ void keyboard(unsigned char key, int, int) {
             std::cout << ">>> S pressionado - Distância ANTES: " << camera.distance << std::endl;
             camera.distance *= 1.1f;  // Aumentar 10%
             camera.updateEye();
+            notifyInteraction();
+            requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
             std::cout << ">>> S pressionado - Distância DEPOIS: " << camera.distance << std::endl;
             break;
         case 'q':
@@ -50,43 +105,68 @@ void keyboard(unsigned char key, int, int) {
             // Rotação horizontal (azimuth) -
             camera.azimuth -= step;
             camera.updateEye();
+            notifyInteraction();
+            requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
             break;
         case 'e':
         case 'E':
             // Rotação horizontal (azimuth) +
             camera.azimuth += step;
             camera.updateEye();
+            notifyInteraction();
+            requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
             break;
         case 'a':
         case 'A':
             // Rotação vertical (elevation) -
             camera.elevation = std::max(-89.0f, camera.elevation - step);
             camera.updateEye();
+            notifyInteraction();
+            requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
             break;
         case 'd':
         case 'D':
             // Rotação vertical (elevation) +
             camera.elevation = std::min(89.0f, camera.elevation + step);
             camera.updateEye();
+            notifyInteraction();
+            requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
             break;
         case 'i':
         case 'I':
             // Alternar modo de iluminação (Flat/Phong)
             lighting_mode = (lighting_mode + 1) % 2;
             std::cout << "Modo de iluminação: " << (lighting_mode == 0 ? "Flat" : "Phong") << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
             break;
         case 'l':
         case 'L':
             // Toggle iluminação
             lighting_enabled = !lighting_enabled;
             std::cout << "Iluminação: " << (lighting_enabled ? "ON" : "OFF") << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
             break;
         case 't':
         case 'T':
             // Toggle transparência
             transparency_enabled = !transparency_enabled;
             std::cout << ">>> T pressionado - Transparência: " << (transparency_enabled ? "ON" : "OFF") << std::endl;
-            glutPostRedisplay();
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
+        case 'o':
+        case 'O':
+            // Alternar método de transparência (Blending/OIT)
+            transparency_method = (transparency_method + 1) % 2;
+            std::cout << "Método de transparência: " << (transparency_method == 0 ? "Blending" : "OIT (weighted blended)") << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
+        case 'c':
+        case 'C':
+            // Toggle culling por oclusão
+            occlusion_culling_enabled = !occlusion_culling_enabled;
+            resetOcclusionProbe();
+            std::cout << "Culling por oclusão: " << (occlusion_culling_enabled ? "ON" : "OFF") << std::endl;
+            requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
             break;
         case '[':
             // Arquivo anterior de crescimento
@@ -102,6 +182,7 @@ void keyboard(unsigned char key, int, int) {
                     std::cout << "Arquivo anterior: " << (current_growth_index + 1) << "/" << growth_files.size() << std::endl;
                     // Garantir que estamos mostrando todos os segmentos do novo arquivo
                     n_segments_draw = max_segments;
+                    requestRedraw(DIRTY_HUD);  // A carga já marcou geometria ou raios
                 } else {
                     std::cerr << "Erro ao carregar arquivo de crescimento" << std::endl;
                     growth_mode = prev_growth_mode;
@@ -124,6 +205,7 @@ void keyboard(unsigned char key, int, int) {
                     std::cout << "Próximo arquivo: " << (current_growth_index + 1) << "/" << growth_files.size() << std::endl;
                     // Garantir que estamos mostrando todos os segmentos do novo arquivo
                     n_segments_draw = max_segments;
+                    requestRedraw(DIRTY_HUD);  // A carga já marcou geometria ou raios
                 } else {
                     std::cerr << "Erro ao carregar arquivo de crescimento" << std::endl;
                     growth_mode = prev_growth_mode;
@@ -132,6 +214,114 @@ void keyboard(unsigned char key, int, int) {
                 std::cout << "Nenhum arquivo de crescimento disponível" << std::endl;
             }
             break;
+        case 'v':
+        case 'V':
+            // Alternar exibição da subárvore selecionada (normal/isolada/oculta/destacada)
+            subtree_view_mode = (subtree_view_mode + 1) % 4;
+            std::cout << "Subárvore: " << subtreeModeName(subtree_view_mode) << std::endl;
+            if (selected_segment < 0) {
+                std::cout << "    (clique em um segmento para selecioná-lo)" << std::endl;
+            }
+            requestRedraw(DIRTY_HUD);
+            break;
+        case 'p':
+        case 'P':
+            // Selecionar o segmento pai (sobe na árvore)
+            if (selected_segment >= 0 && !topology.parent.empty() && topology.parent[selected_segment] >= 0) {
+                selected_segment = topology.parent[selected_segment];
+                std::cout << "Selecionado: segmento " << selected_segment << std::endl;
+                requestRedraw(DIRTY_HUD);
+            }
+            break;
+        case 'h':
+        case 'H':
+            // Toggle renumeração dos pontos pela curva de Hilbert (recarrega o arquivo)
+            hilbert_reorder_enabled = !hilbert_reorder_enabled;
+            std::cout << "Ordem espacial (Hilbert): " << (hilbert_reorder_enabled ? "ON" : "OFF") << std::endl;
+            if (loadCurrentGrowthFile()) {
+                requestRedraw(DIRTY_HUD);
+            } else {
+                std::cerr << "Erro ao recarregar o arquivo" << std::endl;
+            }
+            break;
+        case 'g':
+        case 'G':
+            // Toggle cores pela diferença para o passo anterior da série
+            diff_view_enabled = !diff_view_enabled;
+            std::cout << "Diferença entre passos: " << (diff_view_enabled ? "ON" : "OFF") << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
+        case 'x':
+        case 'X':
+            // Verificação de colisões nas cores: desligada → raio de exibição
+            // → raio do arquivo (nas unidades das coordenadas)
+            collision_view = (collision_view + 1) % COLLISION_MODES;
+            invalidateCollisions();
+            std::cout << "Colisões: " << collisionRadiusName(collision_view) << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
+        case 'f':
+        case 'F':
+            // Territórios de perfusão: desligado → fatia da grade → fronteiras
+            territory_view = (territory_view + 1) % TERRITORY_VIEWS;
+            std::cout << "Territórios: " << territoryViewName(territory_view) << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
+        case 'y':
+        case 'Y':
+            // Fatia do volume parcial das cápsulas (raio de exibição)
+            voxel_view_enabled = !voxel_view_enabled;
+            std::cout << "Voxels: " << (voxel_view_enabled ? "ON" : "OFF") << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
+        case 'b':
+        case 'B':
+            // Oclusão ambiente nos tubos: calculada em segundo plano na
+            // primeira vez e mantida até a próxima carga ou troca de raio
+            ambient_occlusion_enabled = !ambient_occlusion_enabled;
+            std::cout << "Oclusão ambiente: " << (ambient_occlusion_enabled ? "ON" : "OFF") << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
+        case 'u':
+        case 'U':
+            // Sombras da luz principal: o mapa fica em cache até a luz, a
+            // geometria ou o passo mudarem
+            shadows_enabled = !shadows_enabled;
+            std::cout << "Sombras: " << (shadows_enabled ? "ON" : "OFF") << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
+        case '+':
+        case '=':
+        case '-':
+        case '_': {
+            // Fatia z dos territórios e dos voxels
+            int step = (key == '+' || key == '=') ? 1 : -1;
+            if (territory_view == TERRITORY_SLICE && territory_map.valid && territory_map.dims[2] > 0) {
+                territory_slice = std::max(0, std::min(territory_map.dims[2] - 1, territory_slice + step));
+                requestRedraw(DIRTY_HUD);
+            }
+            if (voxel_view_enabled && voxel_grid.valid && voxel_grid.dims[2] > 0) {
+                voxel_slice = std::max(0, std::min(voxel_grid.dims[2] - 1, voxel_slice + step));
+                requestRedraw(DIRTY_HUD);
+            }
+            break;
+        }
+        case 'j':
+        case 'J':
+            // Filtro por faixa do atributo das cores: setas ←→ movem o limite
+            // inferior, ↑↓ o superior; Ctrl+arrastar usa a barra do rodapé
+            range_filter_enabled = !range_filter_enabled;
+            std::cout << "Filtro por faixa: " << (range_filter_enabled ? "ON" : "OFF") << std::endl;
+            requestRedraw(DIRTY_HUD);
+            break;
+        case 'k':
+        case 'K':
+            // Próximo atributo das cores: raio, Strahler, geração, ramo, ângulo,
+            // Murray, vazão, pressão, resistência
+            color_metric = (color_metric + 1) % METRIC_COUNT;
+            std::cout << "Cor por: " << metricName(color_metric) << std::endl;
+            requestRedraw(DIRTY_LIGHTING | DIRTY_HUD);
+            break;
         case 'm':
         case 'M':
             // Toggle animação
@@ -143,6 +333,7 @@ void keyboard(unsigned char key, int, int) {
             } else {
                 std::cout << "Animação: OFF" << std::endl;
             }
+            requestRedraw(DIRTY_HUD);
             break;
         case 'r':
         case 'R': {
@@ -150,11 +341,7 @@ void keyboard(unsigned char key, int, int) {
             radius_mode_fixed = !radius_mode_fixed;
             std::cout << ">>> R pressionado - Modo de raio: " << (radius_mode_fixed ? "FIXO" : "VARIÁVEL") << std::endl;
             // Calcular e mostrar estatísticas dos raios
-            float min_r = 1e9f, max_r = -1e9f;
-            for (const auto& L : lines) {
-                if (L.radius < min_r) min_r = L.radius;
-                if (L.radius > max_r) max_r = L.radius;
-            }
+            float min_r = radius_min, max_r = radius_max;
             float avg_r = (min_r + max_r) / 2.0f;
             float range_r = max_r - min_r;
             std::cout << "    Raios originais - Mín: " << min_r << ", Máx: " << max_r 
@@ -164,7 +351,11 @@ void keyboard(unsigned char key, int, int) {
             } else {
                 std::cout << "    ✓ Segmentos usarão raios variáveis (0.145 a 1.226)" << std::endl;
             }
-            glutPostRedisplay();
+            invalidateCollisions();  // Raio de exibição mudou
+            invalidateVoxels();
+            invalidateAmbientOcclusion();
+            invalidateShadowMap();
+            requestRedraw(DIRTY_GEOMETRY | DIRTY_HUD);
             break;
         }
         case ' ':
@@ -176,16 +367,41 @@ void keyboard(unsigned char key, int, int) {
             camera.updateEye();
             n_segments_draw = max_segments;
             selected_segment = -1;
+            path_target_segment = -1;
+            requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
             break;
         case 27:  // ESC
             exit(0);
             break;
     }
-    
-    glutPostRedisplay();
+}
+
+// Um passo de um dos limites do filtro (setas)
+static void stepFilterBound(int bound, int direction) {
+    float low = range_filter.low, high = range_filter.high;
+    if (bound == 0) {
+        low = std::min(high, low + direction * RANGE_FILTER_STEP);
+    } else {
+        high = std::max(low, high + direction * RANGE_FILTER_STEP);
+    }
+    setRangeFilterBounds(low, high);
+    if (range_filter.valid) {
+        std::cout << "Filtro: " << metricName(range_filter.metric) << " em [" << rangeFilterValue(range_filter.low)
+                  << ", " << rangeFilterValue(range_filter.high) << "], " << range_filter.count() << " segmentos"
+                  << std::endl;
+    }
+    requestRedraw(DIRTY_HUD);
 }
 
 void specialKeys(int key, int, int) {
+    if (range_filter_enabled) {
+        switch (key) {
+            case GLUT_KEY_LEFT: stepFilterBound(0, -1); return;
+            case GLUT_KEY_RIGHT: stepFilterBound(0, 1); return;
+            case GLUT_KEY_DOWN: stepFilterBound(1, -1); return;
+            case GLUT_KEY_UP: stepFilterBound(1, 1); return;
+        }
+    }
     switch (key) {
         case GLUT_KEY_PAGE_UP:
             // Incrementar segmentos visíveis (aumentar quantidade)
@@ -194,6 +410,7 @@ void specialKeys(int key, int, int) {
                 n_segments_draw = std::min(max_segments, n_segments_draw + increment);
                 std::cout << "Segmentos visíveis: " << n_segments_draw << "/" << max_segments << std::endl;
                 // NÃO alterar a câmera ao mudar segmentos
+                requestRedraw(DIRTY_HUD);
             } else {
                 std::cout << "Nenhum segmento disponível" << std::endl;
             }
@@ -205,46 +422,117 @@ void specialKeys(int key, int, int) {
                 n_segments_draw = std::max(1, n_segments_draw - decrement);
                 std::cout << "Segmentos visíveis: " << n_segments_draw << "/" << max_segments << std::endl;
                 // NÃO alterar a câmera ao mudar segmentos
+                requestRedraw(DIRTY_HUD);
             } else {
                 std::cout << "Nenhum segmento disponível" << std::endl;
             }
             break;
     }
-    
-    glutPostRedisplay();
+}
+
+// Ctrl+arrastar: o limite do filtro mais perto do cursor segue a coluna
+// do mouse na barra do rodapé
+static void dragFilterBound(int x) {
+    float t = filterSliderFraction(x);
+    if (filter_drag_bound == 0) {
+        setRangeFilterBounds(std::min(t, range_filter.high), range_filter.high);
+    } else {
+        setRangeFilterBounds(range_filter.low, std::max(t, range_filter.low));
+    }
+    requestRedraw(DIRTY_HUD);
 }
 
 void mouse(int button, int state, int x, int y) {
+    if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN && range_filter_enabled &&
+        (glutGetModifiers() & GLUT_ACTIVE_CTRL) != 0) {
+        float t = filterSliderFraction(x);
+        filter_drag_bound = (fabsf(t - range_filter.low) <= fabsf(t - range_filter.high)) ? 0 : 1;
+        dragFilterBound(x);
+        return;
+    }
+    if (button == GLUT_LEFT_BUTTON && state == GLUT_UP && filter_drag_bound >= 0) {
+        filter_drag_bound = -1;
+        return;
+    }
     if (button == GLUT_LEFT_BUTTON) {
         if (state == GLUT_DOWN) {
             mouse_left_pressed = true;
             last_mouse_x = x;
             last_mouse_y = y;
+            press_mouse_x = x;
+            press_mouse_y = y;
         } else {
             mouse_left_pressed = false;
+            endInteraction();
+            
+            // Clique sem arrasto: seleção do segmento sob o cursor; com Shift,
+            // o outro extremo do caminho a partir do segmento já selecionado
+            if (abs(x - press_mouse_x) <= 3 && abs(y - press_mouse_y) <= 3) {
+                bool shift = (glutGetModifiers() & GLUT_ACTIVE_SHIFT) != 0;
+                if (shift && selected_segment >= 0) {
+                    path_target_segment = pickSegmentAt(x, y);
+                    if (path_target_segment >= 0) {
+                        TreePath path = queryPath(selected_segment, path_target_segment);
+                        std::cout << "Caminho " << selected_segment << " -> " << path_target_segment;
+                        if (path.lca >= 0) {
+                            std::cout << ": " << path.segments << " segmentos, ancestral comum " << path.lca
+                                      << ", L=" << path.length << ", R=" << path.resistance
+                                      << ", " << path.bifurcations << " bifurcações";
+                        } else {
+                            std::cout << ": segmentos em árvores diferentes";
+                        }
+                        std::cout << std::endl;
+                    }
+                } else {
+                    selected_segment = pickSegmentAt(x, y);
+                    path_target_segment = -1;
+                    show_segment_info = selected_segment >= 0;
+                    if (selected_segment >= 0) {
+                        std::cout << "Selecionado: segmento " << selected_segment;
+                        if (topology.hasSubtreeLayout()) {
+                            std::cout << " (subárvore com " << topology.subtreeSize(selected_segment) << " segmentos)";
+                        }
+                        std::cout << std::endl;
+                    }
+                }
+                requestRedraw(DIRTY_HUD);
+            }
         }
     }
 }
 
 void mouseMotion(int x, int y) {
+    if (filter_drag_bound >= 0) {
+        // A consulta é feita já (O(log n)); o buffer, uma vez por quadro
+        dragFilterBound(x);
+        return;
+    }
     if (mouse_left_pressed) {
-        int dx = x - last_mouse_x;
-        int dy = y - last_mouse_y;
-        
-        // Rotação baseada no movimento do mouse
-        float sensitivity = 0.5f;
-        camera.azimuth += dx * sensitivity;
-        camera.elevation += dy * sensitivity;
-        
-        // Limitar elevação
-        if (camera.elevation > 89.0f) camera.elevation = 89.0f;
-        if (camera.elevation < -89.0f) camera.elevation = -89.0f;
-        
-        camera.updateEye();
+        // Apenas acumula: a câmera é atualizada uma vez por quadro
+        pending_dx += x - last_mouse_x;
+        pending_dy += y - last_mouse_y;
         
         last_mouse_x = x;
         last_mouse_y = y;
         
-        glutPostRedisplay();
+        notifyInteraction();
+        requestRedraw(DIRTY_CAMERA | DIRTY_HUD);
     }
 }
+
+void applyPendingMotion() {
+    if (pending_dx == 0 && pending_dy == 0) return;
+    
+    // Rotação baseada no movimento do mouse
+    float sensitivity = 0.5f;
+    camera.azimuth += pending_dx * sensitivity;
+    camera.elevation += pending_dy * sensitivity;
+    
+    // Limitar elevação
+    if (camera.elevation > 89.0f) camera.elevation = 89.0f;
+    if (camera.elevation < -89.0f) camera.elevation = -89.0f;
+    
+    camera.updateEye();
+    pending_dx = 0;
+    pending_dy = 0;
+}
@@ -12,4 +12,7 @@ void specialKeys(int key, int x, int y);
 void mouse(int button, int state, int x, int y);
 void mouseMotion(int x, int y);
 
+// Aplica o movimento do mouse acumulado desde o último quadro
+void applyPendingMotion();
+
 #endif // HANDLERS_H
@@ -0,0 +1,1891 @@
+/*
+ * headless.cpp
+ * Comandos sem janela (linha de comando) - TP2 (3D)
+ *
+ * Uso:
+ *   tp2_visualizador --synthetic <n_terminais> <saida.vtk> [semente]
+ *   tp2_visualizador --bench-occlusion <arquivo.vtk> [...]
+ *   tp2_visualizador --bench-locality <arquivo.vtk> [...]
+ *   tp2_visualizador --bench-points <arquivo.vtk> [...]
+ *   tp2_visualizador --memstats <arquivo.vtk> [...]
+ *   tp2_visualizador --bench-growth <arquivo.vtk> [...]
+ *   tp2_visualizador --diff <base.vtk> <atual.vtk> | --diff <arquivo.vtk>
+ *   tp2_visualizador --morph <arquivo.vtk> [...]
+ *   tp2_visualizador --flow <arquivo.vtk> [saida.csv]
+ *   tp2_visualizador --paths <arquivo.vtk> [...]
+ *   tp2_visualizador --check <arquivo.vtk> [exibicao|arquivo[:escala]] [folga] [saida.csv]
+ *   tp2_visualizador --territories <arquivo.vtk> [resolucao] [saida.vtk]
+ *   tp2_visualizador --voxelize <arquivo.vtk> [resolucao] [ocupacao|parcial] [exibicao|arquivo[:escala]]
+ *                    [saida.raw] [densidade.csv]
+ *   tp2_visualizador --surface <arquivo.vtk> [resolucao] [exibicao|arquivo[:escala]] [raio_minimo]
+ *                    [saida.stl|saida.ply]
+ *   tp2_visualizador --ao <arquivo.vtk> [raios] [alcance]
+ *   tp2_visualizador --shadows <arquivo.vtk> [resolucao]
+ *   tp2_visualizador --filter <arquivo.vtk> [atributo]
+ *   tp2_visualizador --check-oit <arquivo.vtk> [largura]
+ */
+
+#include "headless.h"
+#include "globals.h"
+#include "utils.h"
+#include "occlusion.h"
+#include "bvh.h"
+#include "mesh.h"
+#include "topology.h"
+#include "spatial_order.h"
+#include "point_store.h"
+#include "memstats.h"
+#include "growth_diff.h"
+#include "morphometry.h"
+#include "parallel.h"
+#include "tree_paths.h"
+#include "collision.h"
+#include "territories.h"
+#include "voxelizer.h"
+#include "ambient_occlusion.h"
+#include "shadow_map.h"
+#include "range_filter.h"
+#include "surface.h"
+#include "oit.h"
+#include "interface.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <random>
+
+static void printUsage(const char* program) {
+    std::cout << "Comandos sem janela:" << std::endl;
+    std::cout << "  " << program << " --synthetic <n_terminais> <saida.vtk> [semente]" << std::endl;
+    std::cout << "      Gera uma árvore sintética (lei de Murray) e salva em VTK" << std::endl;
+    std::cout << "  " << program << " --bench-occlusion <arquivo.vtk> [...]" << std::endl;
+    std::cout << "      Mede a taxa de culling (frustum + Hi-Z) em uma órbita da câmera" << std::endl;
+    std::cout << "  " << program << " --bench-locality <arquivo.vtk> [...]" << std::endl;
+    std::cout << "      Compara a ordem dos pontos do arquivo com a curva de Hilbert" << std::endl;
+    std::cout << "  " << program << " --bench-points <arquivo.vtk> [...]" << std::endl;
+    std::cout << "      Compara os laços escalares sobre points com os kernels SSE (sem cópia)" << std::endl;
+    std::cout << "  " << program << " --memstats <arquivo.vtk> [...]" << std::endl;
+    std::cout << "      Memória por estrutura em cada passo da série de crescimento do arquivo" << std::endl;
+    std::cout << "  " << program << " --bench-growth <arquivo.vtk> [...]" << std::endl;
+    std::cout << "      Tempo de cada troca de passo (carga completa x só raios)" << std::endl;
+    std::cout << "  " << program << " --diff <base.vtk> <atual.vtk>" << std::endl;
+    std::cout << "      Classifica os segmentos do passo atual (iguais, raio, divididos, novos)" << std::endl;
+    std::cout << "  " << program << " --diff <arquivo.vtk>" << std::endl;
+    std::cout << "      O mesmo para cada par de passos consecutivos da série do arquivo" << std::endl;
+    std::cout << "  " << program << " --morph <arquivo.vtk> [...]" << std::endl;
+    std::cout << "      Morfometria (Strahler, ramos, bifurcações, Murray) de cada passo da série" << std::endl;
+    std::cout << "  " << program << " --flow <arquivo.vtk> [saida.csv]" << std::endl;
+    std::cout << "      Escoamento de Poiseuille de cada passo da série (e os valores por segmento em CSV)" << std::endl;
+    std::cout << "  " << program << " --paths <arquivo.vtk> [...]" << std::endl;
+    std::cout << "      Consultas de caminho entre terminais: índice (LCA em O(1)) x subida pelos pais" << std::endl;
+    std::cout << "  " << program << " --check <arquivo.vtk> [exibicao|arquivo[:escala]] [folga] [saida.csv]" << std::endl;
+    std::cout << "      Pares de vasos que se sobrepõem ou ficam a menos da folga (raio de exibição, ou do arquivo" << std::endl;
+    std::cout << "      vezes a escala para as unidades das coordenadas)" << std::endl;
+    std::cout << "  " << program << " --territories <arquivo.vtk> [resolucao] [saida.vtk]" << std::endl;
+    std::cout << "      Território de cada terminal (jump flooding em voxels, resolução no maior eixo)" << std::endl;
+    std::cout << "      conferido por força bruta em uma amostra; rótulos em VTK (STRUCTURED_POINTS)" << std::endl;
+    std::cout << "  " << program << " --voxelize <arquivo.vtk> [resolucao] [ocupacao|parcial] [exibicao|arquivo[:escala]]"
+              << " [saida.raw] [densidade.csv]" << std::endl;
+    std::cout << "      Voxelização das cápsulas (.raw + .mhd) e fração de volume vascular por bloco de "
+              << VOXEL_TILE << "³ voxels" << std::endl;
+    std::cout << "  " << program << " --surface <arquivo.vtk> [resolucao] [exibicao|arquivo[:escala]] [raio_minimo]"
+              << " [saida.stl|saida.ply]" << std::endl;
+    std::cout << "      Superfície fechada da união das cápsulas (marching cubes em blocos de " << SURFACE_BLOCK
+              << "³ células), conferida aresta por aresta; raio mínimo em células (padrão 0,87)" << std::endl;
+    std::cout << "  " << program << " --ao <arquivo.vtk> [raios] [alcance]" << std::endl;
+    std::cout << "      Oclusão ambiente dos tubos (" << AO_SAMPLES << " amostras por segmento, alcance em raios"
+              << " de exibição), conferida por força bruta em uma amostra" << std::endl;
+    std::cout << "  " << program << " --shadows <arquivo.vtk> [resolucao]" << std::endl;
+    std::cout << "      Mapa de sombras da luz principal (faixas de " << SHADOW_BAND
+              << " linhas), consultas por vértice e conferência por raios exatos até a luz" << std::endl;
+    std::cout << "  " << program << " --filter <arquivo.vtk> [atributo]" << std::endl;
+    std::cout << "      Filtro por faixa com índice ordenado (atributo 0-" << METRIC_COUNT - 1
+              << " na ordem da tecla K, padrão 0 = raio), conferido contra a varredura de todos os segmentos"
+              << std::endl;
+    std::cout << "  " << program << " --check-oit <arquivo.vtk> [largura]" << std::endl;
+    std::cout << "      OIT com acumulador de 8 bits (escala fixa antiga e calibrada) contra o blending ordenado,"
+              << " com as camadas de cada pixel achadas por raios" << std::endl;
+}
+
+// ============================================================
+// --synthetic
+// ============================================================
+
+static int commandSynthetic(int argc, char** argv) {
+    if (argc < 4) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    int n_terminals = std::atoi(argv[2]);
+    unsigned int seed = (argc > 4) ? (unsigned int)std::atoi(argv[4]) : 1u;
+    if (n_terminals < 1) {
+        std::cerr << "Erro: número de terminais inválido" << std::endl;
+        return 1;
+    }
+
+    generateSyntheticTree(n_terminals, seed);
+    if (!writeVTKFile3D(argv[3])) return 1;
+    std::cout << "Arquivo salvo: " << argv[3] << std::endl;
+    return 0;
+}
+
+// ============================================================
+// --bench-occlusion
+// ============================================================
+
+static void benchOcclusionOrbit(const char* label, float distance) {
+    const float aspect = 800.0f / 600.0f;
+    const float elevations[] = {-30.0f, 0.0f, 30.0f, 60.0f};
+
+    long long visible = 0, frustum = 0, occluded = 0;
+    double raster_ms = 0.0, query_ms = 0.0;
+    int views = 0;
+    std::vector<int> visible_segments;
+
+    for (float el : elevations) {
+        for (int az = 0; az < 360; az += 10) {
+            camera.distance = distance;
+            camera.azimuth = (float)az;
+            camera.elevation = el;
+            camera.updateEye();
+
+            buildOcclusionBuffer(camera, aspect, max_segments);
+            collectVisibleSegments(max_segments, visible_segments);
+
+            visible += occlusion_stats.segments_visible;
+            frustum += occlusion_stats.segments_frustum_culled;
+            occluded += occlusion_stats.segments_occlusion_culled;
+            raster_ms += occlusion_stats.raster_ms;
+            query_ms += occlusion_stats.query_ms;
+            views++;
+        }
+    }
+
+    double total = (double)(visible + frustum + occluded);
+    if (total <= 0.0) total = 1.0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  " << label << " (" << views << " vistas)" << std::endl;
+    std::cout << "    visíveis: " << 100.0 * visible / total << "%"
+              << " | frustum: " << 100.0 * frustum / total << "%"
+              << " | oclusão: " << 100.0 * occluded / total << "%" << std::endl;
+    std::cout << std::setprecision(3);
+    std::cout << "    rasterização+Hi-Z: " << raster_ms / views << " ms"
+              << " | travessia BVH: " << query_ms / views << " ms (média por quadro)" << std::endl;
+}
+
+static int commandBenchOcclusion(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    for (int i = 2; i < argc; i++) {
+        if (!readVTKFile3D(argv[i], true)) return 1;
+        std::cout << "\n=== Culling por oclusão: " << getFilename(argv[i])
+                  << " (" << max_segments << " segmentos) ===" << std::endl;
+
+        float overview = camera.distance;
+        benchOcclusionOrbit("Visão geral", overview);
+        benchOcclusionOrbit("Voo próximo", data_scale * 0.6f);
+    }
+    return 0;
+}
+
+// ============================================================
+// --bench-locality
+// ============================================================
+
+// Cache associativo por conjunto com substituição LRU. Sem perf/valgrind,
+// as faltas são estimadas simulando os acessos a `points` (linhas de 64 B).
+struct CacheModel {
+    int ways;
+    size_t sets;
+    std::vector<uint64_t> tags;  // sets * ways, mais recente primeiro
+    long long accesses;
+    long long misses;
+
+    CacheModel(size_t bytes, int associativity)
+        : ways(associativity), sets(bytes / (64 * associativity)),
+          tags(sets * associativity, UINT64_MAX), accesses(0), misses(0) {}
+
+    void access(uint64_t address) {
+        uint64_t line = address >> 6;
+        uint64_t* set = &tags[(line % sets) * ways];
+        accesses++;
+        int hit = -1;
+        for (int w = 0; w < ways; w++) {
+            if (set[w] == line) {
+                hit = w;
+                break;
+            }
+        }
+        if (hit < 0) {
+            misses++;
+            hit = ways - 1;
+        }
+        for (int w = hit; w > 0; w--) set[w] = set[w - 1];
+        set[0] = line;
+    }
+
+    double missRate() const { return accesses > 0 ? 100.0 * misses / accesses : 0.0; }
+};
+
+// Faltas por acesso ao ler p0 e p1 dos segmentos na ordem dada
+static void simulatePointAccesses(const std::vector<int>& order, double& l1_rate, double& l2_rate) {
+    CacheModel l1(32 * 1024, 8);
+    CacheModel l2(1024 * 1024, 16);
+    for (int s : order) {
+        uint64_t a0 = (uint64_t)lines[s].p0 * sizeof(Point3D);
+        uint64_t a1 = (uint64_t)lines[s].p1 * sizeof(Point3D);
+        l1.access(a0);
+        l2.access(a0);
+        l1.access(a1);
+        l2.access(a1);
+    }
+    l1_rate = l1.missRate();
+    l2_rate = l2.missRate();
+}
+
+static double elapsedSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct LocalityReport {
+    double stride;             // |índice do ponto atual - anterior| médio, na ordem dos segmentos
+    double dfs_l1, dfs_l2;     // Faltas na ordem dos segmentos (topologia, BVH, culling)
+    double radius_l1, radius_l2;  // Faltas na ordem de raio (montagem da malha)
+    double topology_ms, bvh_ms, mesh_ms, culling_ms;
+};
+
+// Menor tempo de algumas repetições: reduz o ruído do escalonador
+static const int LOCALITY_REPEATS = 5;
+
+static void measureLocality(LocalityReport& r) {
+    size_t n = lines.size();
+
+    std::vector<int> dfs_order(n);
+    for (size_t s = 0; s < n; s++) dfs_order[s] = (int)s;
+    simulatePointAccesses(dfs_order, r.dfs_l1, r.dfs_l2);
+    simulatePointAccesses(segments_by_radius, r.radius_l1, r.radius_l2);
+
+    double stride = 0.0;
+    int previous = -1;
+    for (size_t s = 0; s < n; s++) {
+        int a = lines[s].p0, b = lines[s].p1;
+        if (previous >= 0) stride += std::abs(a - previous);
+        stride += std::abs(b - a);
+        previous = b;
+    }
+    r.stride = n > 0 ? stride / (2.0 * n) : 0.0;
+
+    r.topology_ms = r.bvh_ms = r.mesh_ms = r.culling_ms = 1e30;
+    const float aspect = 800.0f / 600.0f;
+    std::vector<int> visible_segments;
+    for (int k = 0; k < LOCALITY_REPEATS; k++) {
+        auto start = std::chrono::steady_clock::now();
+        buildTopology();
+        reorderSegmentsDepthFirst();
+        r.topology_ms = std::min(r.topology_ms, elapsedSince(start));
+
+        start = std::chrono::steady_clock::now();
+        buildSegmentBVH();
+        r.bvh_ms = std::min(r.bvh_ms, elapsedSince(start));
+
+        start = std::chrono::steady_clock::now();
+        beginTreeGeometry();
+        while (!treeGeometryComplete()) continueTreeGeometry(1e9);
+        r.mesh_ms = std::min(r.mesh_ms, elapsedSince(start));
+
+        // Quadro típico sem GPU: culling em 36 vistas da órbita
+        start = std::chrono::steady_clock::now();
+        for (int az = 0; az < 360; az += 10) {
+            camera.azimuth = (float)az;
+            camera.updateEye();
+            buildOcclusionBuffer(camera, aspect, max_segments);
+            collectVisibleSegments(max_segments, visible_segments);
+        }
+        r.culling_ms = std::min(r.culling_ms, elapsedSince(start) / 36.0);
+    }
+}
+
+static int commandBenchLocality(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    bool saved = hilbert_reorder_enabled;
+    for (int i = 2; i < argc; i++) {
+        LocalityReport report[2];
+        for (int mode = 0; mode < 2; mode++) {
+            hilbert_reorder_enabled = (mode == 1);
+            if (!readVTKFile3D(argv[i], true)) {
+                hilbert_reorder_enabled = saved;
+                return 1;
+            }
+            measureLocality(report[mode]);
+        }
+
+        std::cout << "\n=== Localidade dos pontos: " << getFilename(argv[i])
+                  << " (" << points.size() << " pontos, " << lines.size() << " segmentos) ===" << std::endl;
+        std::cout << std::fixed;
+        const char* labels[2] = {"Arquivo", "Hilbert"};
+        for (int mode = 0; mode < 2; mode++) {
+            const LocalityReport& r = report[mode];
+            std::cout << "  " << labels[mode] << std::endl;
+            std::cout << std::setprecision(1)
+                      << "    salto médio de índice: " << r.stride << std::endl;
+            std::cout << std::setprecision(2)
+                      << "    faltas simuladas L1 32K / L2 1M: ordem dos segmentos "
+                      << r.dfs_l1 << "% / " << r.dfs_l2 << "%, ordem de raio "
+                      << r.radius_l1 << "% / " << r.radius_l2 << "%" << std::endl;
+            std::cout << std::setprecision(3)
+                      << "    topologia " << r.topology_ms << " ms | BVH " << r.bvh_ms
+                      << " ms | malha " << r.mesh_ms << " ms | culling " << r.culling_ms
+                      << " ms/quadro" << std::endl;
+        }
+    }
+    hilbert_reorder_enabled = saved;
+    return 0;
+}
+
+// ============================================================
+// --bench-points
+// ============================================================
+
+// Mesmas operações dos kernels, escalares sobre std::vector<Point3D>
+static void boundsScalar(float bmin[3], float bmax[3]) {
+    bmin[0] = bmax[0] = points[0].x;
+    bmin[1] = bmax[1] = points[0].y;
+    bmin[2] = bmax[2] = points[0].z;
+    for (const Point3D& p : points) {
+        bmin[0] = std::min(bmin[0], p.x); bmax[0] = std::max(bmax[0], p.x);
+        bmin[1] = std::min(bmin[1], p.y); bmax[1] = std::max(bmax[1], p.y);
+        bmin[2] = std::min(bmin[2], p.z); bmax[2] = std::max(bmax[2], p.z);
+    }
+}
+
+static void transformScalar(const float m[12], std::vector<Point3D>& out) {
+    for (size_t i = 0; i < points.size(); i++) {
+        const Point3D& p = points[i];
+        out[i] = Point3D(m[0] * p.x + m[1] * p.y + m[2] * p.z + m[3],
+                         m[4] * p.x + m[5] * p.y + m[6] * p.z + m[7],
+                         m[8] * p.x + m[9] * p.y + m[10] * p.z + m[11]);
+    }
+}
+
+static void distancesScalar(const Point3D& q, std::vector<float>& out) {
+    for (size_t i = 0; i < points.size(); i++) {
+        out[i] = (points[i] - q).length();
+    }
+}
+
+// Menor tempo (ms) de `repeats` execuções de f
+template <typename F>
+static double bestOf(int repeats, F f) {
+    double best = 1e30;
+    for (int k = 0; k < repeats; k++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, elapsedSince(start));
+    }
+    return best;
+}
+
+static int commandBenchPoints(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const int repeats = 50;
+    // Rotação em torno de y com translação (uma matriz de visão típica)
+    const float c = 0.8f, s = 0.6f;
+    const float m[12] = {c, 0.0f, -s, 1.0f,
+                         0.0f, 1.0f, 0.0f, -2.0f,
+                         s, 0.0f, c, 3.0f};
+
+    for (int i = 2; i < argc; i++) {
+        if (!readVTKFile3D(argv[i], true)) return 1;
+        size_t n = points.size();
+        if (n == 0) continue;
+
+        float amin[3], amax[3], smin[3], smax[3];
+        std::vector<Point3D> scalar_out(n);
+        std::vector<float> scalar_dist(n);
+        std::vector<float> sx(n), sy(n), sz(n);
+        std::vector<float> kernel_dist(n);
+
+        double bounds_scalar = bestOf(repeats, [&]() { boundsScalar(amin, amax); });
+        double bounds_kernel = bestOf(repeats, [&]() { pointBounds(points, smin, smax); });
+        double transform_scalar = bestOf(repeats, [&]() { transformScalar(m, scalar_out); });
+        double transform_kernel = bestOf(repeats, [&]() {
+            transformPoints(points, m, sx.data(), sy.data(), sz.data());
+        });
+        double dist_scalar = bestOf(repeats, [&]() { distancesScalar(camera.eye, scalar_dist); });
+        double dist_kernel = bestOf(repeats, [&]() { pointDistances(points, camera.eye, kernel_dist.data()); });
+
+        // Conferência: os kernels devem reproduzir os laços escalares
+        float max_error = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            max_error = std::max(max_error, std::abs(amin[k] - smin[k]));
+            max_error = std::max(max_error, std::abs(amax[k] - smax[k]));
+        }
+        for (size_t k = 0; k < n; k++) {
+            max_error = std::max(max_error, std::abs(scalar_out[k].x - sx[k]));
+            max_error = std::max(max_error, std::abs(scalar_out[k].y - sy[k]));
+            max_error = std::max(max_error, std::abs(scalar_out[k].z - sz[k]));
+            max_error = std::max(max_error, std::abs(scalar_dist[k] - kernel_dist[k]));
+        }
+
+        std::cout << "\n=== Pontos em lote: " << getFilename(argv[i])
+                  << " (" << n << " pontos, menor de " << repeats << " execuções) ===" << std::endl;
+        std::cout << std::fixed << std::setprecision(4);
+        std::cout << "  caixa envolvente: escalar " << bounds_scalar << " ms | kernel " << bounds_kernel << " ms" << std::endl;
+        std::cout << "  transformação:    escalar " << transform_scalar << " ms | kernel " << transform_kernel << " ms" << std::endl;
+        std::cout << "  distâncias:       escalar " << dist_scalar << " ms | kernel " << dist_kernel << " ms" << std::endl;
+        std::cout << std::scientific << std::setprecision(2)
+                  << "  maior diferença entre escalar e kernel: " << max_error << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout.precision(6);
+    }
+    return 0;
+}
+
+// ============================================================
+// --memstats
+// ============================================================
+
+// Carrega o passo e produz tudo o que um quadro na janela produziria sem
+// OpenGL: malhas completas e o buffer de oclusão da visão geral
+static bool loadStepForMemstats(const std::string& path) {
+    if (!readVTKFile3D(path, true)) return false;
+    beginTreeGeometry();
+    while (!treeGeometryComplete()) continueTreeGeometry(1e9);
+    buildOcclusionBuffer(camera, 800.0f / 600.0f, max_segments);
+    return true;
+}
+
+static int commandMemstats(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<MemoryEntry> entries;
+    for (int i = 2; i < argc; i++) {
+        findGrowthFiles(argv[i]);
+        std::vector<std::string> steps = growth_files;
+
+        std::vector<std::string> summary;
+        for (const std::string& step : steps) {
+            if (!loadStepForMemstats(step)) return 1;
+            collectMemoryStats(entries);
+            size_t used = memoryUsedTotal(entries);
+            size_t reserved = memoryReservedTotal(entries);
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(1)
+                 << "  " << getFilename(step) << ": " << lines.size() << " segmentos, "
+                 << used / 1024.0 << " KB usados, " << reserved / 1024.0 << " KB reservados, "
+                 << (double)used / std::max<size_t>(1, lines.size()) << " B/segmento";
+            summary.push_back(line.str());
+        }
+
+        // O detalhe é do arquivo pedido, carregado por último
+        if (!loadStepForMemstats(argv[i])) return 1;
+        collectMemoryStats(entries);
+
+        std::cout << "\n=== Memória por passo: " << getFilename(argv[i])
+                  << " (" << steps.size() << " passos) ===" << std::endl;
+        for (const std::string& line : summary) {
+            std::cout << line << std::endl;
+        }
+        std::cout << "\n=== Memória por estrutura: " << getFilename(argv[i]) << " ===" << std::endl;
+        printMemoryStats(entries, lines.size());
+    }
+    return 0;
+}
+
+// ============================================================
+// --bench-growth
+// ============================================================
+
+struct GrowthTiming {
+    bool radii_only;   // A carga seguiu pelo caminho só de raios
+    int reused;        // Blocos já na tela no início da reconstrução (mesh_reused_count)
+    double load_ms;    // loadCurrentGrowthFile
+    double fresh_ms;   // Até os blocos novos ficarem prontos (árvore inteira na tela)
+    double mesh_ms;    // Malhas completas (mesma decisão de updateRetainedState)
+};
+
+static GrowthTiming timeGrowthStep(int index) {
+    GrowthTiming t;
+    current_growth_index = index;
+    dirty_flags = 0;
+    auto start = std::chrono::steady_clock::now();
+    loadCurrentGrowthFile();
+    t.load_ms = elapsedSince(start);
+    t.radii_only = (dirty_flags & DIRTY_RADII) && !(dirty_flags & DIRTY_GEOMETRY);
+
+    // Orçamento zero enquanto faltam blocos novos: o laço para a cada 32
+    // segmentos e marca quando eles acabam
+    start = std::chrono::steady_clock::now();
+    if (!t.radii_only || !beginTreeRadii()) beginTreeGeometry();
+    t.reused = mesh_reused_count;
+    int fresh = (int)lines.size() - mesh_reused_count;
+    t.fresh_ms = (fresh == 0) ? elapsedSince(start) : -1.0;
+    while (!treeGeometryComplete()) {
+        continueTreeGeometry(mesh_built_count < fresh ? 0.0 : 1e9);
+        if (t.fresh_ms < 0.0 && mesh_built_count >= fresh) t.fresh_ms = elapsedSince(start);
+    }
+    t.mesh_ms = elapsedSince(start);
+    if (t.fresh_ms < 0.0) t.fresh_ms = t.mesh_ms;
+    return t;
+}
+
+static std::string formatGrowthTiming(const char* label, const GrowthTiming& t) {
+    const char* path = t.radii_only ? "raios" : (t.reused > 0 ? "prefixo" : "completa");
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1)
+         << "    " << std::left << std::setw(18) << label << std::right
+         << std::setw(10) << path << std::setw(10) << t.reused
+         << std::setw(10) << t.load_ms << std::setw(10) << t.fresh_ms << std::setw(10) << t.mesh_ms
+         << std::setw(10) << t.load_ms + t.mesh_ms;
+    return line.str();
+}
+
+static int commandBenchGrowth(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    for (int i = 2; i < argc; i++) {
+        findGrowthFiles(argv[i]);
+
+        std::vector<std::string> report;
+        for (int step = 0; step < (int)growth_files.size(); step++) {
+            // Do passo anterior (ou do arquivo anterior) e recarga do mesmo passo
+            GrowthTiming next = timeGrowthStep(step);
+            GrowthTiming same = timeGrowthStep(step);
+            report.push_back("  " + getFilename(growth_files[step]) + " (" + std::to_string(lines.size()) + " segmentos)");
+            report.push_back(formatGrowthTiming("do passo anterior", next));
+            report.push_back(formatGrowthTiming("mesma topologia", same));
+        }
+
+        std::cout << "\n=== Troca de passo: " << getFilename(argv[i]) << " ===" << std::endl;
+        std::cout << "    " << std::left << std::setw(18) << "" << std::right << std::setw(10) << "caminho"
+                  << std::setw(10) << "copiados" << std::setw(10) << "carga ms" << std::setw(10) << "novos ms"
+                  << std::setw(10) << "malha ms" << std::setw(10) << "total ms" << std::endl;
+        for (const std::string& line : report) {
+            std::cout << line << std::endl;
+        }
+    }
+    return 0;
+}
+
+// ============================================================
+// --diff
+// ============================================================
+
+static std::string formatDiff(const std::string& base, const std::string& current) {
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(1)
+         << "  " << getFilename(base) << " -> " << getFilename(current) << std::endl
+         << "    " << growth_diff.base_segments << " -> " << lines.size() << " segmentos:";
+    for (int c = 0; c < CHANGE_CLASSES; c++) {
+        line << " " << growth_diff.counts[c] << " " << changeClassName(c) << (c + 1 < CHANGE_CLASSES ? "," : "");
+    }
+    line << std::endl
+         << "    " << growth_diff.removed << " segmentos do passo base sem par; leitura "
+         << growth_diff.parse_ms << " ms, junção " << growth_diff.join_ms << " ms";
+    return line.str();
+}
+
+static int commandDiff(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Par explícito ou todos os passos consecutivos da série
+    std::vector<std::pair<std::string, std::string> > pairs;
+    if (argc >= 4) {
+        pairs.push_back(std::make_pair(std::string(argv[2]), std::string(argv[3])));
+    } else {
+        findGrowthFiles(argv[2]);
+        for (size_t k = 1; k < growth_files.size(); k++) {
+            pairs.push_back(std::make_pair(growth_files[k - 1], growth_files[k]));
+        }
+    }
+
+    std::vector<std::string> report;
+    for (const auto& pair : pairs) {
+        if (!readVTKFile3D(pair.second, true)) return 1;
+        if (!computeGrowthDiff(pair.first)) return 1;
+        report.push_back(formatDiff(pair.first, pair.second));
+    }
+
+    std::cout << "\n=== Diferença entre passos ===" << std::endl;
+    for (const std::string& line : report) {
+        std::cout << line << std::endl;
+    }
+    return 0;
+}
+
+// ============================================================
+// --morph
+// ============================================================
+
+static std::string formatMorphometry(const Morphometry& m) {
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(2)
+         << std::setw(10) << lines.size() << std::setw(6) << m.max_strahler
+         << std::setw(8) << m.branches << std::setw(10) << std::setprecision(4) << m.mean_branch_length
+         << std::setprecision(2)
+         << std::setw(8) << m.bifurcations << std::setw(8) << m.mean_angle
+         << std::setw(8) << m.murray_exponent
+         << std::setw(10) << morphSourceName(m.source) << std::setw(10) << m.compute_ms;
+    return line.str();
+}
+
+static int commandMorph(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    for (int i = 2; i < argc; i++) {
+        findGrowthFiles(argv[i]);
+
+        // Primeira passagem calcula; a segunda (em ordem inversa) sai do cache
+        std::vector<std::string> report;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int k = 0; k < (int)growth_files.size(); k++) {
+                int step = (pass == 0) ? k : (int)growth_files.size() - 1 - k;
+                current_growth_index = step;
+                if (!loadCurrentGrowthFile()) return 1;
+                const Morphometry& m = updateMorphometry();
+                if (!m.valid) {
+                    std::cerr << "Erro: " << getFilename(growth_files[step])
+                              << " sem topologia (índice de ponto fora da faixa)" << std::endl;
+                    return 1;
+                }
+                report.push_back("  " + std::string(pass == 0 ? "" : "* ") + getFilename(growth_files[step]));
+                report.back().resize(40, ' ');
+                report.back() += formatMorphometry(m);
+            }
+        }
+
+        const Morphometry& m = updateMorphometry();
+        std::cout << "\n=== Morfometria: " << getFilename(argv[i]) << " (" << parallelThreadCount()
+                  << " threads; * = segunda passagem) ===" << std::endl;
+        std::cout << "  " << std::left << std::setw(38) << "passo" << std::right
+                  << std::setw(10) << "segmentos" << std::setw(6) << "ordem"
+                  << std::setw(8) << "ramos" << std::setw(10) << "compr." << std::setw(8) << "bifurc."
+                  << std::setw(8) << "ângulo" << std::setw(8) << "Murray"
+                  << std::setw(10) << "caminho" << std::setw(10) << "ms" << std::endl;
+        for (const std::string& line : report) {
+            std::cout << line << std::endl;
+        }
+
+        std::cout << "  Ordens de Strahler de " << getFilename(growth_files[current_growth_index]) << ":" << std::endl;
+        std::cout << std::fixed << std::setprecision(4);
+        std::cout << "    " << std::setw(6) << "ordem" << std::setw(12) << "segmentos"
+                  << std::setw(14) << "comprimento" << std::setw(12) << "raio médio" << std::endl;
+        for (int k = 1; k <= m.max_strahler; k++) {
+            std::cout << "    " << std::setw(6) << k << std::setw(12) << m.order_segments[k]
+                      << std::setw(14) << m.order_length[k] << std::setw(12) << m.order_mean_radius[k] << std::endl;
+        }
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << "  Expoente de Murray ajustado: " << m.murray_exponent << " (" << m.murray_samples
+                  << " bifurcações)" << std::endl;
+    }
+    return 0;
+}
+
+// ============================================================
+// --flow
+// ============================================================
+
+static void writeFlowRows(std::ofstream& csv, const std::string& step, const Morphometry& m) {
+    const std::vector<int>& source = topology.source_segment;
+    for (size_t s = 0; s < lines.size(); s++) {
+        int parent = topology.parent[s];
+        float p_proximal = (parent >= 0) ? m.values[METRIC_PRESSURE][parent] : 1.0f;
+        csv << step << ',' << s << ',' << (source.size() == lines.size() ? source[s] : (int)s) << ','
+            << (points[lines[s].p1] - points[lines[s].p0]).length() << ',' << radii[s] << ','
+            << m.values[METRIC_RESISTANCE][s] << ',' << m.values[METRIC_FLOW][s] << ','
+            << p_proximal << ',' << m.values[METRIC_PRESSURE][s] << '\n';
+    }
+}
+
+static int commandFlow(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::ofstream csv;
+    if (argc >= 4) {
+        csv.open(argv[3]);
+        if (!csv) {
+            std::cerr << "Erro: não foi possível criar " << argv[3] << std::endl;
+            return 1;
+        }
+        csv << "passo,segmento,segmento_arquivo,comprimento,raio,resistencia,vazao,pressao_proximal,pressao_distal\n";
+        csv << std::setprecision(9);
+    }
+
+    findGrowthFiles(argv[2]);
+    std::vector<std::string> report;
+    for (int step = 0; step < (int)growth_files.size(); step++) {
+        current_growth_index = step;
+        if (!loadCurrentGrowthFile()) return 1;
+        const Morphometry& m = updateMorphometry();
+        if (!m.valid) {
+            std::cerr << "Erro: " << getFilename(growth_files[step])
+                      << " sem topologia (índice de ponto fora da faixa)" << std::endl;
+            return 1;
+        }
+        const FlowSummary& f = m.flow;
+
+        std::ostringstream line;
+        line << "  " << std::left << std::setw(36) << getFilename(growth_files[step]) << std::right
+             << std::setw(10) << lines.size() << std::setw(12) << std::setprecision(4) << f.tree_resistance
+             << std::setw(12) << f.terminal_flow_min << std::setw(12) << f.terminal_flow_max
+             << std::fixed << std::setprecision(2) << std::setw(8) << 100.0 * f.terminal_flow_cv
+             << std::setw(8) << f.blocked << std::setw(10) << f.solve_ms;
+        report.push_back(line.str());
+        if (csv.is_open()) writeFlowRows(csv, getFilename(growth_files[step]), m);
+    }
+
+    std::cout << "\n=== Escoamento de Poiseuille: " << getFilename(argv[2])
+              << " (entrada 1, terminais 0; vazões relativas à entrada) ===" << std::endl;
+    std::cout << "  " << std::left << std::setw(36) << "passo" << std::right << std::setw(10) << "segmentos"
+              << std::setw(12) << "R árvore" << std::setw(12) << "Q term min" << std::setw(12) << "Q term max"
+              << std::setw(8) << "CV %" << std::setw(8) << "sem Q" << std::setw(10) << "ms" << std::endl;
+    for (const std::string& line : report) {
+        std::cout << line << std::endl;
+    }
+    if (csv.is_open()) {
+        std::cout << "  Valores por segmento em " << argv[3] << std::endl;
+    }
+    return 0;
+}
+
+// ============================================================
+// --paths
+// ============================================================
+
+// Referência: sobe pelos pais a partir dos dois extremos, igualando as
+// gerações, e soma segmento a segmento
+static TreePath walkPath(int a, int b, std::vector<int>& segments) {
+    TreePath path;
+    std::vector<int> up_b;
+    segments.clear();
+    int ua = a, ub = b;
+    while (ua >= 0 && ub >= 0 && ua != ub) {
+        if (topology.generation[ua] >= topology.generation[ub]) {
+            segments.push_back(ua);
+            ua = topology.parent[ua];
+        } else {
+            up_b.push_back(ub);
+            ub = topology.parent[ub];
+        }
+    }
+    if (ua < 0 || ub < 0) return path;
+    path.lca = ua;
+    if (ua == a || ua == b) segments.push_back(ua);
+    segments.insert(segments.end(), up_b.rbegin(), up_b.rend());
+
+    path.segments = (int)segments.size();
+    for (size_t k = 0; k < segments.size(); k++) {
+        int s = segments[k];
+        double length = topology.length_prefix[s + 1] - topology.length_prefix[s];
+        path.length += length;
+        path.resistance += poiseuilleResistance(length, radii[s]);
+        if (k == 0) continue;
+
+        // Ponto entre dois segmentos consecutivos: distal do mais alto, ou
+        // do pai comum quando o caminho passa de um irmão para outro
+        int x = segments[k - 1];
+        int joint = (topology.parent[s] == x) ? x : (topology.parent[x] == s) ? s : topology.parent[x];
+        if (topology.childCount(joint) >= 2) path.bifurcations++;
+    }
+    return path;
+}
+
+static bool samePath(const TreePath& a, const TreePath& b) {
+    const double tol = 1e-9;
+    return a.lca == b.lca && a.segments == b.segments && a.bifurcations == b.bifurcations &&
+           std::fabs(a.length - b.length) <= tol * std::max(1.0, std::fabs(b.length)) &&
+           std::fabs(a.resistance - b.resistance) <= 1e-6 * std::max(1.0, std::fabs(b.resistance));
+}
+
+static int commandPaths(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const int QUERIES = 1000000;
+    const int CHECKED = 20000;
+    for (int i = 2; i < argc; i++) {
+        if (!readVTKFile3D(argv[i], false)) return 1;
+        const std::vector<int>& terminals = topology.terminals;
+        if (!path_index.valid || terminals.size() < 2) {
+            std::cerr << "Erro: " << getFilename(argv[i]) << " sem terminais suficientes" << std::endl;
+            return 1;
+        }
+
+        // Pares de terminais sorteados (a busca do programa é entre quaisquer
+        // segmentos; terminais dão os caminhos mais longos)
+        std::mt19937 rng(12345);
+        std::uniform_int_distribution<size_t> pick(0, terminals.size() - 1);
+        std::vector<int> pair_a(QUERIES), pair_b(QUERIES);
+        for (int q = 0; q < QUERIES; q++) {
+            pair_a[q] = terminals[pick(rng)];
+            pair_b[q] = terminals[pick(rng)];
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        double checksum = 0.0;
+        for (int q = 0; q < QUERIES; q++) {
+            checksum += queryPath(pair_a[q], pair_b[q]).length;
+        }
+        double index_ns = elapsedSince(start) * 1e6 / QUERIES;
+
+        // Subida pelos pais nos primeiros pares, que também conferem o índice;
+        // depois pares segmento-ancestral e pares quaisquer
+        std::vector<int> segments;
+        size_t mismatches = 0, path_segments = 0;
+        start = std::chrono::steady_clock::now();
+        for (int q = 0; q < CHECKED; q++) {
+            TreePath walked = walkPath(pair_a[q], pair_b[q], segments);
+            path_segments += segments.size();
+            if (!samePath(queryPath(pair_a[q], pair_b[q]), walked)) mismatches++;
+        }
+        double walk_ns = elapsedSince(start) * 1e6 / CHECKED;
+        std::uniform_int_distribution<int> any(0, (int)lines.size() - 1);
+        for (int q = 0; q < CHECKED; q++) {
+            int s = any(rng);
+            int ancestor = s;
+            for (int up = any(rng) % 8; up > 0 && topology.parent[ancestor] >= 0; up--) {
+                ancestor = topology.parent[ancestor];
+            }
+            if (!samePath(queryPath(ancestor, s), walkPath(ancestor, s, segments))) mismatches++;
+            int other = any(rng);
+            if (!samePath(queryPath(s, other), walkPath(s, other, segments))) mismatches++;
+        }
+
+        std::vector<MemoryEntry> entries;
+        appendPathIndexMemory(entries);
+        std::cout << "\n=== Caminhos: " << getFilename(argv[i]) << " (" << lines.size() << " segmentos, "
+                  << terminals.size() << " terminais) ===" << std::endl;
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "  Índice: " << path_index.build_ms << " ms, "
+                  << memoryUsedTotal(entries) / 1024.0 << " KB (" << path_index.levels << " níveis de tabela)" << std::endl;
+        std::cout << "  Consulta pelo índice:  " << std::setw(10) << index_ns << " ns (" << QUERIES << " pares)" << std::endl;
+        std::cout << "  Subida pelos pais:     " << std::setw(10) << walk_ns << " ns (" << CHECKED
+                  << " pares, " << (double)path_segments / CHECKED << " segmentos por caminho)" << std::endl;
+        std::cout << "  Divergências: " << mismatches << " em " << 3 * CHECKED << " pares" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        if (checksum < 0.0) std::cout << checksum << std::endl;  // Mantém o laço medido
+        if (mismatches > 0) return 1;
+    }
+    return 0;
+}
+
+// ============================================================
+// --check
+// ============================================================
+
+static int fileSegment(int s) {
+    const std::vector<int>& source = topology.source_segment;
+    return source.size() == lines.size() ? source[s] : s;
+}
+
+// Raio das cápsulas: "exibicao" ou "arquivo[:escala]" (raio do arquivo
+// vezes a escala, para as unidades das coordenadas)
+static bool parseRadiusArgument(const std::string& mode, bool& from_file, float& scale) {
+    from_file = false;
+    scale = 1.0f;
+    if (mode.compare(0, 7, "arquivo") == 0) {
+        from_file = true;
+        if (mode.size() > 8 && mode[7] == ':') scale = (float)atof(mode.c_str() + 8);
+        return true;
+    }
+    if (mode == "exibicao") return true;
+    std::cerr << "Erro: raio deve ser 'exibicao' ou 'arquivo[:escala]'" << std::endl;
+    return false;
+}
+
+static int commandCheck(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    bool from_file = false;
+    float radius_scale = 1.0f;
+    if (argc >= 4 && !parseRadiusArgument(argv[3], from_file, radius_scale)) return 1;
+    int radius_source = from_file ? COLLISION_FILE : COLLISION_DISPLAY;
+    float clearance = (argc >= 5) ? (float)atof(argv[4]) : 0.0f;
+
+    if (!readVTKFile3D(argv[2], true)) return 1;
+    CollisionReport& r = collision_report;
+    checkCollisions(radius_source, radius_scale, clearance, r);
+
+    std::cout << "\n=== Colisões: " << getFilename(argv[2]) << " (" << lines.size() << " segmentos, "
+              << collisionRadiusName(radius_source)
+              << (radius_source == COLLISION_FILE ? " × " + std::to_string(radius_scale).substr(0, 8) : std::string())
+              << ", folga " << clearance << ", "
+              << parallelThreadCount() << " threads) ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  BVH: " << r.bvh_ms << " ms; verificação: " << r.check_ms << " ms" << std::endl;
+    std::cout << "  Pares testados: " << r.candidates << " (" << r.adjacent_skipped
+              << " adjacentes ignorados; todos os pares seriam "
+              << (double)lines.size() * (lines.size() - 1) / 2.0 << ")" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << "  Sobreposições: " << r.overlaps << "; abaixo da folga: " << r.clearance_violations << std::endl;
+    std::cout << "  Em junções (um segmento curto entre os dois): " << r.junction_pairs
+              << "; entre ramos distantes: " << r.pairs.size() - r.junction_pairs << std::endl;
+
+    // Piores pares (índices do layout e do arquivo)
+    const size_t LISTED = 20;
+    if (!r.pairs.empty()) {
+        std::cout << "  " << std::setw(10) << "segmento" << std::setw(10) << "arquivo" << std::setw(10) << "segmento"
+                  << std::setw(10) << "arquivo" << std::setw(14) << "gap" << std::setw(12) << "raio a"
+                  << std::setw(12) << "raio b" << std::setw(10) << "caminho" << std::endl;
+    }
+    for (size_t k = 0; k < std::min(LISTED, r.pairs.size()); k++) {
+        const CollisionPair& p = r.pairs[k];
+        std::cout << "  " << std::setw(10) << p.a << std::setw(10) << fileSegment(p.a) << std::setw(10) << p.b
+                  << std::setw(10) << fileSegment(p.b) << std::setw(14) << std::setprecision(5) << p.gap
+                  << std::setw(12) << radii[p.a] << std::setw(12) << radii[p.b] << std::setw(10) << p.path_segments
+                  << std::endl;
+    }
+    if (r.pairs.size() > LISTED) {
+        std::cout << "  ... mais " << r.pairs.size() - LISTED << " pares" << std::endl;
+    }
+
+    if (argc >= 6) {
+        std::ofstream csv(argv[5]);
+        if (!csv) {
+            std::cerr << "Erro: não foi possível criar " << argv[5] << std::endl;
+            return 1;
+        }
+        csv << "segmento_a,segmento_b,arquivo_a,arquivo_b,gap,sobreposicao,caminho_segmentos\n" << std::setprecision(9);
+        for (const CollisionPair& p : r.pairs) {
+            csv << p.a << ',' << p.b << ',' << fileSegment(p.a) << ',' << fileSegment(p.b) << ','
+                << p.gap << ',' << (p.gap < 0.0f ? 1 : 0) << ',' << p.path_segments << '\n';
+        }
+        std::cout << "  Pares em " << argv[5] << std::endl;
+    }
+    return r.pairs.empty() ? 0 : 2;
+}
+
+// ============================================================
+// --territories
+// ============================================================
+
+static int commandTerritories(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    int resolution = (argc >= 4) ? atoi(argv[3]) : 128;
+    if (resolution < 1 || resolution > 2048) {
+        std::cerr << "Erro: resolução deve estar entre 1 e 2048" << std::endl;
+        return 1;
+    }
+
+    if (!readVTKFile3D(argv[2], true)) return 1;
+    TerritoryMap& map = territory_map;
+    computeTerritories(resolution, map);
+    size_t n_voxels = map.voxelCount();
+    size_t n_territories = map.terminals.size();
+    if (n_territories == 0) {
+        std::cerr << "Erro: árvore sem terminais" << std::endl;
+        return 1;
+    }
+
+    // Volumes: voxels por território (sementes no mesmo voxel podem deixar
+    // um território vazio)
+    uint32_t vmin = UINT32_MAX, vmax = 0;
+    size_t empty = 0;
+    for (uint32_t c : map.voxel_counts) {
+        vmin = std::min(vmin, c);
+        vmax = std::max(vmax, c);
+        if (c == 0) empty++;
+    }
+
+    // Conferência: amostra de voxels contra a busca exata em todos os
+    // terminais. Empates podem trocar o rótulo sem erro; conta só distância
+    // maior que a exata.
+    const int SAMPLES = 4096;
+    std::mt19937 rng(12345);
+    int wrong = 0;
+    double worst = 0.0;
+    auto brute_start = std::chrono::steady_clock::now();
+    for (int k = 0; k < SAMPLES; k++) {
+        int x = (int)(rng() % map.dims[0]), y = (int)(rng() % map.dims[1]), z = (int)(rng() % map.dims[2]);
+        int exact = nearestTerminal(map, x, y, z);
+        int got = map.labels[map.index(x, y, z)];
+        double d_exact = std::sqrt(territorySeedDistance2(map, exact, x, y, z));
+        double d_got = std::sqrt(territorySeedDistance2(map, got, x, y, z));
+        if (d_got > d_exact * (1.0 + 1e-6) + 1e-6) {
+            wrong++;
+            worst = std::max(worst, d_got - d_exact);
+        }
+    }
+    double brute_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - brute_start).count();
+
+    double voxel_volume = (double)map.voxel * map.voxel * map.voxel;
+    std::cout << "\n=== Territórios: " << getFilename(argv[2]) << " (" << n_territories << " terminais, "
+              << parallelThreadCount() << " threads) ===" << std::endl;
+    std::cout << "  Grade: " << map.dims[0] << " x " << map.dims[1] << " x " << map.dims[2] << " = " << n_voxels
+              << " voxels (aresta " << map.voxel << "), " << 2 * n_voxels * sizeof(int) / (1024 * 1024)
+              << " MB nos dois buffers" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Sementes: " << map.seed_ms << " ms; jump flooding: " << map.flood_ms << " ms (" << map.passes
+              << " passos de 3 passadas, " << 1e6 * map.flood_ms / ((double)n_voxels * 3 * map.passes)
+              << " ns por voxel e passada)" << std::endl;
+    std::cout << "  Força bruta estimada: " << brute_ms / SAMPLES * n_voxels / 1000.0 << " s ("
+              << 1e3 * brute_ms / SAMPLES << " µs por voxel, " << n_territories << " distâncias)" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << "  Voxels por território: mín " << vmin << ", médio " << (double)n_voxels / n_territories << ", máx "
+              << vmax << " (volume médio " << voxel_volume * n_voxels / n_territories << "); vazios: " << empty
+              << std::endl;
+    std::cout << "  Conferência em " << SAMPLES << " voxels: " << wrong << " com terminal mais distante que o exato";
+    if (wrong > 0) std::cout << " (pior diferença " << worst << " voxels)";
+    std::cout << std::endl;
+
+    if (argc >= 5) {
+        if (!writeTerritoryVolume(argv[4], map)) return 1;
+        std::cout << "  Rótulos (segmento terminal no arquivo) em " << argv[4] << std::endl;
+    }
+    return 0;
+}
+
+// ============================================================
+// --voxelize
+// ============================================================
+
+// Referência da conferência: testa o ponto contra todas as cápsulas
+static bool insideAnyCapsule(const Point3D& p, const std::vector<float>& capsule_radii) {
+    for (size_t s = 0; s < lines.size(); s++) {
+        const Point3D& a = points[lines[s].p0];
+        Point3D d = points[lines[s].p1] - a;
+        float len2 = dotProduct(d, d);
+        float t = (len2 > 0.0f) ? std::max(0.0f, std::min(1.0f, dotProduct(p - a, d) / len2)) : 0.0f;
+        Point3D q = p - (a + d * t);
+        if (dotProduct(q, q) <= capsule_radii[s] * capsule_radii[s]) return true;
+    }
+    return false;
+}
+
+// Valor esperado do voxel: centro (ocupação) ou fração de 4³ amostras
+static int bruteForceVoxel(const VoxelGrid& grid, const std::vector<float>& capsule_radii, int x, int y, int z) {
+    Point3D center(grid.origin[0] + x * grid.voxel, grid.origin[1] + y * grid.voxel, grid.origin[2] + z * grid.voxel);
+    if (grid.mode == VOXEL_OCCUPANCY) return insideAnyCapsule(center, capsule_radii) ? 255 : 0;
+    const int n = 4;
+    float sub = grid.voxel / n, sub0 = -0.5f * grid.voxel + 0.5f * sub;
+    int covered = 0;
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) {
+                Point3D p(center.x + sub0 + i * sub, center.y + sub0 + j * sub, center.z + sub0 + k * sub);
+                if (insideAnyCapsule(p, capsule_radii)) covered++;
+            }
+        }
+    }
+    return (covered * 255 + 32) / 64;
+}
+
+static int commandVoxelize(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    int resolution = (argc >= 4) ? atoi(argv[3]) : 256;
+    if (resolution < 1 || resolution > 2048) {
+        std::cerr << "Erro: resolução deve estar entre 1 e 2048" << std::endl;
+        return 1;
+    }
+    int mode = VOXEL_PARTIAL;
+    if (argc >= 5) {
+        std::string m = argv[4];
+        if (m == "ocupacao") {
+            mode = VOXEL_OCCUPANCY;
+        } else if (m != "parcial") {
+            std::cerr << "Erro: modo deve ser 'ocupacao' ou 'parcial'" << std::endl;
+            return 1;
+        }
+    }
+    bool from_file = false;
+    float radius_scale = 1.0f;
+    if (argc >= 6 && !parseRadiusArgument(argv[5], from_file, radius_scale)) return 1;
+
+    if (!readVTKFile3D(argv[2], true)) return 1;
+    std::vector<float> capsule_radii(lines.size());
+    for (size_t s = 0; s < lines.size(); s++) {
+        capsule_radii[s] = from_file ? radii[s] * radius_scale : getDisplayRadius(s);
+    }
+    VoxelGrid& grid = voxel_grid;
+    voxelizeCapsules(capsule_radii, resolution, mode, grid);
+    size_t n_voxels = grid.voxelCount();
+
+    // Conferência: metade da amostra em voxels quaisquer, metade em voxels
+    // com vaso, contra o teste de todas as cápsulas (volume parcial: 4³
+    // amostras, as mesmas do voxelizador)
+    int samples = (int)std::max<size_t>(16, std::min<size_t>(1024, 100000000 / (64 * lines.size() + 1)));
+    std::mt19937 rng(12345);
+    int wrong = 0, tested = 0;
+    for (int k = 0; k < 50 * samples && tested < samples; k++) {
+        int x = (int)(rng() % grid.dims[0]), y = (int)(rng() % grid.dims[1]), z = (int)(rng() % grid.dims[2]);
+        unsigned char got = grid.values[grid.index(x, y, z)];
+        if (tested % 2 == 1 && got == 0) continue;
+        tested++;
+        int expected = bruteForceVoxel(grid, capsule_radii, x, y, z);
+        // Uma amostra de diferença tolerada (arredondamento na borda)
+        if (std::abs((int)got - expected) > 4) wrong++;
+    }
+
+    // Densidade por bloco
+    size_t with_vessels = 0;
+    float densest = 0.0f;
+    size_t densest_tile = 0;
+    for (size_t t = 0; t < grid.tileCount(); t++) {
+        if (grid.tile_fraction[t] > 0.0f) with_vessels++;
+        if (grid.tile_fraction[t] > densest) {
+            densest = grid.tile_fraction[t];
+            densest_tile = t;
+        }
+    }
+    double box_volume = (double)n_voxels * grid.voxel * grid.voxel * grid.voxel;
+
+    std::cout << "\n=== Voxelização: " << getFilename(argv[2]) << " (" << lines.size() << " segmentos, "
+              << voxelModeName(mode) << ", " << (from_file ? "raio do arquivo" : "raio de exibição")
+              << (from_file ? " × " + std::to_string(radius_scale).substr(0, 8) : std::string()) << ", "
+              << parallelThreadCount() << " threads) ===" << std::endl;
+    std::cout << "  Grade: " << grid.dims[0] << " x " << grid.dims[1] << " x " << grid.dims[2] << " = " << n_voxels
+              << " voxels (aresta " << grid.voxel << "), " << n_voxels / (1024 * 1024) << " MB" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  BVH: " << grid.bvh_ms << " ms; rasterização: " << grid.raster_ms << " ms" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(4);
+    std::cout << "  Blocos de " << VOXEL_TILE << "³: " << grid.tileCount() << " (" << grid.tiles_empty
+              << " sem cápsulas); pares bloco x cápsula: " << grid.capsule_tests << std::endl;
+    std::cout << "  Volume ocupado: " << grid.occupied_volume << " (" << 100.0 * grid.occupied_volume / box_volume
+              << "% da caixa); soma de π r² L: " << grid.capsule_volume << std::endl;
+    std::cout << "  Blocos com vasos: " << with_vessels << "; mais denso: " << 100.0 * densest << "% (bloco "
+              << densest_tile % grid.tiles[0] << ", " << densest_tile / grid.tiles[0] % grid.tiles[1] << ", "
+              << densest_tile / ((size_t)grid.tiles[0] * grid.tiles[1]) << ")" << std::endl;
+    std::cout << "  Conferência em " << tested << " voxels (todas as cápsulas): " << wrong << " diferentes" << std::endl;
+
+    if (argc >= 7) {
+        if (!writeVoxelVolume(argv[6], grid)) return 1;
+        std::cout << "  Volume em " << argv[6] << " (cabeçalho .mhd ao lado)" << std::endl;
+    }
+    if (argc >= 8) {
+        std::ofstream csv(argv[7]);
+        if (!csv) {
+            std::cerr << "Erro: não foi possível criar " << argv[7] << std::endl;
+            return 1;
+        }
+        csv << "bloco_x,bloco_y,bloco_z,centro_x,centro_y,centro_z,fracao_vascular\n" << std::setprecision(7);
+        float half = 0.5f * VOXEL_TILE * grid.voxel;
+        for (size_t t = 0; t < grid.tileCount(); t++) {
+            int tx = (int)(t % grid.tiles[0]);
+            int ty = (int)(t / grid.tiles[0] % grid.tiles[1]);
+            int tz = (int)(t / ((size_t)grid.tiles[0] * grid.tiles[1]));
+            csv << tx << ',' << ty << ',' << tz << ','
+                << grid.origin[0] + (tx * VOXEL_TILE - 0.5f) * grid.voxel + half << ','
+                << grid.origin[1] + (ty * VOXEL_TILE - 0.5f) * grid.voxel + half << ','
+                << grid.origin[2] + (tz * VOXEL_TILE - 0.5f) * grid.voxel + half << ','
+                << grid.tile_fraction[t] << '\n';
+        }
+        std::cout << "  Densidade por bloco em " << argv[7] << std::endl;
+    }
+    return 0;
+}
+
+// ============================================================
+// --surface
+// ============================================================
+
+static int commandSurface(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    int resolution = (argc >= 4) ? atoi(argv[3]) : 256;
+    if (resolution < 1 || resolution > 4096) {
+        std::cerr << "Erro: resolução deve estar entre 1 e 4096" << std::endl;
+        return 1;
+    }
+    bool from_file = false;
+    float radius_scale = 1.0f;
+    if (argc >= 5 && !parseRadiusArgument(argv[4], from_file, radius_scale)) return 1;
+    float min_radius_cells = (argc >= 6) ? (float)atof(argv[5]) : 0.87f;
+
+    if (!readVTKFile3D(argv[2], true)) return 1;
+    std::vector<float> capsule_radii(lines.size());
+    double capsule_volume = 0.0;
+    for (size_t s = 0; s < lines.size(); s++) {
+        capsule_radii[s] = from_file ? radii[s] * radius_scale : getDisplayRadius(s);
+        double r = capsule_radii[s];
+        capsule_volume += M_PI * r * r * (points[lines[s].p1] - points[lines[s].p0]).length();
+    }
+    SurfaceMesh mesh;
+    buildVesselSurface(capsule_radii, resolution, min_radius_cells, mesh);
+    SurfaceCheck check;
+    checkSurface(mesh, check);
+    bool closed = check.boundary_edges == 0 && check.nonmanifold_edges == 0 && check.misoriented_edges == 0;
+
+    std::cout << "\n=== Superfície: " << getFilename(argv[2]) << " (" << lines.size() << " segmentos, "
+              << (from_file ? "raio do arquivo × " + std::to_string(radius_scale).substr(0, 8) : std::string("raio de exibição"))
+              << ", " << parallelThreadCount() << " threads) ===" << std::endl;
+    std::cout << "  Grade: " << mesh.cells[0] << " x " << mesh.cells[1] << " x " << mesh.cells[2]
+              << " células (aresta " << mesh.cell << "); raio mínimo " << mesh.min_radius << " ("
+              << mesh.thickened << " segmentos engrossados)" << std::endl;
+    std::cout << "  Blocos de " << SURFACE_BLOCK << "³: " << mesh.blocks << " (" << mesh.blocks_near
+              << " com cápsulas, " << mesh.blocks_crossed << " cortados); pares bloco x cápsula: "
+              << mesh.capsule_tests << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  BVH: " << mesh.bvh_ms << " ms; campo + marching cubes: " << mesh.march_ms << " ms; solda: "
+              << mesh.weld_ms << " ms" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(4);
+    std::cout << "  Malha: " << mesh.vertexCount() << " vértices, " << mesh.triangleCount() << " triângulos, "
+              << check.edges << " arestas (Euler " << check.euler << "), " << check.components << " componentes ("
+              << check.cavities << " cavidades)"
+              << std::endl;
+    std::cout << "  Arestas abertas: " << check.boundary_edges << "; em 3+ triângulos: " << check.nonmanifold_edges
+              << "; sentido trocado: " << check.misoriented_edges << "; triângulos degenerados: "
+              << check.degenerate_triangles << std::endl;
+    std::cout << "  Área: " << check.area << "; volume interno: " << check.volume << " (soma de π r² L: "
+              << capsule_volume << ")" << std::endl;
+    std::cout << "  " << (closed ? "Fechada e orientada" : "ABERTA") << std::endl;
+
+    if (argc >= 7) {
+        if (!writeSurfaceMesh(argv[6], mesh)) return 1;
+        std::cout << "  Malha em " << argv[6] << std::endl;
+    }
+    return closed ? 0 : 2;
+}
+
+// ============================================================
+// --ao
+// ============================================================
+
+static int commandAmbientOcclusion(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    AmbientOcclusion& ao = ambient_occlusion;
+    ao.rays = (argc >= 4) ? atoi(argv[3]) : 12;
+    ao.reach = (argc >= 5) ? (float)atof(argv[4]) : 4.0f;
+    if (ao.rays < 1 || ao.rays > 1024) {
+        std::cerr << "Erro: raios por amostra devem estar entre 1 e 1024" << std::endl;
+        return 1;
+    }
+    if (!(ao.reach > 0.0f)) {
+        std::cerr << "Erro: alcance deve ser positivo" << std::endl;
+        return 1;
+    }
+
+    if (!readVTKFile3D(argv[2], true)) return 1;
+    invalidateAmbientOcclusion();
+    continueAmbientOcclusion(-1.0);
+    size_t n_samples = ao.visibility.size();
+    if (n_samples == 0) {
+        std::cerr << "Erro: árvore sem segmentos" << std::endl;
+        return 1;
+    }
+
+    // Distribuição da visibilidade: amostras enterradas em vasos vizinhos
+    // (0), livres (1) e a média
+    size_t buried = 0, open = 0;
+    double sum = 0.0;
+    size_t histogram[5] = {0, 0, 0, 0, 0};
+    for (unsigned char v : ao.visibility) {
+        if (v == 0) buried++;
+        if (v == 255) open++;
+        sum += v;
+        histogram[std::min(4, v * 5 / 255)]++;
+    }
+
+    // Conferência: amostras sorteadas contra todos os segmentos (sem BVH)
+    const int SAMPLES = 512;
+    std::mt19937 rng(12345);
+    int wrong = 0;
+    auto brute_start = std::chrono::steady_clock::now();
+    for (int k = 0; k < SAMPLES; k++) {
+        size_t seg = rng() % lines.size();
+        int sample = (int)(rng() % AO_SAMPLES);
+        int free_rays = ao.rays - countOccludedRays(seg, sample);
+        if (ao.visibility[seg * AO_SAMPLES + sample] != (free_rays * 255 + ao.rays / 2) / ao.rays) wrong++;
+    }
+    double brute_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - brute_start).count();
+
+    double total_rays = (double)n_samples * ao.rays;
+    std::cout << "\n=== Oclusão ambiente: " << getFilename(argv[2]) << " (" << lines.size() << " segmentos, "
+              << parallelThreadCount() << " threads) ===" << std::endl;
+    std::cout << "  Amostras: " << n_samples << " (" << AO_SAMPLES << " por segmento), " << ao.rays
+              << " raios cada, alcance " << ao.reach << " raios de exibição" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Cálculo: " << ao.bake_ms << " ms (" << total_rays / (1e3 * ao.bake_ms) << " milhões de raios/s, "
+              << (double)ao.candidate_tests / n_samples << " cápsulas por amostra)" << std::endl;
+    std::cout << "  Força bruta estimada: " << brute_ms / SAMPLES * n_samples / 1000.0 << " s ("
+              << 1e3 * brute_ms / SAMPLES << " µs por amostra)" << std::endl;
+    std::cout << "  Visibilidade média: " << sum / (255.0 * n_samples) << "; enterradas: "
+              << 100.0 * buried / n_samples << "%; livres: " << 100.0 * open / n_samples << "%" << std::endl;
+    std::cout << "  Por faixa de visibilidade:";
+    for (int b = 0; b < 5; b++) {
+        std::cout << " " << 100.0 * histogram[b] / n_samples << "%";
+    }
+    std::cout << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << "  Conferência em " << SAMPLES << " amostras: " << wrong << " diferentes" << std::endl;
+    return wrong == 0 ? 0 : 2;
+}
+
+// ============================================================
+// --shadows
+// ============================================================
+
+// Ponto dentro de outra cápsula (nas junções): fica escondido e o mapa não
+// tem como separá-lo da superfície do vizinho
+static bool insideOtherCapsule(const Point3D& p, size_t segment) {
+    for (size_t s = 0; s < lines.size(); s++) {
+        if (s == segment) continue;
+        const Point3D& a = points[lines[s].p0];
+        Point3D d = points[lines[s].p1] - a;
+        float dd = dotProduct(d, d);
+        float t = (dd > 0.0f) ? std::max(0.0f, std::min(1.0f, dotProduct(p - a, d) / dd)) : 0.0f;
+        Point3D q = p - (a + d * t);
+        float radius = getDisplayRadius(s);
+        if (dotProduct(q, q) <= radius * radius) return true;
+    }
+    return false;
+}
+
+// Referência da conferência: algum outro segmento corta o trecho de p até
+// a luz (segmento contra eixo de cada cápsula, todos os segmentos)
+static bool blockedTowardLight(const Point3D& p, size_t segment) {
+    Point3D r = light.position - p;
+    float rr = dotProduct(r, r);
+    for (size_t s = 0; s < lines.size(); s++) {
+        if (s == segment) continue;
+        const Point3D& a = points[lines[s].p0];
+        Point3D d = points[lines[s].p1] - a;
+        float dd = dotProduct(d, d);
+        Point3D w = p - a;
+        float b = dotProduct(r, d), d1 = dotProduct(r, w), d2 = dotProduct(d, w);
+        float denom = rr * dd - b * b;
+        float u = (denom > 1e-12f) ? std::max(0.0f, std::min(1.0f, (b * d2 - dd * d1) / denom)) : 0.0f;
+        float t = (dd > 1e-12f) ? (b * u + d2) / dd : 0.0f;
+        if (t < 0.0f) {
+            t = 0.0f;
+            u = std::max(0.0f, std::min(1.0f, -d1 / rr));
+        } else if (t > 1.0f) {
+            t = 1.0f;
+            u = std::max(0.0f, std::min(1.0f, (b - d1) / rr));
+        }
+        Point3D diff = (p + r * u) - (a + d * t);
+        float radius = getDisplayRadius(s);
+        if (dotProduct(diff, diff) <= radius * radius) return true;
+    }
+    return false;
+}
+
+static int commandShadows(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    int resolution = (argc >= 4) ? atoi(argv[3]) : 1024;
+    if (resolution < 16 || resolution > 16384) {
+        std::cerr << "Erro: resolução deve estar entre 16 e 16384" << std::endl;
+        return 1;
+    }
+
+    if (!readVTKFile3D(argv[2], true)) return 1;
+    const ShadowMap& map = shadow_map;
+    updateShadowMap(resolution);
+    if (map.light_inside) {
+        std::cerr << "Erro: a luz está dentro da esfera envolvente da árvore" << std::endl;
+        return 1;
+    }
+    double first_ms = map.build_ms;
+
+    // Órbita: a câmera não entra no mapa, então as chamadas seguintes
+    // (uma por quadro na janela) só conferem a chave do cache
+    const int ORBIT_FRAMES = 144;
+    size_t builds_before = map.builds;
+    auto orbit_start = std::chrono::steady_clock::now();
+    for (int f = 0; f < ORBIT_FRAMES; f++) {
+        camera.azimuth = 360.0f * f / ORBIT_FRAMES;
+        camera.updateEye();
+        updateShadowMap(resolution);
+    }
+    double orbit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - orbit_start).count();
+    size_t orbit_builds = map.builds - builds_before;
+
+    // Consultas: 8 pontos em cada anel das pontas, como os vértices da
+    // malha; só os que encaram a luz importam para o difuso
+    const int RING = 8;
+    std::vector<Point3D> query_points;
+    std::vector<int> query_segments;
+    for (size_t s = 0; s < lines.size(); s++) {
+        const Point3D& p0 = points[lines[s].p0];
+        const Point3D& p1 = points[lines[s].p1];
+        Point3D dir = p1 - p0;
+        if (dir.length() < 0.0001f) continue;
+        dir.normalize();
+        Point3D u, v;
+        ringBasis(dir, u, v);
+        float r = getDisplayRadius(s);
+        for (int j = 0; j < RING; j++) {
+            float angle = 2.0f * (float)M_PI * j / RING;
+            Point3D n = u * cosf(angle) + v * sinf(angle);
+            for (int e = 0; e < 2; e++) {
+                Point3D p = (e == 0 ? p0 : p1) + n * r;
+                Point3D to_light = light.position - p;
+                if (dotProduct(n, to_light) <= 0.0f) continue;
+                query_points.push_back(p);
+                query_segments.push_back((int)s);
+            }
+        }
+    }
+    size_t n_queries = query_points.size();
+    if (n_queries == 0) {
+        std::cerr << "Erro: nenhum vértice voltado para a luz" << std::endl;
+        return 1;
+    }
+    std::vector<float> lit(n_queries);
+    auto lookup_start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < n_queries; q++) {
+        lit[q] = shadowLitFraction(query_points[q], query_segments[q],
+                                   0.5f * getDisplayRadius(query_segments[q]));
+    }
+    double lookup_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lookup_start).count();
+    size_t shadowed = 0, partial = 0;
+    for (float l : lit) {
+        if (l < 0.5f) shadowed++;
+        if (l > 0.0f && l < 1.0f) partial++;
+    }
+
+    // Conferência: pontos sorteados contra o raio exato até a luz. Os
+    // enterrados num vizinho ficam de fora; nos outros o mapa erra perto das
+    // bordas das sombras (texel, PCF) e nos vasos a menos de meio raio (folga)
+    const int SAMPLES = 2048;
+    std::mt19937 rng(12345);
+    int agree = 0, missed = 0, extra = 0, buried = 0;
+    auto brute_start = std::chrono::steady_clock::now();
+    for (int k = 0; k < SAMPLES; k++) {
+        size_t q = rng() % n_queries;
+        if (insideOtherCapsule(query_points[q], query_segments[q])) {
+            buried++;
+            continue;
+        }
+        bool exact = blockedTowardLight(query_points[q], query_segments[q]);
+        bool mapped = lit[q] < 0.5f;
+        if (exact == mapped) agree++;
+        else if (exact) missed++;
+        else extra++;
+    }
+    double brute_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - brute_start).count();
+
+    size_t texels = (size_t)map.resolution * map.resolution;
+    std::cout << "\n=== Sombras: " << getFilename(argv[2]) << " (" << lines.size() << " segmentos, "
+              << parallelThreadCount() << " threads) ===" << std::endl;
+    std::cout << "  Mapa: " << map.resolution << " x " << map.resolution << " (" << texels * 8 / (1024 * 1024)
+              << " MB com os segmentos), " << (texels + SHADOW_BAND * map.resolution - 1) / (SHADOW_BAND * map.resolution)
+              << " faixas, " << map.band_entries << " pares faixa x segmento" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "  Construção: " << first_ms << " ms; " << 100.0 * map.texels_covered / texels
+              << "% dos texels com tubo" << std::endl;
+    std::cout << "  Órbita de " << ORBIT_FRAMES << " quadros: " << orbit_builds << " reconstruções, "
+              << orbit_ms << " ms no total" << std::endl;
+    std::cout << "  Consultas (PCF 2x2): " << n_queries << " vértices voltados para a luz em " << lookup_ms
+              << " ms (" << 1e6 * lookup_ms / n_queries << " ns cada); na sombra: "
+              << 100.0 * shadowed / n_queries << "%; na penumbra do filtro: " << 100.0 * partial / n_queries << "%"
+              << std::endl;
+    std::cout << "  Força bruta estimada: " << brute_ms / SAMPLES * n_queries / 1000.0 << " s ("
+              << 1e3 * brute_ms / SAMPLES << " µs por vértice)" << std::endl;
+    std::cout << "  Conferência em " << SAMPLES << " vértices (" << buried << " enterrados em vizinhos, fora): "
+              << 100.0 * agree / std::max(1, SAMPLES - buried) << "% iguais (" << missed << " sombras perdidas, "
+              << extra << " a mais)" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    return 0;
+}
+
+// ============================================================
+// --filter
+// ============================================================
+
+static int commandFilter(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    int metric = (argc >= 4) ? atoi(argv[3]) : METRIC_RADIUS;
+    if (metric < 0 || metric >= METRIC_COUNT) {
+        std::cerr << "Erro: atributo deve estar entre 0 e " << METRIC_COUNT - 1 << std::endl;
+        return 1;
+    }
+
+    if (!readVTKFile3D(argv[2], true)) return 1;
+    beginTreeGeometry();
+    while (!treeGeometryComplete()) continueTreeGeometry(1e9);
+    const float* values = radii.data();
+    if (metric != METRIC_RADIUS) values = updateMorphometry().values[metric].data();
+    const RangeFilter& f = range_filter;
+    if (!updateRangeFilterIndex(metric) || f.order.empty()) {
+        std::cerr << "Erro: atributo sem valores definidos nesta árvore" << std::endl;
+        return 1;
+    }
+
+    // Janelas sorteadas de até 10% da barra (alguns passos das setas),
+    // consultadas pelo índice e pela varredura de todos os segmentos (que
+    // também monta o buffer de índices) em laços separados, para nenhum
+    // dos dois achar os blocos da malha no cache do outro
+    const int QUERIES = 200;
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<float> lows(QUERIES), highs(QUERIES);
+    for (int q = 0; q < QUERIES; q++) {
+        lows[q] = unit(rng) * 0.9f;
+        highs[q] = lows[q] + 0.1f * unit(rng);
+    }
+    size_t n = lines.size();
+    std::vector<unsigned int> indices, scan_indices;
+    std::vector<size_t> counts(QUERIES);
+    double query_us = 0.0, build_ms = 0.0, scan_select_ms = 0.0, scan_ms = 0.0;
+    size_t shown = 0;
+    for (int q = 0; q < QUERIES; q++) {
+        setRangeFilterBounds(lows[q], highs[q]);
+        query_us += f.query_us;
+        auto build_start = std::chrono::steady_clock::now();
+        counts[q] = buildRangeFilterIndices(tree_mesh, nullptr, indices);
+        build_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_start).count();
+        shown += counts[q];
+    }
+
+    int wrong = 0;
+    std::vector<unsigned char> in_range(n);
+    for (int q = 0; q < QUERIES; q++) {
+        setRangeFilterBounds(lows[q], highs[q]);
+        float lo = rangeFilterValue(f.low), hi = rangeFilterValue(f.high);
+        auto scan_start = std::chrono::steady_clock::now();
+        size_t scan_count = 0;
+        for (size_t s = 0; s < n; s++) {
+            in_range[s] = values[s] >= lo && values[s] <= hi;
+            scan_count += in_range[s];
+        }
+        scan_select_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scan_start).count();
+        scan_indices.clear();
+        for (size_t s = 0; s < n; s++) {
+            if (!in_range[s]) continue;
+            size_t at = scan_indices.size();
+            scan_indices.resize(at + tree_mesh.indices_per_segment);
+            writeSegmentIndices(tree_mesh, s, &scan_indices[at]);
+        }
+        scan_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scan_start).count();
+
+        // Mesmo conjunto: contagem igual e todo segmento do índice na
+        // varredura; o buffer, igual ao da varredura (as duas em ordem de layout)
+        bool same = scan_count == counts[q];
+        for (size_t k = f.first; same && k < f.last; k++) same = in_range[f.order[k]] != 0;
+        if (same) {
+            buildRangeFilterIndices(tree_mesh, nullptr, indices);
+            same = indices == scan_indices;
+        }
+        if (!same) wrong++;
+    }
+
+    std::cout << "\n=== Filtro por faixa: " << getFilename(argv[2]) << " (" << n << " segmentos, atributo "
+              << metricName(metric) << ") ===" << std::endl;
+    std::cout << "  Índice: " << f.order.size() << " segmentos com valor, em [" << f.min_value << ", "
+              << f.max_value << "]" << (f.log_scale ? " (escala log)" : "");
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << ", ordenado em " << f.sort_ms << " ms" << std::endl;
+    std::cout << "  " << QUERIES << " faixas sorteadas, " << 100.0 * shown / ((double)QUERIES * n)
+              << "% dos segmentos visíveis em média (" << tree_mesh.indices_per_segment << " índices por segmento)"
+              << std::endl;
+    std::cout << "  Seleção: busca binária " << query_us / QUERIES << " µs, varredura "
+              << 1e3 * scan_select_ms / QUERIES << " µs (" << 1e3 * scan_select_ms / std::max(1e-9, query_us)
+              << "x)" << std::endl;
+    std::cout << "  Seleção + buffer compacto: índice " << (build_ms + 1e-3 * query_us) / QUERIES
+              << " ms, varredura " << scan_ms / QUERIES << " ms por faixa" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << "  Conferência: " << wrong << " faixas diferentes da varredura" << std::endl;
+    return wrong == 0 ? 0 : 2;
+}
+
+// ============================================================
+// --check-oit
+// ============================================================
+
+// Fragmento de um pixel: distância ao olho, cor RGBA8 iluminada e segmento
+struct OITFragment {
+    float depth;
+    unsigned char color[4];
+    int segment;
+};
+
+// Camadas de um pixel: cada cápsula atingida vira as duas paredes do tubo
+// (a malha não descarta faces de trás), com a cor do Flat na normal de cada
+// parede, como a malha em bytes
+static void collectPixelFragments(const Point3D& eye, const Point3D& dir, std::vector<int>& hits,
+                                  std::vector<float>& hit_t, std::vector<OITFragment>& out) {
+    out.clear();
+    raycastAllSegments(eye, dir, hits, hit_t);
+    float range_r = std::max(1e-6f, radius_max - radius_min);
+    for (size_t k = 0; k < hits.size(); k++) {
+        int s = hits[k];
+        const Point3D& a = points[lines[s].p0];
+        Point3D axis = points[lines[s].p1] - a;
+        Point3D p = eye + dir * hit_t[k];
+        float len2 = dotProduct(axis, axis);
+        float u = (len2 > 1e-12f) ? std::max(0.0f, std::min(1.0f, dotProduct(p - a, axis) / len2)) : 0.0f;
+        Point3D q = a + axis * u;
+        Point3D off = p - q;
+        float r = getDisplayRadius(s);
+        float h = sqrtf(std::max(0.0f, r * r - dotProduct(off, off)));
+
+        float base[3];
+        getColorFromRadius(std::min(1.0f, std::max(0.0f, (radii[s] - radius_min) / range_r)), base[0], base[1],
+                           base[2]);
+        for (int side = -1; side <= 1; side += 2) {
+            Point3D normal = (p + dir * (side * h)) - q;
+            if (normal.length() < 1e-12f) normal = dir * -1.0f;
+            normal.normalize();
+            float rgb[3];
+            shadeFlat(normal, base[0], base[1], base[2], rgb);
+            OITFragment f;
+            f.depth = hit_t[k] + side * h;
+            for (int c = 0; c < 3; c++) f.color[c] = (unsigned char)(255.0f * rgb[c] + 0.5f);
+            f.color[3] = 255;
+            f.segment = s;
+            out.push_back(f);
+        }
+    }
+}
+
+// Soma dos fragmentos escalados no acumulador de 8 bits (o blending
+// GL_ONE, GL_ONE satura em 255 a cada fragmento)
+static void accumulateOIT(const std::vector<OITFragment>& frags, const std::vector<float>& factors,
+                          unsigned char out[4]) {
+    int sum[4] = {0, 0, 0, 0};
+    for (const OITFragment& f : frags) {
+        unsigned char scaled[4];
+        scaleOITColor(f.color, factors[f.segment], scaled);
+        for (int c = 0; c < 4; c++) sum[c] = std::min(255, sum[c] + scaled[c]);
+    }
+    for (int c = 0; c < 4; c++) out[c] = (unsigned char)sum[c];
+}
+
+// Erro de cada variante contra a referência: média e percentil 99 do maior
+// desvio entre os canais, em níveis de 8 bits, nos pixels cobertos
+struct OITError {
+    std::vector<float> diffs;
+
+    void add(const unsigned char* px, const float ref[3]) {
+        float d = 0.0f;
+        for (int c = 0; c < 3; c++) d = std::max(d, fabsf(px[c] - 255.0f * ref[c]));
+        diffs.push_back(d);
+    }
+    double mean() const {
+        double sum = 0.0;
+        for (float d : diffs) sum += d;
+        return diffs.empty() ? 0.0 : sum / diffs.size();
+    }
+    float percentile99() {
+        if (diffs.empty()) return 0.0f;
+        size_t k = (size_t)(0.99 * (diffs.size() - 1));
+        std::nth_element(diffs.begin(), diffs.begin() + k, diffs.end());
+        return diffs[k];
+    }
+};
+
+static bool checkOITView(const char* label, int width, int height) {
+    const float aspect = (float)width / (float)height;
+    Point3D f = camera.center - camera.eye;
+    f.normalize();
+    Point3D side = crossProduct(f, camera.up);
+    side.normalize();
+    Point3D up = crossProduct(side, f);
+    float tan_y = tanf(camera.fovy * 0.5f * (float)M_PI / 180.0f);
+
+    // Pesos e escala como no quadro da janela
+    std::vector<float> weights;
+    computeOITWeights(weights);
+
+    size_t npix = (size_t)width * height;
+    std::vector<std::vector<OITFragment> > pixels(npix);
+    std::vector<unsigned char> counts(npix);
+    std::vector<int> hits;
+    std::vector<float> hit_t;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float sx = (2.0f * (x + 0.5f) / width - 1.0f) * tan_y * aspect;
+            float sy = (2.0f * (y + 0.5f) / height - 1.0f) * tan_y;
+            Point3D dir = f + side * sx + up * sy;
+            dir.normalize();
+            size_t i = (size_t)y * width + x;
+            collectPixelFragments(camera.eye, dir, hits, hit_t, pixels[i]);
+            counts[i] = (unsigned char)std::min<size_t>(255, pixels[i].size());
+        }
+    }
+
+    // Escala fixa antiga (alpha * peso / 8) e calibrada como na janela: a
+    // partir do limite inicial, um quadro por nova escala até estabilizar
+    std::vector<float> old_factors(lines.size()), new_factors(lines.size());
+    for (size_t s = 0; s < lines.size(); s++) old_factors[s] = transparency_alpha * weights[s] * 0.125f;
+    std::vector<unsigned char> old_image(npix * 4), new_image(npix * 4);
+    for (size_t i = 0; i < npix; i++) accumulateOIT(pixels[i], old_factors, &old_image[4 * i]);
+
+    oit_scale.layers = OIT_DEFAULT_LAYERS;
+    int frames = 0;
+    for (;;) {
+        for (size_t s = 0; s < lines.size(); s++) new_factors[s] = oit_scale.factor(weights[s]);
+        for (size_t i = 0; i < npix; i++) accumulateOIT(pixels[i], new_factors, &new_image[4 * i]);
+        frames++;
+        int layers = calibrateOITLayers(new_image.data(), counts.data(), npix);
+        if (layers == oit_scale.layers || frames == 8) break;
+        oit_scale.layers = layers;
+    }
+    const float bg[3] = {0.0f, 0.0f, 0.0f};
+    resolveOITPixels(old_image.data(), counts.data(), npix, bg);
+    resolveOITPixels(new_image.data(), counts.data(), npix, bg);
+
+    // Referências: blending ordenado de trás para a frente e a mesma média
+    // ponderada do OIT em ponto flutuante (só o erro de quantização)
+    OITError old_sorted, new_sorted, float_sorted, old_quant, new_quant;
+    size_t covered = 0, saturated = 0;
+    for (size_t i = 0; i < npix; i++) {
+        std::vector<OITFragment>& frags = pixels[i];
+        if (frags.empty()) continue;
+        covered++;
+        float weight_sum = 0.0f;
+        for (const OITFragment& fr : frags) weight_sum += weights[fr.segment];
+        if (weight_sum > oit_scale.layers * oit_scale.max_weight) saturated++;
+
+        std::sort(frags.begin(), frags.end(),
+                  [](const OITFragment& a, const OITFragment& b) { return a.depth > b.depth; });
+        float sorted[3] = {bg[0], bg[1], bg[2]};
+        float sum[3] = {0.0f, 0.0f, 0.0f};
+        float sum_w = 0.0f;
+        for (const OITFragment& fr : frags) {
+            float w = weights[fr.segment];
+            for (int c = 0; c < 3; c++) {
+                float col = fr.color[c] / 255.0f;
+                sorted[c] = transparency_alpha * col + (1.0f - transparency_alpha) * sorted[c];
+                sum[c] += col * w;
+            }
+            sum_w += w;
+        }
+        float reveal = powf(1.0f - transparency_alpha, (float)counts[i]);
+        float exact[3];
+        for (int c = 0; c < 3; c++) exact[c] = sum[c] / sum_w * (1.0f - reveal) + bg[c] * reveal;
+        unsigned char exact_px[3];
+        for (int c = 0; c < 3; c++) exact_px[c] = (unsigned char)(255.0f * exact[c] + 0.5f);
+
+        old_sorted.add(&old_image[4 * i], sorted);
+        new_sorted.add(&new_image[4 * i], sorted);
+        float_sorted.add(exact_px, sorted);
+        old_quant.add(&old_image[4 * i], exact);
+        new_quant.add(&new_image[4 * i], exact);
+    }
+
+    std::cout << "  " << label << ": " << covered << " pixels cobertos, limite calibrado " << oit_scale.layers
+              << " camadas em " << frames << " quadros (" << std::fixed << std::setprecision(2)
+              << 100.0 * saturated / std::max<size_t>(1, covered) << "% dos pixels saturam)" << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "variante" << std::right << std::setw(16)
+              << "vs ordenado" << std::setw(20) << "vs OIT em float" << std::endl;
+    std::cout << std::setprecision(1);
+    std::cout << "    " << std::left << std::setw(28) << "OIT em float" << std::right << std::setw(8)
+              << float_sorted.mean() << " / " << std::setw(5) << float_sorted.percentile99() << std::setw(20) << "-"
+              << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "8 bits, escala fixa 1/8" << std::right << std::setw(8)
+              << old_sorted.mean() << " / " << std::setw(5) << old_sorted.percentile99() << std::setw(12)
+              << old_quant.mean() << " / " << std::setw(5) << old_quant.percentile99() << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "8 bits, escala calibrada" << std::right << std::setw(8)
+              << new_sorted.mean() << " / " << std::setw(5) << new_sorted.percentile99() << std::setw(12)
+              << new_quant.mean() << " / " << std::setw(5) << new_quant.percentile99() << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    return new_quant.mean() <= old_quant.mean();
+}
+
+static int commandCheckOIT(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    int width = (argc >= 4) ? atoi(argv[3]) : 320;
+    if (width < 16 || width > 4096) {
+        std::cerr << "Erro: largura deve estar entre 16 e 4096" << std::endl;
+        return 1;
+    }
+    int height = width * 3 / 4;
+
+    if (!readVTKFile3D(argv[2], true)) return 1;
+    std::cout << "\n=== OIT x blending ordenado: " << getFilename(argv[2]) << " (" << lines.size()
+              << " segmentos, " << width << "x" << height << ", alpha " << transparency_alpha << ") ===" << std::endl;
+    std::cout << "  Erro em níveis de 8 bits (média / percentil 99 do maior desvio entre os canais)" << std::endl;
+
+    bool ok = checkOITView("Visão geral", width, height);
+    camera.distance = data_scale * 0.6f;
+    camera.updateEye();
+    ok = checkOITView("Voo próximo", width, height) && ok;
+    std::cout << "  Conferência: " << (ok ? "escala calibrada com erro de quantização menor ou igual ao da fixa"
+                                         : "escala calibrada pior que a fixa") << std::endl;
+    return ok ? 0 : 2;
+}
+
+// ============================================================
+// DESPACHO
+// ============================================================
+
+bool isHeadlessCommand(int argc, char** argv) {
+    return argc > 1 && std::string(argv[1]).compare(0, 2, "--") == 0;
+}
+
+int runHeadless(int argc, char** argv) {
+    std::string command = argv[1];
+
+    if (command == "--synthetic") return commandSynthetic(argc, argv);
+    if (command == "--bench-occlusion") return commandBenchOcclusion(argc, argv);
+    if (command == "--bench-locality") return commandBenchLocality(argc, argv);
+    if (command == "--bench-points") return commandBenchPoints(argc, argv);
+    if (command == "--memstats") return commandMemstats(argc, argv);
+    if (command == "--bench-growth") return commandBenchGrowth(argc, argv);
+    if (command == "--diff") return commandDiff(argc, argv);
+    if (command == "--morph") return commandMorph(argc, argv);
+    if (command == "--flow") return commandFlow(argc, argv);
+    if (command == "--paths") return commandPaths(argc, argv);
+    if (command == "--check") return commandCheck(argc, argv);
+    if (command == "--territories") return commandTerritories(argc, argv);
+    if (command == "--voxelize") return commandVoxelize(argc, argv);
+    if (command == "--surface") return commandSurface(argc, argv);
+    if (command == "--ao") return commandAmbientOcclusion(argc, argv);
+    if (command == "--shadows") return commandShadows(argc, argv);
+    if (command == "--filter") return commandFilter(argc, argv);
+    if (command == "--check-oit") return commandCheckOIT(argc, argv);
+
+    std::cerr << "Comando desconhecido: " << command << std::endl;
+    printUsage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,15 @@
+/*
+ * headless.h
+ * Modo sem janela (linha de comando) para benchmarks e ferramentas - TP2 (3D)
+ */
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Retorna true se os argumentos pedem um comando sem janela (--comando)
+bool isHeadlessCommand(int argc, char** argv);
+
+// Executa o comando e retorna o código de saída do programa
+int runHeadless(int argc, char** argv);
+
+#endif // HEADLESS_H
@@ -0,0 +1,101 @@
+/*
+ * hemodynamics.cpp
+ * Escoamento de Poiseuille na árvore (resistência, vazão, pressão) - TP2 (3D)
+ */
+
+#include "hemodynamics.h"
+#include "globals.h"
+#include "topology.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Comprimento do segmento: das somas de prefixo quando existem (acesso
+// sequencial, sem consultar points)
+static double segmentLength(int s, bool use_prefix) {
+    if (use_prefix) return topology.length_prefix[s + 1] - topology.length_prefix[s];
+    return (points[lines[s].p1] - points[lines[s].p0]).length();
+}
+
+void solvePoiseuille(std::vector<float>& resistance, std::vector<float>& flow,
+                     std::vector<float>& pressure, FlowSummary& summary) {
+    auto start = std::chrono::steady_clock::now();
+    size_t n = lines.size();
+    summary = FlowSummary();
+    resistance.assign(n, 0.0f);
+    flow.assign(n, 0.0f);
+    pressure.assign(n, 0.0f);
+    if (n == 0 || topology.parent.size() != n) return;
+
+    // Ordem das passadas: no layout em profundidade os filhos têm índice
+    // maior que o pai, então basta percorrer os segmentos de trás para
+    // frente (subida) e de frente para trás (descida); sem o layout, a ordem
+    // por geração
+    bool by_index = topology.hasSubtreeLayout() || topology.generation_order.size() != n;
+    const int* order = by_index ? nullptr : topology.generation_order.data();
+    bool use_prefix = topology.length_prefix.size() == n + 1;
+
+    // Subida: condutância equivalente da subárvore de cada segmento. Os
+    // filhos ficam em paralelo entre si e em série com o segmento; um
+    // terminal desemboca direto na pressão 0. Raio nulo = condutância 0.
+    std::vector<double> r_seg(n), g_eq(n);
+    for (size_t k = n; k-- > 0; ) {
+        int s = order ? order[k] : (int)k;
+        double r = radii[s];
+        r_seg[s] = poiseuilleResistance(segmentLength(s, use_prefix), r);
+        resistance[s] = (float)r_seg[s];
+
+        double g_children = 0.0;
+        for (const int* c = topology.childrenBegin(s); c != topology.childrenEnd(s); ++c) {
+            g_children += g_eq[*c];
+        }
+        if (r <= 0.0) {
+            g_eq[s] = 0.0;
+        } else if (topology.childCount(s) == 0) {
+            g_eq[s] = 1.0 / r_seg[s];
+        } else {
+            g_eq[s] = (g_children > 0.0) ? 1.0 / (r_seg[s] + 1.0 / g_children) : 0.0;
+        }
+    }
+
+    // Descida: vazão = pressão proximal × condutância equivalente; a queda
+    // no próprio segmento dá a pressão distal, que alimenta os filhos
+    std::vector<double> q(n), p_distal(n);
+    double inflow = 0.0;
+    for (size_t k = 0; k < n; k++) {
+        int s = order ? order[k] : (int)k;
+        int parent = topology.parent[s];
+        double p_proximal = (parent >= 0) ? p_distal[parent] : 1.0;
+        q[s] = p_proximal * g_eq[s];
+        p_distal[s] = (q[s] > 0.0) ? std::max(0.0, p_proximal - q[s] * r_seg[s]) : p_proximal;
+        if (parent < 0) inflow += q[s];
+    }
+
+    // Resumo: vazões relativas e uniformidade dos terminais (o CCO busca
+    // vazões terminais iguais)
+    double sum = 0.0, sum2 = 0.0, qmin = HUGE_VAL, qmax = 0.0;
+    size_t terminals = 0;
+    for (size_t s = 0; s < n; s++) {
+        double fraction = (inflow > 0.0) ? q[s] / inflow : 0.0;
+        flow[s] = (float)fraction;
+        pressure[s] = (float)p_distal[s];
+        if (q[s] <= 0.0) summary.blocked++;
+        if (topology.childCount((int)s) == 0) {
+            terminals++;
+            sum += fraction;
+            sum2 += fraction * fraction;
+            qmin = std::min(qmin, fraction);
+            qmax = std::max(qmax, fraction);
+        }
+    }
+    summary.inflow = inflow;
+    summary.tree_resistance = (inflow > 0.0) ? 1.0 / inflow : HUGE_VAL;
+    if (terminals > 0) {
+        double mean = sum / terminals;
+        double variance = std::max(0.0, sum2 / terminals - mean * mean);
+        summary.terminal_flow_min = qmin;
+        summary.terminal_flow_max = qmax;
+        summary.terminal_flow_cv = (mean > 0.0) ? sqrt(variance) / mean : 0.0;
+    }
+    summary.solve_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
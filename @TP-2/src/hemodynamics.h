@@ -0,0 +1,48 @@
+/*
+ * hemodynamics.h
+ * Escoamento de Poiseuille na árvore (resistência, vazão, pressão) - TP2 (3D)
+ */
+
+#ifndef HEMODYNAMICS_H
+#define HEMODYNAMICS_H
+
+#include <vector>
+#include <cstddef>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Grandezas normalizadas: pressão 1 na entrada de cada raiz e 0 na saída de
+// cada terminal, viscosidade 1 (as resistências ficam em unidades de μ, com
+// comprimentos e raios nas unidades do arquivo). Vazões, frações e pressões
+// não dependem dessas escolhas; valores absolutos são só um fator comum.
+struct FlowSummary {
+    double tree_resistance;      // Resistência equivalente vista da(s) raiz(es)
+    double inflow;               // Vazão total de entrada (= 1 / tree_resistance)
+    double terminal_flow_min;    // Vazões dos terminais, relativas à entrada
+    double terminal_flow_max;
+    double terminal_flow_cv;     // Coeficiente de variação das vazões terminais
+    size_t blocked;              // Segmentos sem vazão (raio nulo no caminho)
+    double solve_ms;
+
+    FlowSummary() : tree_resistance(0.0), inflow(0.0), terminal_flow_min(0.0), terminal_flow_max(0.0),
+                    terminal_flow_cv(0.0), blocked(0), solve_ms(0.0) {}
+};
+
+// Resistência de Poiseuille de um tubo (μ = 1); raio nulo bloqueia
+inline double poiseuilleResistance(double length, double r) {
+    double r2 = r * r;
+    return (r > 0.0) ? 8.0 * length / (M_PI * r2 * r2) : HUGE_VAL;
+}
+
+// Resolve o escoamento em O(n) sobre lines/radii/topology: resistência de
+// cada segmento por Poiseuille (8·L / (π·r⁴)), condutâncias equivalentes
+// das subárvores de baixo para cima e pressões e vazões de cima para baixo.
+// Saídas por segmento: resistance, flow (fração da vazão de entrada) e
+// pressure (no ponto distal; a proximal é a distal do pai, ou 1 na raiz).
+void solvePoiseuille(std::vector<float>& resistance, std::vector<float>& flow,
+                     std::vector<float>& pressure, FlowSummary& summary);
+
+#endif // HEMODYNAMICS_H
@@ -12,55 +12,181 @@
 #include "interface.h"
 #include "globals.h"
 #include "utils.h"
+#include "bvh.h"
+#include "occlusion.h"
+#include "mesh.h"
+#include "topology.h"
+#include "point_store.h"
+#include "memstats.h"
+#include "growth_diff.h"
+#include "morphometry.h"
+#include "tree_paths.h"
+#include "collision.h"
+#include "territories.h"
+#include "voxelizer.h"
+#include "ambient_occlusion.h"
+#include "oit.h"
+#include "shadow_map.h"
+#include "range_filter.h"
+#include "handlers.h"
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// ============================================================
+// TRANSPARÊNCIA (BLENDING E OIT)
+// ============================================================
+
+// Buffers de leitura usados na composição do OIT; oit_accum guarda a imagem
+// composta, redesenhada sem nova leitura enquanto a cena não muda
+static std::vector<unsigned char> oit_accum;
+static std::vector<unsigned char> oit_count;
+static bool oit_image_stale = true;
+static int oit_image_width = 0;
+static int oit_image_height = 0;
+static bool oit_image_preview = false;   // Imagem feita na prévia da interação
+
+// Custo da última composição completa (leitura, resolução, desenho) e do
+// último quadro, que pode ter só redesenhado a imagem
+static double oit_composite_ms = 0.0;
+static double oit_frame_ms = 0.0;
+static bool oit_image_reused = false;
+
+// Cores escaladas de cada malha a refazer (câmera, cores ou escala mudaram)
+static bool oit_tree_stale = true;
+static bool oit_preview_stale = true;
+
+static bool oitActive() {
+    return transparency_enabled && transparency_method == 1;
+}
+
+static void beginOITPass() {
+    // Acumulação: RGB += cor*alpha*peso, A += alpha*peso (soma, sem ordenação)
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glDepthMask(GL_FALSE);
+
+    // Stencil conta as camadas de cada pixel (revealage = (1 - alpha)^n)
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 0, 0xFF);
+    glStencilOp(GL_KEEP, GL_INCR, GL_INCR);
+}
+
+static void endOITPass() {
+    glDisable(GL_STENCIL_TEST);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+static void drawOITImage(int w, int h) {
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, w, 0, h);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glDisable(GL_DEPTH_TEST);
+    glRasterPos2i(0, 0);
+    glDrawPixels(w, h, GL_RGBA, GL_UNSIGNED_BYTE, oit_accum.data());
+    glEnable(GL_DEPTH_TEST);
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+}
+
+// A imagem composta ainda vale: nada que muda a árvore desenhada mudou
+// desde a última composição (ver updateRetainedState) e não há especular
+// pendente, que só avança dentro de drawTree3D
+static bool oitImageCurrent() {
+    bool refining = !interaction_active && refine_count < mesh_built_count;
+    return !oit_image_stale && !refining && oit_image_width == window_width &&
+           oit_image_height == window_height && oit_image_preview == interaction_active;
+}
+
+// Passo de composição em tela cheia: média ponderada * (1 - revealage)
+// sobre o fundo. Custo proporcional ao número de pixels, não de segmentos,
+// e com a leitura do framebuffer a GPU para até terminar o quadro; por isso
+// a imagem fica em cache e só é refeita quando a cena muda.
+static void compositeOIT(bool reuse) {
+    int w = window_width;
+    int h = window_height;
+    if (w <= 0 || h <= 0) return;
+
+    auto start = std::chrono::steady_clock::now();
+    oit_image_reused = reuse;
+    if (reuse) {
+        drawOITImage(w, h);
+        oit_frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return;
+    }
+
+    size_t npix = (size_t)w * (size_t)h;
+    oit_accum.resize(npix * 4);
+    oit_count.resize(npix);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, oit_accum.data());
+    glReadPixels(0, 0, w, h, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, oit_count.data());
+
+    // Calibração da escala pelo acumulador desta vista (antes da resolução,
+    // que sobrescreve os pixels)
+    int layers = calibrateOITLayers(oit_accum.data(), oit_count.data(), npix);
+
+    GLfloat bg[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, bg);
+    resolveOITPixels(oit_accum.data(), oit_count.data(), npix, bg);
+    drawOITImage(w, h);
+
+    oit_image_stale = false;
+    oit_image_width = w;
+    oit_image_height = h;
+    oit_image_preview = interaction_active;
+    oit_composite_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    oit_frame_ms = oit_composite_ms;
+
+    // Escala nova: as cores são escaladas de novo e um quadro extra refaz a
+    // imagem com ela
+    if (layers != oit_scale.layers) {
+        oit_scale.layers = layers;
+        oit_tree_stale = true;
+        oit_preview_stale = true;
+        oit_image_stale = true;
+        requestRedraw(DIRTY_HUD);
+    }
+}
+
 // ============================================================
 // FUNÇÕES DE ILUMINAÇÃO
 // ============================================================
 
-void setupLightingFlat(const Point3D& normal, float base_r, float base_g, float base_b) {
+void shadeFlat(const Point3D& normal, float base_r, float base_g, float base_b, float out[3], float visibility, float lit) {
     // Iluminação Flat - calcula apenas uma cor por face usando cores baseadas no raio
     Point3D lightDir = light.position;
     lightDir.normalize();
     
     float ndotl = dotProduct(normal, lightDir);
     if (ndotl < 0.0f) ndotl = 0.0f;
+    ndotl *= lit;
     
-    float ambient_intensity = 0.3f;
+    float ambient_intensity = 0.3f * visibility;
     float r = base_r * ambient_intensity + base_r * ndotl * 0.9f;
     float g = base_g * ambient_intensity + base_g * ndotl * 0.9f;
     float b = base_b * ambient_intensity + base_b * ndotl * 0.9f;
     
-    r = std::min(1.0f, std::max(0.0f, r));
-    g = std::min(1.0f, std::max(0.0f, g));
-    b = std::min(1.0f, std::max(0.0f, b));
-    
-    glColor3f(r, g, b);
-}
-
-void setupLightingFlat(const Point3D& normal) {
-    // Versão sem cores customizadas
-    Point3D lightDir = light.position;
-    lightDir.normalize();
-    
-    float ndotl = dotProduct(normal, lightDir);
-    if (ndotl < 0.0f) ndotl = 0.0f;
-    
-    float r = material_ambient[0] + material_diffuse[0] * ndotl;
-    float g = material_ambient[1] + material_diffuse[1] * ndotl;
-    float b = material_ambient[2] + material_diffuse[2] * ndotl;
-    
-    r = std::min(1.0f, std::max(0.0f, r));
-    g = std::min(1.0f, std::max(0.0f, g));
-    b = std::min(1.0f, std::max(0.0f, b));
-    
-    glColor3f(r, g, b);
+    out[0] = std::min(1.0f, std::max(0.0f, r));
+    out[1] = std::min(1.0f, std::max(0.0f, g));
+    out[2] = std::min(1.0f, std::max(0.0f, b));
 }
 
 void getColorFromRadius(float normalized_radius, float& r, float& g, float& b) {
@@ -107,8 +233,8 @@ void getColorFromRadius(float normalized_radius, float& r, float& g, float& b) {
     }
 }
 
-void setupLightingPhong(const Point3D& vertex, const Point3D& normal, const Point3D& eye, 
-                         float base_r, float base_g, float base_b) {
+void shadePhong(const Point3D& vertex, const Point3D& normal, const Point3D& eye,
+                float base_r, float base_g, float base_b, bool specular_enabled, float out[3], float visibility, float lit) {
     // Iluminação Phong - calcula cor considerando ambiente, difuso e especular
     // Usa cores baseadas no raio do segmento
     Point3D lightDir = light.position - vertex;
@@ -117,286 +243,540 @@ void setupLightingPhong(const Point3D& vertex, const Point3D& normal, const Poin
     Point3D viewDir = eye - vertex;
     viewDir.normalize();
     
-    // Componente ambiente (usar cor base com intensidade reduzida)
-    float ambient_intensity = 0.3f;
+    // Componente ambiente (usar cor base com intensidade reduzida), menos a
+    // parte do céu que os vasos vizinhos encobrem
+    float ambient_intensity = 0.3f * visibility;
     float r = base_r * ambient_intensity;
     float g = base_g * ambient_intensity;
     float b = base_b * ambient_intensity;
     
-    // Componente difuso
+    // Componente difuso (só a fração da luz que não é barrada por outro vaso)
     float ndotl = dotProduct(normal, lightDir);
     if (ndotl < 0.0f) ndotl = 0.0f;
     
-    r += base_r * light.diffuse[0] * ndotl * 0.9f;
-    g += base_g * light.diffuse[1] * ndotl * 0.9f;
-    b += base_b * light.diffuse[2] * ndotl * 0.9f;
+    r += base_r * light.diffuse[0] * ndotl * 0.9f * lit;
+    g += base_g * light.diffuse[1] * ndotl * 0.9f * lit;
+    b += base_b * light.diffuse[2] * ndotl * 0.9f * lit;
     
     // Componente especular (Phong) - sempre branco para reflexos
-    if (ndotl > 0.0f) {
+    // (omitido na parte da cor que independe da câmera, ver mesh.cpp)
+    if (ndotl > 0.0f && specular_enabled) {
         Point3D reflectDir = normal * (2.0f * ndotl) - lightDir;
         reflectDir.normalize();
         float rdotv = dotProduct(reflectDir, viewDir);
         if (rdotv < 0.0f) rdotv = 0.0f;
         
         float specular = powf(rdotv, material_shininess);
-        float spec_intensity = 0.8f * specular;
+        float spec_intensity = 0.8f * specular * lit;
         r += spec_intensity;
         g += spec_intensity;
         b += spec_intensity;
     }
     
-    r = std::min(1.0f, std::max(0.0f, r));
-    g = std::min(1.0f, std::max(0.0f, g));
-    b = std::min(1.0f, std::max(0.0f, b));
-    
-    if (transparency_enabled) {
-        glColor4f(r, g, b, transparency_alpha);
-    } else {
-        glColor3f(r, g, b);
+    out[0] = std::min(1.0f, std::max(0.0f, r));
+    out[1] = std::min(1.0f, std::max(0.0f, g));
+    out[2] = std::min(1.0f, std::max(0.0f, b));
+}
+
+// ============================================================
+// DESENHO DA ÁRVORE 3D
+// ============================================================
+
+// Segmentos que passaram pelo culling no quadro atual
+static std::vector<int> visible_segments;
+static std::vector<unsigned char> visible_mask;
+
+// Tempo de CPU do último quadro (ms)
+static double last_frame_ms = 0.0;
+
+// Renderização progressiva: enquanto há entrada do usuário a árvore é
+// desenhada com a malha de poucos lados, sem especular, e os vasos finos
+// viram linhas. Ao parar, o especular da nova posição da câmera é recuperado
+// em ordem decrescente de raio, dentro de um orçamento por quadro ocioso.
+static const int INTERACTION_IDLE_MS = 200;        // Sem eventos por esse tempo = fim da interação
+static const int INTERACTION_MAX_CYLINDERS = 2000; // Demais segmentos viram linhas na prévia
+static const double REFINE_BUDGET_MS = 8.0;        // Especular recalculado por quadro ocioso
+
+// ============================================================
+// INVALIDAÇÃO E REDESENHO SOB DEMANDA
+// ============================================================
+
+// Um único glutPostRedisplay por rajada de eventos: os handlers acumulam
+// o que mudou em dirty_flags e display() consome tudo de uma vez
+static bool redraw_pending = false;
+
+void requestRedraw(unsigned int flags) {
+    dirty_flags |= flags;
+    if (!redraw_pending) {
+        redraw_pending = true;
+        glutPostRedisplay();
     }
 }
 
-void setupLightingPhong(const Point3D& vertex, const Point3D& normal, const Point3D& eye) {
-    // Versão sem cores customizadas - usar cores do material padrão
-    Point3D lightDir = light.position - vertex;
-    lightDir.normalize();
-    
-    Point3D viewDir = eye - vertex;
-    viewDir.normalize();
-    
-    float ambient_intensity = 0.3f;
-    float r = material_ambient[0] * ambient_intensity;
-    float g = material_ambient[1] * ambient_intensity;
-    float b = material_ambient[2] * ambient_intensity;
-    
-    float ndotl = dotProduct(normal, lightDir);
-    if (ndotl < 0.0f) ndotl = 0.0f;
-    
-    r += material_diffuse[0] * light.diffuse[0] * ndotl;
-    g += material_diffuse[1] * light.diffuse[1] * ndotl;
-    b += material_diffuse[2] * light.diffuse[2] * ndotl;
-    
-    if (ndotl > 0.0f) {
-        Point3D reflectDir = normal * (2.0f * ndotl) - lightDir;
-        reflectDir.normalize();
-        float rdotv = dotProduct(reflectDir, viewDir);
-        if (rdotv < 0.0f) rdotv = 0.0f;
-        
-        float specular = powf(rdotv, material_shininess);
-        r += material_specular[0] * light.specular[0] * specular;
-        g += material_specular[1] * light.specular[1] * specular;
-        b += material_specular[2] * light.specular[2] * specular;
+// Intervalo contíguo de segmentos (desenhado em lotes de run_segments blocos)
+struct SegmentRun {
+    int first;
+    int count;
+};
+
+// Intervalos desenhados em qualidade total (culling + n_segments_draw)
+static std::vector<SegmentRun> draw_runs;
+static bool draw_runs_stale = true;
+
+// Prévia: maiores segmentos como cilindros de poucos lados, demais como linhas
+static std::vector<SegmentRun> preview_runs;
+static std::vector<unsigned int> preview_line_indices;
+static bool preview_lists_stale = true;
+
+// Intervalos permitidos pelo modo de subárvore (ver subtreeRanges)
+static std::vector<SegmentRun> allowed_runs;
+
+// Filtro por faixa (tecla J): blocos de índices dos segmentos dentro da
+// faixa, em ordem de layout, refeitos só quando a faixa ou as listas mudam
+static std::vector<unsigned int> filter_indices;
+static size_t filter_segment_count = 0;
+static bool filter_indices_stale = true;
+
+// n_segments_draw, subárvore e filtro usados para montar as listas acima
+static int lists_segment_limit = -1;
+static int lists_subtree_first = -1;
+static int lists_subtree_mode = -1;
+static int lists_filter_enabled = -1;
+static unsigned int lists_filter_revision = 0;
+
+// Especular pendente desde a última mudança de câmera
+static bool specular_stale = true;
+
+// Cores do OIT (pré-multiplicadas pelo fator do peso de profundidade), por
+// malha, e os pesos de cada segmento na vista atual
+static std::vector<unsigned char> oit_tree_colors;
+static std::vector<unsigned char> oit_preview_colors;
+static std::vector<unsigned char> oit_skeleton_colors;
+static std::vector<float> oit_segment_weights;
+static bool oit_weights_stale = true;
+
+// Territórios (tecla F): fatia ou fronteiras prontas para desenhar, refeitas
+// quando a grade, o modo ou a fatia mudam
+static std::vector<float> territory_positions;
+static std::vector<unsigned char> territory_colors;
+static bool territory_buffers_stale = true;
+static int territory_cached_view = TERRITORY_OFF;
+static int territory_cached_slice = -1;
+
+// Voxels (tecla Y): quadriláteros da fatia, refeitos quando a grade ou a
+// fatia mudam
+static std::vector<float> voxel_positions;
+static std::vector<unsigned char> voxel_colors;
+static bool voxel_buffers_stale = true;
+static int voxel_cached_slice = -1;
+
+// Tempo máximo por quadro gasto construindo as malhas após uma carga
+static const double UPLOAD_BUDGET_MS = 4.0;
+static bool upload_timer_pending = false;
+
+// Tempo máximo por quadro gasto na oclusão ambiente (somado ao das malhas)
+static const double AO_BUDGET_MS = 12.0;
+
+// Transição da animação: aguardando as malhas do novo passo e fração do
+// passo atual já percorrida (0 = estado inicial, 1 = final)
+static bool growth_transition_pending = false;
+static float growth_blend = 1.0f;
+
+static void uploadTimer(int) {
+    upload_timer_pending = false;
+    requestRedraw(DIRTY_HUD);
+}
+
+// Consome as flags de invalidação: cada mudança refaz apenas o que depende dela
+static void updateRetainedState() {
+    unsigned int flags = dirty_flags;
+    dirty_flags = 0;
+    if (flags & ~DIRTY_HUD) oit_image_stale = true;
+
+    // Diferença para o passo anterior (tecla G): refeita após cada carga
+    if (diff_view_enabled && !growth_diff.valid) {
+        computeGrowthDiffWithPrevious();
+        flags |= DIRTY_LIGHTING;
     }
-    
-    r = std::min(1.0f, std::max(0.0f, r));
-    g = std::min(1.0f, std::max(0.0f, g));
-    b = std::min(1.0f, std::max(0.0f, b));
-    
-    if (transparency_enabled) {
-        glColor4f(r, g, b, transparency_alpha);
-    } else {
-        glColor3f(r, g, b);
+
+    // Morfometria das cores (tecla K): calculada (ou tirada do cache) após
+    // cada carga, antes de as malhas lerem as cores
+    if (color_metric != METRIC_RADIUS && !morphometry.valid) {
+        if (updateMorphometry().valid) flags |= DIRTY_LIGHTING;
     }
-}
 
-// ============================================================
-// DESENHO DE CILINDRO 3D
-// ============================================================
+    // Filtro por faixa (tecla J): o atributo é o das cores; o índice
+    // ordenado é refeito após cada carga ou troca de atributo
+    if (range_filter_enabled) {
+        updateRangeFilterIndex(color_metric);
+    }
 
-void drawCylinder(const Point3D& p0, const Point3D& p1, float radius, int segments,
-                  float base_r, float base_g, float base_b) {
-    bool use_custom_color = (base_r >= 0.0f && base_g >= 0.0f && base_b >= 0.0f);
-    if (segments < 3) segments = 3;
-    
-    Point3D dir = p1 - p0;
-    float length = dir.length();
-    if (length < 0.0001f) return;
-    
-    dir.normalize();
-    
-    // Encontrar dois vetores perpendiculares para criar a base do cilindro
-    Point3D up(0, 1, 0);
-    if (fabsf(dotProduct(dir, up)) > 0.9f) {
-        up = Point3D(1, 0, 0);
+    // Colisões (tecla X): refeitas após cada carga ou troca de raio
+    if (collision_view != COLLISION_OFF && !collision_report.valid) {
+        checkCollisions(collision_view, 1.0f, 0.0f, collision_report);
+        flags |= DIRTY_LIGHTING;
     }
-    
-    Point3D u = crossProduct(up, dir);
-    u.normalize();
-    Point3D v = crossProduct(dir, u);
-    v.normalize();
-    
-    // Gerar vértices das bases
-    std::vector<Point3D> base0(segments);
-    std::vector<Point3D> base1(segments);
-    
-    for (int i = 0; i < segments; i++) {
-        float angle = 2.0f * M_PI * i / segments;
-        float cos_a = cosf(angle);
-        float sin_a = sinf(angle);
-        
-        Point3D offset = (u * cos_a + v * sin_a) * radius;
-        base0[i] = p0 + offset;
-        base1[i] = p1 + offset;
+
+    // Territórios (tecla F): grade refeita após cada carga
+    if (territory_view != TERRITORY_OFF && !territory_map.valid) {
+        computeTerritories(territory_resolution, territory_map);
+        territory_buffers_stale = true;
+        flags |= DIRTY_LIGHTING;
     }
-    
-    // Desenhar superfície lateral
-    glBegin(GL_QUAD_STRIP);
-    for (int i = 0; i <= segments; i++) {
-        int idx = i % segments;
-        Point3D normal = base0[idx] - p0;
-        normal.normalize();
-        
-        Point3D vertex0 = base0[idx];
-        Point3D vertex1 = base1[idx];
-        
-        if (lighting_enabled) {
-            if (lighting_mode == 0) {
-                if (use_custom_color) {
-                    setupLightingFlat(normal, base_r, base_g, base_b);
-                } else {
-                    setupLightingFlat(normal);
-                }
-            } else {
-                if (use_custom_color) {
-                    setupLightingPhong(vertex0, normal, camera.eye, base_r, base_g, base_b);
-                } else {
-                    setupLightingPhong(vertex0, normal, camera.eye);
-                }
-            }
-        } else if (use_custom_color) {
-            if (transparency_enabled) {
-                glColor4f(base_r, base_g, base_b, transparency_alpha);
-            } else {
-                glColor3f(base_r, base_g, base_b);
-            }
-        }
-        
-        glNormal3f(normal.x, normal.y, normal.z);
-        glVertex3f(vertex0.x, vertex0.y, vertex0.z);
-        
-        if (lighting_enabled && lighting_mode == 1) {
-            if (use_custom_color) {
-                setupLightingPhong(vertex1, normal, camera.eye, base_r, base_g, base_b);
-            } else {
-                setupLightingPhong(vertex1, normal, camera.eye);
-            }
-        } else if (use_custom_color) {
-            if (transparency_enabled) {
-                glColor4f(base_r, base_g, base_b, transparency_alpha);
-            } else {
-                glColor3f(base_r, base_g, base_b);
-            }
+
+    // Voxels (tecla Y): volume parcial com o raio de exibição, refeito após
+    // cada carga ou troca de raio
+    if (voxel_view_enabled && !voxel_grid.valid) {
+        std::vector<float> capsule_radii(lines.size());
+        for (size_t s = 0; s < lines.size(); s++) capsule_radii[s] = getDisplayRadius(s);
+        voxelizeCapsules(capsule_radii, voxel_resolution, VOXEL_PARTIAL, voxel_grid);
+        voxel_buffers_stale = true;
+    }
+
+    // Sombras (tecla U): o mapa só é refeito quando a luz, a geometria ou o
+    // passo mudam; a órbita da câmera reaproveita o mapa em cache
+    if (shadows_enabled && lighting_enabled && updateShadowMap(shadow_resolution)) {
+        flags |= DIRTY_LIGHTING;
+    }
+    if (flags & (DIRTY_GEOMETRY | DIRTY_RADII)) {
+        if ((flags & DIRTY_GEOMETRY) || !beginTreeRadii()) beginTreeGeometry();
+        flags |= DIRTY_LIGHTING;
+        preview_lists_stale = true;
+        filter_indices_stale = true;
+    }
+    // Oclusão ambiente (tecla B): calculada em lotes depois que as malhas
+    // ficam completas, refeita após cada carga ou troca de raio; as cores
+    // são refeitas uma vez só, quando a última amostra fica pronta
+    if (ambient_occlusion_enabled && !ambient_occlusion.valid && treeGeometryComplete() &&
+        !(flags & (DIRTY_GEOMETRY | DIRTY_RADII))) {
+        if (continueAmbientOcclusion(AO_BUDGET_MS)) {
+            flags |= DIRTY_LIGHTING;
+        } else if (!upload_timer_pending) {
+            upload_timer_pending = true;
+            glutTimerFunc(1, uploadTimer, 0);
         }
-        glNormal3f(normal.x, normal.y, normal.z);
-        glVertex3f(vertex1.x, vertex1.y, vertex1.z);
     }
-    glEnd();
+    if (flags & DIRTY_LIGHTING) {
+        updateSegmentColors();
+        lightMesh(tree_mesh);
+        lightMesh(preview_mesh);
+        lightSkeleton();
+        flags |= DIRTY_CAMERA;
+    }
+    if (flags & DIRTY_CAMERA) {
+        // Só o especular do Phong e o peso do OIT dependem da posição do olho
+        specular_stale = true;
+        draw_runs_stale = true;
+        oit_weights_stale = true;
+        oit_tree_stale = true;
+        oit_preview_stale = true;
+    }
+    if (selected_segment >= (int)lines.size()) {
+        selected_segment = -1;
+    }
+    if (selected_segment < 0 || path_target_segment >= (int)lines.size()) {
+        path_target_segment = -1;
+    }
+    if (n_segments_draw != lists_segment_limit || selected_segment != lists_subtree_first ||
+        subtree_view_mode != lists_subtree_mode || (int)range_filter_enabled != lists_filter_enabled ||
+        range_filter.revision != lists_filter_revision) {
+        lists_segment_limit = n_segments_draw;
+        lists_subtree_first = selected_segment;
+        lists_subtree_mode = subtree_view_mode;
+        lists_filter_enabled = range_filter_enabled;
+        lists_filter_revision = range_filter.revision;
+        draw_runs_stale = true;
+        preview_lists_stale = true;
+        filter_indices_stale = true;
+        oit_image_stale = true;
+    }
     
-    // Desenhar bases (tampas)
-    // Base 0
-    Point3D normal0 = dir * -1.0f;
-    glBegin(GL_TRIANGLE_FAN);
-    if (lighting_enabled) {
-        if (lighting_mode == 0) {
-            if (use_custom_color) {
-                setupLightingFlat(normal0, base_r, base_g, base_b);
-            } else {
-                setupLightingFlat(normal0);
-            }
-        } else {
-            if (use_custom_color) {
-                setupLightingPhong(p0, normal0, camera.eye, base_r, base_g, base_b);
-            } else {
-                setupLightingPhong(p0, normal0, camera.eye);
-            }
+    // Construção incremental das malhas: um bloco por quadro, maiores raios
+    // primeiro, para que a câmera continue respondendo em árvores grandes
+    if (!treeGeometryComplete()) {
+        continueTreeGeometry(UPLOAD_BUDGET_MS);
+        oit_tree_stale = true;
+        oit_preview_stale = true;
+        oit_image_stale = true;
+        if (!treeGeometryComplete() && !upload_timer_pending) {
+            upload_timer_pending = true;
+            glutTimerFunc(1, uploadTimer, 0);
         }
-    } else if (use_custom_color) {
-        if (transparency_enabled) {
-            glColor4f(base_r, base_g, base_b, transparency_alpha);
+    }
+
+    // Transição animada: começa quando as malhas do novo passo ficam
+    // completas; depois, cada quadro só interpola as posições
+    if (growth_transition_pending && treeGeometryComplete()) {
+        growth_transition_pending = false;
+        if (beginGrowthTransition()) draw_runs_stale = true;
+    }
+    if (growthTransitionActive()) {
+        oit_image_stale = true;
+        if (animation_enabled) {
+            blendGrowthTransition(growth_blend, interaction_active);
         } else {
-            glColor3f(base_r, base_g, base_b);
+            endGrowthTransition();
+            draw_runs_stale = true;
         }
     }
-    glNormal3f(normal0.x, normal0.y, normal0.z);
-    glVertex3f(p0.x, p0.y, p0.z);
-    
-    for (int i = 0; i <= segments; i++) {
-        int idx = i % segments;
-        if (lighting_enabled && lighting_mode == 1) {
-            if (use_custom_color) {
-                setupLightingPhong(base0[idx], normal0, camera.eye, base_r, base_g, base_b);
-            } else {
-                setupLightingPhong(base0[idx], normal0, camera.eye);
-            }
-        } else if (use_custom_color) {
-            if (transparency_enabled) {
-                glColor4f(base_r, base_g, base_b, transparency_alpha);
-            } else {
-                glColor3f(base_r, base_g, base_b);
-            }
+}
+
+static void appendRunsFromMask(const std::vector<unsigned char>& mask, int limit,
+                               std::vector<SegmentRun>& runs) {
+    runs.clear();
+    int i = 0;
+    while (i < limit) {
+        while (i < limit && !mask[i]) i++;
+        int first = i;
+        while (i < limit && mask[i]) i++;
+        if (i > first) runs.push_back({first, i - first});
+    }
+}
+
+// Subárvore do segmento selecionado: [s, subtree_end[s]) no layout em
+// profundidade. Isolar ou ocultar vira um ou dois intervalos contíguos.
+static bool subtreeFilterActive() {
+    return selected_segment >= 0 && topology.hasSubtreeLayout() &&
+           (subtree_view_mode == SUBTREE_ISOLATE || subtree_view_mode == SUBTREE_HIDE);
+}
+
+static void subtreeRanges(int n, std::vector<SegmentRun>& ranges) {
+    ranges.clear();
+    if (!subtreeFilterActive()) {
+        ranges.push_back({0, n});
+        return;
+    }
+    int first = selected_segment;
+    int end = topology.subtree_end[selected_segment];
+    if (subtree_view_mode == SUBTREE_ISOLATE) {
+        ranges.push_back({first, end - first});
+    } else {
+        if (first > 0) ranges.push_back({0, first});
+        if (n > end) ranges.push_back({end, n - end});
+    }
+}
+
+// PageUp/PageDown: os primeiros n_segments_draw segmentos na ordem de geração
+static bool partialGrowth() {
+    return n_segments_draw < (int)lines.size();
+}
+
+static bool segmentGrown(int i) {
+    if (topology.generation_rank.size() != lines.size()) return i < n_segments_draw;
+    return topology.generation_rank[i] < n_segments_draw;
+}
+
+static bool rangeFilterActive() {
+    return range_filter_enabled && range_filter.valid;
+}
+
+// Segmentos exibidos (filtro de subárvore + crescimento parcial) como
+// intervalos no layout em profundidade
+static void computeAllowedRuns(std::vector<SegmentRun>& runs) {
+    int n = (int)lines.size();
+    subtreeRanges(n, runs);
+    if (!partialGrowth()) return;
+
+    std::vector<unsigned char> mask(n, 0);
+    for (const SegmentRun& range : runs) {
+        for (int i = range.first; i < range.first + range.count; i++) {
+            mask[i] = segmentGrown(i) ? 1 : 0;
         }
-        glNormal3f(normal0.x, normal0.y, normal0.z);
-        glVertex3f(base0[idx].x, base0[idx].y, base0[idx].z);
     }
-    glEnd();
-    
-    // Base 1
-    Point3D normal1 = dir;
-    glBegin(GL_TRIANGLE_FAN);
-    if (lighting_enabled) {
-        if (lighting_mode == 0) {
-            if (use_custom_color) {
-                setupLightingFlat(normal1, base_r, base_g, base_b);
-            } else {
-                setupLightingFlat(normal1);
-            }
-        } else {
-            if (use_custom_color) {
-                setupLightingPhong(p1, normal1, camera.eye, base_r, base_g, base_b);
-            } else {
-                setupLightingPhong(p1, normal1, camera.eye);
-            }
+    appendRunsFromMask(mask, n, runs);
+}
+
+static void rebuildPreviewLists() {
+    // Cilindros para os INTERACTION_MAX_CYLINDERS maiores raios exibidos; o
+    // resto vira esqueleto de linhas. Independe da câmera.
+    int n = (int)lines.size();
+    std::vector<unsigned char> shown(n, 0);
+    for (const SegmentRun& range : allowed_runs) {
+        std::fill(shown.begin() + range.first, shown.begin() + range.first + range.count, 1);
+    }
+    if (rangeFilterActive()) {
+        std::vector<unsigned char> in_range(n, 0);
+        for (size_t k = range_filter.first; k < range_filter.last; k++) in_range[range_filter.order[k]] = 1;
+        for (int i = 0; i < n; i++) shown[i] &= in_range[i];
+    }
+    std::vector<unsigned char> cylinder(n, 0);
+    int taken = 0;
+    for (size_t k = 0; k < segments_by_radius.size() && taken < INTERACTION_MAX_CYLINDERS; k++) {
+        int i = segments_by_radius[k];
+        if (shown[i]) {
+            cylinder[i] = 1;
+            taken++;
         }
-    } else if (use_custom_color) {
-        if (transparency_enabled) {
-            glColor4f(base_r, base_g, base_b, transparency_alpha);
-        } else {
-            glColor3f(base_r, base_g, base_b);
+    }
+    appendRunsFromMask(cylinder, n, preview_runs);
+
+    preview_line_indices.clear();
+    for (int i = 0; i < n; i++) {
+        if (shown[i] && !cylinder[i]) {
+            preview_line_indices.push_back(2 * i);
+            preview_line_indices.push_back(2 * i + 1);
         }
     }
-    glNormal3f(normal1.x, normal1.y, normal1.z);
-    glVertex3f(p1.x, p1.y, p1.z);
-    
-    for (int i = segments; i >= 0; i--) {
-        int idx = i % segments;
-        if (lighting_enabled && lighting_mode == 1) {
-            if (use_custom_color) {
-                setupLightingPhong(base1[idx], normal1, camera.eye, base_r, base_g, base_b);
-            } else {
-                setupLightingPhong(base1[idx], normal1, camera.eye);
-            }
-        } else if (use_custom_color) {
-            if (transparency_enabled) {
-                glColor4f(base_r, base_g, base_b, transparency_alpha);
-            } else {
-                glColor3f(base_r, base_g, base_b);
-            }
+}
+
+// Buffer compacto do filtro por faixa; subárvore e crescimento parcial
+// entram como máscara (só quando ativos)
+static void rebuildFilterIndices() {
+    std::vector<unsigned char> allowed;
+    if (subtreeFilterActive() || partialGrowth()) {
+        computeAllowedRuns(allowed_runs);
+        allowed.assign(lines.size(), 0);
+        for (const SegmentRun& range : allowed_runs) {
+            std::fill(allowed.begin() + range.first, allowed.begin() + range.first + range.count, 1);
         }
-        glNormal3f(normal1.x, normal1.y, normal1.z);
-        glVertex3f(base1[idx].x, base1[idx].y, base1[idx].z);
     }
-    glEnd();
+    filter_segment_count = buildRangeFilterIndices(tree_mesh, allowed.empty() ? nullptr : &allowed, filter_indices);
+}
+
+// Fator do peso de profundidade do OIT aplicado por segmento às cores já
+// iluminadas; os pesos são refeitos uma vez por câmera para todas as malhas,
+// que precisam da mesma escala para a média ponderada
+static void weightOITColors(const unsigned char* src, size_t segment_count, int verts_per_segment,
+                            std::vector<unsigned char>& dst) {
+    if (oit_weights_stale) {
+        computeOITWeights(oit_segment_weights);
+        oit_weights_stale = false;
+    }
+    dst.resize(segment_count * verts_per_segment * 4);
+    for (size_t i = 0; i < segment_count; i++) {
+        float f = oit_scale.factor(oit_segment_weights[i]);
+        size_t first = i * verts_per_segment * 4;
+        for (int k = 0; k < verts_per_segment * 4; k += 4) {
+            scaleOITColor(&src[first + k], f, &dst[first + k]);
+        }
+    }
+}
+
+// Desfaz a quantização das posições (short -> coordenadas da cena) na
+// modelview; o chamador envolve em glPushMatrix/glPopMatrix
+static void applyMeshQuantization() {
+    glTranslatef(mesh_quantization.origin[0], mesh_quantization.origin[1], mesh_quantization.origin[2]);
+    glScalef(mesh_quantization.step[0], mesh_quantization.step[1], mesh_quantization.step[2]);
+}
+
+// Cada intervalo vira lotes de até run_segments blocos: os ponteiros dos
+// arrays apontam para o primeiro bloco do lote e o molde de 16 bits da malha
+// serve para todos (sem base-vertex no OpenGL 1.1)
+static void drawMeshRuns(const TubeMesh& mesh, const unsigned char* colors,
+                         const std::vector<SegmentRun>& runs) {
+    if (mesh.segment_count == 0) return;
+    glPushMatrix();
+    applyMeshQuantization();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    for (const SegmentRun& run : runs) {
+        for (int first = run.first, end = run.first + run.count; first < end; first += mesh.run_segments) {
+            int count = std::min(mesh.run_segments, end - first);
+            size_t vertex = (size_t)first * mesh.verts_per_segment;
+            glVertexPointer(3, GL_SHORT, 0, mesh.positions.data() + 3 * vertex);
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors + 4 * vertex);
+            glDrawElements(GL_TRIANGLES, count * mesh.indices_per_segment, GL_UNSIGNED_SHORT, mesh.indices.data());
+        }
+    }
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopMatrix();
+}
+
+static void drawMeshPrefix(const TubeMesh& mesh, const unsigned char* colors,
+                           const std::vector<unsigned int>& indices, int segment_count) {
+    if (segment_count <= 0) return;
+    glPushMatrix();
+    applyMeshQuantization();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_SHORT, 0, mesh.positions.data());
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors);
+    glDrawElements(GL_TRIANGLES, segment_count * mesh.indices_per_segment, GL_UNSIGNED_INT, indices.data());
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopMatrix();
+}
+
+static void drawSkeleton(const unsigned char* colors, const std::vector<unsigned int>& indices) {
+    if (indices.empty()) return;
+    glPushMatrix();
+    applyMeshQuantization();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_SHORT, 0, skeleton_positions.data());
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors);
+    glDrawElements(GL_LINES, (GLsizei)indices.size(), GL_UNSIGNED_INT, indices.data());
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glPopMatrix();
+}
+
+void appendInterfaceMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Caches", "interface.visible_segments", visible_segments);
+    addMemoryEntry(entries, "Caches", "interface.visible_mask", visible_mask);
+    addMemoryEntry(entries, "Caches", "interface.draw_runs", draw_runs);
+    addMemoryEntry(entries, "Caches", "interface.preview_runs", preview_runs);
+    addMemoryEntry(entries, "Caches", "interface.preview_line_indices", preview_line_indices);
+    addMemoryEntry(entries, "Caches", "interface.allowed_runs", allowed_runs);
+    addMemoryEntry(entries, "Caches", "interface.filter_indices", filter_indices);
+    addMemoryEntry(entries, "Caches", "interface.oit_tree_colors", oit_tree_colors);
+    addMemoryEntry(entries, "Caches", "interface.oit_preview_colors", oit_preview_colors);
+    addMemoryEntry(entries, "Caches", "interface.oit_skeleton_colors", oit_skeleton_colors);
+    addMemoryEntry(entries, "Caches", "interface.oit_accum", oit_accum);
+    addMemoryEntry(entries, "Caches", "interface.oit_count", oit_count);
+    addMemoryEntry(entries, "Caches", "interface.oit_segment_weights", oit_segment_weights);
+    addMemoryEntry(entries, "Caches", "interface.territory_positions", territory_positions);
+    addMemoryEntry(entries, "Caches", "interface.territory_colors", territory_colors);
+    addMemoryEntry(entries, "Caches", "interface.voxel_positions", voxel_positions);
+    addMemoryEntry(entries, "Caches", "interface.voxel_colors", voxel_colors);
 }
 
 // ============================================================
 // DESENHO DA ÁRVORE 3D
 // ============================================================
 
+static int last_interaction_ms = 0;
+static bool interaction_timer_pending = false;
+static bool refine_timer_pending = false;
+
+static void interactionTimer(int) {
+    int idle = glutGet(GLUT_ELAPSED_TIME) - last_interaction_ms;
+    if (idle < INTERACTION_IDLE_MS) {
+        glutTimerFunc(INTERACTION_IDLE_MS - idle, interactionTimer, 0);
+        return;
+    }
+    interaction_timer_pending = false;
+    endInteraction();
+}
+
+static void refineTimer(int) {
+    refine_timer_pending = false;
+    requestRedraw(DIRTY_HUD);
+}
+
+void notifyInteraction() {
+    interaction_active = true;
+    last_interaction_ms = glutGet(GLUT_ELAPSED_TIME);
+    if (!interaction_timer_pending) {
+        interaction_timer_pending = true;
+        glutTimerFunc(INTERACTION_IDLE_MS, interactionTimer, 0);
+    }
+}
+
+void endInteraction() {
+    if (!interaction_active) return;
+    interaction_active = false;
+    requestRedraw(DIRTY_HUD);
+}
+
 void drawTree3D() {
-    if (points.empty() || lines.empty()) return;
+    if (points.empty() || lines.empty() || tree_mesh.segment_count != lines.size()) return;
     
     // Configurar transparência
-    if (transparency_enabled) {
+    if (oitActive()) {
+        beginOITPass();
+    } else if (transparency_enabled) {
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glDepthMask(GL_FALSE);  // Permitir que objetos transparentes sejam desenhados corretamente
@@ -405,82 +785,100 @@ void drawTree3D() {
         glDepthMask(GL_TRUE);   // Habilitar write no depth buffer quando não transparente
     }
     
-    // Normalizar raios para visualização (para o gradiente de cores)
-    float min_r = 1e9f, max_r = -1e9f;
-    for (const auto& L : lines) {
-        if (L.radius < min_r) min_r = L.radius;
-        if (L.radius > max_r) max_r = L.radius;
-    }
-    
-    float range_r = max_r - min_r;
-    if (range_r < 1e-6f) range_r = 1.0f;
-    
-    // Calcular raio médio para escala
-    float avg_radius = (min_r + max_r) / 2.0f;
-    
-    // Desenhar segmentos como cilindros
-    int count = 0;
-    
-    // Calcular raio médio para modo fixo
-    float fixed_radius = 0.0f;
-    if (radius_mode_fixed && avg_radius > 0.0001f) {
-        fixed_radius = avg_radius;
-    }
-    
-    for (size_t i = 0; i < lines.size() && count < n_segments_draw; i++) {
-        Point3D p0 = points[lines[i].p0];
-        Point3D p1 = points[lines[i].p1];
-        
-        // Escolher entre raio fixo ou variável
-        float segment_radius;
-        if (radius_mode_fixed && fixed_radius > 0.0f) {
-            // Modo (a): raio fixo - usar o raio médio para todos os segmentos
-            segment_radius = fixed_radius;
-        } else {
-            // Modo (b): raio variável - usar o raio original do arquivo VTK
-            segment_radius = lines[i].radius;
+    if (interaction_active) {
+        // Prévia: malha de poucos lados (cores sem especular) + esqueleto
+        if (preview_lists_stale) {
+            computeAllowedRuns(allowed_runs);
+            rebuildPreviewLists();
+            preview_lists_stale = false;
         }
-        
-        // Escala dos raios para corresponder aos exemplos Nterm:
-        // - Modo FIXO: todos os segmentos com a mesma espessura (raio médio), tubos com espessura uniforme
-        // - Modo VARIÁVEL: espessura proporcional ao raio do VTK (tronco grosso, ramos finos)
-        // Referência: raio máximo do tronco em ~2.5% do data_scale (tubos mais finos)
-        
-        float display_radius = segment_radius;
-        
-        if (data_scale > 0.001f) {
-            float ref_r = (max_r > 0.0001f) ? max_r : avg_radius;
-            if (ref_r > 0.0001f) {
-                // Fator para que o raio MÁXIMO fique em ~2.5% do tamanho da cena
-                float scale_factor = (data_scale * 0.025f) / ref_r;
-                display_radius = segment_radius * scale_factor;
+        const unsigned char* mesh_colors = preview_mesh.colors.data();
+        const unsigned char* line_colors = skeleton_colors.data();
+        if (oitActive()) {
+            if (oit_preview_stale) {
+                weightOITColors(preview_mesh.colors.data(), preview_mesh.segment_count,
+                                preview_mesh.verts_per_segment, oit_preview_colors);
+                weightOITColors(skeleton_colors.data(), lines.size(), 2, oit_skeleton_colors);
+                oit_preview_stale = false;
+            }
+            mesh_colors = oit_preview_colors.data();
+            line_colors = oit_skeleton_colors.data();
+        }
+        drawMeshRuns(preview_mesh, mesh_colors, preview_runs);
+        drawSkeleton(line_colors, preview_line_indices);
+    } else {
+        // Especular da posição atual da câmera, maiores raios primeiro
+        bool needs_specular = lighting_enabled && lighting_mode == 1;
+        if (specular_stale) {
+            specular_stale = false;
+            if (needs_specular) {
+                refine_count = 0;
+            } else {
+                refine_count = (int)segments_by_radius.size();
+            }
+        }
+        if (refine_count < mesh_built_count) {
+            refine_count = refineSpecular(tree_mesh, refine_count, REFINE_BUDGET_MS);
+            oit_tree_stale = true;
+            if (refine_count < mesh_built_count && !refine_timer_pending) {
+                refine_timer_pending = true;
+                glutTimerFunc(1, refineTimer, 0);
             }
         }
         
-        // Limites de segurança (tubos visíveis, sem extremos)
-        float min_radius = data_scale * 0.0015f;  // Mínimo: 0.15% do tamanho
-        float max_radius = data_scale * 0.04f;    // Máximo: 4% do tamanho (preserva proporção tronco/ramos)
-        
-        if (display_radius < min_radius) display_radius = min_radius;
-        if (display_radius > max_radius) display_radius = max_radius;
-        
-        // Normalizar raio para gradiente de cores (0.0 a 1.0)
-        // Usar o raio original do arquivo VTK para as cores, mesmo no modo fixo
-        float normalized_radius = (lines[i].radius - min_r) / range_r;
-        
-        // Calcular cor baseada no raio (gradiente de azul para vermelho)
-        float base_r, base_g, base_b;
-        getColorFromRadius(normalized_radius, base_r, base_g, base_b);
-        
-        // SEMPRE usar cores do gradiente, mesmo com iluminação
-        // A iluminação será aplicada manualmente usando essas cores como base
-        drawCylinder(p0, p1, display_radius, cylinder_quality, base_r, base_g, base_b);
+        // Culling por oclusão: só faz sentido com superfícies opacas e com a
+        // árvore inteira (segmentos ocultos não podem servir de oclusores);
+        // na transição animada as caixas da BVH são as do estado final
+        bool culling = occlusion_culling_enabled && !transparency_enabled && !segment_bvh.nodes.empty() &&
+                       !subtreeFilterActive() && !partialGrowth() && !growthTransitionActive() &&
+                       !rangeFilterActive();
+        if (draw_runs_stale) {
+            computeAllowedRuns(allowed_runs);
+            if (culling) {
+                int n = (int)lines.size();
+                float aspect = (float)window_width / (float)std::max(1, window_height);
+                buildOcclusionBuffer(camera, aspect, n);
+                collectVisibleSegments(n, visible_segments);
+                visible_mask.assign(n, 0);
+                for (int s : visible_segments) visible_mask[s] = 1;
+                appendRunsFromMask(visible_mask, n, draw_runs);
+                if (!occlusionCullingPays()) {
+                    occlusion_culling_enabled = false;
+                    std::cout << "Culling por oclusão: OFF (descartou menos de 10% dos segmentos, "
+                              << "não compensa o custo na CPU)" << std::endl;
+                }
+            } else {
+                draw_runs = allowed_runs;
+            }
+            draw_runs_stale = false;
+        }
+        if (rangeFilterActive() && filter_indices_stale) {
+            rebuildFilterIndices();
+            filter_indices_stale = false;
+        }
         
-        count++;
+        const unsigned char* colors = tree_mesh.colors.data();
+        if (oitActive()) {
+            if (oit_tree_stale) {
+                weightOITColors(tree_mesh.colors.data(), tree_mesh.segment_count,
+                                tree_mesh.verts_per_segment, oit_tree_colors);
+                oit_tree_stale = false;
+            }
+            colors = oit_tree_colors.data();
+        }
+        // Crescimento parcial: os intervalos de computeAllowedRuns (máscara
+        // pelo rank de geração) sobre os blocos do layout em profundidade
+        if (rangeFilterActive()) {
+            drawMeshPrefix(tree_mesh, colors, filter_indices, (int)filter_segment_count);
+        } else {
+            drawMeshRuns(tree_mesh, colors, draw_runs);
+        }
     }
     
     // Restaurar estado do depth buffer se estava desabilitado
-    if (transparency_enabled) {
+    if (oitActive()) {
+        endOITPass();
+    } else if (transparency_enabled) {
         glDepthMask(GL_TRUE);  // Restaurar write no depth buffer
         // NÃO desabilitar GL_BLEND aqui - será usado se houver outros objetos transparentes
     }
@@ -503,10 +901,266 @@ void drawSelectedSegment() {
     glVertex3f(p1.x, p1.y, p1.z);
     glEnd();
     
+    // Caminho até o segundo segmento (Shift+clique): só os segmentos dele,
+    // subindo pelos pais a partir dos dois extremos
+    if (path_target_segment >= 0 && path_target_segment < (int)lines.size()) {
+        static std::vector<int> path_segments;
+        collectPathSegments(selected_segment, path_target_segment, path_segments);
+        glColor3f(1.0f, 0.0f, 1.0f);  // Magenta
+        glBegin(GL_LINES);
+        for (int s : path_segments) {
+            Point3D a = points[lines[s].p0];
+            Point3D b = points[lines[s].p1];
+            glVertex3f(a.x, a.y, a.z);
+            glVertex3f(b.x, b.y, b.z);
+        }
+        glEnd();
+    }
+    
+    // Subárvore destacada: o intervalo contíguo do esqueleto em uma chamada
+    if (subtree_view_mode == SUBTREE_HIGHLIGHT && topology.hasSubtreeLayout() &&
+        skeleton_positions.size() == 6 * lines.size()) {
+        int first = selected_segment;
+        int count = topology.subtree_end[first] - first;
+        if (count > 0) {
+            glColor3f(1.0f, 0.5f, 0.0f);  // Laranja
+            glLineWidth(2.0f);
+            glPushMatrix();
+            applyMeshQuantization();
+            glEnableClientState(GL_VERTEX_ARRAY);
+            glVertexPointer(3, GL_SHORT, 0, skeleton_positions.data());
+            glDrawArrays(GL_LINES, 2 * first, 2 * count);
+            glDisableClientState(GL_VERTEX_ARRAY);
+            glPopMatrix();
+        }
+    }
+    
+    glLineWidth(1.0f);
+    if (lighting_enabled) {
+        glEnable(GL_LIGHTING);
+    }
+}
+
+// ============================================================
+// TERRITÓRIOS DE PERFUSÃO
+// ============================================================
+
+// Pontos da nuvem de fronteiras (acima disso, um a cada k)
+static const size_t TERRITORY_MAX_POINTS = 1000000;
+static const unsigned char TERRITORY_SLICE_ALPHA = 140;
+
+static void pushTerritoryVertex(float x, float y, float z, int territory, unsigned char alpha) {
+    float r, g, b;
+    getTerritoryColor(territory, r, g, b);
+    territory_positions.push_back(x);
+    territory_positions.push_back(y);
+    territory_positions.push_back(z);
+    territory_colors.push_back((unsigned char)(255.0f * r));
+    territory_colors.push_back((unsigned char)(255.0f * g));
+    territory_colors.push_back((unsigned char)(255.0f * b));
+    territory_colors.push_back(alpha);
+}
+
+// Fatia z: um quadrilátero por sequência de voxels do mesmo território na
+// linha (bem menos que um por voxel)
+static void buildTerritorySlice(const TerritoryMap& map, int z) {
+    float half = 0.5f * map.voxel;
+    float wz = map.origin[2] + z * map.voxel;
+    for (int y = 0; y < map.dims[1]; y++) {
+        const int* row = &map.labels[map.index(0, y, z)];
+        float y0 = map.origin[1] + y * map.voxel - half, y1 = y0 + map.voxel;
+        for (int x = 0; x < map.dims[0]; ) {
+            int t = row[x], end = x + 1;
+            while (end < map.dims[0] && row[end] == t) end++;
+            float x0 = map.origin[0] + x * map.voxel - half, x1 = map.origin[0] + (end - 1) * map.voxel + half;
+            pushTerritoryVertex(x0, y0, wz, t, TERRITORY_SLICE_ALPHA);
+            pushTerritoryVertex(x1, y0, wz, t, TERRITORY_SLICE_ALPHA);
+            pushTerritoryVertex(x1, y1, wz, t, TERRITORY_SLICE_ALPHA);
+            pushTerritoryVertex(x0, y1, wz, t, TERRITORY_SLICE_ALPHA);
+            x = end;
+        }
+    }
+}
+
+// Voxels com vizinho (+x, +y ou +z) de outro território
+static bool isTerritoryBoundary(const TerritoryMap& map, int x, int y, int z) {
+    int t = map.labels[map.index(x, y, z)];
+    return (x + 1 < map.dims[0] && map.labels[map.index(x + 1, y, z)] != t) ||
+           (y + 1 < map.dims[1] && map.labels[map.index(x, y + 1, z)] != t) ||
+           (z + 1 < map.dims[2] && map.labels[map.index(x, y, z + 1)] != t);
+}
+
+static void buildTerritoryBoundary(const TerritoryMap& map) {
+    // Primeira passada conta, a segunda guarda um a cada `stride`
+    size_t boundary = 0;
+    for (int z = 0; z < map.dims[2]; z++) {
+        for (int y = 0; y < map.dims[1]; y++) {
+            for (int x = 0; x < map.dims[0]; x++) {
+                if (isTerritoryBoundary(map, x, y, z)) boundary++;
+            }
+        }
+    }
+    size_t stride = std::max<size_t>(1, (boundary + TERRITORY_MAX_POINTS - 1) / TERRITORY_MAX_POINTS);
+    territory_positions.reserve(3 * (boundary / stride + 1));
+    territory_colors.reserve(4 * (boundary / stride + 1));
+    size_t k = 0;
+    for (int z = 0; z < map.dims[2]; z++) {
+        for (int y = 0; y < map.dims[1]; y++) {
+            for (int x = 0; x < map.dims[0]; x++) {
+                if (!isTerritoryBoundary(map, x, y, z) || k++ % stride != 0) continue;
+                pushTerritoryVertex(map.origin[0] + x * map.voxel, map.origin[1] + y * map.voxel,
+                                    map.origin[2] + z * map.voxel, map.labels[map.index(x, y, z)], 255);
+            }
+        }
+    }
+}
+
+void drawTerritories() {
+    const TerritoryMap& map = territory_map;
+    if (territory_view == TERRITORY_OFF || !map.valid || map.labels.empty()) return;
+    if (territory_slice < 0 || territory_slice >= map.dims[2]) territory_slice = map.dims[2] / 2;
+
+    if (territory_buffers_stale || territory_cached_view != territory_view ||
+        (territory_view == TERRITORY_SLICE && territory_cached_slice != territory_slice)) {
+        territory_positions.clear();
+        territory_colors.clear();
+        if (territory_view == TERRITORY_SLICE) {
+            buildTerritorySlice(map, territory_slice);
+        } else {
+            buildTerritoryBoundary(map);
+        }
+        territory_buffers_stale = false;
+        territory_cached_view = territory_view;
+        territory_cached_slice = territory_slice;
+    }
+
+    // Fatia translúcida sobre a árvore, sem escrever profundidade
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, territory_positions.data());
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, territory_colors.data());
+    GLsizei count = (GLsizei)(territory_positions.size() / 3);
+    if (territory_view == TERRITORY_SLICE) {
+        glDrawArrays(GL_QUADS, 0, count);
+    } else {
+        glPointSize(2.0f);
+        glDrawArrays(GL_POINTS, 0, count);
+        glPointSize(1.0f);
+    }
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+// ============================================================
+// VOXELS
+// ============================================================
+
+// Fatia z da grade: um quadrilátero por sequência de voxels de mesmo valor
+// na linha, vermelho com opacidade pela fração vascular (vazios de fora)
+static void buildVoxelSlice(const VoxelGrid& grid, int z) {
+    float half = 0.5f * grid.voxel;
+    float wz = grid.origin[2] + z * grid.voxel;
+    for (int y = 0; y < grid.dims[1]; y++) {
+        const unsigned char* row = &grid.values[grid.index(0, y, z)];
+        float y0 = grid.origin[1] + y * grid.voxel - half, y1 = y0 + grid.voxel;
+        for (int x = 0; x < grid.dims[0]; ) {
+            unsigned char v = row[x];
+            int end = x + 1;
+            while (end < grid.dims[0] && row[end] == v) end++;
+            if (v > 0) {
+                float x0 = grid.origin[0] + x * grid.voxel - half, x1 = grid.origin[0] + (end - 1) * grid.voxel + half;
+                float corners[4][2] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+                for (int c = 0; c < 4; c++) {
+                    voxel_positions.push_back(corners[c][0]);
+                    voxel_positions.push_back(corners[c][1]);
+                    voxel_positions.push_back(wz);
+                    voxel_colors.push_back(255);
+                    voxel_colors.push_back(80);
+                    voxel_colors.push_back(40);
+                    voxel_colors.push_back((unsigned char)(40 + v * 200 / 255));
+                }
+            }
+            x = end;
+        }
+    }
+}
+
+void drawVoxelSlice() {
+    const VoxelGrid& grid = voxel_grid;
+    if (!voxel_view_enabled || !grid.valid || grid.values.empty()) return;
+    if (voxel_slice < 0 || voxel_slice >= grid.dims[2]) voxel_slice = grid.dims[2] / 2;
+
+    if (voxel_buffers_stale || voxel_cached_slice != voxel_slice) {
+        voxel_positions.clear();
+        voxel_colors.clear();
+        buildVoxelSlice(grid, voxel_slice);
+        voxel_buffers_stale = false;
+        voxel_cached_slice = voxel_slice;
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, voxel_positions.data());
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, voxel_colors.data());
+    glDrawArrays(GL_QUADS, 0, (GLsizei)(voxel_positions.size() / 3));
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+// Barra do filtro por faixa no rodapé: a largura toda é a faixa do
+// atributo, o trecho destacado são os limites atuais
+static const int FILTER_SLIDER_MARGIN = 10;
+static const int FILTER_SLIDER_Y = 14;
+
+float filterSliderFraction(int x) {
+    float width = (float)std::max(1, window_width - 2 * FILTER_SLIDER_MARGIN);
+    return std::max(0.0f, std::min(1.0f, (x - FILTER_SLIDER_MARGIN) / width));
+}
+
+static void drawFilterSlider() {
+    float x0 = (float)FILTER_SLIDER_MARGIN;
+    float x1 = (float)(window_width - FILTER_SLIDER_MARGIN);
+    float lo = x0 + range_filter.low * (x1 - x0);
+    float hi = x0 + range_filter.high * (x1 - x0);
+
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glColor3f(0.4f, 0.4f, 0.4f);
     glLineWidth(1.0f);
+    glBegin(GL_LINES);
+    glVertex2f(x0, FILTER_SLIDER_Y);
+    glVertex2f(x1, FILTER_SLIDER_Y);
+    glEnd();
+
+    glColor3f(1.0f, 0.8f, 0.2f);
+    glLineWidth(5.0f);
+    glBegin(GL_LINES);
+    glVertex2f(lo, FILTER_SLIDER_Y);
+    glVertex2f(std::max(hi, lo + 1.0f), FILTER_SLIDER_Y);
+    glEnd();
+    glLineWidth(1.0f);
+    glBegin(GL_LINES);
+    glVertex2f(lo, FILTER_SLIDER_Y - 6);
+    glVertex2f(lo, FILTER_SLIDER_Y + 6);
+    glVertex2f(hi, FILTER_SLIDER_Y - 6);
+    glVertex2f(hi, FILTER_SLIDER_Y + 6);
+    glEnd();
+
+    glEnable(GL_DEPTH_TEST);
     if (lighting_enabled) {
         glEnable(GL_LIGHTING);
     }
+    glColor3f(1.0f, 1.0f, 1.0f);
 }
 
 void displayText() {
@@ -527,22 +1181,63 @@ void displayText() {
     std::string status = "Iluminação: " + std::string(lighting_enabled ? "ON" : "OFF") + 
                         " (" + lighting_mode_str + ") | " +
                         "Raio: " + radius_mode_str + " | " +
-                        "Transparência: " + std::string(transparency_enabled ? "ON" : "OFF") + " | " +
+                        "Transparência: " + std::string(transparency_enabled ? "ON" : "OFF") +
+                        (transparency_enabled ? (transparency_method == 0 ? " (Blend)" : " (OIT)") : "") + " | " +
                         "Segmentos: " + std::to_string(n_segments_draw) + "/" + std::to_string(max_segments) +
+                        (partialGrowth() && n_segments_draw > 0 && !topology.generation_order.empty() ?
+                            " (até geração " + std::to_string(topology.generation[topology.generation_order[n_segments_draw - 1]]) +
+                            "/" + std::to_string(topology.max_generation) + ")" : "") +
                         " | Câmera: dist=" + std::to_string(camera.distance).substr(0, 4) +
                         " az=" + std::to_string(camera.azimuth).substr(0, 5) + "°" +
                         " el=" + std::to_string(camera.elevation).substr(0, 5) + "°";
     
     if (selected_segment >= 0) {
         status += " | Selecionado: " + std::to_string(selected_segment);
+        if (subtree_view_mode == SUBTREE_ISOLATE) status += " [isolada]";
+        else if (subtree_view_mode == SUBTREE_HIDE) status += " [oculta]";
+        else if (subtree_view_mode == SUBTREE_HIGHLIGHT) status += " [destacada]";
         if (show_segment_info) {
             Line3D& line = lines[selected_segment];
             Point3D p0 = points[line.p0];
             Point3D p1 = points[line.p1];
             Point3D dir = p1 - p0;
             float length = dir.length();
-            status += " (raio=" + std::to_string(line.radius).substr(0, 4) +
-                     " comprimento=" + std::to_string(length).substr(0, 4) + ")";
+            status += " (raio=" + std::to_string(radii[selected_segment]).substr(0, 4) +
+                     " comprimento=" + std::to_string(length).substr(0, 4);
+            if (!topology.parent.empty()) {
+                status += " pai=" + std::to_string(topology.parent[selected_segment]) +
+                          " filhos=" + std::to_string(topology.childCount(selected_segment));
+            }
+            if (topology.hasSubtreeLayout()) {
+                status += " subárvore=" + std::to_string(topology.subtreeSize(selected_segment)) + " seg, " +
+                          std::to_string(topology.subtreeTerminals(selected_segment)) + " term, L=" +
+                          std::to_string(topology.subtreeLength(selected_segment)).substr(0, 5) + " V=" +
+                          std::to_string(topology.subtreeVolume(selected_segment)).substr(0, 7);
+            }
+            // Escoamento de Poiseuille (calculado junto com a morfometria)
+            const Morphometry& m = updateMorphometry();
+            if (m.values[METRIC_FLOW].size() == lines.size()) {
+                char flow_info[96];
+                snprintf(flow_info, sizeof(flow_info), " Q=%.3g p=%.3g R=%.3g", m.values[METRIC_FLOW][selected_segment],
+                         m.values[METRIC_PRESSURE][selected_segment], m.values[METRIC_RESISTANCE][selected_segment]);
+                status += flow_info;
+            }
+            if (path_index.valid) {
+                status += " dist. raiz=" + std::to_string(rootPathLength(selected_segment)).substr(0, 5);
+            }
+            status += ")";
+        }
+        if (path_target_segment >= 0) {
+            // O(1) pelo índice de caminhos, qualquer que seja o tamanho da árvore
+            TreePath path = queryPath(selected_segment, path_target_segment);
+            char path_info[160];
+            if (path.lca >= 0) {
+                snprintf(path_info, sizeof(path_info), " | Caminho até %d: %d seg, LCA=%d, L=%.4g, R=%.4g, %d bif.",
+                         path_target_segment, path.segments, path.lca, path.length, path.resistance, path.bifurcations);
+            } else {
+                snprintf(path_info, sizeof(path_info), " | Caminho até %d: árvores diferentes", path_target_segment);
+            }
+            status += path_info;
         }
     }
     
@@ -552,8 +1247,128 @@ void displayText() {
                 "/" + std::to_string(growth_files.size());
     }
     
+    if (diff_view_enabled && growth_diff.valid) {
+        status += " | Diferença: " + std::to_string(growth_diff.counts[CHANGE_NEW]) + " novos, " +
+                  std::to_string(growth_diff.counts[CHANGE_SPLIT]) + " divididos, " +
+                  std::to_string(growth_diff.counts[CHANGE_RESIZED]) + " raio, " +
+                  std::to_string(growth_diff.counts[CHANGE_UNCHANGED]) + " iguais";
+    }
+    
+    if (collision_view != COLLISION_OFF && collision_report.valid) {
+        char collisions[160];
+        snprintf(collisions, sizeof(collisions), " | Colisões (%s): %lu sobreposições (%lu em junções), %.0f ms",
+                 collisionRadiusName(collision_view), (unsigned long)collision_report.overlaps,
+                 (unsigned long)collision_report.junction_pairs,
+                 collision_report.bvh_ms + collision_report.check_ms);
+        status += collisions;
+    }
+    
+    if (territory_view != TERRITORY_OFF && territory_map.valid && !territory_map.terminals.empty()) {
+        char territories[160];
+        const TerritoryMap& map = territory_map;
+        snprintf(territories, sizeof(territories), " | Territórios (%s%s): %lu terminais, %dx%dx%d voxels, %.0f ms",
+                 territoryViewName(territory_view),
+                 territory_view == TERRITORY_SLICE ? (" z=" + std::to_string(territory_slice)).c_str() : "",
+                 (unsigned long)map.terminals.size(), map.dims[0], map.dims[1], map.dims[2],
+                 map.seed_ms + map.flood_ms);
+        status += territories;
+    }
+
+    if (voxel_view_enabled && voxel_grid.valid && !voxel_grid.values.empty()) {
+        char voxels[160];
+        const VoxelGrid& grid = voxel_grid;
+        snprintf(voxels, sizeof(voxels), " | Voxels (z=%d): %dx%dx%d, %.1f%% vascular, %.0f ms", voxel_slice,
+                 grid.dims[0], grid.dims[1], grid.dims[2],
+                 100.0 * grid.occupied_volume / (grid.voxelCount() * (double)grid.voxel * grid.voxel * grid.voxel),
+                 grid.bvh_ms + grid.raster_ms);
+        status += voxels;
+    }
+
+    if (shadows_enabled && shadow_map.valid) {
+        char shadows[96];
+        if (shadow_map.light_inside) {
+            snprintf(shadows, sizeof(shadows), " | Sombras: luz dentro da árvore");
+        } else {
+            snprintf(shadows, sizeof(shadows), " | Sombras: %d², %.0f ms (%lu mapas)", shadow_map.resolution,
+                     shadow_map.build_ms, (unsigned long)shadow_map.builds);
+        }
+        status += shadows;
+    }
+
+    if (range_filter_enabled && range_filter.valid) {
+        char filter[160];
+        snprintf(filter, sizeof(filter), " | Filtro: %s [%.3g, %.3g] %lu/%lu seg (busca %.1f µs)",
+                 metricName(range_filter.metric), rangeFilterValue(range_filter.low),
+                 rangeFilterValue(range_filter.high), (unsigned long)filter_segment_count,
+                 (unsigned long)lines.size(), range_filter.query_us);
+        status += filter;
+    }
+
+    if (ambient_occlusion_enabled) {
+        char occlusion[96];
+        const AmbientOcclusion& ao = ambient_occlusion;
+        if (ao.valid) {
+            snprintf(occlusion, sizeof(occlusion), " | Oclusão ambiente: %d raios, alcance %.0fr, %.1f s", ao.rays,
+                     ao.reach, ao.bake_ms / 1000.0);
+        } else {
+            snprintf(occlusion, sizeof(occlusion), " | Oclusão ambiente: %.0f%%",
+                     lines.empty() ? 0.0 : 100.0 * ao.baked / lines.size());
+        }
+        status += occlusion;
+    }
+
+    if (color_metric != METRIC_RADIUS && morphometry.valid) {
+        char range[64];
+        snprintf(range, sizeof(range), " [%.3g, %.3g]", morphometry.min_value[color_metric],
+                 morphometry.max_value[color_metric]);
+        status += " | Cor: " + std::string(metricName(color_metric)) + range;
+        if (color_metric == METRIC_MURRAY && !std::isnan(morphometry.murray_exponent)) {
+            snprintf(range, sizeof(range), ", ajustado %.2f", morphometry.murray_exponent);
+            status += range;
+        }
+        if (color_metric == METRIC_FLOW) {
+            snprintf(range, sizeof(range), ", CV terminais %.1f%%", 100.0 * morphometry.flow.terminal_flow_cv);
+            status += range;
+        }
+    }
+    
     if (animation_enabled) {
         status += " | Animação: ON";
+        if (growthTransitionActive()) {
+            status += " (transição " + std::to_string((int)(100.0f * growth_blend)) + "%)";
+        }
+    }
+    
+    if (!treeGeometryComplete()) {
+        status += " | Malha: " + std::to_string(mesh_built_count) + "/" + std::to_string(lines.size()) +
+                  " (" + std::to_string(100 * mesh_built_count / std::max<size_t>(1, lines.size())) + "%)";
+    }
+    if (interaction_active) {
+        status += " | Prévia";
+    } else if (refine_count < max_segments) {
+        status += " | Refinando: " + std::to_string(100 * refine_count / std::max(1, max_segments)) + "%";
+    }
+    
+    // Estatísticas de culling e tempo de quadro
+    std::string perf = "Quadro (CPU): " + std::to_string(last_frame_ms).substr(0, 5) + " ms | Culling: ";
+    if (occlusion_culling_enabled && !transparency_enabled) {
+        int total = occlusion_stats.segments_visible + occlusion_stats.segments_frustum_culled +
+                    occlusion_stats.segments_occlusion_culled;
+        perf += "ON (visíveis " + std::to_string(occlusion_stats.segments_visible) + "/" + std::to_string(total) +
+                ", frustum " + std::to_string(occlusion_stats.segments_frustum_culled) +
+                ", oclusão " + std::to_string(occlusion_stats.segments_occlusion_culled) +
+                ", oclusores " + std::to_string(occlusion_stats.occluders) +
+                ", " + std::to_string(occlusion_stats.raster_ms + occlusion_stats.query_ms).substr(0, 4) + " ms)";
+    } else {
+        perf += occlusion_culling_enabled ? "OFF (transparência)" : "OFF";
+    }
+    if (occlusion_culling_enabled && !transparency_enabled &&
+        (subtreeFilterActive() || partialGrowth() || growthTransitionActive() || rangeFilterActive())) {
+        const char* reason = subtreeFilterActive() ? "subárvore" :
+                             rangeFilterActive() ? "filtro" :
+                             partialGrowth() ? "crescimento parcial" : "transição";
+        perf = "Quadro (CPU): " + std::to_string(last_frame_ms).substr(0, 5) + " ms | Culling: OFF (" +
+               std::string(reason) + ")";
     }
     
     glRasterPos2f(10, window_height - 20);
@@ -561,12 +1376,35 @@ void displayText() {
         glutBitmapCharacter(GLUT_BITMAP_9_BY_15, c);
     }
     
-    std::string controls = "Controles: Mouse(arrastar=câmera) W/S(zoom) Q/E(azimuth) A/D(elevação) I(i=Flat/Phong) R(raio fixo/variável) T(transp) [](crescimento) M(animação)";
+    std::string controls = "Controles: Mouse(arrastar=câmera) W/S(zoom) Q/E(azimuth) A/D(elevação) I(i=Flat/Phong) R(raio fixo/variável) T(transp) O(blend/OIT) C(culling) Click(seleção) Shift+Click(caminho) V(subárvore) P(pai) H(Hilbert) [](crescimento) G(diferença) X(colisões) F(territórios) Y(voxels) +/-(fatia) B(oclusão ambiente) U(sombras) K(cor por métrica) J(filtro) ←→↑↓/Ctrl+arrastar(limites) M(animação)";
     glRasterPos2f(10, window_height - 40);
     for (char c : controls) {
         glutBitmapCharacter(GLUT_BITMAP_9_BY_15, c);
     }
     
+    // Composição do OIT: custo da última leitura + resolução e limite de
+    // saturação da escala calibrada
+    if (oitActive()) {
+        char oit[128];
+        if (oit_image_reused) {
+            snprintf(oit, sizeof(oit), " | OIT: imagem em cache (%.2f ms; composição %.1f ms), %d camadas",
+                     oit_frame_ms, oit_composite_ms, oit_scale.layers);
+        } else {
+            snprintf(oit, sizeof(oit), " | OIT: composição %.1f ms, %d camadas", oit_composite_ms,
+                     oit_scale.layers);
+        }
+        perf += oit;
+    }
+    
+    glRasterPos2f(10, window_height - 60);
+    for (char c : perf) {
+        glutBitmapCharacter(GLUT_BITMAP_9_BY_15, c);
+    }
+
+    if (range_filter_enabled && range_filter.valid) {
+        drawFilterSlider();
+    }
+    
     glPopMatrix();
     glMatrixMode(GL_PROJECTION);
     glPopMatrix();
@@ -574,7 +1412,14 @@ void displayText() {
 }
 
 void display() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    auto frame_start = std::chrono::steady_clock::now();
+    
+    // Aplicar a rajada de eventos acumulada e refazer só o que foi invalidado
+    redraw_pending = false;
+    applyPendingMotion();
+    updateRetainedState();
+    
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
@@ -594,8 +1439,21 @@ void display() {
     glEnable(GL_COLOR_MATERIAL);
     glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
     
-    // Desenhar árvore
-    drawTree3D();
+    // Desenhar árvore; no OIT, com a cena inalterada, só a imagem composta
+    // do quadro anterior é redesenhada (sem acumulação nem leitura)
+    bool oit_reuse = oitActive() && oitImageCurrent();
+    if (!oit_reuse) {
+        drawTree3D();
+    }
+    
+    // Composição do OIT (passo extra de custo fixo por pixel)
+    if (oitActive()) {
+        compositeOIT(oit_reuse);
+    }
+    
+    // Territórios de perfusão por cima da árvore (translúcidos)
+    drawTerritories();
+    drawVoxelSlice();
     
     // Desenhar segmento selecionado
     if (selected_segment >= 0) {
@@ -606,6 +1464,8 @@ void display() {
     displayText();
     
     glutSwapBuffers();
+    
+    last_frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
 }
 
 void reshape(int w, int h) {
@@ -616,12 +1476,15 @@ void reshape(int w, int h) {
     
     glViewport(0, 0, w, h);
     
+    // O GLUT já agenda o redesenho após o reshape
+    dirty_flags |= DIRTY_CAMERA | DIRTY_HUD;
+    
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
     
     // Projeção perspectiva
     float aspect = (float)w / (float)h;
-    gluPerspective(45.0f, aspect, 0.1f, 1000.0f);
+    gluPerspective(camera.fovy, aspect, camera.znear, camera.zfar);
     
     glMatrixMode(GL_MODELVIEW);
 }
@@ -630,21 +1493,63 @@ void updateCamera() {
     camera.updateEye();
 }
 
-void updateAnimation(int /* value */) {
-    if (animation_enabled) {
-        animation_timer += animation_speed * 0.1f;
-        
-        // Atualizar índice de crescimento baseado no timer
-        if (!growth_files.empty()) {
-            float segment_time = 1.0f;  // Tempo por arquivo em segundos
-            int frame = (int)(animation_timer / segment_time);
-            current_growth_index = frame % growth_files.size();
-            loadCurrentGrowthFile();
+// Instante do último tique da animação (o avanço usa o tempo real, não o
+// período nominal do timer)
+static std::chrono::steady_clock::time_point animation_last_tick;
+
+// Troca de passo durante a animação: o passo atual vira a base da transição
+// (cópia em memória, sem reler o arquivo) e o próximo é carregado uma vez.
+// Ao voltar ao início da série (ou ao saltar passos), a base é a árvore
+// vazia e a árvore inteira brota da raiz.
+static void advanceGrowthStep(int index) {
+    std::vector<Point3D> base_points;
+    std::vector<Line3D> base_lines;
+    std::vector<float> base_radii;
+    std::vector<float> base_display_radii;
+    std::string base_label;
+    if (index == current_growth_index + 1) {
+        base_points = points;
+        base_lines = lines;
+        base_radii = radii;
+        base_display_radii.resize(lines.size());
+        for (size_t i = 0; i < lines.size(); i++) {
+            base_display_radii[i] = getDisplayRadius(i);
         }
-        
-        glutPostRedisplay();
-        glutTimerFunc(50, updateAnimation, 0);  // ~20 FPS
+        base_label = growth_files[current_growth_index];
+    }
+
+    current_growth_index = index;
+    if (!loadCurrentGrowthFile()) return;
+    growth_transition_pending = computeGrowthDiffFrom(base_points, base_lines, base_radii,
+                                                      &base_display_radii, base_label);
+}
+
+void updateAnimation(int value) {
+    if (!animation_enabled) return;
+
+    // value == 0: chamada da tecla M (início da animação)
+    auto now = std::chrono::steady_clock::now();
+    if (value == 0) animation_last_tick = now;
+    float dt = std::chrono::duration<float>(now - animation_last_tick).count();
+    animation_last_tick = now;
+    animation_timer += animation_speed * dt;
+
+    // Cada passo dura segment_time segundos: o arquivo é carregado quando o
+    // passo muda e, no resto do intervalo, só a mistura entre os estados
+    // inicial e final avança
+    if (!growth_files.empty()) {
+        float segment_time = 1.0f;  // Tempo por arquivo em segundos
+        float progress = animation_timer / segment_time;
+        int frame = (int)progress;
+        int index = frame % growth_files.size();
+        if (index != current_growth_index) {
+            advanceGrowthStep(index);
+        }
+        growth_blend = progress - frame;
+        requestRedraw(DIRTY_HUD);  // A carga já marcou geometria ou raios
     }
+
+    glutTimerFunc(16, updateAnimation, 1);  // ~60 FPS
 }
 
 // ============================================================
@@ -652,7 +1557,9 @@ void updateAnimation(int /* value */) {
 // ============================================================
 
 void init() {
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    // Alpha 0 no fundo: o canal alpha é usado como acumulador no OIT
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClearStencil(0);
     
     // Habilitar Z-buffer (remoção de superfícies escondidas)
     glEnable(GL_DEPTH_TEST);
@@ -676,10 +1583,16 @@ void init() {
     std::cout << "  L              - Toggle iluminação ON/OFF\n";
     std::cout << "  R              - Alternar modo de raio (Fixo/Variável)\n";
     std::cout << "  T              - Toggle transparência\n";
+    std::cout << "  O              - Alternar transparência (Blending/OIT)\n";
+    std::cout << "  C              - Toggle culling por oclusão (Hi-Z)\n";
     std::cout << "  [/]            - Arquivo anterior/próximo de crescimento\n";
     std::cout << "  PageUp/Down    - Segmentos incrementais\n";
     std::cout << "  M              - Toggle animação do crescimento\n";
-    std::cout << "  Click          - Selecionar segmento (ao implementar)\n";
+    std::cout << "  Click          - Selecionar segmento (raio na BVH)\n";
+    std::cout << "  Shift+Click    - Caminho do selecionado até outro segmento\n";
+    std::cout << "  V              - Subárvore do selecionado: normal/isolada/oculta/destacada\n";
+    std::cout << "  P              - Selecionar o segmento pai\n";
+    std::cout << "  H              - Renumerar pontos pela curva de Hilbert (recarrega)\n";
     std::cout << "  ESPAÇO         - Reset câmera\n";
     std::cout << "  ESC            - Sair\n";
     std::cout << "\n";
@@ -8,11 +8,13 @@
 
 #include "globals.h"
 
+struct MemoryEntry;
+
 // Funções de interface gráfica
-void drawCylinder(const Point3D& p0, const Point3D& p1, float radius, int segments = 16, 
-                  float base_r = -1.0f, float base_g = -1.0f, float base_b = -1.0f);
 void drawTree3D();
 void drawSelectedSegment();
+void drawTerritories();
+void drawVoxelSlice();
 void displayText();
 void display();
 void reshape(int w, int h);
@@ -20,9 +22,30 @@ void init();
 void updateCamera();
 void updateAnimation(int value = 0);
 
+// Redesenho sob demanda: acumula as flags DIRTY_* e agenda um único quadro
+void requestRedraw(unsigned int flags);
+
+// Filtro por faixa: fração da faixa do atributo sob a coluna x da janela
+// (barra do rodapé, arrastada com Ctrl)
+float filterSliderFraction(int x);
+
+// Renderização progressiva durante a interação
+void notifyInteraction();  // Evento de arrasto/zoom: desenha a prévia barata
+void endInteraction();     // Fim da entrada: inicia o refinamento progressivo
+
 // Funções de iluminação
-void setupLightingFlat(const Point3D& normal);
-void setupLightingPhong(const Point3D& vertex, const Point3D& normal, const Point3D& eye);
 void getColorFromRadius(float normalized_radius, float& r, float& g, float& b);
 
+// Cor iluminada sem emitir glColor (usada na geometria retida, ver mesh.h);
+// visibility multiplica o termo ambiente (oclusão ambiente, ver
+// ambient_occlusion.h) e lit o difuso e o especular (sombras, ver shadow_map.h)
+void shadeFlat(const Point3D& normal, float base_r, float base_g, float base_b, float out[3],
+               float visibility = 1.0f, float lit = 1.0f);
+void shadePhong(const Point3D& vertex, const Point3D& normal, const Point3D& eye,
+                float base_r, float base_g, float base_b, bool specular_enabled, float out[3],
+                float visibility = 1.0f, float lit = 1.0f);
+
+// Caches de desenho (listas de intervalos, cores do OIT) para o --memstats
+void appendInterfaceMemory(std::vector<MemoryEntry>& entries);
+
 #endif // INTERFACE_H
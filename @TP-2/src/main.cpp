@@ -23,14 +23,20 @@
 #include "utils.h"
 #include "interface.h"
 #include "handlers.h"
+#include "headless.h"
 
 // ============================================================
 // MAIN
 // ============================================================
 
 int main(int argc, char** argv) {
+    // Comandos sem janela (--synthetic, --bench-occlusion, ...)
+    if (isHeadlessCommand(argc, argv)) {
+        return runHeadless(argc, argv);
+    }
+    
     glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_ALPHA | GLUT_DEPTH | GLUT_STENCIL);
     glutInitWindowSize(800, 600);
     glutInitWindowPosition(100, 100);
     glutCreateWindow("TP2 - Visualizador 3D Árvores Arteriais");
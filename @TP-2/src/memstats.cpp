@@ -0,0 +1,146 @@
+/*
+ * memstats.cpp
+ * Contabilidade de memória por estrutura (--memstats) - TP2 (3D)
+ */
+
+#include "memstats.h"
+#include "globals.h"
+#include "point_store.h"
+#include "topology.h"
+#include "bvh.h"
+#include "mesh.h"
+#include "interface.h"
+#include "occlusion.h"
+#include "growth_diff.h"
+#include "morphometry.h"
+#include "tree_paths.h"
+#include "territories.h"
+#include "voxelizer.h"
+#include "ambient_occlusion.h"
+#include "shadow_map.h"
+#include "range_filter.h"
+#include "oit.h"
+#include <iostream>
+#include <iomanip>
+
+// ============================================================
+// COLETA
+// ============================================================
+
+static void addMeshEntries(std::vector<MemoryEntry>& entries, const char* prefix, const TubeMesh& mesh) {
+    std::string p(prefix);
+    addMemoryEntry(entries, "Malhas", (p + ".positions").c_str(), mesh.positions);
+    addMemoryEntry(entries, "Malhas", (p + ".indices").c_str(), mesh.indices);
+    addMemoryEntry(entries, "Malhas", (p + ".colors").c_str(), mesh.colors);
+}
+
+void collectMemoryStats(std::vector<MemoryEntry>& entries) {
+    entries.clear();
+
+    // Dados do arquivo
+    addMemoryEntry(entries, "Dados", "points", points);
+    addMemoryEntry(entries, "Dados", "lines", lines);
+    addMemoryEntry(entries, "Dados", "radii", radii);
+
+    // Estruturas derivadas na carga
+    addMemoryEntry(entries, "Derivados", "segments_by_radius", segments_by_radius);
+    addMemoryEntry(entries, "Derivados", "topology.node_offsets", topology.node_offsets);
+    addMemoryEntry(entries, "Derivados", "topology.node_segments", topology.node_segments);
+    addMemoryEntry(entries, "Derivados", "topology.proximal_node", topology.proximal_node);
+    addMemoryEntry(entries, "Derivados", "topology.distal_node", topology.distal_node);
+    addMemoryEntry(entries, "Derivados", "topology.parent", topology.parent);
+    addMemoryEntry(entries, "Derivados", "topology.child_offsets", topology.child_offsets);
+    addMemoryEntry(entries, "Derivados", "topology.children", topology.children);
+    addMemoryEntry(entries, "Derivados", "topology.subtree_end", topology.subtree_end);
+    addMemoryEntry(entries, "Derivados", "topology.source_segment", topology.source_segment);
+    addMemoryEntry(entries, "Derivados", "topology.length_prefix", topology.length_prefix);
+    addMemoryEntry(entries, "Derivados", "topology.volume_prefix", topology.volume_prefix);
+    addMemoryEntry(entries, "Derivados", "topology.terminal_prefix", topology.terminal_prefix);
+    addMemoryEntry(entries, "Derivados", "topology.generation", topology.generation);
+    addMemoryEntry(entries, "Derivados", "topology.generation_order", topology.generation_order);
+    addMemoryEntry(entries, "Derivados", "topology.generation_rank", topology.generation_rank);
+    addMemoryEntry(entries, "Derivados", "topology.terminals", topology.terminals);
+    appendPathIndexMemory(entries);
+    addMemoryEntry(entries, "Derivados", "bvh.nodes", segment_bvh.nodes);
+    addMemoryEntry(entries, "Derivados", "bvh.segment_ids", segment_bvh.segment_ids);
+    addMemoryEntry(entries, "Derivados", "bvh.segment_boxes", segment_bvh.segment_boxes);
+
+    // Geometria retida
+    addMeshEntries(entries, "tree_mesh", tree_mesh);
+    addMeshEntries(entries, "preview_mesh", preview_mesh);
+    addMemoryEntry(entries, "Malhas", "skeleton_positions", skeleton_positions);
+    addMemoryEntry(entries, "Malhas", "skeleton_colors", skeleton_colors);
+    addMemoryEntry(entries, "Malhas", "segment_color_index", segment_color_index);
+
+    // Caches por quadro
+    addMemoryEntry(entries, "Caches", "growth_diff.change", growth_diff.change);
+    addMemoryEntry(entries, "Caches", "growth_diff.start_points", growth_diff.start_points);
+    addMemoryEntry(entries, "Caches", "growth_diff.start_radii", growth_diff.start_radii);
+    appendMeshMemory(entries);
+    appendMorphometryMemory(entries);
+    appendTerritoryMemory(entries);
+    appendVoxelMemory(entries);
+    appendAmbientOcclusionMemory(entries);
+    appendShadowMapMemory(entries);
+    appendRangeFilterMemory(entries);
+    appendOITMemory(entries);
+    appendOcclusionMemory(entries);
+    appendInterfaceMemory(entries);
+}
+
+size_t memoryUsedTotal(const std::vector<MemoryEntry>& entries) {
+    size_t total = 0;
+    for (const MemoryEntry& e : entries) total += e.used;
+    return total;
+}
+
+size_t memoryReservedTotal(const std::vector<MemoryEntry>& entries) {
+    size_t total = 0;
+    for (const MemoryEntry& e : entries) total += e.reserved;
+    return total;
+}
+
+// ============================================================
+// RELATÓRIO
+// ============================================================
+
+static double toKB(size_t bytes) {
+    return bytes / 1024.0;
+}
+
+void printMemoryStats(const std::vector<MemoryEntry>& entries, size_t segment_count) {
+    const char* groups[] = {"Dados", "Derivados", "Malhas", "Caches"};
+    size_t per_segment = segment_count > 0 ? segment_count : 1;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  " << std::left << std::setw(36) << "estrutura" << std::right
+              << std::setw(12) << "usado KB" << std::setw(12) << "reserv. KB"
+              << std::setw(10) << "B/seg" << std::endl;
+    for (const char* group : groups) {
+        size_t used = 0, reserved = 0;
+        for (const MemoryEntry& e : entries) {
+            if (e.group != group) continue;
+            used += e.used;
+            reserved += e.reserved;
+        }
+        std::cout << "  [" << group << "]" << std::endl;
+        for (const MemoryEntry& e : entries) {
+            if (e.group != group || e.reserved == 0) continue;
+            std::cout << "    " << std::left << std::setw(34) << e.name << std::right
+                      << std::setw(12) << toKB(e.used) << std::setw(12) << toKB(e.reserved)
+                      << std::setw(10) << (double)e.used / per_segment << std::endl;
+        }
+        std::cout << "    " << std::left << std::setw(34) << "subtotal" << std::right
+                  << std::setw(12) << toKB(used) << std::setw(12) << toKB(reserved)
+                  << std::setw(10) << (double)used / per_segment << std::endl;
+    }
+
+    size_t used = memoryUsedTotal(entries);
+    size_t reserved = memoryReservedTotal(entries);
+    std::cout << "  " << std::left << std::setw(36) << "TOTAL" << std::right
+              << std::setw(12) << toKB(used) << std::setw(12) << toKB(reserved)
+              << std::setw(10) << (double)used / per_segment << std::endl;
+    std::cout << "  folga (reservado - usado): " << toKB(reserved - used) << " KB" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout.precision(6);
+}
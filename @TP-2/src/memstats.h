@@ -0,0 +1,41 @@
+/*
+ * memstats.h
+ * Contabilidade de memória por estrutura (--memstats) - TP2 (3D)
+ */
+
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Uma estrutura: bytes em uso (size) e reservados (capacity)
+struct MemoryEntry {
+    std::string group;   // Dados, Derivados, Malhas, Caches
+    std::string name;
+    size_t used;
+    size_t reserved;
+};
+
+template <typename V>
+void addMemoryEntry(std::vector<MemoryEntry>& entries, const char* group, const char* name, const V& v) {
+    MemoryEntry e;
+    e.group = group;
+    e.name = name;
+    e.used = v.size() * sizeof(typename V::value_type);
+    e.reserved = v.capacity() * sizeof(typename V::value_type);
+    entries.push_back(e);
+}
+
+// Coleta todas as estruturas do programa. Cada módulo com caches próprios
+// (static) contribui pela sua função append*Memory.
+void collectMemoryStats(std::vector<MemoryEntry>& entries);
+
+// Tabela agrupada com totais e folga (reservado - usado)
+void printMemoryStats(const std::vector<MemoryEntry>& entries, size_t segment_count);
+
+size_t memoryUsedTotal(const std::vector<MemoryEntry>& entries);
+size_t memoryReservedTotal(const std::vector<MemoryEntry>& entries);
+
+#endif // MEMSTATS_H
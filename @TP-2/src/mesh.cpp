@@ -0,0 +1,746 @@
+/*
+ * mesh.cpp
+ * Construção e iluminação da geometria retida dos tubos - TP2 (3D)
+ */
+
+#include "mesh.h"
+#include "globals.h"
+#include "utils.h"
+#include "interface.h"
+#include "point_store.h"
+#include "growth_diff.h"
+#include "morphometry.h"
+#include "collision.h"
+#include "territories.h"
+#include "memstats.h"
+#include "ambient_occlusion.h"
+#include "shadow_map.h"
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MESH_SSE 1
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+MeshQuantization mesh_quantization = {{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}};
+TubeMesh tree_mesh;
+TubeMesh preview_mesh;
+std::vector<short> skeleton_positions;
+std::vector<unsigned char> skeleton_colors;
+std::vector<unsigned char> segment_color_index;
+std::vector<int> mesh_previous_segment;
+int mesh_built_count = 0;
+int mesh_reused_count = 0;
+
+// Ordem de construção dos blocos: maiores raios primeiro, com os blocos
+// copiados do passo anterior depois dos novos (mesh_built_count conta nela)
+static std::vector<int> build_order;
+
+// Lados da malha de prévia (usada durante a interação)
+static const int PREVIEW_SIDES = 6;
+
+// Paleta do gradiente do raio (RGB), indexada por segment_color_index
+static const int PALETTE_SIZE = 256;
+static float color_palette[3 * PALETTE_SIZE];
+
+// ============================================================
+// FORMATO COMPACTO DOS VÉRTICES
+// ============================================================
+
+// Inverso de mesh_quantization.step (a quantização só multiplica)
+static float quant_inv_step[3] = {1.0f, 1.0f, 1.0f};
+
+// Folga da margem de raio na caixa quantizada (beginTreeRadii). O maior raio
+// de exibição é normalizado pelo maior raio do arquivo (scaleRadiusForDisplay),
+// então entre passos ele só varia por arredondamento ou troca de modo de raio;
+// 25% a mais custam ~1% de precisão no maior eixo e evitam refazer a caixa
+static const float QUANT_RADIUS_HEADROOM = 1.25f;
+
+// Caixa dos pontos com margem de `margin_scale` vezes o maior raio de exibição
+static void tubeBounds(float margin_scale, float lo[3], float hi[3]) {
+    pointBounds(points, lo, hi);
+    float margin = 0.0f;
+    for (size_t i = 0; i < lines.size(); i++) {
+        margin = std::max(margin, getDisplayRadius(i));
+    }
+    for (int k = 0; k < 3; k++) {
+        lo[k] -= margin_scale * margin;
+        hi[k] += margin_scale * margin;
+    }
+}
+
+// Caixa dos tubos, com a folga, dividida em 65536 níveis por eixo; origin
+// fica no nível 32768 para usar toda a faixa do short
+static void computeQuantization() {
+    float bmin[3], bmax[3];
+    tubeBounds(QUANT_RADIUS_HEADROOM, bmin, bmax);
+    for (int k = 0; k < 3; k++) {
+        float extent = std::max(bmax[k] - bmin[k], 1e-6f);
+        mesh_quantization.step[k] = extent / 65535.0f;
+        mesh_quantization.origin[k] = bmin[k] + 32768.0f * mesh_quantization.step[k];
+        quant_inv_step[k] = 1.0f / mesh_quantization.step[k];
+    }
+}
+
+// A quantização atual representa a caixa [lo, hi] sem saturar?
+static bool quantizationCovers(const float lo[3], const float hi[3]) {
+    for (int k = 0; k < 3; k++) {
+        if (lo[k] < mesh_quantization.origin[k] - 32768.0f * mesh_quantization.step[k] ||
+            hi[k] > mesh_quantization.origin[k] + 32767.0f * mesh_quantization.step[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Arredonda para o inteiro mais próximo e satura na faixa do short. O
+// deslocamento deixa o valor positivo: o truncamento vira arredondamento sem
+// desvio condicional (os sinais alternam ao redor do tubo)
+static short toShort(float t) {
+    t = std::min(32767.0f, std::max(-32768.0f, t));
+    return (short)((int)(t + 32768.5f) - 32768);
+}
+
+// Reescreve posições já quantizadas de `previous` para a quantização atual
+// (q' = (origem + q * passo - origem') / passo', por eixo)
+static void requantizePositions(const MeshQuantization& previous, short* pos, size_t count) {
+    float scale[3], offset[3];
+    for (int k = 0; k < 3; k++) {
+        scale[k] = previous.step[k] * quant_inv_step[k];
+        offset[k] = (previous.origin[k] - mesh_quantization.origin[k]) * quant_inv_step[k];
+    }
+    for (size_t i = 0; i < count; i++) {
+        short* q = &pos[3 * i];
+        for (int k = 0; k < 3; k++) {
+            q[k] = toShort(q[k] * scale[k] + offset[k]);
+        }
+    }
+}
+
+static void quantizePosition(const Point3D& p, short* q) {
+    q[0] = toShort((p.x - mesh_quantization.origin[0]) * quant_inv_step[0]);
+    q[1] = toShort((p.y - mesh_quantization.origin[1]) * quant_inv_step[1]);
+    q[2] = toShort((p.z - mesh_quantization.origin[2]) * quant_inv_step[2]);
+}
+
+static Point3D dequantizePosition(const short* q) {
+    return Point3D(mesh_quantization.origin[0] + q[0] * mesh_quantization.step[0],
+                   mesh_quantization.origin[1] + q[1] * mesh_quantization.step[1],
+                   mesh_quantization.origin[2] + q[2] * mesh_quantization.step[2]);
+}
+
+// ============================================================
+// TESSELAÇÃO
+// ============================================================
+
+// Base ortonormal ao redor da direção unitária dir
+void ringBasis(const Point3D& dir, Point3D& u, Point3D& v) {
+    Point3D up(0, 1, 0);
+    if (fabsf(dotProduct(dir, up)) > 0.9f) {
+        up = Point3D(1, 0, 0);
+    }
+    u = crossProduct(up, dir);
+    u.normalize();
+    v = crossProduct(dir, u);
+    v.normalize();
+}
+
+// Layout dos vértices de um segmento (s = lados):
+//   [0, s)        anel lateral em p0      [s, 2s)        anel lateral em p1
+//   2s            centro da tampa p0      [2s+1, 3s+1)   anel da tampa p0
+//   3s+1          centro da tampa p1      [3s+2, 4s+2)   anel da tampa p1
+// Cada posição do anel aparece na lateral e na tampa: quantiza uma vez e copia
+static void writeBlockPositions(int s, const Point3D& p0, const Point3D& p1, const Point3D& u, const Point3D& v,
+                                float radius, const std::vector<float>& cos_t, const std::vector<float>& sin_t,
+                                short* pos) {
+    auto copy3 = [](short* dst, const short* src) { dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; };
+    for (int j = 0; j < s; j++) {
+        Point3D offset = (u * cos_t[j] + v * sin_t[j]) * radius;
+        quantizePosition(p0 + offset, &pos[3 * j]);
+        quantizePosition(p1 + offset, &pos[3 * (s + j)]);
+        copy3(&pos[3 * (2 * s + 1 + j)], &pos[3 * j]);
+        copy3(&pos[3 * (3 * s + 2 + j)], &pos[3 * (s + j)]);
+    }
+    quantizePosition(p0, &pos[3 * (2 * s)]);
+    quantizePosition(p1, &pos[3 * (3 * s + 1)]);
+}
+
+// Posições do bloco do segmento; os índices vêm do molde compartilhado e as
+// normais são refeitas na iluminação (computeBlockNormals)
+static void tessellateSegment(TubeMesh& mesh, size_t seg) {
+    short* pos = &mesh.positions[3 * seg * mesh.verts_per_segment];
+    const Point3D& p0 = points[lines[seg].p0];
+    const Point3D& p1 = points[lines[seg].p1];
+    Point3D dir = p1 - p0;
+    if (dir.length() < 0.0001f) {
+        // Segmento degenerado: todos os vértices em p0 (triângulos sem área)
+        for (int k = 0; k < mesh.verts_per_segment; k++) {
+            quantizePosition(p0, &pos[3 * k]);
+        }
+        return;
+    }
+    dir.normalize();
+
+    Point3D u, v;
+    ringBasis(dir, u, v);
+    writeBlockPositions(mesh.sides, p0, p1, u, v, getDisplayRadius(seg), mesh.ring_cos, mesh.ring_sin, pos);
+}
+
+// Molde de índices de um lote: run_segments blocos consecutivos, o bloco k
+// com os vértices a partir de k * verts_per_segment (16 bits bastam porque o
+// lote inteiro cabe em 65536 vértices)
+static void buildIndexTemplate(TubeMesh& mesh) {
+    int s = mesh.sides;
+    mesh.indices.resize((size_t)mesh.run_segments * mesh.indices_per_segment);
+    unsigned short* idx = mesh.indices.data();
+    for (int block = 0; block < mesh.run_segments; block++) {
+        unsigned short b = (unsigned short)(block * mesh.verts_per_segment);
+        // Dois triângulos por face lateral + leque em cada tampa
+        for (int j = 0; j < s; j++) {
+            unsigned short j1 = (unsigned short)((j + 1) % s);
+            unsigned short r0 = b + j, r0n = b + j1;
+            unsigned short r1 = b + s + j, r1n = b + s + j1;
+            *idx++ = r0; *idx++ = r1; *idx++ = r1n;
+            *idx++ = r0; *idx++ = r1n; *idx++ = r0n;
+        }
+        for (int j = 0; j < s; j++) {
+            unsigned short j1 = (unsigned short)((j + 1) % s);
+            unsigned short c0 = b + 2 * s;
+            *idx++ = c0; *idx++ = c0 + 1 + j1; *idx++ = c0 + 1 + j;
+            unsigned short c1 = b + 3 * s + 1;
+            *idx++ = c1; *idx++ = c1 + 1 + j; *idx++ = c1 + 1 + j1;
+        }
+    }
+}
+
+void writeSegmentIndices(const TubeMesh& mesh, size_t seg, unsigned int* dst) {
+    unsigned int offset = (unsigned int)(seg * mesh.verts_per_segment);
+    for (int k = 0; k < mesh.indices_per_segment; k++) {
+        dst[k] = mesh.indices[k] + offset;
+    }
+}
+
+static void allocateMesh(TubeMesh& mesh, int sides) {
+    if (sides < 3) sides = 3;
+    size_t n = lines.size();
+
+    mesh.sides = sides;
+    mesh.verts_per_segment = 4 * sides + 2;
+    mesh.indices_per_segment = 12 * sides;
+    mesh.segment_count = n;
+    mesh.run_segments = (int)std::max<size_t>(1, std::min<size_t>(n, 65536 / mesh.verts_per_segment));
+
+    // Posições zeradas: um bloco ainda não construído é um tubo degenerado
+    // num só ponto (sem área) até a vez do segmento em continueTreeGeometry
+    mesh.positions.assign(n * mesh.verts_per_segment * 3, 0);
+    mesh.colors.clear();
+    mesh.colors.resize(n * mesh.verts_per_segment * 4);
+    buildIndexTemplate(mesh);
+
+    mesh.ring_cos.resize(sides);
+    mesh.ring_sin.resize(sides);
+    for (int j = 0; j < sides; j++) {
+        float angle = 2.0f * (float)M_PI * j / sides;
+        mesh.ring_cos[j] = cosf(angle);
+        mesh.ring_sin[j] = sinf(angle);
+    }
+}
+
+void updateSegmentColors() {
+    size_t n = lines.size();
+
+    // Colisões (tecla X): cinza, laranja (abaixo da folga) e vermelho
+    // (sobreposição) nas primeiras entradas
+    if (collision_view != COLLISION_OFF && collision_report.valid && collision_report.segment_class.size() == n) {
+        const float classes[3][3] = {{0.55f, 0.55f, 0.55f}, {1.0f, 0.6f, 0.1f}, {1.0f, 0.15f, 0.15f}};
+        for (int c = 0; c < 3; c++) {
+            for (int k = 0; k < 3; k++) color_palette[3 * c + k] = classes[c][k];
+        }
+        segment_color_index.assign(collision_report.segment_class.begin(), collision_report.segment_class.end());
+        return;
+    }
+
+    // Territórios (tecla F): cada terminal com a cor do seu território
+    // (entradas 1 a 255), o resto da árvore em cinza (entrada 0)
+    if (territory_view != TERRITORY_OFF && territory_map.valid) {
+        getTerritoryColor(-1, color_palette[0], color_palette[1], color_palette[2]);
+        for (int k = 1; k < PALETTE_SIZE; k++) {
+            getTerritoryColor(k - 1, color_palette[3 * k], color_palette[3 * k + 1], color_palette[3 * k + 2]);
+        }
+        segment_color_index.assign(n, 0);
+        for (size_t t = 0; t < territory_map.terminals.size(); t++) {
+            int s = territory_map.terminals[t];
+            if (s < (int)n) segment_color_index[s] = (unsigned char)(1 + t % (PALETTE_SIZE - 1));
+        }
+        return;
+    }
+
+    // Diferença entre passos: uma cor por classe nas primeiras entradas
+    if (diff_view_enabled && growth_diff.valid && growth_diff.change.size() == n) {
+        for (int c = 0; c < CHANGE_CLASSES; c++) {
+            getChangeClassColor(c, color_palette[3 * c], color_palette[3 * c + 1], color_palette[3 * c + 2]);
+        }
+        segment_color_index.assign(growth_diff.change.begin(), growth_diff.change.end());
+        return;
+    }
+
+    // Métrica morfológica (tecla K): gradiente nas primeiras 255 entradas,
+    // cinza na última para os segmentos onde a métrica não se aplica (ou sem
+    // valor positivo, nas métricas em escala log)
+    if (color_metric != METRIC_RADIUS && morphometry.valid && morphometry.values[color_metric].size() == n) {
+        const int steps = PALETTE_SIZE - 1;
+        for (int k = 0; k < steps; k++) {
+            getColorFromRadius(k / (float)(steps - 1), color_palette[3 * k],
+                               color_palette[3 * k + 1], color_palette[3 * k + 2]);
+        }
+        color_palette[3 * steps] = color_palette[3 * steps + 1] = color_palette[3 * steps + 2] = 0.5f;
+        const std::vector<float>& values = morphometry.values[color_metric];
+        float lo = morphometry.min_value[color_metric];
+        float hi = morphometry.max_value[color_metric];
+        bool log_scale = metricLogScale(color_metric) && lo > 0.0f;
+        if (log_scale) {
+            lo = log10f(lo);
+            hi = log10f(hi);
+        }
+        float range = hi - lo;
+        if (range < 1e-6f) range = 1.0f;
+        segment_color_index.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            if (!std::isfinite(values[i]) || (log_scale && !(values[i] > 0.0f))) {
+                segment_color_index[i] = (unsigned char)steps;
+                continue;
+            }
+            float v = log_scale ? log10f(values[i]) : values[i];
+            float t = std::min(1.0f, std::max(0.0f, (v - lo) / range));
+            segment_color_index[i] = (unsigned char)floorf(t * (steps - 1) + 0.5f);
+        }
+        return;
+    }
+
+    // Gradiente do raio original do VTK, amostrado em uma paleta de 256 cores
+    for (int k = 0; k < PALETTE_SIZE; k++) {
+        getColorFromRadius(k / (float)(PALETTE_SIZE - 1), color_palette[3 * k],
+                           color_palette[3 * k + 1], color_palette[3 * k + 2]);
+    }
+    float range_r = radius_max - radius_min;
+    if (range_r < 1e-6f) range_r = 1.0f;
+    segment_color_index.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        float t = std::min(1.0f, std::max(0.0f, (radii[i] - radius_min) / range_r));
+        segment_color_index[i] = (unsigned char)floorf(t * (PALETTE_SIZE - 1) + 0.5f);
+    }
+}
+
+static void discardGrowthTransition();
+
+// Copia os blocos dos segmentos casados (mesh_previous_segment) de old_mesh,
+// convertendo as posições se a quantização mudou
+static void copyPreviousBlocks(const TubeMesh& old_mesh, TubeMesh& mesh, const MeshQuantization& previous,
+                               bool requantize) {
+    size_t vps = mesh.verts_per_segment;
+    for (size_t s = 0; s < mesh.segment_count; s++) {
+        int p = mesh_previous_segment[s];
+        if (p < 0 || (size_t)p >= old_mesh.segment_count) continue;
+        short* pos = &mesh.positions[3 * s * vps];
+        std::copy(&old_mesh.positions[3 * p * vps], &old_mesh.positions[3 * (p + 1) * vps], pos);
+        if (requantize) requantizePositions(previous, pos, vps);
+        std::copy(&old_mesh.colors[4 * p * vps], &old_mesh.colors[4 * (p + 1) * vps], &mesh.colors[4 * s * vps]);
+    }
+}
+
+void beginTreeGeometry() {
+    size_t n = lines.size();
+
+    discardGrowthTransition();
+
+    updateSegmentColors();
+    MeshQuantization previous = mesh_quantization;
+    computeQuantization();
+
+    // Passo que estende o anterior: as malhas atuais ainda são as dele e os
+    // blocos dos segmentos casados são copiados para o novo layout
+    bool reuse = mesh_previous_segment.size() == n && tree_mesh.sides == std::max(3, cylinder_quality) &&
+                 preview_mesh.sides == PREVIEW_SIDES;
+    TubeMesh old_tree, old_preview;
+    if (reuse) {
+        std::swap(old_tree, tree_mesh);
+        std::swap(old_preview, preview_mesh);
+    }
+
+    allocateMesh(tree_mesh, cylinder_quality);
+    allocateMesh(preview_mesh, PREVIEW_SIDES);
+    mesh_built_count = 0;
+    mesh_reused_count = 0;
+    build_order.clear();
+    build_order.reserve(n);
+
+    if (reuse) {
+        bool requantize = false;
+        for (int k = 0; k < 3; k++) {
+            requantize |= previous.origin[k] != mesh_quantization.origin[k] ||
+                          previous.step[k] != mesh_quantization.step[k];
+        }
+        copyPreviousBlocks(old_tree, tree_mesh, previous, requantize);
+        copyPreviousBlocks(old_preview, preview_mesh, previous, requantize);
+
+        // Novos primeiro; os copiados continuam na tela com o raio antigo até
+        // a vez deles
+        auto copied = [&](int s) {
+            int p = mesh_previous_segment[s];
+            return p >= 0 && (size_t)p < old_tree.segment_count;
+        };
+        for (int s : segments_by_radius) {
+            if (!copied(s)) build_order.push_back(s);
+        }
+        size_t fresh = build_order.size();
+        for (int s : segments_by_radius) {
+            if (copied(s)) build_order.push_back(s);
+        }
+        mesh_reused_count = (int)(n - fresh);
+    } else {
+        build_order.assign(segments_by_radius.begin(), segments_by_radius.end());
+    }
+    std::vector<int>().swap(mesh_previous_segment);
+
+    // O esqueleto é barato (2 vértices por segmento): sai completo
+    skeleton_positions.resize(6 * n);
+    skeleton_colors.assign(8 * n, 0);
+    for (size_t i = 0; i < n; i++) {
+        quantizePosition(points[lines[i].p0], &skeleton_positions[6 * i]);
+        quantizePosition(points[lines[i].p1], &skeleton_positions[6 * i + 3]);
+    }
+}
+
+bool beginTreeRadii() {
+    // Só as posições dependem do raio: basta que a malha tenha os mesmos
+    // segmentos e lados, mesmo no meio de uma construção
+    size_t n = lines.size();
+    if (tree_mesh.segment_count != n ||
+        preview_mesh.segment_count != n || tree_mesh.sides != std::max(3, cylinder_quality)) {
+        return false;
+    }
+
+    discardGrowthTransition();
+
+    // Os blocos ainda não refeitos continuam desenhados com as posições
+    // antigas. Em geral os novos raios cabem na folga da caixa e nada muda;
+    // senão a caixa é refeita e as posições antigas (malhas e esqueleto) são
+    // convertidas no lugar, sem refazer a tesselação
+    float lo[3], hi[3];
+    tubeBounds(1.0f, lo, hi);
+    if (!quantizationCovers(lo, hi)) {
+        MeshQuantization previous = mesh_quantization;
+        computeQuantization();
+        requantizePositions(previous, tree_mesh.positions.data(), tree_mesh.positions.size() / 3);
+        requantizePositions(previous, preview_mesh.positions.data(), preview_mesh.positions.size() / 3);
+        requantizePositions(previous, skeleton_positions.data(), skeleton_positions.size() / 3);
+    }
+
+    updateSegmentColors();
+    mesh_built_count = 0;
+    mesh_reused_count = (int)n;
+    build_order.assign(segments_by_radius.begin(), segments_by_radius.end());
+    return true;
+}
+
+static void shadeSegment(const TubeMesh& mesh, size_t seg, bool specular, unsigned char* dst);
+
+static void lightSegment(TubeMesh& mesh, size_t seg) {
+    shadeSegment(mesh, seg, false, &mesh.colors[seg * 4 * mesh.verts_per_segment]);
+}
+
+int continueTreeGeometry(double budget_ms) {
+    auto start = std::chrono::steady_clock::now();
+    int total = (int)build_order.size();
+
+    while (mesh_built_count < total) {
+        int seg = build_order[mesh_built_count++];
+        tessellateSegment(tree_mesh, seg);
+        tessellateSegment(preview_mesh, seg);
+        lightSegment(tree_mesh, seg);
+        lightSegment(preview_mesh, seg);
+        if ((mesh_built_count & 31) == 0) {
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed > budget_ms) break;
+        }
+    }
+    return mesh_built_count;
+}
+
+bool treeGeometryComplete() {
+    // Ordem de uma carga anterior (beginTreeGeometry ainda não chamado) não conta
+    return build_order.size() == segments_by_radius.size() && mesh_built_count >= (int)build_order.size();
+}
+
+// ============================================================
+// TRANSIÇÃO ENTRE PASSOS
+// ============================================================
+
+// Posições quantizadas dos dois estados de uma malha; a cada quadro
+// `positions` recebe a interpolação linear entre elas
+struct TransitionBuffers {
+    RawVector<short> start;
+    RawVector<short> end;
+};
+
+static TransitionBuffers tree_transition;
+static TransitionBuffers preview_transition;
+static TransitionBuffers skeleton_transition;
+static bool transition_active = false;
+
+static void discardGrowthTransition() {
+    for (TransitionBuffers* tb : {&tree_transition, &preview_transition, &skeleton_transition}) {
+        RawVector<short>().swap(tb->start);
+        RawVector<short>().swap(tb->end);
+    }
+    transition_active = false;
+}
+
+// Bloco do segmento no estado inicial (growth_diff.start_*). A base do anel
+// vem da direção final: o tubo cresce/desliza sem girar ao redor do eixo.
+static void writeStartPositions(const TubeMesh& mesh, size_t seg, short* pos) {
+    const Point3D& a = growth_diff.start_points[lines[seg].p0];
+    const Point3D& b = growth_diff.start_points[lines[seg].p1];
+    Point3D dir = points[lines[seg].p1] - points[lines[seg].p0];
+    if (dir.length() < 0.0001f) {
+        for (int k = 0; k < mesh.verts_per_segment; k++) {
+            quantizePosition(a, &pos[3 * k]);
+        }
+        return;
+    }
+    dir.normalize();
+    Point3D u, v;
+    ringBasis(dir, u, v);
+    writeBlockPositions(mesh.sides, a, b, u, v, growth_diff.start_radii[seg], mesh.ring_cos, mesh.ring_sin, pos);
+}
+
+static void prepareTransition(const TubeMesh& mesh, TransitionBuffers& tb) {
+    tb.end.assign(mesh.positions.begin(), mesh.positions.end());
+    tb.start.resize(mesh.positions.size());
+    size_t stride = 3 * mesh.verts_per_segment;
+    for (size_t i = 0; i < mesh.segment_count; i++) {
+        writeStartPositions(mesh, i, &tb.start[i * stride]);
+    }
+}
+
+bool beginGrowthTransition() {
+    size_t n = lines.size();
+    if (!treeGeometryComplete() || !growth_diff.valid ||
+        growth_diff.start_radii.size() != n || growth_diff.start_points.size() != points.size() ||
+        tree_mesh.segment_count != n || preview_mesh.segment_count != n) {
+        return false;
+    }
+
+    prepareTransition(tree_mesh, tree_transition);
+    prepareTransition(preview_mesh, preview_transition);
+    skeleton_transition.end.assign(skeleton_positions.begin(), skeleton_positions.end());
+    skeleton_transition.start.resize(6 * n);
+    for (size_t i = 0; i < n; i++) {
+        quantizePosition(growth_diff.start_points[lines[i].p0], &skeleton_transition.start[6 * i]);
+        quantizePosition(growth_diff.start_points[lines[i].p1], &skeleton_transition.start[6 * i + 3]);
+    }
+    transition_active = true;
+    blendGrowthTransition(0.0f, false);
+    blendGrowthTransition(0.0f, true);
+    return true;
+}
+
+// out = a·(1 - t) + b·t em ponto fixo Q14: com t = 0 ou 1 o resultado é
+// exatamente um dos estados. Na versão SSE2, cada _mm_madd_epi16 mistura 4
+// pares (a, b) intercalados; a escalar faz a mesma conta.
+static void blendPositions(const TransitionBuffers& tb, float t, short* out) {
+    const short* a = tb.start.data();
+    const short* b = tb.end.data();
+    size_t count = tb.end.size();
+    int w1 = (int)(t * 16384.0f + 0.5f);
+    int w0 = 16384 - w1;
+    size_t i = 0;
+#ifdef MESH_SSE
+    __m128i weights = _mm_set1_epi32((w1 << 16) | w0);
+    __m128i round = _mm_set1_epi32(1 << 13);
+    for (; i + 8 <= count; i += 8) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(va, vb), weights);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(va, vb), weights);
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, round), 14);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, round), 14);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = (short)((a[i] * w0 + b[i] * w1 + (1 << 13)) >> 14);
+    }
+}
+
+void blendGrowthTransition(float t, bool preview) {
+    if (!transition_active) return;
+    t = std::min(1.0f, std::max(0.0f, t));
+    if (preview) {
+        blendPositions(preview_transition, t, preview_mesh.positions.data());
+        blendPositions(skeleton_transition, t, skeleton_positions.data());
+    } else {
+        blendPositions(tree_transition, t, tree_mesh.positions.data());
+    }
+}
+
+void endGrowthTransition() {
+    if (!transition_active) return;
+    blendGrowthTransition(1.0f, false);
+    blendGrowthTransition(1.0f, true);
+    discardGrowthTransition();
+}
+
+bool growthTransitionActive() {
+    return transition_active;
+}
+
+void appendMeshMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Caches", "mesh.build_order", build_order);
+    MemoryEntry e;
+    e.group = "Caches";
+    e.name = "transition (início + fim)";
+    e.used = e.reserved = 0;
+    for (const TransitionBuffers* tb : {&tree_transition, &preview_transition, &skeleton_transition}) {
+        e.used += (tb->start.size() + tb->end.size()) * sizeof(short);
+        e.reserved += (tb->start.capacity() + tb->end.capacity()) * sizeof(short);
+    }
+    entries.push_back(e);
+}
+
+// ============================================================
+// ILUMINAÇÃO DOS VÉRTICES
+// ============================================================
+
+static unsigned char toByte(float c) {
+    return (unsigned char)(255.0f * std::min(1.0f, std::max(0.0f, c)) + 0.5f);
+}
+
+// Alpha gravado nas cores: o OIT reescala as cores por quadro (ver interface.cpp)
+static unsigned char vertexAlpha() {
+    return transparency_enabled ? toByte(transparency_alpha) : 255;
+}
+
+// Normais do bloco em iluminação (reaproveitado entre segmentos)
+static std::vector<Point3D> block_normals;
+
+// Normais do bloco refeitas a partir do eixo, no layout de writeBlockPositions:
+// os dois anéis laterais têm a direção radial de cada lado e cada tampa uma
+// só normal; o segmento degenerado fica sem normal (só a luz ambiente)
+static void computeBlockNormals(const TubeMesh& mesh, size_t seg) {
+    int s = mesh.sides;
+    block_normals.resize(mesh.verts_per_segment);
+    Point3D dir = points[lines[seg].p1] - points[lines[seg].p0];
+    if (dir.length() < 0.0001f) {
+        std::fill(block_normals.begin(), block_normals.end(), Point3D());
+        return;
+    }
+    dir.normalize();
+    Point3D u, v;
+    ringBasis(dir, u, v);
+    for (int j = 0; j < s; j++) {
+        block_normals[j] = block_normals[s + j] = u * mesh.ring_cos[j] + v * mesh.ring_sin[j];
+    }
+    std::fill(block_normals.begin() + 2 * s, block_normals.begin() + 3 * s + 1, dir * -1.0f);
+    std::fill(block_normals.begin() + 3 * s + 1, block_normals.end(), dir);
+}
+
+// Luz que chega a cada vértice do bloco (mapa de sombras): as posições dos
+// anéis das tampas repetem as dos anéis laterais, então só os 2s vértices
+// laterais e os dois centros consultam o mapa
+static std::vector<float> block_lit;
+
+static void lookupBlockShadows(const TubeMesh& mesh, size_t seg, size_t first) {
+    int s = mesh.sides;
+    block_lit.resize(mesh.verts_per_segment);
+    float bias = 0.5f * getDisplayRadius(seg);
+    for (int k = 0; k < 2 * s; k++) {
+        block_lit[k] = shadowLitFraction(dequantizePosition(&mesh.positions[3 * (first + k)]), (int)seg, bias);
+    }
+    block_lit[2 * s] = shadowLitFraction(dequantizePosition(&mesh.positions[3 * (first + 2 * s)]), (int)seg, bias);
+    block_lit[3 * s + 1] =
+        shadowLitFraction(dequantizePosition(&mesh.positions[3 * (first + 3 * s + 1)]), (int)seg, bias);
+    std::copy(block_lit.begin(), block_lit.begin() + s, block_lit.begin() + 2 * s + 1);
+    std::copy(block_lit.begin() + s, block_lit.begin() + 2 * s, block_lit.begin() + 3 * s + 2);
+}
+
+static void shadeSegment(const TubeMesh& mesh, size_t seg, bool specular, unsigned char* dst) {
+    const float* base = &color_palette[3 * segment_color_index[seg]];
+    size_t first = seg * mesh.verts_per_segment;
+    unsigned char alpha = vertexAlpha();
+    if (lighting_enabled) computeBlockNormals(mesh, seg);
+    // Oclusão ambiente (tecla B): gravada nas cores junto com o resto da
+    // iluminação, sem custo por quadro
+    bool occlusion = ambient_occlusion_enabled && ambient_occlusion.valid;
+    // Sombras (tecla U): o mapa só muda com a luz, a geometria ou o passo,
+    // então girar a câmera não refaz nada disto
+    bool shadows = lighting_enabled && shadows_enabled && shadow_map.valid;
+    if (shadows) lookupBlockShadows(mesh, seg, first);
+
+    for (int k = 0; k < mesh.verts_per_segment; k++) {
+        float rgb[3] = {base[0], base[1], base[2]};
+        if (lighting_enabled) {
+            const Point3D& normal = block_normals[k];
+            float visibility = occlusion ? vertexVisibility(seg, mesh.sides, k) : 1.0f;
+            float lit = shadows ? block_lit[k] : 1.0f;
+            if (lighting_mode == 0) {
+                shadeFlat(normal, base[0], base[1], base[2], rgb, visibility, lit);
+            } else {
+                shadePhong(dequantizePosition(&mesh.positions[3 * (first + k)]), normal, camera.eye,
+                           base[0], base[1], base[2], specular, rgb, visibility, lit);
+            }
+        }
+        unsigned char* c = &dst[4 * k];
+        c[0] = toByte(rgb[0]);
+        c[1] = toByte(rgb[1]);
+        c[2] = toByte(rgb[2]);
+        c[3] = alpha;
+    }
+}
+
+void lightMesh(TubeMesh& mesh) {
+    // Segmentos ainda não construídos são iluminados ao serem tesselados
+    for (int k = 0; k < mesh_built_count; k++) {
+        lightSegment(mesh, build_order[k]);
+    }
+}
+
+void lightSkeleton() {
+    unsigned char alpha = vertexAlpha();
+    size_t n = segment_color_index.size();
+    for (size_t i = 0; i < n; i++) {
+        const float* base = &color_palette[3 * segment_color_index[i]];
+        for (int e = 0; e < 2; e++) {
+            unsigned char* c = &skeleton_colors[8 * i + 4 * e];
+            c[0] = toByte(base[0]);
+            c[1] = toByte(base[1]);
+            c[2] = toByte(base[2]);
+            c[3] = alpha;
+        }
+    }
+}
+
+int refineSpecular(TubeMesh& mesh, int start_rank, double budget_ms) {
+    auto start = std::chrono::steady_clock::now();
+    size_t stride = 4 * mesh.verts_per_segment;
+    int rank = start_rank;
+    int total = mesh_built_count;
+
+    while (rank < total) {
+        int seg = build_order[rank++];
+        if ((size_t)seg < mesh.segment_count) {
+            shadeSegment(mesh, seg, true, &mesh.colors[seg * stride]);
+        }
+        if ((rank & 63) == 0) {
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed > budget_ms) break;
+        }
+    }
+    return rank;
+}
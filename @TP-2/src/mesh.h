@@ -0,0 +1,153 @@
+/*
+ * mesh.h
+ * Geometria retida dos tubos (arrays de vértices) - TP2 (3D)
+ */
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include <cstddef>
+#include <memory>
+
+struct MemoryEntry;
+struct Point3D;
+
+// Alocador que não inicializa os elementos, para arrays sempre escritos antes
+// de lidos: as cores da malha (cada bloco é pintado junto com a sua construção
+// em continueTreeGeometry) e os estados da transição de crescimento. Zerá-los
+// na carga só custaria tempo e faltas de página. As posições ficam em um
+// std::vector comum, porque são zeradas de propósito (ver allocateMesh).
+template <typename T>
+struct DefaultInitAllocator : std::allocator<T> {
+    template <typename U> struct rebind { typedef DefaultInitAllocator<U> other; };
+    DefaultInitAllocator() {}
+    template <typename U> DefaultInitAllocator(const DefaultInitAllocator<U>&) {}
+    template <typename U> void construct(U* p) { ::new ((void*)p) U; }
+    template <typename U, typename... Args> void construct(U* p, Args&&... args) {
+        ::new ((void*)p) U(std::forward<Args>(args)...);
+    }
+};
+
+template <typename T>
+using RawVector = std::vector<T, DefaultInitAllocator<T> >;
+
+// Posições quantizadas: cada coordenada é um short relativo à caixa
+// envolvente dos tubos, e o OpenGL recupera p = origin + q·step com
+// glTranslatef/glScalef na modelview (ver drawMeshRuns em interface.cpp).
+// Vale para as duas malhas e para o esqueleto; refeita em beginTreeGeometry.
+struct MeshQuantization {
+    float origin[3];
+    float step[3];
+};
+
+extern MeshQuantization mesh_quantization;
+
+// Malha de tubos: cada segmento ocupa um bloco fixo de vértices, na mesma
+// ordem de `lines`. Os índices de todos os blocos seguem o mesmo molde, então
+// a malha guarda um único lote de run_segments blocos com índices de 16 bits
+// relativos ao primeiro vértice do lote: qualquer intervalo de segmentos é
+// desenhado em lotes, deslocando os ponteiros dos arrays até o bloco inicial
+// de cada lote (ver drawMeshRuns em interface.cpp). As normais não são
+// guardadas: a iluminação as refaz a partir do eixo do segmento.
+struct TubeMesh {
+    int sides;                  // Lados de cada cilindro
+    int verts_per_segment;      // 2 anéis laterais + 2 tampas (centro + anel)
+    int indices_per_segment;    // Triângulos laterais + tampas
+    int run_segments;           // Blocos por lote (vértices do lote cabem em 16 bits)
+    size_t segment_count;
+
+    std::vector<short> positions;             // xyz quantizado por vértice (GL_SHORT; zerado = ainda não construído)
+    RawVector<unsigned char> colors;          // RGBA enviado ao OpenGL (especular refinado aos poucos)
+    std::vector<unsigned short> indices;      // GL_TRIANGLES do lote: run_segments blocos
+    std::vector<float> ring_cos, ring_sin;    // Direção de cada vértice do anel
+
+    TubeMesh() : sides(0), verts_per_segment(0), indices_per_segment(0), run_segments(0), segment_count(0) {}
+};
+
+// Malha em qualidade total (cylinder_quality lados) e prévia de interação
+extern TubeMesh tree_mesh;
+extern TubeMesh preview_mesh;
+
+// Esqueleto de linhas: 2 vértices por segmento, na ordem de `lines`
+// (posições quantizadas como as das malhas)
+extern std::vector<short> skeleton_positions;
+extern std::vector<unsigned char> skeleton_colors;
+
+// Cor base de cada segmento: índice na paleta de 256 cores do gradiente do
+// raio (ou da classe de mudança, com a diferença entre passos ativa)
+extern std::vector<unsigned char> segment_color_index;
+
+// Refaz segment_color_index e a paleta (chamada na reconstrução e antes de
+// iluminar, em DIRTY_LIGHTING)
+void updateSegmentColors();
+
+// Segmentos (na ordem de construção) já tesselados e iluminados
+extern int mesh_built_count;
+
+// Passo que estende o anterior (loadCurrentGrowthFile): para cada segmento de
+// `lines`, o segmento do passo anterior com as mesmas extremidades, ou -1.
+// Consumido (e esvaziado) pelo próximo beginTreeGeometry; qualquer outra
+// carga o esvazia.
+extern std::vector<int> mesh_previous_segment;
+
+// Blocos que já estavam na tela quando a reconstrução começou (copiados do
+// passo anterior ou mantidos por beginTreeRadii); são refeitos por último
+extern int mesh_reused_count;
+
+// Prepara a reconstrução a partir de points/lines (DIRTY_GEOMETRY): aloca os
+// arrays e monta o esqueleto. Os tubos são construídos por continueTreeGeometry
+// em blocos, maiores raios primeiro, até esgotar o orçamento de cada quadro.
+// Com mesh_previous_segment, os blocos dos segmentos casados são copiados das
+// malhas atuais (com a quantização convertida, se mudou) e os segmentos novos
+// vêm primeiro: a árvore nova fica inteira na tela depois de construir só os
+// novos, e os copiados recebem o raio novo em seguida.
+void beginTreeGeometry();
+int continueTreeGeometry(double budget_ms);
+bool treeGeometryComplete();
+
+// Reconstrução quando só os raios mudaram (DIRTY_RADII): mantém os arrays e o
+// esqueleto e refaz posições e cores pelo mesmo continueTreeGeometry;
+// até lá os tubos continuam visíveis com os raios anteriores. A caixa
+// quantizada tem folga para os raios crescerem; se ainda assim eles não
+// couberem, a quantização é refeita e as posições atuais convertidas no
+// lugar. Retorna false (nada é alterado) quando as malhas têm outros
+// segmentos ou lados e é preciso chamar beginTreeGeometry.
+bool beginTreeRadii();
+
+// Transição animada entre passos de crescimento: guarda as posições atuais
+// (estado final, malhas completas) e as do estado inicial de growth_diff
+// (start_points/start_radii) para as duas malhas e o esqueleto. Índices e
+// cores não mudam; blendGrowthTransition(t) só reescreve as
+// posições quantizadas da malha desenhada no quadro (total, ou prévia +
+// esqueleto). Qualquer reconstrução descarta a transição;
+// endGrowthTransition volta ao estado final.
+bool beginGrowthTransition();
+void blendGrowthTransition(float t, bool preview);
+void endGrowthTransition();
+bool growthTransitionActive();
+
+// Buffers da transição (--memstats)
+void appendMeshMemory(std::vector<MemoryEntry>& entries);
+
+// Base ortonormal (u, v) ao redor da direção unitária dir: o vértice j de um
+// anel de s lados fica na direção u·cos(2πj/s) + v·sin(2πj/s)
+void ringBasis(const Point3D& dir, Point3D& u, Point3D& v);
+
+// Índices absolutos (32 bits) do bloco do segmento seg: o molde do lote
+// deslocado até o bloco, para buffers compactos com um único glDrawElements
+void writeSegmentIndices(const TubeMesh& mesh, size_t seg, unsigned int* dst);
+
+// Recalcula as cores sem especular (DIRTY_LIGHTING); o especular é
+// adicionado depois por refineSpecular
+void lightMesh(TubeMesh& mesh);
+void lightSkeleton();
+
+// Refaz as cores com o especular da câmera atual, em ordem decrescente de
+// raio, a partir de start_rank, até esgotar o orçamento ou alcançar os
+// segmentos ainda não construídos. Retorna o novo rank. Sem cópia das cores
+// sem especular: após uma mudança de câmera, os segmentos ainda não
+// refinados mantêm o especular da posição anterior.
+int refineSpecular(TubeMesh& mesh, int start_rank, double budget_ms);
+
+#endif // MESH_H
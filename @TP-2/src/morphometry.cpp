@@ -0,0 +1,423 @@
+/*
+ * morphometry.cpp
+ * Morfometria da árvore (Strahler, gerações, ramos, bifurcações) - TP2 (3D)
+ */
+
+#include "morphometry.h"
+#include "globals.h"
+#include "utils.h"
+#include "topology.h"
+#include "parallel.h"
+#include "spatial_order.h"
+#include "memstats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+Morphometry morphometry;
+int color_metric = METRIC_RADIUS;
+
+// Passos guardados no cache (os mais antigos saem primeiro)
+static const size_t MORPH_CACHE_STEPS = 16;
+
+// Segmentos por bloco nos laços paralelos das métricas locais
+static const size_t MORPH_CHUNK = 4096;
+
+// Subárvores por thread no cálculo recursivo: blocos menores equilibram
+// melhor a carga, maiores deixam menos segmentos na espinha sequencial
+static const int SUBTREES_PER_THREAD = 8;
+
+struct CachedMorphometry {
+    std::string key;
+    Morphometry data;
+};
+
+static std::vector<CachedMorphometry> morph_cache;
+static std::string morph_key;                  // Chave da carga atual (vazio = sem cache)
+static bool topology_metrics_valid = false;    // Strahler, ramos e ângulos valem para a topologia atual
+
+// ============================================================
+// SUBÁRVORES INDEPENDENTES
+// ============================================================
+
+struct SubtreeTask {
+    int first;
+    int last;
+};
+
+// Subárvores disjuntas de até `grain` segmentos no layout em profundidade;
+// os segmentos acima delas (perto da raiz) formam a espinha, percorrida em
+// sequência. Na espinha, os índices ficam em ordem crescente.
+static void splitSubtrees(int grain, std::vector<SubtreeTask>& tasks, std::vector<int>& spine) {
+    int n = (int)lines.size();
+    int s = 0;
+    while (s < n) {
+        if (topology.subtreeSize(s) <= grain) {
+            tasks.push_back({s, topology.subtree_end[s]});
+            s = topology.subtree_end[s];
+        } else {
+            spine.push_back(s);
+            s++;
+        }
+    }
+}
+
+static float segmentLength(int s) {
+    return (points[lines[s].p1] - points[lines[s].p0]).length();
+}
+
+// ============================================================
+// MÉTRICAS TOPOLÓGICAS
+// ============================================================
+
+// Strahler e comprimento da cadeia abaixo de s (até a próxima bifurcação);
+// os filhos já foram visitados
+static void bottomUpStep(int s, std::vector<int>& strahler, std::vector<float>& downstream) {
+    int best = 0, ties = 0;
+    for (const int* c = topology.childrenBegin(s); c != topology.childrenEnd(s); ++c) {
+        int order = strahler[*c];
+        if (order > best) {
+            best = order;
+            ties = 1;
+        } else if (order == best) {
+            ties++;
+        }
+    }
+    int count = topology.childCount(s);
+    strahler[s] = (count == 0) ? 1 : (ties >= 2 ? best + 1 : best);
+    downstream[s] = segmentLength(s) + (count == 1 ? downstream[*topology.childrenBegin(s)] : 0.0f);
+}
+
+// Comprimento do ramo: o do início da cadeia, herdado pelos segmentos
+// seguintes (pai com um único filho); o pai já foi visitado
+static void topDownStep(int s, const std::vector<float>& downstream, std::vector<float>& branch) {
+    int p = topology.parent[s];
+    branch[s] = (p >= 0 && topology.childCount(p) == 1) ? branch[p] : downstream[s];
+}
+
+static void computeTopologyMetrics(Morphometry& m) {
+    size_t n = lines.size();
+    std::vector<int> strahler(n, 0);
+    std::vector<float> downstream(n, 0.0f);
+    std::vector<float>& branch = m.values[METRIC_BRANCH_LENGTH];
+    branch.assign(n, 0.0f);
+
+    if (topology.hasSubtreeLayout()) {
+        // Subárvores em paralelo (filhos têm índice maior: de trás para
+        // frente), depois a espinha, cujos filhos já estão prontos
+        std::vector<SubtreeTask> tasks;
+        std::vector<int> spine;
+        int grain = std::max(1024, (int)(n / (SUBTREES_PER_THREAD * parallelThreadCount())));
+        splitSubtrees(grain, tasks, spine);
+        parallelFor(tasks.size(), 1, [&](size_t first, size_t last) {
+            for (size_t t = first; t < last; t++) {
+                for (int s = tasks[t].last - 1; s >= tasks[t].first; s--) {
+                    bottomUpStep(s, strahler, downstream);
+                }
+            }
+        });
+        for (size_t k = spine.size(); k-- > 0; ) {
+            bottomUpStep(spine[k], strahler, downstream);
+        }
+
+        // Descida: espinha primeiro, depois as subárvores em paralelo
+        for (int s : spine) {
+            topDownStep(s, downstream, branch);
+        }
+        parallelFor(tasks.size(), 1, [&](size_t first, size_t last) {
+            for (size_t t = first; t < last; t++) {
+                for (int s = tasks[t].first; s < tasks[t].last; s++) {
+                    topDownStep(s, downstream, branch);
+                }
+            }
+        });
+    } else {
+        // Sem layout em profundidade: ordem por geração, em sequência
+        const std::vector<int>& order = topology.generation_order;
+        for (size_t k = order.size(); k-- > 0; ) {
+            bottomUpStep(order[k], strahler, downstream);
+        }
+        for (int s : order) {
+            topDownStep(s, downstream, branch);
+        }
+    }
+
+    // Métricas locais: ângulo entre os dois primeiros filhos
+    std::vector<float>& angle = m.values[METRIC_BIFURCATION_ANGLE];
+    angle.assign(n, NAN);
+    parallelFor(n, MORPH_CHUNK, [&](size_t first, size_t last) {
+        for (size_t s = first; s < last; s++) {
+            if (topology.childCount((int)s) < 2) continue;
+            const int* c = topology.childrenBegin((int)s);
+            Point3D a = points[topology.distal_node[c[0]]] - points[topology.proximal_node[c[0]]];
+            Point3D b = points[topology.distal_node[c[1]]] - points[topology.proximal_node[c[1]]];
+            float len = a.length() * b.length();
+            if (len < 1e-12f) continue;
+            float cosine = std::min(1.0f, std::max(-1.0f, dotProduct(a, b) / len));
+            angle[s] = acosf(cosine) * (float)(180.0 / M_PI);
+        }
+    });
+
+    std::vector<float>& order_values = m.values[METRIC_STRAHLER];
+    std::vector<float>& generation = m.values[METRIC_GENERATION];
+    order_values.resize(n);
+    generation.assign(n, NAN);
+    bool has_generation = topology.generation.size() == n;
+    m.max_strahler = 0;
+    for (size_t s = 0; s < n; s++) {
+        order_values[s] = (float)strahler[s];
+        if (has_generation) generation[s] = (float)topology.generation[s];
+        m.max_strahler = std::max(m.max_strahler, strahler[s]);
+    }
+
+    // Resumos que só dependem da topologia
+    m.order_segments.assign(m.max_strahler + 1, 0);
+    m.order_length.assign(m.max_strahler + 1, 0.0);
+    m.branches = 0;
+    m.bifurcations = 0;
+    double branch_total = 0.0, angle_total = 0.0;
+    for (size_t s = 0; s < n; s++) {
+        m.order_segments[strahler[s]]++;
+        m.order_length[strahler[s]] += segmentLength((int)s);
+        int p = topology.parent[s];
+        if (p < 0 || topology.childCount(p) != 1) {
+            m.branches++;
+            branch_total += downstream[s];
+        }
+        if (!std::isnan(angle[s])) {
+            m.bifurcations++;
+            angle_total += angle[s];
+        }
+    }
+    m.mean_branch_length = m.branches > 0 ? branch_total / m.branches : 0.0;
+    m.mean_angle = m.bifurcations > 0 ? angle_total / m.bifurcations : 0.0;
+}
+
+// ============================================================
+// MÉTRICAS DOS RAIOS
+// ============================================================
+
+// Expoente x com Σ_g (Σ_c (r_c/r_0)^x - 1) = 0 sobre os grupos (uma
+// bifurcação cada), a partir de log_ratio = ln(r_c/r_0) < 0. A soma decresce
+// com x: Newton protegido por um intervalo que sempre contém a raiz.
+static double solveMurray(const float* log_ratio, const int* offsets, size_t groups) {
+    auto residual = [&](double x, double& derivative) {
+        double f = 0.0;
+        derivative = 0.0;
+        for (size_t g = 0; g < groups; g++) {
+            f -= 1.0;
+            for (int k = offsets[g]; k < offsets[g + 1]; k++) {
+                double e = exp(x * log_ratio[k]);
+                f += e;
+                derivative += e * log_ratio[k];
+            }
+        }
+        return f;
+    };
+
+    double lo = 0.0, hi = 4.0, d;
+    while (residual(hi, d) > 0.0) {
+        lo = hi;
+        hi *= 2.0;
+        if (hi > 1024.0) return NAN;
+    }
+    double x = 3.0;  // Lei de Murray
+    if (x <= lo || x >= hi) x = 0.5 * (lo + hi);
+    for (int it = 0; it < 60; it++) {
+        double f = residual(x, d);
+        if (f > 0.0) lo = x; else hi = x;
+        double next = (d < 0.0) ? x - f / d : 0.5 * (lo + hi);
+        if (!(next > lo && next < hi)) next = 0.5 * (lo + hi);
+        if (fabs(next - x) <= 1e-9 * std::max(1.0, x)) return next;
+        x = next;
+    }
+    return x;
+}
+
+// Razões ln(r_c/r_0) da bifurcação em s; false se não há bifurcação ou se
+// algum filho não é mais fino que o pai
+static bool murrayRatios(int s, std::vector<float>& out) {
+    out.clear();
+    if (topology.childCount(s) < 2 || !(radii[s] > 0.0f)) return false;
+    for (const int* c = topology.childrenBegin(s); c != topology.childrenEnd(s); ++c) {
+        float ratio = radii[*c] / radii[s];
+        if (!(ratio > 0.0f && ratio < 1.0f)) return false;
+        out.push_back(logf(ratio));
+    }
+    return true;
+}
+
+static void computeRadiusMetrics(Morphometry& m) {
+    size_t n = lines.size();
+    std::vector<float>& murray = m.values[METRIC_MURRAY];
+    murray.assign(n, NAN);
+    parallelFor(n, MORPH_CHUNK, [&](size_t first, size_t last) {
+        std::vector<float> ratios;
+        for (size_t s = first; s < last; s++) {
+            if (!murrayRatios((int)s, ratios)) continue;
+            int offsets[2] = {0, (int)ratios.size()};
+            murray[s] = (float)solveMurray(ratios.data(), offsets, 1);
+        }
+    });
+
+    // Ajuste global: todas as bifurcações válidas na mesma equação
+    std::vector<float> all_ratios, ratios;
+    std::vector<int> offsets(1, 0);
+    for (size_t s = 0; s < n; s++) {
+        if (std::isnan(murray[s]) || !murrayRatios((int)s, ratios)) continue;
+        all_ratios.insert(all_ratios.end(), ratios.begin(), ratios.end());
+        offsets.push_back((int)all_ratios.size());
+    }
+    m.murray_samples = offsets.size() - 1;
+    m.murray_exponent = m.murray_samples > 0 ? solveMurray(all_ratios.data(), offsets.data(), m.murray_samples) : NAN;
+
+    // Escoamento de Poiseuille: depende dos raios, refeito junto com Murray
+    solvePoiseuille(m.values[METRIC_RESISTANCE], m.values[METRIC_FLOW], m.values[METRIC_PRESSURE], m.flow);
+
+    // Raio médio por ordem de Strahler
+    const std::vector<float>& order = m.values[METRIC_STRAHLER];
+    m.order_mean_radius.assign(m.max_strahler + 1, 0.0);
+    for (size_t s = 0; s < n; s++) {
+        m.order_mean_radius[(int)order[s]] += radii[s];
+    }
+    for (int k = 1; k <= m.max_strahler; k++) {
+        if (m.order_segments[k] > 0) m.order_mean_radius[k] /= m.order_segments[k];
+    }
+}
+
+// Faixa dos valores válidos de cada métrica (normalização das cores); nas
+// métricas em escala log, só os positivos
+static void computeRanges(Morphometry& m) {
+    for (int k = 0; k < METRIC_COUNT; k++) {
+        float lo = 1e30f, hi = -1e30f;
+        bool positive_only = metricLogScale(k);
+        for (float v : m.values[k]) {
+            if (!std::isfinite(v) || (positive_only && !(v > 0.0f))) continue;
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+        m.min_value[k] = (lo <= hi) ? lo : 0.0f;
+        m.max_value[k] = (lo <= hi) ? hi : 0.0f;
+    }
+}
+
+// ============================================================
+// CACHE POR PASSO
+// ============================================================
+
+static std::string cacheKey(const std::string& source) {
+    if (source.empty()) return source;
+    // A renumeração de Hilbert pode mudar a ordem dos segmentos
+    return source + (hilbert_reorder_enabled ? "#hilbert" : "");
+}
+
+static void storeInCache() {
+    if (morph_key.empty()) return;
+    for (CachedMorphometry& entry : morph_cache) {
+        if (entry.key == morph_key) {
+            entry.data = morphometry;
+            return;
+        }
+    }
+    if (morph_cache.size() >= MORPH_CACHE_STEPS) {
+        morph_cache.erase(morph_cache.begin());
+    }
+    morph_cache.push_back({morph_key, morphometry});
+}
+
+const Morphometry& updateMorphometry() {
+    if (morphometry.valid) return morphometry;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t n = lines.size();
+
+    // Sem topologia (índice de ponto fora da faixa, ver buildTopology): as
+    // métricas dependem de pai e filhos, então fica inválida e vazia
+    if (topology.parent.size() != n) {
+        morphometry = Morphometry();
+        topology_metrics_valid = false;
+        return morphometry;
+    }
+
+    for (const CachedMorphometry& entry : morph_cache) {
+        if (!morph_key.empty() && entry.key == morph_key && entry.data.values[METRIC_STRAHLER].size() == n) {
+            morphometry = entry.data;
+            morphometry.source = MORPH_CACHE;
+            morphometry.compute_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            topology_metrics_valid = true;
+            return morphometry;
+        }
+    }
+
+    bool radii_only = topology_metrics_valid && morphometry.values[METRIC_STRAHLER].size() == n;
+    if (!radii_only) computeTopologyMetrics(morphometry);
+    computeRadiusMetrics(morphometry);
+    computeRanges(morphometry);
+    morphometry.source = radii_only ? MORPH_RADII : MORPH_FULL;
+    morphometry.valid = true;
+    topology_metrics_valid = true;
+    morphometry.compute_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    storeInCache();
+    return morphometry;
+}
+
+void invalidateMorphometry(const std::string& source, bool radii_only) {
+    morphometry.valid = false;
+    morph_key = cacheKey(source);
+    if (!radii_only) topology_metrics_valid = false;
+}
+
+const char* metricName(int metric) {
+    switch (metric) {
+        case METRIC_STRAHLER: return "Strahler";
+        case METRIC_GENERATION: return "geração";
+        case METRIC_BRANCH_LENGTH: return "comprimento do ramo";
+        case METRIC_BIFURCATION_ANGLE: return "ângulo de bifurcação";
+        case METRIC_MURRAY: return "expoente de Murray";
+        case METRIC_FLOW: return "vazão";
+        case METRIC_PRESSURE: return "pressão";
+        case METRIC_RESISTANCE: return "resistência";
+        default: return "raio";
+    }
+}
+
+bool metricLogScale(int metric) {
+    return metric == METRIC_FLOW || metric == METRIC_RESISTANCE;
+}
+
+const char* morphSourceName(int source) {
+    switch (source) {
+        case MORPH_RADII: return "raios";
+        case MORPH_CACHE: return "cache";
+        default: return "completo";
+    }
+}
+
+static void addMorphometryBytes(const Morphometry& m, MemoryEntry& e) {
+    for (int k = 0; k < METRIC_COUNT; k++) {
+        e.used += m.values[k].size() * sizeof(float);
+        e.reserved += m.values[k].capacity() * sizeof(float);
+    }
+}
+
+void appendMorphometryMemory(std::vector<MemoryEntry>& entries) {
+    MemoryEntry current;
+    current.group = "Caches";
+    current.name = "morphometry.values";
+    current.used = current.reserved = 0;
+    addMorphometryBytes(morphometry, current);
+    entries.push_back(current);
+
+    MemoryEntry cached;
+    cached.group = "Caches";
+    cached.name = "morphometry.cache (" + std::to_string(morph_cache.size()) + " passos)";
+    cached.used = cached.reserved = 0;
+    for (const CachedMorphometry& entry : morph_cache) {
+        addMorphometryBytes(entry.data, cached);
+    }
+    entries.push_back(cached);
+}
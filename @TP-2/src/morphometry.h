@@ -0,0 +1,95 @@
+/*
+ * morphometry.h
+ * Morfometria da árvore (Strahler, gerações, ramos, bifurcações) - TP2 (3D)
+ */
+
+#ifndef MORPHOMETRY_H
+#define MORPHOMETRY_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "hemodynamics.h"
+
+struct MemoryEntry;
+
+// Atributo usado nas cores dos segmentos (tecla K); METRIC_RADIUS é o
+// gradiente do raio original
+enum MorphMetric {
+    METRIC_RADIUS = 0,
+    METRIC_STRAHLER,           // Ordem de Horton-Strahler (terminais = 1)
+    METRIC_GENERATION,         // Profundidade em segmentos a partir da raiz
+    METRIC_BRANCH_LENGTH,      // Comprimento do ramo (cadeia entre bifurcações) do segmento
+    METRIC_BIFURCATION_ANGLE,  // Ângulo entre os dois primeiros filhos, em graus
+    METRIC_MURRAY,             // Expoente x de r0^x = Σ ri^x na bifurcação distal
+    METRIC_FLOW,               // Vazão de Poiseuille, fração da entrada (escala log nas cores)
+    METRIC_PRESSURE,           // Pressão normalizada no ponto distal (entrada 1, terminais 0)
+    METRIC_RESISTANCE,         // Resistência de Poiseuille do segmento (escala log nas cores)
+    METRIC_COUNT
+};
+
+// Como os resultados atuais foram obtidos
+enum MorphSource {
+    MORPH_FULL = 0,   // Cálculo completo
+    MORPH_RADII,      // Só o que depende dos raios (mesma topologia)
+    MORPH_CACHE       // Passo já calculado antes
+};
+
+struct Morphometry {
+    bool valid;
+
+    // Um valor por segmento de `lines` em cada métrica (values[METRIC_RADIUS]
+    // fica vazio); NAN onde a métrica não se aplica (ângulo e Murray fora
+    // das bifurcações)
+    std::vector<float> values[METRIC_COUNT];
+    float min_value[METRIC_COUNT];
+    float max_value[METRIC_COUNT];
+
+    // Resumo por ordem de Strahler (índice = ordem; posição 0 sem uso)
+    int max_strahler;
+    std::vector<size_t> order_segments;
+    std::vector<double> order_length;
+    std::vector<double> order_mean_radius;
+
+    size_t branches;
+    double mean_branch_length;
+    size_t bifurcations;
+    double mean_angle;          // Graus
+    double murray_exponent;     // Ajustado sobre todas as bifurcações (NAN sem bifurcações)
+    size_t murray_samples;      // Bifurcações usadas no ajuste
+    FlowSummary flow;           // Escoamento (METRIC_FLOW/PRESSURE/RESISTANCE)
+
+    int source;                 // MorphSource
+    double compute_ms;
+
+    Morphometry() : valid(false), min_value(), max_value(), max_strahler(0), branches(0),
+                    mean_branch_length(0.0), bifurcations(0), mean_angle(0.0), murray_exponent(0.0),
+                    murray_samples(0), source(MORPH_FULL), compute_ms(0.0) {}
+};
+
+extern Morphometry morphometry;
+extern int color_metric;  // MorphMetric das cores (tecla K)
+
+// Calcula a morfometria do passo carregado, se ainda não calculada, em
+// tempo linear: as métricas locais em paralelo por blocos de segmentos e as
+// recursivas (Strahler, ramos) em paralelo por subárvores disjuntas do
+// layout em profundidade. Passos já vistos saem do cache; passos com a mesma
+// topologia do anterior refazem só o que depende dos raios. Sem topologia
+// (buildTopology recusou o arquivo) retorna uma morfometria vazia, com
+// valid = false.
+const Morphometry& updateMorphometry();
+
+// Chamada a cada carga com o arquivo lido (chave do cache; vazio = sem
+// cache). radii_only: mesma topologia da carga anterior.
+void invalidateMorphometry(const std::string& source, bool radii_only);
+
+const char* metricName(int metric);
+
+// Métricas que variam em ordens de grandeza: cores por log10
+bool metricLogScale(int metric);
+const char* morphSourceName(int source);
+
+// Valores atuais e cache por passo (--memstats)
+void appendMorphometryMemory(std::vector<MemoryEntry>& entries);
+
+#endif // MORPHOMETRY_H
@@ -0,0 +1,375 @@
+/*
+ * occlusion.cpp
+ * Culling por oclusão com Z-buffer hierárquico em software - TP2 (3D)
+ *
+ * A cada quadro os segmentos de maior raio (troncos) são rasterizados na CPU
+ * em um buffer de profundidade de baixa resolução. Cada oclusor é uma faixa
+ * ao redor do eixo projetado, com largura menor que a silhueta do tubo e
+ * profundidade da face mais distante, de modo que o teste seja conservador.
+ * A pirâmide Hi-Z guarda a profundidade máxima de cada bloco 2x2 e permite
+ * descartar nós inteiros da BVH com poucos acessos. Uma segunda pirâmide com
+ * a profundidade mínima identifica nós que nenhum oclusor pode esconder; esses
+ * são aceitos inteiros, sem testar os filhos.
+ */
+
+#include "occlusion.h"
+#include "globals.h"
+#include "utils.h"
+#include "bvh.h"
+#include "memstats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+bool occlusion_culling_enabled = false;
+OcclusionStats occlusion_stats;
+
+// Resolução horizontal do buffer de oclusão (a vertical segue o aspecto)
+static const int OCC_WIDTH = 256;
+// Quantidade máxima de oclusores rasterizados por quadro
+static const int OCC_MAX_OCCLUDERS = 512;
+// Fração da silhueta usada pelo oclusor (margem para a perspectiva)
+static const float OCC_SHRINK = 0.8f;
+// Avaliação do ganho: após OCC_PROBE_PASSES passagens seguidas descartando
+// menos que OCC_MIN_CULLED dos segmentos, o culling se desliga sozinho
+static const int OCC_PROBE_PASSES = 8;
+static const double OCC_MIN_CULLED = 0.1;
+
+// Passagens e segmentos acumulados na avaliação em curso
+static int probe_passes = 0;
+static long long probe_total = 0;
+static long long probe_culled = 0;
+
+// Base da câmera e parâmetros de projeção do quadro atual
+static Point3D view_eye, view_f, view_s, view_u;
+static float proj_x = 1.0f, proj_y = 1.0f;
+static float view_near = 0.1f, view_far = 1000.0f;
+
+// Pirâmides Hi-Z (máximo e mínimo): nível 0 é o buffer rasterizado
+static std::vector<std::vector<float> > hiz_levels;
+static std::vector<std::vector<float> > hiz_min_levels;
+static std::vector<int> hiz_width;
+static std::vector<int> hiz_height;
+
+static const float OCC_EMPTY = 1e30f;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Converte um ponto para coordenadas de tela (pixels do nível 0) e
+// profundidade de visão. Retorna false se estiver atrás do plano near.
+static bool projectPoint(const Point3D& p, float& sx, float& sy, float& depth) {
+    Point3D v = p - view_eye;
+    depth = dotProduct(v, view_f);
+    if (depth < view_near) return false;
+
+    float ndc_x = dotProduct(v, view_s) * proj_x / depth;
+    float ndc_y = dotProduct(v, view_u) * proj_y / depth;
+    sx = (ndc_x * 0.5f + 0.5f) * hiz_width[0];
+    sy = (ndc_y * 0.5f + 0.5f) * hiz_height[0];
+    return true;
+}
+
+static void setupView(const Camera& cam, float aspect) {
+    view_eye = cam.eye;
+    view_f = cam.center - cam.eye;
+    view_f.normalize();
+    view_s = crossProduct(view_f, cam.up);
+    view_s.normalize();
+    view_u = crossProduct(view_s, view_f);
+
+    proj_y = 1.0f / tanf(cam.fovy * 0.5f * (float)M_PI / 180.0f);
+    proj_x = proj_y / aspect;
+    view_near = cam.znear;
+    view_far = cam.zfar;
+
+    int w = OCC_WIDTH;
+    int h = std::max(1, (int)(OCC_WIDTH / aspect + 0.5f));
+
+    hiz_levels.resize(1);
+    hiz_min_levels.clear();
+    hiz_width.assign(1, w);
+    hiz_height.assign(1, h);
+    hiz_levels[0].assign((size_t)w * h, OCC_EMPTY);
+}
+
+static void rasterizeOccluder(int segment) {
+    const Point3D& p0 = points[lines[segment].p0];
+    const Point3D& p1 = points[lines[segment].p1];
+    float r = getDisplayRadius(segment);
+
+    float ax, ay, d0, bx, by, d1;
+    if (!projectPoint(p0, ax, ay, d0) || !projectPoint(p1, bx, by, d1)) return;
+    if (std::min(d0, d1) - r < view_near) return;
+
+    // Meia largura da faixa em pixels (raio projetado na extremidade mais distante)
+    float pixels_per_unit = proj_y * 0.5f * hiz_height[0];
+    float half_w = OCC_SHRINK * r * pixels_per_unit / std::max(d0, d1);
+    if (half_w < 0.5f) return;
+
+    float ex = bx - ax;
+    float ey = by - ay;
+    float len2 = ex * ex + ey * ey;
+    if (len2 < 1e-6f) return;
+    float inv_len = 1.0f / sqrtf(len2);
+
+    int w = hiz_width[0];
+    int h = hiz_height[0];
+    int x0 = std::max(0, (int)floorf(std::min(ax, bx) - half_w));
+    int x1 = std::min(w - 1, (int)ceilf(std::max(ax, bx) + half_w));
+    int y0 = std::max(0, (int)floorf(std::min(ay, by) - half_w));
+    int y1 = std::min(h - 1, (int)ceilf(std::max(ay, by) + half_w));
+    if (x0 > x1 || y0 > y1) return;
+
+    float inv_d0 = 1.0f / d0;
+    float inv_d1 = 1.0f / d1;
+    std::vector<float>& depth = hiz_levels[0];
+
+    for (int y = y0; y <= y1; y++) {
+        float qy = y + 0.5f - ay;
+        for (int x = x0; x <= x1; x++) {
+            float qx = x + 0.5f - ax;
+            float t = (qx * ex + qy * ey) / len2;
+            if (t < 0.0f || t > 1.0f) continue;
+            float dist = fabsf(qx * ey - qy * ex) * inv_len;
+            if (dist > half_w) continue;
+
+            // 1/z é linear no espaço de tela; soma o raio para ficar na face de trás
+            float d = 1.0f / (inv_d0 + t * (inv_d1 - inv_d0)) + r;
+            float& dst = depth[(size_t)y * w + x];
+            if (d < dst) dst = d;
+        }
+    }
+    occlusion_stats.occluders++;
+}
+
+static void buildPyramid() {
+    hiz_min_levels.push_back(hiz_levels[0]);
+
+    while (hiz_width.back() > 1 || hiz_height.back() > 1) {
+        int pw = hiz_width.back();
+        int ph = hiz_height.back();
+        int w = (pw + 1) / 2;
+        int h = (ph + 1) / 2;
+        const std::vector<float>& src_max = hiz_levels.back();
+        const std::vector<float>& src_min = hiz_min_levels.back();
+        std::vector<float> dst_max((size_t)w * h);
+        std::vector<float> dst_min((size_t)w * h);
+
+        for (int y = 0; y < h; y++) {
+            size_t row0 = (size_t)(2 * y) * pw;
+            size_t row1 = (size_t)std::min(2 * y + 1, ph - 1) * pw;
+            for (int x = 0; x < w; x++) {
+                int sx0 = 2 * x;
+                int sx1 = std::min(2 * x + 1, pw - 1);
+                dst_max[(size_t)y * w + x] = std::max(std::max(src_max[row0 + sx0], src_max[row0 + sx1]),
+                                                      std::max(src_max[row1 + sx0], src_max[row1 + sx1]));
+                dst_min[(size_t)y * w + x] = std::min(std::min(src_min[row0 + sx0], src_min[row0 + sx1]),
+                                                      std::min(src_min[row1 + sx0], src_min[row1 + sx1]));
+            }
+        }
+
+        hiz_levels.push_back(dst_max);
+        hiz_min_levels.push_back(dst_min);
+        hiz_width.push_back(w);
+        hiz_height.push_back(h);
+    }
+}
+
+void buildOcclusionBuffer(const Camera& cam, float aspect, int max_index) {
+    auto start = std::chrono::steady_clock::now();
+    occlusion_stats = OcclusionStats();
+
+    setupView(cam, aspect);
+
+    int used = 0;
+    for (size_t k = 0; k < segments_by_radius.size() && used < OCC_MAX_OCCLUDERS; k++) {
+        int s = segments_by_radius[k];
+        if (s >= max_index) continue;
+        rasterizeOccluder(s);
+        used++;
+    }
+
+    buildPyramid();
+    occlusion_stats.raster_ms = elapsedMs(start);
+}
+
+// Resultado do teste de um nó. BOX_UNOCCLUDED: dentro da tela e na frente
+// de todos os oclusores (nenhum filho pode ser descartado)
+enum BoxVisibility { BOX_VISIBLE, BOX_UNOCCLUDED, BOX_OUTSIDE, BOX_OCCLUDED };
+
+static BoxVisibility testBox(const float bmin[3], const float bmax[3]) {
+    // Os cantos são combinações de bmin/bmax: projeta o canto mínimo uma vez
+    // e soma as contribuições de cada eixo (sem 3 produtos escalares por canto)
+    float ox = bmin[0] - view_eye.x, oy = bmin[1] - view_eye.y, oz = bmin[2] - view_eye.z;
+    float ex = bmax[0] - bmin[0], ey = bmax[1] - bmin[1], ez = bmax[2] - bmin[2];
+    float base_d = ox * view_f.x + oy * view_f.y + oz * view_f.z;
+    float base_s = ox * view_s.x + oy * view_s.y + oz * view_s.z;
+    float base_u = ox * view_u.x + oy * view_u.y + oz * view_u.z;
+
+    float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f;
+    float min_d = 1e30f, max_d = 0.0f;
+    int behind = 0;
+    float half_w = 0.5f * hiz_width[0];
+    float half_h = 0.5f * hiz_height[0];
+
+    for (int c = 0; c < 8; c++) {
+        float cx = (c & 1) ? ex : 0.0f;
+        float cy = (c & 2) ? ey : 0.0f;
+        float cz = (c & 4) ? ez : 0.0f;
+        float d = base_d + cx * view_f.x + cy * view_f.y + cz * view_f.z;
+        if (d < view_near) {
+            behind++;
+            continue;
+        }
+        float inv_d = 1.0f / d;
+        float sx = ((base_s + cx * view_s.x + cy * view_s.y + cz * view_s.z) * proj_x * inv_d + 1.0f) * half_w;
+        float sy = ((base_u + cx * view_u.x + cy * view_u.y + cz * view_u.z) * proj_y * inv_d + 1.0f) * half_h;
+        min_x = std::min(min_x, sx);
+        max_x = std::max(max_x, sx);
+        min_y = std::min(min_y, sy);
+        max_y = std::max(max_y, sy);
+        min_d = std::min(min_d, d);
+        max_d = std::max(max_d, d);
+    }
+
+    // Caixa inteira atrás da câmera; parcialmente atrás é tratada como visível
+    if (behind == 8) return BOX_OUTSIDE;
+    if (behind > 0) return BOX_VISIBLE;
+    if (min_d > view_far) return BOX_OUTSIDE;
+
+    int w = hiz_width[0];
+    int h = hiz_height[0];
+    if (max_x < 0.0f || max_y < 0.0f || min_x >= w || min_y >= h) return BOX_OUTSIDE;
+
+    int x0 = std::max(0, (int)min_x);
+    int x1 = std::min(w - 1, (int)max_x);
+    int y0 = std::max(0, (int)min_y);
+    int y1 = std::min(h - 1, (int)max_y);
+
+    // Nível em que o retângulo cobre no máximo 4x4 texels
+    int level = 0;
+    int last_level = (int)hiz_levels.size() - 1;
+    while (level < last_level && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3)) {
+        level++;
+    }
+
+    const std::vector<float>& depth_max = hiz_levels[level];
+    const std::vector<float>& depth_min = hiz_min_levels[level];
+    int lw = hiz_width[level];
+    float max_occluder = 0.0f;
+    float min_occluder = OCC_EMPTY;
+    for (int y = y0 >> level; y <= (y1 >> level); y++) {
+        for (int x = x0 >> level; x <= (x1 >> level); x++) {
+            max_occluder = std::max(max_occluder, depth_max[(size_t)y * lw + x]);
+            min_occluder = std::min(min_occluder, depth_min[(size_t)y * lw + x]);
+        }
+    }
+
+    if (min_d > max_occluder) return BOX_OCCLUDED;
+
+    bool inside_screen = min_x >= 0.0f && min_y >= 0.0f && max_x < w && max_y < h && max_d < view_far;
+    if (inside_screen && max_d <= min_occluder) return BOX_UNOCCLUDED;
+    return BOX_VISIBLE;
+}
+
+static int countSegments(const BVHNode& node, int max_index) {
+    int n = 0;
+    for (int i = node.first; i < node.first + node.count; i++) {
+        if (segment_bvh.segment_ids[i] < max_index) n++;
+    }
+    return n;
+}
+
+void collectVisibleSegments(int max_index, std::vector<int>& visible) {
+    auto start = std::chrono::steady_clock::now();
+    visible.clear();
+    if (segment_bvh.nodes.empty() || hiz_levels.empty()) return;
+
+    std::vector<int> stack;
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const BVHNode& node = segment_bvh.nodes[stack.back()];
+        stack.pop_back();
+        occlusion_stats.nodes_tested++;
+
+        BoxVisibility vis = testBox(node.bmin, node.bmax);
+        if (vis == BOX_OUTSIDE) {
+            occlusion_stats.segments_frustum_culled += countSegments(node, max_index);
+            continue;
+        }
+        if (vis == BOX_OCCLUDED) {
+            occlusion_stats.segments_occlusion_culled += countSegments(node, max_index);
+            continue;
+        }
+        if (vis == BOX_UNOCCLUDED) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                int s = segment_bvh.segment_ids[i];
+                if (s < max_index) visible.push_back(s);
+            }
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            // Nas folhas cada segmento é testado com a própria caixa, que é
+            // bem menor que a do nó e pode caber atrás de um único tronco
+            for (int i = node.first; i < node.first + node.count; i++) {
+                int s = segment_bvh.segment_ids[i];
+                if (s >= max_index) continue;
+
+                const float* box = &segment_bvh.segment_boxes[6 * i];
+                BoxVisibility seg_vis = testBox(box, box + 3);
+                if (seg_vis == BOX_VISIBLE || seg_vis == BOX_UNOCCLUDED) {
+                    visible.push_back(s);
+                } else if (seg_vis == BOX_OUTSIDE) {
+                    occlusion_stats.segments_frustum_culled++;
+                } else {
+                    occlusion_stats.segments_occlusion_culled++;
+                }
+            }
+        } else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    occlusion_stats.segments_visible = (int)visible.size();
+    occlusion_stats.query_ms = elapsedMs(start);
+}
+
+bool occlusionCullingPays() {
+    const OcclusionStats& st = occlusion_stats;
+    probe_passes++;
+    probe_total += st.segments_visible + st.segments_frustum_culled + st.segments_occlusion_culled;
+    probe_culled += st.segments_frustum_culled + st.segments_occlusion_culled;
+    if (probe_passes < OCC_PROBE_PASSES) return true;
+
+    bool pays = probe_culled >= OCC_MIN_CULLED * probe_total;
+    resetOcclusionProbe();
+    return pays;
+}
+
+void resetOcclusionProbe() {
+    probe_passes = 0;
+    probe_total = 0;
+    probe_culled = 0;
+}
+
+void appendOcclusionMemory(std::vector<MemoryEntry>& entries) {
+    MemoryEntry e;
+    e.group = "Caches";
+    e.name = "occlusion.hiz_levels";
+    e.used = e.reserved = 0;
+    for (const std::vector<std::vector<float> >* pyramid : {&hiz_levels, &hiz_min_levels}) {
+        for (const std::vector<float>& level : *pyramid) {
+            e.used += level.size() * sizeof(float);
+            e.reserved += level.capacity() * sizeof(float);
+        }
+    }
+    entries.push_back(e);
+}
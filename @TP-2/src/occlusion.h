@@ -0,0 +1,51 @@
+/*
+ * occlusion.h
+ * Culling por oclusão com Z-buffer hierárquico em software - TP2 (3D)
+ */
+
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <vector>
+
+struct Camera;
+struct MemoryEntry;
+
+// Estatísticas do último quadro (exibidas no HUD e no benchmark)
+struct OcclusionStats {
+    int occluders;                  // Segmentos rasterizados como oclusores
+    int nodes_tested;               // Nós da BVH testados
+    int segments_visible;           // Segmentos enviados para desenho
+    int segments_frustum_culled;    // Descartados fora do volume de visão
+    int segments_occlusion_culled;  // Descartados por oclusão (Hi-Z)
+    double raster_ms;               // Rasterização dos oclusores + pirâmide
+    double query_ms;                // Travessia da BVH
+
+    OcclusionStats() : occluders(0), nodes_tested(0), segments_visible(0),
+                       segments_frustum_culled(0), segments_occlusion_culled(0),
+                       raster_ms(0.0), query_ms(0.0) {}
+};
+
+extern bool occlusion_culling_enabled;
+extern OcclusionStats occlusion_stats;
+
+// Rasteriza os maiores segmentos (entre os max_index primeiros) em um
+// buffer de profundidade de baixa resolução e monta a pirâmide Hi-Z
+void buildOcclusionBuffer(const Camera& cam, float aspect, int max_index);
+
+// Percorre a BVH e devolve os segmentos (índice < max_index) que
+// sobrevivem aos testes de frustum e de oclusão
+void collectVisibleSegments(int max_index, std::vector<int>& visible);
+
+// Acumula o resultado da última passagem; a cada OCC_PROBE_PASSES passagens
+// retorna false se a fração descartada (frustum + oclusão) ficou abaixo do
+// mínimo, quando o custo na CPU não compensa o desenho economizado
+bool occlusionCullingPays();
+
+// Recomeça a avaliação (culling religado ou arquivo novo)
+void resetOcclusionProbe();
+
+// Pirâmides Hi-Z do último quadro (--memstats)
+void appendOcclusionMemory(std::vector<MemoryEntry>& entries);
+
+#endif // OCCLUSION_H
@@ -0,0 +1,88 @@
+/*
+ * oit.cpp
+ * Transparência independente de ordem (weighted blended OIT) - TP2 (3D)
+ *
+ * A parte em OpenGL (passo de acumulação, leitura e desenho da imagem) fica
+ * em interface.cpp; aqui ficam os pesos, a escala do acumulador e a
+ * composição de cada pixel, usados também pelo --check-oit.
+ */
+
+#include "oit.h"
+#include "globals.h"
+#include "point_store.h"
+#include "memstats.h"
+#include <algorithm>
+#include <cmath>
+
+OITScale oit_scale;
+
+// Distância de cada ponto ao olho (kernel em colunas, uma vez por ponto)
+static std::vector<float> point_eye_distance;
+
+float oitDepthWeight(float eye_distance) {
+    float z = eye_distance / (camera.distance + data_scale);
+    return 1.0f / (1.0f + 4.0f * z * z * z);
+}
+
+void computeOITWeights(std::vector<float>& weights) {
+    size_t n = lines.size();
+    weights.resize(n);
+    point_eye_distance.resize(points.size());
+    pointDistances(points, camera.eye, point_eye_distance.data());
+
+    float max_weight = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        float d = 0.5f * (point_eye_distance[lines[i].p0] + point_eye_distance[lines[i].p1]);
+        weights[i] = oitDepthWeight(d);
+        max_weight = std::max(max_weight, weights[i]);
+    }
+    oit_scale.max_weight = (max_weight > 0.0f) ? max_weight : 1.0f;
+}
+
+int calibrateOITLayers(const unsigned char* rgba, const unsigned char* counts, size_t npix) {
+    size_t histogram[256] = {0};
+    size_t covered = 0;
+    for (size_t i = 0; i < npix; i++) {
+        if (counts[i] == 0) continue;
+        covered++;
+        unsigned char alpha = rgba[4 * i + 3];
+        int sum = (alpha < 255) ? (int)ceil(alpha * oit_scale.layers / 255.0f) : counts[i];
+        histogram[std::max(1, std::min(255, sum))]++;
+    }
+    if (covered == 0) return oit_scale.layers;
+
+    size_t target = (size_t)ceil(OIT_LAYER_COVERAGE * covered);
+    size_t sum = 0;
+    for (int n = 1; n < 256; n++) {
+        sum += histogram[n];
+        if (sum >= target) return n;
+    }
+    return 255;
+}
+
+void resolveOITPixels(unsigned char* rgba, const unsigned char* counts, size_t npix, const float bg[3]) {
+    float reveal_table[256];
+    for (int n = 0; n < 256; n++) {
+        reveal_table[n] = powf(1.0f - transparency_alpha, (float)n);
+    }
+
+    for (size_t i = 0; i < npix; i++) {
+        unsigned char* px = &rgba[i * 4];
+        float reveal = reveal_table[counts[i]];
+        float avg_r = 0.0f, avg_g = 0.0f, avg_b = 0.0f;
+        if (px[3] > 0) {
+            float inv = 1.0f / px[3];
+            avg_r = std::min(1.0f, px[0] * inv);
+            avg_g = std::min(1.0f, px[1] * inv);
+            avg_b = std::min(1.0f, px[2] * inv);
+        }
+        px[0] = (unsigned char)(255.0f * (avg_r * (1.0f - reveal) + bg[0] * reveal) + 0.5f);
+        px[1] = (unsigned char)(255.0f * (avg_g * (1.0f - reveal) + bg[1] * reveal) + 0.5f);
+        px[2] = (unsigned char)(255.0f * (avg_b * (1.0f - reveal) + bg[2] * reveal) + 0.5f);
+        px[3] = 255;
+    }
+}
+
+void appendOITMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Caches", "oit.point_eye_distance", point_eye_distance);
+}
@@ -0,0 +1,69 @@
+/*
+ * oit.h
+ * Transparência independente de ordem (weighted blended OIT) - TP2 (3D)
+ */
+
+#ifndef OIT_H
+#define OIT_H
+
+#include <vector>
+#include <cstddef>
+
+struct MemoryEntry;
+
+// Limite de saturação antes da primeira calibração (camadas de peso máximo)
+static const int OIT_DEFAULT_LAYERS = 8;
+// Fração dos pixels cobertos cujo número de camadas deve caber no acumulador
+static const float OIT_LAYER_COVERAGE = 0.99f;
+
+// Escala das contribuições no acumulador de 8 bits. Cada fragmento soma
+// cor * f e 255 * f, com f = peso / (layers * max_weight): a média
+// ponderada não depende de alpha (que só entra na revealage), e o
+// fragmento mais próximo ocupa 255 / layers níveis. O acumulador satura
+// quando a soma dos pesos do pixel passa de `layers` pesos máximos; a
+// calibração escolhe `layers` para que isso não aconteça em
+// OIT_LAYER_COVERAGE dos pixels cobertos. Nos demais, a soma satura e a
+// média pende para as primeiras camadas desenhadas.
+struct OITScale {
+    int layers;                 // Limite de saturação, em camadas de peso máximo
+    float max_weight;           // Maior peso de profundidade da vista
+
+    OITScale() : layers(OIT_DEFAULT_LAYERS), max_weight(1.0f) {}
+
+    float factor(float weight) const { return weight / (layers * max_weight); }
+};
+
+extern OITScale oit_scale;
+
+// Peso decrescente com a distância ao observador: superfícies próximas
+// dominam a média quando várias camadas se sobrepõem
+float oitDepthWeight(float eye_distance);
+
+// Pesos por segmento (distância média das extremidades ao olho) e o maior
+// deles em oit_scale.max_weight; refeitos a cada mudança de câmera
+void computeOITWeights(std::vector<float>& weights);
+
+// Cor RGBA8 do vértice já escalada para o acumulador
+inline void scaleOITColor(const unsigned char src[4], float f, unsigned char dst[4]) {
+    dst[0] = (unsigned char)(src[0] * f + 0.5f);
+    dst[1] = (unsigned char)(src[1] * f + 0.5f);
+    dst[2] = (unsigned char)(src[2] * f + 0.5f);
+    dst[3] = (unsigned char)(255.0f * f + 0.5f);
+}
+
+// Novo limite de saturação a partir do acumulador lido com a escala atual:
+// a soma dos pesos de cada pixel, em pesos máximos, é alpha * layers / 255
+// (ou, com o alpha saturado, no máximo a contagem do stencil). Retorna o
+// menor inteiro que cobre OIT_LAYER_COVERAGE dos pixels com ao menos uma
+// camada, entre 1 e 255; converge em poucos quadros porque a soma não
+// depende da escala.
+int calibrateOITLayers(const unsigned char* rgba, const unsigned char* counts, size_t npix);
+
+// Composição de cada pixel, no lugar: média ponderada * (1 - revealage)
+// + fundo * revealage, com revealage = (1 - transparency_alpha)^camadas
+void resolveOITPixels(unsigned char* rgba, const unsigned char* counts, size_t npix, const float bg[3]);
+
+// Distâncias ao olho usadas pelos pesos (--memstats)
+void appendOITMemory(std::vector<MemoryEntry>& entries);
+
+#endif // OIT_H
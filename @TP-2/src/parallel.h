@@ -0,0 +1,55 @@
+/*
+ * parallel.h
+ * Laço paralelo sobre std::thread (blocos distribuídos sob demanda) - TP2 (3D)
+ */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// Threads usadas pelos laços paralelos: núcleos de hardware (no mínimo 1)
+inline unsigned parallelThreadCount() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+// Executa body(first, last) sobre blocos de `chunk` itens de [0, count).
+// Cada thread pega o próximo bloco livre (contador atômico), então blocos
+// de custo desigual se equilibram. Com um bloco só, ou uma thread só, tudo
+// roda na thread atual. Os blocos precisam escrever em posições disjuntas.
+template <typename F>
+void parallelFor(size_t count, size_t chunk, F body) {
+    if (count == 0) return;
+    if (chunk == 0) chunk = 1;
+    size_t chunks = (count + chunk - 1) / chunk;
+    unsigned threads = (unsigned)std::min<size_t>(parallelThreadCount(), chunks);
+    if (threads <= 1) {
+        body((size_t)0, count);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (;;) {
+            size_t c = next.fetch_add(1);
+            if (c >= chunks) break;
+            size_t first = c * chunk;
+            body(first, std::min(count, first + chunk));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : pool) {
+        t.join();
+    }
+}
+
+#endif // PARALLEL_H
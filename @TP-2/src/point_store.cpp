@@ -0,0 +1,122 @@
+/*
+ * point_store.cpp
+ * Kernels em lote sobre os pontos (SSE2 com alternativa escalar) - TP2 (3D)
+ */
+
+#include "point_store.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define POINT_STORE_SSE 1
+#endif
+
+// Os kernels tratam o vetor de pontos como um array de floats x, y, z
+static_assert(sizeof(Point3D) == 3 * sizeof(float), "Point3D precisa ter só x, y, z");
+
+// ============================================================
+// KERNELS
+// ============================================================
+
+#ifdef POINT_STORE_SSE
+// Quatro pontos a partir de p (12 floats) transpostos em x, y e z
+static inline void loadFourPoints(const float* p, __m128& x, __m128& y, __m128& z) {
+    __m128 a = _mm_loadu_ps(p);        // x0 y0 z0 x1
+    __m128 b = _mm_loadu_ps(p + 4);    // y1 z1 x2 y2
+    __m128 c = _mm_loadu_ps(p + 8);    // z2 x3 y3 z3
+    __m128 xy = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));  // x2 y2 x3 y3
+    __m128 yz = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));  // y0 z0 y1 z1
+    x = _mm_shuffle_ps(a, xy, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(yz, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+#endif
+
+void pointBounds(const std::vector<Point3D>& pts, float bmin[3], float bmax[3]) {
+    size_t n = pts.size();
+    if (n == 0) {
+        bmin[0] = bmin[1] = bmin[2] = 0.0f;
+        bmax[0] = bmax[1] = bmax[2] = 0.0f;
+        return;
+    }
+    bmin[0] = bmax[0] = pts[0].x;
+    bmin[1] = bmax[1] = pts[0].y;
+    bmin[2] = bmax[2] = pts[0].z;
+    size_t i = 0;
+#ifdef POINT_STORE_SSE
+    // Sem transpor: cada registrador repete o mesmo padrão de eixos a cada
+    // 4 pontos (x y z x | y z x y | z x y z), e os eixos se separam no fim
+    if (n >= 4) {
+        const float* p = &pts[0].x;
+        __m128 lo_a = _mm_loadu_ps(p), hi_a = lo_a;
+        __m128 lo_b = _mm_loadu_ps(p + 4), hi_b = lo_b;
+        __m128 lo_c = _mm_loadu_ps(p + 8), hi_c = lo_c;
+        for (; i + 4 <= n; i += 4, p += 12) {
+            __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+            lo_a = _mm_min_ps(lo_a, a); hi_a = _mm_max_ps(hi_a, a);
+            lo_b = _mm_min_ps(lo_b, b); hi_b = _mm_max_ps(hi_b, b);
+            lo_c = _mm_min_ps(lo_c, c); hi_c = _mm_max_ps(hi_c, c);
+        }
+        float lo[12], hi[12];
+        _mm_storeu_ps(lo, lo_a); _mm_storeu_ps(lo + 4, lo_b); _mm_storeu_ps(lo + 8, lo_c);
+        _mm_storeu_ps(hi, hi_a); _mm_storeu_ps(hi + 4, hi_b); _mm_storeu_ps(hi + 8, hi_c);
+        for (int k = 0; k < 12; k++) {
+            bmin[k % 3] = std::min(bmin[k % 3], lo[k]);
+            bmax[k % 3] = std::max(bmax[k % 3], hi[k]);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        bmin[0] = std::min(bmin[0], pts[i].x); bmax[0] = std::max(bmax[0], pts[i].x);
+        bmin[1] = std::min(bmin[1], pts[i].y); bmax[1] = std::max(bmax[1], pts[i].y);
+        bmin[2] = std::min(bmin[2], pts[i].z); bmax[2] = std::max(bmax[2], pts[i].z);
+    }
+}
+
+void transformPoints(const std::vector<Point3D>& pts, const float m[12], float* out_x, float* out_y, float* out_z) {
+    size_t n = pts.size();
+    size_t i = 0;
+#ifdef POINT_STORE_SSE
+    __m128 m00 = _mm_set1_ps(m[0]), m01 = _mm_set1_ps(m[1]), m02 = _mm_set1_ps(m[2]), t0 = _mm_set1_ps(m[3]);
+    __m128 m10 = _mm_set1_ps(m[4]), m11 = _mm_set1_ps(m[5]), m12 = _mm_set1_ps(m[6]), t1 = _mm_set1_ps(m[7]);
+    __m128 m20 = _mm_set1_ps(m[8]), m21 = _mm_set1_ps(m[9]), m22 = _mm_set1_ps(m[10]), t2 = _mm_set1_ps(m[11]);
+    for (; i + 4 <= n; i += 4) {
+        __m128 vx, vy, vz;
+        loadFourPoints(&pts[i].x, vx, vy, vz);
+        __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, vx), _mm_mul_ps(m01, vy)), _mm_add_ps(_mm_mul_ps(m02, vz), t0));
+        __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m10, vx), _mm_mul_ps(m11, vy)), _mm_add_ps(_mm_mul_ps(m12, vz), t1));
+        __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m20, vx), _mm_mul_ps(m21, vy)), _mm_add_ps(_mm_mul_ps(m22, vz), t2));
+        _mm_storeu_ps(out_x + i, rx);
+        _mm_storeu_ps(out_y + i, ry);
+        _mm_storeu_ps(out_z + i, rz);
+    }
+#endif
+    for (; i < n; i++) {
+        float px = pts[i].x, py = pts[i].y, pz = pts[i].z;
+        out_x[i] = m[0] * px + m[1] * py + m[2] * pz + m[3];
+        out_y[i] = m[4] * px + m[5] * py + m[6] * pz + m[7];
+        out_z[i] = m[8] * px + m[9] * py + m[10] * pz + m[11];
+    }
+}
+
+void pointDistances(const std::vector<Point3D>& pts, const Point3D& q, float* out) {
+    size_t n = pts.size();
+    size_t i = 0;
+#ifdef POINT_STORE_SSE
+    __m128 qx = _mm_set1_ps(q.x), qy = _mm_set1_ps(q.y), qz = _mm_set1_ps(q.z);
+    for (; i + 4 <= n; i += 4) {
+        __m128 vx, vy, vz;
+        loadFourPoints(&pts[i].x, vx, vy, vz);
+        __m128 dx = _mm_sub_ps(vx, qx);
+        __m128 dy = _mm_sub_ps(vy, qy);
+        __m128 dz = _mm_sub_ps(vz, qz);
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        _mm_storeu_ps(out + i, _mm_sqrt_ps(d2));
+    }
+#endif
+    for (; i < n; i++) {
+        float dx = pts[i].x - q.x, dy = pts[i].y - q.y, dz = pts[i].z - q.z;
+        out[i] = sqrtf(dx * dx + dy * dy + dz * dz);
+    }
+}
@@ -0,0 +1,27 @@
+/*
+ * point_store.h
+ * Kernels em lote sobre os pontos (caixa, transformação, distâncias) - TP2 (3D)
+ */
+
+#ifndef POINT_STORE_H
+#define POINT_STORE_H
+
+#include "globals.h"
+#include <vector>
+
+// Os kernels leem `points` diretamente, sem cópia em colunas: quatro pontos
+// consecutivos ocupam 12 floats, carregados em três registradores SSE e
+// transpostos para x, y e z. A sobra (menos de 4 pontos) segue no laço escalar.
+
+// Caixa envolvente dos pontos (zeros para um vetor vazio)
+void pointBounds(const std::vector<Point3D>& pts, float bmin[3], float bmax[3]);
+
+// Transformação afim em lote: out = M·p + t, com M em linhas (m[0..2] é a
+// primeira linha) e t = (m[3], m[7], m[11]). As saídas precisam de
+// pts.size() floats cada.
+void transformPoints(const std::vector<Point3D>& pts, const float m[12], float* out_x, float* out_y, float* out_z);
+
+// Distância euclidiana de cada ponto até q (pts.size() floats em out)
+void pointDistances(const std::vector<Point3D>& pts, const Point3D& q, float* out);
+
+#endif // POINT_STORE_H
@@ -0,0 +1,157 @@
+/*
+ * range_filter.cpp
+ * Filtro dos segmentos por faixa de um atributo (índice ordenado) - TP2 (3D)
+ */
+
+#include "range_filter.h"
+#include "globals.h"
+#include "mesh.h"
+#include "morphometry.h"
+#include "memstats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+RangeFilter range_filter;
+bool range_filter_enabled = false;
+
+static inline int lowestSetBit(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int b = 0;
+    while (!(x & 1u)) { x >>= 1; b++; }
+    return b;
+#endif
+}
+
+// ============================================================
+// ÍNDICE ORDENADO
+// ============================================================
+
+// Valores do atributo na ordem de `lines`; nulo se ainda não calculados
+static const float* metricValues(int metric) {
+    if (metric == METRIC_RADIUS) return radii.size() == lines.size() ? radii.data() : nullptr;
+    if (!morphometry.valid || morphometry.values[metric].size() != lines.size()) return nullptr;
+    return morphometry.values[metric].data();
+}
+
+// Busca do trecho de `order` dentro dos limites; os extremos 0 e 1 não
+// passam pela interpolação, para nenhum segmento ficar de fora por
+// arredondamento
+static void queryRange(RangeFilter& f) {
+    auto start = std::chrono::steady_clock::now();
+    const float* begin = f.sorted_values.data();
+    const float* end = begin + f.sorted_values.size();
+    f.first = (f.low <= 0.0f) ? 0 : std::lower_bound(begin, end, rangeFilterValue(f.low)) - begin;
+    f.last = (f.high >= 1.0f) ? f.sorted_values.size() : std::upper_bound(begin, end, rangeFilterValue(f.high)) - begin;
+    f.last = std::max(f.first, f.last);
+    f.revision++;
+    f.query_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool updateRangeFilterIndex(int metric) {
+    RangeFilter& f = range_filter;
+    if (f.valid && f.metric == metric) return false;
+    const float* values = metricValues(metric);
+    if (!values) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    if (f.metric != metric) {
+        f.low = 0.0f;
+        f.high = 1.0f;
+    }
+    f.metric = metric;
+
+    // Pares (valor, segmento): empates na ordem dos segmentos
+    std::vector<std::pair<float, int> > keyed;
+    keyed.reserve(lines.size());
+    for (size_t s = 0; s < lines.size(); s++) {
+        if (!std::isnan(values[s])) keyed.push_back(std::make_pair(values[s], (int)s));
+    }
+    std::sort(keyed.begin(), keyed.end());
+    f.order.resize(keyed.size());
+    f.sorted_values.resize(keyed.size());
+    for (size_t k = 0; k < keyed.size(); k++) {
+        f.sorted_values[k] = keyed[k].first;
+        f.order[k] = keyed[k].second;
+    }
+    f.min_value = keyed.empty() ? 0.0f : f.sorted_values.front();
+    f.max_value = keyed.empty() ? 0.0f : f.sorted_values.back();
+    f.log_scale = metricLogScale(metric) && f.min_value > 0.0f;
+    f.valid = true;
+    f.sort_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    queryRange(f);
+    return true;
+}
+
+void invalidateRangeFilter() {
+    range_filter.valid = false;
+    range_filter.revision++;
+}
+
+// ============================================================
+// LIMITES
+// ============================================================
+
+float rangeFilterValue(float t) {
+    const RangeFilter& f = range_filter;
+    if (f.log_scale) {
+        return f.min_value * powf(f.max_value / f.min_value, t);
+    }
+    return f.min_value + t * (f.max_value - f.min_value);
+}
+
+void setRangeFilterBounds(float low, float high) {
+    RangeFilter& f = range_filter;
+    f.low = std::max(0.0f, std::min(1.0f, low));
+    f.high = std::max(f.low, std::min(1.0f, high));
+    if (f.valid) queryRange(f);
+}
+
+// ============================================================
+// BUFFER DE ÍNDICES
+// ============================================================
+
+size_t buildRangeFilterIndices(const TubeMesh& mesh, const std::vector<unsigned char>* allowed,
+                               std::vector<unsigned int>& out) {
+    const RangeFilter& f = range_filter;
+    if (!f.valid || mesh.segment_count != lines.size()) {
+        out.clear();
+        return 0;
+    }
+
+    // Segmentos do trecho marcados num mapa de bits e copiados em ordem de
+    // layout: os blocos são lidos em sequência, sem ordenar os k segmentos
+    // (o mapa custa n/64 palavras, desprezível perto dos blocos)
+    static std::vector<uint64_t> selected;
+    selected.assign((lines.size() + 63) / 64, 0);
+    size_t count = 0;
+    for (size_t k = f.first; k < f.last; k++) {
+        int s = f.order[k];
+        if (allowed && !(*allowed)[s]) continue;
+        selected[s >> 6] |= (uint64_t)1 << (s & 63);
+        count++;
+    }
+
+    // Sem clear: os elementos já alocados não são zerados de novo
+    size_t block = mesh.indices_per_segment;
+    out.resize(count * block);
+    unsigned int* dst = out.data();
+    for (size_t w = 0; w < selected.size(); w++) {
+        for (uint64_t bits = selected[w]; bits; bits &= bits - 1) {
+            size_t s = 64 * w + lowestSetBit(bits);
+            writeSegmentIndices(mesh, s, dst);
+            dst += block;
+        }
+    }
+    return count;
+}
+
+void appendRangeFilterMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Caches", "range_filter.order", range_filter.order);
+    addMemoryEntry(entries, "Caches", "range_filter.sorted_values", range_filter.sorted_values);
+}
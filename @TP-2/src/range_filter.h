@@ -0,0 +1,70 @@
+/*
+ * range_filter.h
+ * Filtro dos segmentos por faixa de um atributo (índice ordenado) - TP2 (3D)
+ */
+
+#ifndef RANGE_FILTER_H
+#define RANGE_FILTER_H
+
+#include <vector>
+#include <cstddef>
+
+struct TubeMesh;
+struct MemoryEntry;
+
+// Passo das setas, em fração da faixa do atributo
+static const float RANGE_FILTER_STEP = 0.025f;
+
+// Permutação dos segmentos em ordem crescente do atributo: os segmentos
+// dentro de [valor(low), valor(high)] são sempre um trecho contíguo dela,
+// achado por duas buscas binárias
+struct RangeFilter {
+    bool valid;                         // Índice do atributo `metric` pronto
+    int metric;                         // MorphMetric indexada
+    std::vector<int> order;             // Segmentos com valor definido (sem NAN), do menor valor ao maior
+    std::vector<float> sorted_values;   // Valor de order[k] (a busca não passa pela permutação)
+    float min_value, max_value;
+    bool log_scale;                     // Limites interpolados em log10 (vazão, resistência)
+
+    float low, high;                    // Limites em fração de [min, max], 0 a 1
+    size_t first, last;                 // order[first, last): segmentos dentro dos limites
+    unsigned int revision;              // Muda a cada índice novo ou consulta (listas de desenho)
+
+    double sort_ms;
+    double query_us;                    // Última consulta (duas buscas binárias)
+
+    RangeFilter() : valid(false), metric(-1), min_value(0.0f), max_value(0.0f), log_scale(false), low(0.0f),
+                    high(1.0f), first(0), last(0), revision(0), sort_ms(0.0), query_us(0.0) {}
+
+    size_t count() const { return last - first; }
+};
+
+extern RangeFilter range_filter;
+extern bool range_filter_enabled;   // Só os segmentos dentro da faixa (tecla J)
+
+// Ordena os segmentos pelo atributo (raio do arquivo ou morfometria, que
+// precisa estar calculada) se o índice não vale mais ou o atributo mudou;
+// trocar de atributo volta os limites para a faixa inteira. Retorna true
+// se o índice foi refeito.
+bool updateRangeFilterIndex(int metric);
+
+// Chamada quando raios ou segmentos mudam (os limites, em fração, ficam)
+void invalidateRangeFilter();
+
+// Novos limites (fração, 0 a 1) e o trecho de `order` dentro deles:
+// O(log n), independente de quantos segmentos mudam de estado
+void setRangeFilterBounds(float low, float high);
+
+// Valor do atributo na fração t da faixa
+float rangeFilterValue(float t);
+
+// Buffer de índices compacto com os blocos de `mesh` dos segmentos dentro
+// da faixa (e de `allowed`, se não for nulo), para um único glDrawElements:
+// O(k) blocos gerados a partir do molde da malha. Retorna o número de segmentos.
+size_t buildRangeFilterIndices(const TubeMesh& mesh, const std::vector<unsigned char>* allowed,
+                               std::vector<unsigned int>& out);
+
+// Permutação e valores (--memstats)
+void appendRangeFilterMemory(std::vector<MemoryEntry>& entries);
+
+#endif // RANGE_FILTER_H
@@ -0,0 +1,283 @@
+/*
+ * shadow_map.cpp
+ * Mapa de sombras da luz principal (rasterizado na CPU, em cache) - TP2 (3D)
+ */
+
+#include "shadow_map.h"
+#include "utils.h"
+#include "point_store.h"
+#include "parallel.h"
+#include "memstats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+ShadowMap shadow_map;
+bool shadows_enabled = false;
+int shadow_resolution = 1024;
+
+static const float SHADOW_EMPTY = 1e30f;
+
+// ============================================================
+// VISTA DA LUZ
+// ============================================================
+
+// Coordenadas do texel (contínuas, 0 a resolution) e distância ao longo
+// do eixo da vista
+static void projectToMap(const ShadowMap& map, const Point3D& p, float& tx, float& ty, float& z) {
+    Point3D v = p - map.eye;
+    z = dotProduct(v, map.forward);
+    float inv = map.proj / std::max(z, 1e-12f);
+    tx = (dotProduct(v, map.side) * inv * 0.5f + 0.5f) * map.resolution;
+    ty = (dotProduct(v, map.up) * inv * 0.5f + 0.5f) * map.resolution;
+}
+
+// Cone da luz justo na esfera envolvente dos tubos; false se a luz estiver
+// dentro dela (não há vista que cubra a árvore inteira)
+static bool setupLightView(ShadowMap& map) {
+    float bmin[3], bmax[3];
+    pointBounds(points, bmin, bmax);
+    float max_radius = 0.0f;
+    for (size_t s = 0; s < lines.size(); s++) max_radius = std::max(max_radius, getDisplayRadius(s));
+
+    Point3D center(0.5f * (bmin[0] + bmax[0]), 0.5f * (bmin[1] + bmax[1]), 0.5f * (bmin[2] + bmax[2]));
+    Point3D half(0.5f * (bmax[0] - bmin[0]), 0.5f * (bmax[1] - bmin[1]), 0.5f * (bmax[2] - bmin[2]));
+    float radius = half.length() + max_radius;
+
+    map.eye = light.position;
+    Point3D to_center = center - map.eye;
+    float distance = to_center.length();
+    if (distance <= radius * 1.01f) return false;
+
+    map.forward = to_center * (1.0f / distance);
+    Point3D up_hint(0, 1, 0);
+    if (fabsf(dotProduct(map.forward, up_hint)) > 0.9f) up_hint = Point3D(1, 0, 0);
+    map.side = crossProduct(map.forward, up_hint);
+    map.side.normalize();
+    map.up = crossProduct(map.side, map.forward);
+    map.proj = sqrtf(distance * distance - radius * radius) / radius;
+    return true;
+}
+
+// ============================================================
+// RASTERIZAÇÃO
+// ============================================================
+
+// Ponto de maior aproximação entre o raio eye + t·d (t >= 0, d unitário) e
+// o eixo a-b; devolve a distância entre os dois e o t no raio
+static float rayAxisApproach(const Point3D& o, const Point3D& d, const Point3D& a, const Point3D& b, float& t) {
+    Point3D d2 = b - a;
+    Point3D r = o - a;
+    float e = dotProduct(d2, d2);
+    float f = dotProduct(d2, r);
+    float c = dotProduct(d, r);
+    float bb = dotProduct(d, d2);
+    float u;
+    if (e < 1e-12f) {
+        u = 0.0f;
+        t = std::max(0.0f, -c);
+    } else {
+        float denom = e - bb * bb;
+        t = (denom > 1e-12f) ? std::max(0.0f, (bb * f - c * e) / denom) : 0.0f;
+        u = (bb * t + f) / e;
+        if (u < 0.0f) {
+            u = 0.0f;
+            t = std::max(0.0f, -c);
+        } else if (u > 1.0f) {
+            u = 1.0f;
+            t = std::max(0.0f, bb - c);
+        }
+    }
+    Point3D diff = (o + d * t) - (a + d2 * u);
+    return diff.length();
+}
+
+// Projeção de uma cápsula no mapa: eixo em texels, meia largura
+// conservadora, retângulo (inclusivo) e a menor distância possível da luz
+// até a superfície (para descartar texels que já têm um tubo mais perto)
+struct ShadowFootprint {
+    float ax, ay, bx, by;
+    float half_width;
+    int rect[4];
+    float nearest;
+};
+
+// False se a projeção ficar fora do mapa
+static bool capsuleFootprint(const ShadowMap& map, int s, ShadowFootprint& fp) {
+    const Point3D& p0 = points[lines[s].p0];
+    const Point3D& p1 = points[lines[s].p1];
+    float r = getDisplayRadius(s);
+    float az, bz;
+    projectToMap(map, p0, fp.ax, fp.ay, az);
+    projectToMap(map, p1, fp.bx, fp.by, bz);
+    float nearest_z = std::max(std::min(az, bz) - r, 1e-6f);
+    fp.half_width = r * map.proj * 0.5f * map.resolution / nearest_z + 1.0f;
+    fp.rect[0] = std::max(0, (int)floorf(std::min(fp.ax, fp.bx) - fp.half_width));
+    fp.rect[1] = std::max(0, (int)floorf(std::min(fp.ay, fp.by) - fp.half_width));
+    fp.rect[2] = std::min(map.resolution - 1, (int)ceilf(std::max(fp.ax, fp.bx) + fp.half_width));
+    fp.rect[3] = std::min(map.resolution - 1, (int)ceilf(std::max(fp.ay, fp.by) + fp.half_width));
+
+    Point3D d = p1 - p0;
+    float dd = dotProduct(d, d);
+    float t = (dd > 1e-12f) ? std::max(0.0f, std::min(1.0f, dotProduct(map.eye - p0, d) / dd)) : 0.0f;
+    fp.nearest = (map.eye - (p0 + d * t)).length() - r;
+    return fp.rect[0] <= fp.rect[2] && fp.rect[1] <= fp.rect[3];
+}
+
+// Linhas [y_first, y_last] da projeção da cápsula: raio da luz pelo centro
+// de cada texel dentro da faixa 2D do eixo, entrada aproximada pela esfera
+// no ponto de maior aproximação
+static size_t rasterizeCapsule(ShadowMap& map, int s, const ShadowFootprint& fp, int y_first, int y_last) {
+    const Point3D& a = points[lines[s].p0];
+    const Point3D& b = points[lines[s].p1];
+    float r = getDisplayRadius(s);
+    float r2 = r * r;
+    float scale = 2.0f / (map.resolution * map.proj);
+    float offset = (1.0f - map.resolution) * 0.5f * scale;
+    float ex = fp.bx - fp.ax, ey = fp.by - fp.ay;
+    float len2 = ex * ex + ey * ey;
+    float inv_len2 = (len2 > 1e-12f) ? 1.0f / len2 : 0.0f;
+    float hw2 = fp.half_width * fp.half_width;
+    size_t written = 0;
+    for (int y = std::max(fp.rect[1], y_first); y <= std::min(fp.rect[3], y_last); y++) {
+        Point3D row = map.forward + map.up * (y * scale + offset);
+        float qy = y + 0.5f - fp.ay;
+        for (int x = fp.rect[0]; x <= fp.rect[2]; x++) {
+            // Fora da faixa 2D ou atrás de um tubo já gravado: nem lança o raio
+            float qx = x + 0.5f - fp.ax;
+            float u = std::max(0.0f, std::min(1.0f, (qx * ex + qy * ey) * inv_len2));
+            float gx = qx - u * ex, gy = qy - u * ey;
+            if (gx * gx + gy * gy > hw2) continue;
+            size_t texel = (size_t)y * map.resolution + x;
+            if (map.depth[texel] <= fp.nearest) continue;
+
+            Point3D dir = row + map.side * (x * scale + offset);
+            dir.normalize();
+            float t;
+            float dist = rayAxisApproach(map.eye, dir, a, b, t);
+            if (dist > r) continue;
+            float hit = t - sqrtf(r2 - dist * dist);
+            if (hit < map.depth[texel]) {
+                if (map.segment[texel] < 0) written++;
+                map.depth[texel] = hit;
+                map.segment[texel] = s;
+            }
+        }
+    }
+    return written;
+}
+
+bool updateShadowMap(int resolution) {
+    ShadowMap& map = shadow_map;
+    bool light_moved = map.eye.x != light.position.x || map.eye.y != light.position.y ||
+                       map.eye.z != light.position.z;
+    if (map.valid && map.resolution == resolution && !light_moved) return false;
+
+    auto start = std::chrono::steady_clock::now();
+    map.valid = true;
+    map.resolution = std::max(1, resolution);
+    map.light_inside = lines.empty() || !setupLightView(map);
+    map.eye = light.position;
+    map.band_entries = 0;
+    map.texels_covered = 0;
+    map.builds++;
+    if (map.light_inside) {
+        map.depth.clear();
+        map.segment.clear();
+        map.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+    size_t texels = (size_t)map.resolution * map.resolution;
+    map.depth.assign(texels, SHADOW_EMPTY);
+    map.segment.assign(texels, -1);
+
+    // Faixas de cada cápsula em CSR: contagem, prefixos, preenchimento
+    int bands = (map.resolution + SHADOW_BAND - 1) / SHADOW_BAND;
+    size_t n = lines.size();
+    std::vector<ShadowFootprint> footprints(n);
+    std::vector<size_t> band_start(bands + 1, 0);
+    for (size_t s = 0; s < n; s++) {
+        ShadowFootprint& fp = footprints[s];
+        if (!capsuleFootprint(map, (int)s, fp)) {
+            fp.rect[1] = 1;
+            fp.rect[3] = 0;
+            continue;
+        }
+        for (int band = fp.rect[1] / SHADOW_BAND; band <= fp.rect[3] / SHADOW_BAND; band++) band_start[band + 1]++;
+    }
+    for (int band = 0; band < bands; band++) band_start[band + 1] += band_start[band];
+    std::vector<int> band_segments(band_start[bands]);
+    std::vector<size_t> fill(band_start.begin(), band_start.end() - 1);
+    for (size_t s = 0; s < n; s++) {
+        const ShadowFootprint& fp = footprints[s];
+        if (fp.rect[1] > fp.rect[3]) continue;
+        for (int band = fp.rect[1] / SHADOW_BAND; band <= fp.rect[3] / SHADOW_BAND; band++) {
+            band_segments[fill[band]++] = (int)s;
+        }
+    }
+    map.band_entries = band_segments.size();
+
+    // Cada faixa escreve só nas suas linhas, da cápsula mais perto da luz
+    // para a mais longe: as de trás quase não passam do teste de distância
+    std::vector<size_t> covered(bands, 0);
+    parallelFor((size_t)bands, 1, [&](size_t first, size_t last) {
+        for (size_t band = first; band < last; band++) {
+            int y_first = (int)band * SHADOW_BAND;
+            int y_last = std::min(map.resolution, y_first + SHADOW_BAND) - 1;
+            int* list = band_segments.data() + band_start[band];
+            int* list_end = band_segments.data() + band_start[band + 1];
+            std::sort(list, list_end, [&](int a, int b) { return footprints[a].nearest < footprints[b].nearest; });
+            for (int* it = list; it != list_end; ++it) {
+                covered[band] += rasterizeCapsule(map, *it, footprints[*it], y_first, y_last);
+            }
+        }
+    });
+    for (size_t c : covered) map.texels_covered += c;
+
+    map.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void invalidateShadowMap() {
+    shadow_map.valid = false;
+}
+
+// ============================================================
+// CONSULTA
+// ============================================================
+
+float shadowLitFraction(const Point3D& p, int segment, float bias) {
+    const ShadowMap& map = shadow_map;
+    if (!map.valid || map.light_inside || map.depth.empty()) return 1.0f;
+
+    float tx, ty, z;
+    projectToMap(map, p, tx, ty, z);
+    float distance = (p - map.eye).length();
+    // Folga também pela largura do texel nessa distância (vizinhos do PCF)
+    float limit = distance - bias - 1.5f * 2.0f * z / (map.proj * map.resolution);
+
+    float fx = tx - 0.5f, fy = ty - 0.5f;
+    int x0 = (int)floorf(fx), y0 = (int)floorf(fy);
+    float wx = fx - x0, wy = fy - y0;
+    float lit = 0.0f;
+    for (int j = 0; j < 2; j++) {
+        for (int i = 0; i < 2; i++) {
+            float w = (i ? wx : 1.0f - wx) * (j ? wy : 1.0f - wy);
+            int x = x0 + i, y = y0 + j;
+            if (x < 0 || y < 0 || x >= map.resolution || y >= map.resolution) {
+                lit += w;
+                continue;
+            }
+            size_t texel = (size_t)y * map.resolution + x;
+            int s = map.segment[texel];
+            if (s < 0 || s == segment || map.depth[texel] >= limit) lit += w;
+        }
+    }
+    return lit;
+}
+
+void appendShadowMapMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Caches", "shadow_map.depth", shadow_map.depth);
+    addMemoryEntry(entries, "Caches", "shadow_map.segment", shadow_map.segment);
+}
@@ -0,0 +1,64 @@
+/*
+ * shadow_map.h
+ * Mapa de sombras da luz principal (rasterizado na CPU, em cache) - TP2 (3D)
+ */
+
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include <vector>
+#include <cstddef>
+#include "globals.h"
+
+struct MemoryEntry;
+
+// Linhas de cada faixa do mapa: a unidade de trabalho das threads
+static const int SHADOW_BAND = 16;
+
+// Vista da luz: projeção perspectiva a partir de light.position, com o
+// cone justo na esfera envolvente da árvore (os tubos com o raio de exibição)
+struct ShadowMap {
+    bool valid;
+    bool light_inside;                  // Luz dentro da esfera: sem sombras
+    int resolution;                     // Texels por lado
+    Point3D eye;                        // light.position usada
+    Point3D forward, side, up;          // Base da vista
+    float proj;                         // 1 / tan(meio ângulo do cone)
+    std::vector<float> depth;           // Distância da luz até o primeiro tubo em cada texel
+    std::vector<int> segment;           // Segmento visto em cada texel (-1 = vazio)
+
+    size_t builds;                      // Reconstruções desde o início (o cache evita as outras)
+    size_t band_entries;                // Pares faixa × segmento rasterizados
+    size_t texels_covered;
+    double build_ms;
+
+    ShadowMap() : valid(false), light_inside(false), resolution(0), proj(1.0f), builds(0), band_entries(0),
+                  texels_covered(0), build_ms(0.0) {}
+};
+
+extern ShadowMap shadow_map;
+extern bool shadows_enabled;       // Sombras da luz principal (tecla U)
+extern int shadow_resolution;      // Texels por lado na janela
+
+// Refaz o mapa se ele não vale mais: outra resolução, a luz saiu do lugar
+// ou invalidateShadowMap desde a última vez. Cada cápsula (raio de
+// exibição) é distribuída nas faixas de SHADOW_BAND linhas que a sua
+// projeção toca; as faixas são rasterizadas em paralelo, da cápsula mais
+// perto da luz para a mais longe, e cada texel guarda a entrada do raio da
+// luz na cápsula mais próxima e o segmento dela.
+// Retorna true se o mapa foi refeito (as cores precisam ser recalculadas).
+bool updateShadowMap(int resolution);
+
+// Chamada quando pontos, raios ou o raio de exibição mudam
+void invalidateShadowMap();
+
+// Fração (0 a 1) da luz que chega ao ponto p da superfície do segmento:
+// filtro bilinear sobre os 4 texels vizinhos (PCF). Um texel sombreia p se
+// o tubo visto nele é outro segmento e está mais perto da luz que p, com
+// folga `bias`. O próprio segmento nunca sombreia (sem acne).
+float shadowLitFraction(const Point3D& p, int segment, float bias);
+
+// Depth e segmentos (--memstats)
+void appendShadowMapMemory(std::vector<MemoryEntry>& entries);
+
+#endif // SHADOW_MAP_H
@@ -0,0 +1,106 @@
+/*
+ * spatial_order.cpp
+ * Renumeração dos pontos ao longo de uma curva de Hilbert 3D - TP2 (3D)
+ */
+
+#include "spatial_order.h"
+#include "globals.h"
+#include "point_store.h"
+#include <vector>
+#include <algorithm>
+
+bool hilbert_reorder_enabled = false;
+
+// Bits por eixo da quantização (48 bits de chave no total)
+static const int HILBERT_BITS = 16;
+
+// ============================================================
+// CURVA DE HILBERT
+// ============================================================
+
+// Algoritmo de Skilling (2004): converte as coordenadas para a forma
+// "transposta" do índice de Hilbert e intercala os bits dos três eixos
+uint64_t hilbertIndex3D(uint32_t x, uint32_t y, uint32_t z, int bits) {
+    uint32_t X[3] = {x, y, z};
+    uint32_t M = 1u << (bits - 1);
+
+    // Desfaz as rotações/reflexões de cada nível
+    for (uint32_t Q = M; Q > 1; Q >>= 1) {
+        uint32_t P = Q - 1;
+        for (int i = 0; i < 3; i++) {
+            if (X[i] & Q) {
+                X[0] ^= P;
+            } else {
+                uint32_t t = (X[0] ^ X[i]) & P;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+
+    // Código de Gray
+    for (int i = 1; i < 3; i++) {
+        X[i] ^= X[i - 1];
+    }
+    uint32_t t = 0;
+    for (uint32_t Q = M; Q > 1; Q >>= 1) {
+        if (X[2] & Q) t ^= Q - 1;
+    }
+    for (int i = 0; i < 3; i++) {
+        X[i] ^= t;
+    }
+
+    // Intercala: bit mais significativo de x, y, z, depois o próximo nível...
+    uint64_t key = 0;
+    for (int b = bits - 1; b >= 0; b--) {
+        for (int i = 0; i < 3; i++) {
+            key = (key << 1) | ((X[i] >> b) & 1u);
+        }
+    }
+    return key;
+}
+
+// ============================================================
+// RENUMERAÇÃO
+// ============================================================
+
+void reorderPointsHilbert() {
+    size_t n = points.size();
+    if (n < 2) return;
+
+    float bmin[3], bmax[3];
+    pointBounds(points, bmin, bmax);
+
+    // Mesma escala nos três eixos: a curva não se deforma em caixas alongadas
+    float extent = std::max(bmax[0] - bmin[0], std::max(bmax[1] - bmin[1], bmax[2] - bmin[2]));
+    if (extent < 1e-12f) return;
+    const uint32_t max_coord = (1u << HILBERT_BITS) - 1;
+    float scale = max_coord / extent;
+
+    std::vector<std::pair<uint64_t, int> > keyed(n);
+    for (size_t i = 0; i < n; i++) {
+        const Point3D& p = points[i];
+        uint32_t qx = std::min(max_coord, (uint32_t)((p.x - bmin[0]) * scale));
+        uint32_t qy = std::min(max_coord, (uint32_t)((p.y - bmin[1]) * scale));
+        uint32_t qz = std::min(max_coord, (uint32_t)((p.z - bmin[2]) * scale));
+        keyed[i] = std::make_pair(hilbertIndex3D(qx, qy, qz, HILBERT_BITS), (int)i);
+    }
+    // Empates (pontos na mesma célula) mantêm a ordem original
+    std::stable_sort(keyed.begin(), keyed.end(),
+                     [](const std::pair<uint64_t, int>& a, const std::pair<uint64_t, int>& b) {
+                         return a.first < b.first;
+                     });
+
+    std::vector<Point3D> reordered(n);
+    std::vector<uint32_t> new_index(n);
+    for (size_t k = 0; k < n; k++) {
+        reordered[k] = points[keyed[k].second];
+        new_index[keyed[k].second] = (uint32_t)k;
+    }
+    points.swap(reordered);
+
+    for (Line3D& L : lines) {
+        if (L.p0 < n) L.p0 = new_index[L.p0];
+        if (L.p1 < n) L.p1 = new_index[L.p1];
+    }
+}
@@ -0,0 +1,23 @@
+/*
+ * spatial_order.h
+ * Renumeração dos pontos ao longo de uma curva de Hilbert 3D - TP2 (3D)
+ */
+
+#ifndef SPATIAL_ORDER_H
+#define SPATIAL_ORDER_H
+
+#include <cstdint>
+
+// Passo opcional da carga (tecla H): pontos próximos no espaço passam a ter
+// índices próximos, e os segmentos são remapeados para os novos índices
+extern bool hilbert_reorder_enabled;
+
+// Índice na curva de Hilbert de uma coordenada inteira com `bits` bits por eixo
+uint64_t hilbertIndex3D(uint32_t x, uint32_t y, uint32_t z, int bits);
+
+// Renumera `points` pela curva de Hilbert (dentro da caixa envolvente dos
+// dados) e atualiza p0/p1 de `lines`. Chamada por readVTKFile3D antes da
+// topologia e de qualquer estrutura indexada por ponto.
+void reorderPointsHilbert();
+
+#endif // SPATIAL_ORDER_H
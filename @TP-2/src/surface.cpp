@@ -0,0 +1,624 @@
+/*
+ * surface.cpp
+ * Superfície fechada dos vasos (marching cubes em blocos esparsos) - TP2 (3D)
+ */
+
+#include "surface.h"
+#include "globals.h"
+#include "bvh.h"
+#include "parallel.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+
+// ============================================================
+// TABELA DE CASOS
+// ============================================================
+
+// Canto c da célula: bits (x, y, z) = (c & 1, c >> 1 & 1, c >> 2 & 1).
+// Aresta e: eixo e / 4; os outros dois bits do canto de baixo em e % 4
+// (primeiro o eixo seguinte, depois o outro, na ordem cíclica x → y → z).
+// Face f: eixo f / 2, lado f % 2.
+struct CubeLoop {
+    std::vector<signed char> edges;   // Arestas cortadas, na ordem do laço
+    bool center;                      // Triangulado a partir de um vértice no centro
+};
+
+struct CubeCases {
+    std::vector<CubeLoop> loops[256];
+};
+
+static int edgeBetween(int a, int b) {
+    int axis = ((a ^ b) == 1) ? 0 : ((a ^ b) == 2) ? 1 : 2;
+    int lower = a & b;
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    return 4 * axis + ((lower >> u) & 1) + 2 * ((lower >> v) & 1);
+}
+
+static int edgeLowerCorner(int e) {
+    int axis = e / 4, u = (axis + 1) % 3, v = (axis + 2) % 3;
+    return ((e & 1) << u) | (((e >> 1) & 1) << v);
+}
+
+static bool edgesShareFace(int e0, int e1) {
+    for (int a = 0; a < 3; a++) {
+        if (a == e0 / 4 || a == e1 / 4) continue;
+        if (((edgeLowerCorner(e0) >> a) & 1) == ((edgeLowerCorner(e1) >> a) & 1)) return true;
+    }
+    return false;
+}
+
+// Ponto médio da aresta (só para acertar a orientação da tabela)
+static void edgeMidpoint(int e, float p[3]) {
+    int lower = edgeLowerCorner(e);
+    for (int a = 0; a < 3; a++) p[a] = (float)((lower >> a) & 1);
+    p[e / 4] = 0.5f;
+}
+
+// Em cada face, percorrida no sentido anti-horário visto de fora, cada
+// sequência de cantos internos vira um segmento da aresta por onde entra
+// até a aresta por onde sai. Numa face ambígua (cantos internos em
+// diagonal) são duas sequências: os cantos internos ficam sempre
+// separados, e as duas células da face tomam a mesma decisão. Cada aresta
+// cortada é entrada numa face e saída na outra, então os segmentos formam
+// laços, triangulados em leque.
+//
+// Uma diagonal do leque entre dois vértices da mesma face seria também
+// diagonal na célula vizinha (aresta em quatro triângulos): o leque começa
+// num vértice sem essas diagonais, e o laço sem nenhum ganha um vértice
+// no centro.
+static CubeCases buildCubeCases() {
+    CubeCases cases;
+    for (int c = 0; c < 256; c++) {
+        int next[12];
+        std::fill(next, next + 12, -1);
+        for (int a = 0; a < 3; a++) {
+            int u = (a + 1) % 3, v = (a + 2) % 3;
+            for (int side = 0; side < 2; side++) {
+                int ring[4] = {side << a, (side << a) | (1 << u), (side << a) | (1 << u) | (1 << v),
+                               (side << a) | (1 << v)};
+                if (side == 0) std::swap(ring[1], ring[3]);
+                int start = -1;
+                for (int k = 0; k < 4; k++) {
+                    if (!((c >> ring[k]) & 1)) start = k;
+                }
+                if (start < 0) continue;
+                int entry = -1;
+                for (int k = 1; k <= 4; k++) {
+                    int prev = ring[(start + k - 1) % 4], cur = ring[(start + k) % 4];
+                    bool prev_in = (c >> prev) & 1, cur_in = (c >> cur) & 1;
+                    if (!prev_in && cur_in) entry = edgeBetween(prev, cur);
+                    if (prev_in && !cur_in) next[entry] = edgeBetween(prev, cur);
+                }
+            }
+        }
+        bool visited[12] = {false};
+        for (int e = 0; e < 12; e++) {
+            if (next[e] < 0 || visited[e]) continue;
+            std::vector<int> loop;
+            for (int k = e; !visited[k]; k = next[k]) {
+                visited[k] = true;
+                loop.push_back(k);
+            }
+            int n = (int)loop.size();
+            int apex = -1;
+            for (int s = 0; s < n && apex < 0; s++) {
+                bool ok = true;
+                for (int k = 2; k <= n - 2 && ok; k++) ok = !edgesShareFace(loop[s], loop[(s + k) % n]);
+                if (ok) apex = s;
+            }
+            CubeLoop out;
+            out.center = apex < 0;
+            for (int k = 0; k < n; k++) out.edges.push_back((signed char)loop[(std::max(apex, 0) + k) % n]);
+            cases.loops[c].push_back(out);
+        }
+    }
+
+    // Orientação: no caso de um só canto interno (0), a normal do triângulo
+    // aponta para longe dele; a regra é a mesma em todos os casos, então
+    // basta conferir um e inverter a tabela inteira se preciso
+    const std::vector<signed char>& t = cases.loops[1][0].edges;
+    float p0[3], p1[3], p2[3];
+    edgeMidpoint(t[0], p0);
+    edgeMidpoint(t[1], p1);
+    edgeMidpoint(t[2], p2);
+    float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+    if (n[0] + n[1] + n[2] < 0.0f) {
+        for (int c = 0; c < 256; c++) {
+            for (CubeLoop& loop : cases.loops[c]) std::reverse(loop.edges.begin() + 1, loop.edges.end());
+        }
+    }
+    return cases;
+}
+
+static const CubeCases& cubeCases() {
+    static const CubeCases cases = buildCubeCases();
+    return cases;
+}
+
+// ============================================================
+// CAMPO E MARCHING CUBES POR BLOCO
+// ============================================================
+
+// Eixo da cápsula com o que a distância ponto-segmento precisa
+struct CapsuleAxis {
+    Point3D p0;
+    Point3D d;
+    float inv_len2;
+};
+
+static inline float axisDistance2(const CapsuleAxis& a, float x, float y, float z) {
+    float px = x - a.p0.x, py = y - a.p0.y, pz = z - a.p0.z;
+    float t = (px * a.d.x + py * a.d.y + pz * a.d.z) * a.inv_len2;
+    t = std::max(0.0f, std::min(1.0f, t));
+    float qx = px - a.d.x * t, qy = py - a.d.y * t, qz = pz - a.d.z * t;
+    return qx * qx + qy * qy + qz * qz;
+}
+
+// Trecho t ∈ [t0, t1] do eixo em que coord(t) = p + d·t fica a até `reach`
+// de c; falso se nenhum
+static inline bool clipAxis(float p, float d, float c, float reach, float& t0, float& t1) {
+    if (std::fabs(d) < 1e-20f) return std::fabs(p - c) <= reach;
+    float a = (c - reach - p) / d, b = (c + reach - p) / d;
+    if (a > b) std::swap(a, b);
+    t0 = std::max(t0, a);
+    t1 = std::min(t1, b);
+    return t0 <= t1;
+}
+
+// Vértices [first, last) do bloco [lo, hi] (inclusive) dentro de [a, b]
+static inline void cornerRange(const SurfaceMesh& mesh, int axis, float a, float b, int lo, int hi, int& first,
+                               int& last) {
+    first = std::max(lo, (int)std::ceil((a - mesh.origin[axis]) / mesh.cell));
+    last = std::min(hi + 1, (int)std::floor((b - mesh.origin[axis]) / mesh.cell) + 1);
+}
+
+// Resultado de um bloco: vértices e triângulos com índices locais; os
+// vértices nas faces do bloco (que o vizinho também gera) vão com a chave
+// da aresta da grade, para a solda
+struct BlockSurface {
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    std::vector<std::pair<uint64_t, uint32_t> > shared;   // (aresta da grade, vértice local)
+    uint32_t capsules;
+
+    BlockSurface() : capsules(0) {}
+};
+
+// Memória de trabalho de uma thread
+struct BlockScratch {
+    std::vector<int> candidates;
+    std::vector<float> field;
+    std::vector<int> edge_vertex;    // Vértice local de cada aresta do bloco (-1 sem)
+};
+
+static void marchBlock(const SurfaceMesh& mesh, const SegmentBVH& bvh, const std::vector<float>& capsule_radii,
+                       size_t block, BlockScratch& scratch, BlockSurface& out) {
+    const int blocks_x = (mesh.cells[0] + SURFACE_BLOCK - 1) / SURFACE_BLOCK;
+    const int blocks_y = (mesh.cells[1] + SURFACE_BLOCK - 1) / SURFACE_BLOCK;
+    int b[3] = {(int)(block % blocks_x), (int)(block / blocks_x % blocks_y), (int)(block / ((size_t)blocks_x * blocks_y))};
+    int lo[3], hi[3];
+    float bmin[3], bmax[3];
+    // Campo guardado só até `band` de distância: basta para as arestas
+    // cortadas (os dois cantos a menos de uma célula da superfície)
+    const float band = 1.25f * mesh.cell;
+    for (int a = 0; a < 3; a++) {
+        lo[a] = b[a] * SURFACE_BLOCK;
+        hi[a] = std::min(mesh.cells[a], lo[a] + SURFACE_BLOCK);
+        bmin[a] = mesh.origin[a] + lo[a] * mesh.cell - band;
+        bmax[a] = mesh.origin[a] + hi[a] * mesh.cell + band;
+    }
+    collectSegmentsInBox(bvh, bmin, bmax, scratch.candidates);
+    out.capsules = (uint32_t)scratch.candidates.size();
+    if (scratch.candidates.empty()) return;
+
+    // Campo nos vértices do bloco: mínimo de |p - eixo| - r sobre as
+    // cápsulas, cada uma só nas linhas de vértices que alcança. Um vértice
+    // já mais de `band` para dentro não muda de sinal e é pulado; os demais
+    // recebem o mínimo exato, igual ao do bloco vizinho na face comum
+    const int stride = SURFACE_BLOCK + 1;
+    std::vector<float>& field = scratch.field;
+    field.assign((size_t)stride * stride * stride, band);
+    for (int s : scratch.candidates) {
+        CapsuleAxis axis;
+        axis.p0 = points[lines[s].p0];
+        const Point3D& p1 = points[lines[s].p1];
+        axis.d = p1 - axis.p0;
+        float len2 = axis.d.x * axis.d.x + axis.d.y * axis.d.y + axis.d.z * axis.d.z;
+        axis.inv_len2 = (len2 > 0.0f) ? 1.0f / len2 : 0.0f;
+        float r = capsule_radii[s];
+        float reach = r + band, reach2 = reach * reach;
+        float cmin[3] = {std::min(axis.p0.x, p1.x), std::min(axis.p0.y, p1.y), std::min(axis.p0.z, p1.z)};
+        float cmax[3] = {std::max(axis.p0.x, p1.x), std::max(axis.p0.y, p1.y), std::max(axis.p0.z, p1.z)};
+        int first[3], last[3];
+        for (int a = 0; a < 3; a++) cornerRange(mesh, a, cmin[a] - reach, cmax[a] + reach, lo[a], hi[a], first[a], last[a]);
+        for (int z = first[2]; z < last[2]; z++) {
+            float cz = mesh.origin[2] + z * mesh.cell;
+            float tz0 = 0.0f, tz1 = 1.0f;
+            if (!clipAxis(axis.p0.z, axis.d.z, cz, reach, tz0, tz1)) continue;
+            for (int y = first[1]; y < last[1]; y++) {
+                float cy = mesh.origin[1] + y * mesh.cell;
+                float t0 = tz0, t1 = tz1;
+                if (!clipAxis(axis.p0.y, axis.d.y, cy, reach, t0, t1)) continue;
+                float xa = axis.p0.x + axis.d.x * t0, xb = axis.p0.x + axis.d.x * t1;
+                int row_first, row_last;
+                cornerRange(mesh, 0, std::min(xa, xb) - reach, std::max(xa, xb) + reach, first[0], last[0] - 1,
+                            row_first, row_last);
+                float* row = field.data() + ((size_t)(z - lo[2]) * stride + (y - lo[1])) * stride;
+                for (int x = row_first; x < row_last; x++) {
+                    float& value = row[x - lo[0]];
+                    if (value <= -band) continue;
+                    float d2 = axisDistance2(axis, mesh.origin[0] + x * mesh.cell, cy, cz);
+                    if (d2 >= reach2) continue;
+                    float f = std::sqrt(d2) - r;
+                    if (f < value) value = f;
+                }
+            }
+        }
+    }
+
+    // Marching cubes nas células do bloco
+    const CubeCases& cases = cubeCases();
+    std::vector<int>& edge_vertex = scratch.edge_vertex;
+    edge_vertex.assign((size_t)stride * stride * stride * 3, -1);
+    const size_t corner_offset[8] = {0, 1, (size_t)stride, (size_t)stride + 1, (size_t)stride * stride,
+                                     (size_t)stride * stride + 1, (size_t)stride * stride + stride,
+                                     (size_t)stride * stride + stride + 1};
+    const size_t axis_step[3] = {1, (size_t)stride, (size_t)stride * stride};
+    const uint64_t grid_x = (uint64_t)mesh.cells[0] + 1, grid_y = (uint64_t)mesh.cells[1] + 1;
+    int n[3] = {hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]};
+    for (int z = 0; z < n[2]; z++) {
+        for (int y = 0; y < n[1]; y++) {
+            for (int x = 0; x < n[0]; x++) {
+                size_t base = ((size_t)z * stride + y) * stride + x;
+                int code = 0;
+                for (int c = 0; c < 8; c++) {
+                    if (field[base + corner_offset[c]] < 0.0f) code |= 1 << c;
+                }
+                if (code == 0 || code == 255) continue;
+                for (const CubeLoop& loop : cases.loops[code]) {
+                    uint32_t ids[12];
+                    int count = 0;
+                    for (signed char e : loop.edges) {
+                        int axis = e / 4;
+                        int lower = edgeLowerCorner(e);
+                        int l[3] = {x + (lower & 1), y + ((lower >> 1) & 1), z + ((lower >> 2) & 1)};
+                        size_t corner = ((size_t)l[2] * stride + l[1]) * stride + l[0];
+                        int& vertex = edge_vertex[3 * corner + axis];
+                        if (vertex < 0) {
+                            // Cruzamento interpolado sempre a partir do canto de
+                            // baixo: o mesmo ponto nos dois blocos da face
+                            vertex = (int)(out.positions.size() / 3);
+                            float f0 = field[corner], f1 = field[corner + axis_step[axis]];
+                            float t = f0 / (f0 - f1);
+                            int g[3] = {lo[0] + l[0], lo[1] + l[1], lo[2] + l[2]};
+                            for (int a = 0; a < 3; a++) {
+                                out.positions.push_back(mesh.origin[a] + (g[a] + (a == axis ? t : 0.0f)) * mesh.cell);
+                            }
+                            bool on_face = false;
+                            for (int a = 0; a < 3; a++) {
+                                if (a != axis && (l[a] == 0 || l[a] == n[a])) on_face = true;
+                            }
+                            if (on_face) {
+                                uint64_t key = (((uint64_t)g[2] * grid_y + g[1]) * grid_x + g[0]) * 3 + axis;
+                                out.shared.push_back(std::make_pair(key, (uint32_t)vertex));
+                            }
+                        }
+                        ids[count++] = (uint32_t)vertex;
+                    }
+                    if (!loop.center) {
+                        for (int k = 1; k + 1 < count; k++) {
+                            out.indices.push_back(ids[0]);
+                            out.indices.push_back(ids[k]);
+                            out.indices.push_back(ids[k + 1]);
+                        }
+                        continue;
+                    }
+                    // Vértice no centro do laço, só desta célula
+                    uint32_t center = (uint32_t)(out.positions.size() / 3);
+                    float sum[3] = {0.0f, 0.0f, 0.0f};
+                    for (int k = 0; k < count; k++) {
+                        for (int a = 0; a < 3; a++) sum[a] += out.positions[3 * ids[k] + a];
+                    }
+                    for (int a = 0; a < 3; a++) out.positions.push_back(sum[a] / count);
+                    for (int k = 0; k < count; k++) {
+                        out.indices.push_back(center);
+                        out.indices.push_back(ids[k]);
+                        out.indices.push_back(ids[(k + 1) % count]);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// ============================================================
+// SUPERFÍCIE
+// ============================================================
+
+void buildVesselSurface(const std::vector<float>& capsule_radii, int resolution, float min_radius_cells,
+                        SurfaceMesh& mesh) {
+    auto start = std::chrono::steady_clock::now();
+    mesh = SurfaceMesh();
+    mesh.resolution = std::max(1, resolution);
+    if (lines.empty() || capsule_radii.size() != lines.size()) return;
+
+    // Célula pela caixa dos eixos; os raios engrossados entram na BVH, e a
+    // grade cobre a raiz com uma célula de folga, então os vértices da
+    // borda ficam fora de todas as cápsulas e a malha fecha
+    float bmin[3] = {HUGE_VALF, HUGE_VALF, HUGE_VALF}, bmax[3] = {-HUGE_VALF, -HUGE_VALF, -HUGE_VALF};
+    for (size_t s = 0; s < lines.size(); s++) {
+        const Point3D ends[2] = {points[lines[s].p0], points[lines[s].p1]};
+        for (const Point3D& p : ends) {
+            bmin[0] = std::min(bmin[0], p.x - capsule_radii[s]);
+            bmin[1] = std::min(bmin[1], p.y - capsule_radii[s]);
+            bmin[2] = std::min(bmin[2], p.z - capsule_radii[s]);
+            bmax[0] = std::max(bmax[0], p.x + capsule_radii[s]);
+            bmax[1] = std::max(bmax[1], p.y + capsule_radii[s]);
+            bmax[2] = std::max(bmax[2], p.z + capsule_radii[s]);
+        }
+    }
+    float extent = std::max(bmax[0] - bmin[0], std::max(bmax[1] - bmin[1], bmax[2] - bmin[2]));
+    mesh.cell = (extent > 0.0f) ? extent / mesh.resolution : 1.0f;
+    mesh.min_radius = std::max(0.0f, min_radius_cells) * mesh.cell;
+    std::vector<float> surface_radii(capsule_radii);
+    for (float& r : surface_radii) {
+        if (r < mesh.min_radius) {
+            r = mesh.min_radius;
+            mesh.thickened++;
+        }
+    }
+    SegmentBVH bvh;
+    buildCapsuleBVH(bvh, surface_radii, 0.0f);
+    const BVHNode& root = bvh.nodes[0];
+    size_t blocks_axis[3];
+    for (int a = 0; a < 3; a++) {
+        mesh.cells[a] = (int)std::ceil((root.bmax[a] - root.bmin[a]) / mesh.cell) + 2;
+        mesh.origin[a] = root.bmin[a] - mesh.cell;
+        blocks_axis[a] = (mesh.cells[a] + SURFACE_BLOCK - 1) / SURFACE_BLOCK;
+    }
+    mesh.blocks = blocks_axis[0] * blocks_axis[1] * blocks_axis[2];
+    cubeCases();
+    auto bvh_end = std::chrono::steady_clock::now();
+    mesh.bvh_ms = std::chrono::duration<double, std::milli>(bvh_end - start).count();
+
+    std::vector<BlockSurface> results(mesh.blocks);
+    parallelFor(mesh.blocks, 1, [&](size_t first, size_t last) {
+        BlockScratch scratch;
+        for (size_t b = first; b < last; b++) {
+            marchBlock(mesh, bvh, surface_radii, b, scratch, results[b]);
+        }
+    });
+    auto march_end = std::chrono::steady_clock::now();
+    mesh.march_ms = std::chrono::duration<double, std::milli>(march_end - bvh_end).count();
+
+    // Solda: só os vértices nas faces dos blocos podem repetir; ordenados
+    // pela aresta da grade, cada repetição aponta para a primeira ocorrência
+    std::vector<size_t> offset(mesh.blocks + 1, 0);
+    size_t shared_count = 0;
+    for (size_t b = 0; b < mesh.blocks; b++) {
+        const BlockSurface& r = results[b];
+        offset[b + 1] = offset[b] + r.positions.size() / 3;
+        shared_count += r.shared.size();
+        if (r.capsules > 0) mesh.blocks_near++;
+        if (!r.indices.empty()) mesh.blocks_crossed++;
+        mesh.capsule_tests += r.capsules;
+    }
+    size_t local_vertices = offset[mesh.blocks];
+    std::vector<std::pair<uint64_t, uint64_t> > shared;
+    shared.reserve(shared_count);
+    for (size_t b = 0; b < mesh.blocks; b++) {
+        for (const auto& s : results[b].shared) shared.push_back(std::make_pair(s.first, offset[b] + s.second));
+    }
+    std::sort(shared.begin(), shared.end());
+    std::vector<uint32_t> remap(local_vertices, UINT32_MAX);
+    std::vector<uint64_t> duplicate_of(local_vertices, UINT64_MAX);
+    for (size_t k = 1; k < shared.size(); k++) {
+        if (shared[k].first == shared[k - 1].first) {
+            duplicate_of[shared[k].second] = (duplicate_of[shared[k - 1].second] != UINT64_MAX)
+                                                 ? duplicate_of[shared[k - 1].second]
+                                                 : shared[k - 1].second;
+        }
+    }
+    shared.clear();
+    shared.shrink_to_fit();
+
+    size_t triangles = 0;
+    for (const BlockSurface& r : results) triangles += r.indices.size() / 3;
+    mesh.positions.reserve(3 * local_vertices);
+    mesh.indices.reserve(3 * triangles);
+    uint32_t next_id = 0;
+    for (size_t b = 0; b < mesh.blocks; b++) {
+        BlockSurface& r = results[b];
+        for (size_t v = 0; v < r.positions.size() / 3; v++) {
+            size_t g = offset[b] + v;
+            if (duplicate_of[g] != UINT64_MAX) {
+                remap[g] = remap[duplicate_of[g]];
+                continue;
+            }
+            remap[g] = next_id++;
+            mesh.positions.insert(mesh.positions.end(), &r.positions[3 * v], &r.positions[3 * v] + 3);
+        }
+        for (uint32_t i : r.indices) mesh.indices.push_back(remap[offset[b] + i]);
+        r = BlockSurface();
+    }
+    mesh.weld_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - march_end).count();
+}
+
+// ============================================================
+// CONFERÊNCIA
+// ============================================================
+
+// Volume com sinal do tetraedro (origem, a, b, c)
+static inline double tetVolume(const float* a, const float* b, const float* c) {
+    return (a[0] * ((double)b[1] * c[2] - (double)b[2] * c[1]) - a[1] * ((double)b[0] * c[2] - (double)b[2] * c[0]) +
+            a[2] * ((double)b[0] * c[1] - (double)b[1] * c[0])) / 6.0;
+}
+
+void checkSurface(const SurfaceMesh& mesh, SurfaceCheck& check) {
+    check = SurfaceCheck();
+    size_t n_triangles = mesh.triangleCount();
+    const float* p = mesh.positions.data();
+
+    // Arestas como (menor, maior) com o sentido no bit mais baixo
+    std::vector<uint64_t> half_edges;
+    half_edges.reserve(3 * n_triangles);
+    for (size_t t = 0; t < n_triangles; t++) {
+        const uint32_t* v = &mesh.indices[3 * t];
+        for (int k = 0; k < 3; k++) {
+            uint64_t a = v[k], b = v[(k + 1) % 3];
+            half_edges.push_back(a < b ? ((a << 32 | b) << 1) : ((b << 32 | a) << 1 | 1));
+        }
+        const float* a = p + 3 * v[0];
+        const float* b = p + 3 * v[1];
+        const float* c = p + 3 * v[2];
+        double e1[3] = {(double)b[0] - a[0], (double)b[1] - a[1], (double)b[2] - a[2]};
+        double e2[3] = {(double)c[0] - a[0], (double)c[1] - a[1], (double)c[2] - a[2]};
+        double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        double area2 = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (area2 == 0.0) check.degenerate_triangles++;
+        check.area += 0.5 * area2;
+        check.volume += tetVolume(a, b, c);
+    }
+    std::sort(half_edges.begin(), half_edges.end());
+
+    // Componentes: união dos vértices de cada aresta
+    std::vector<uint32_t> parent(mesh.vertexCount());
+    for (size_t v = 0; v < parent.size(); v++) parent[v] = (uint32_t)v;
+    auto find = [&parent](uint32_t v) {
+        while (parent[v] != v) v = parent[v] = parent[parent[v]];
+        return v;
+    };
+    for (uint64_t h : half_edges) {
+        uint32_t a = find((uint32_t)(h >> 33)), b = find((uint32_t)((h >> 1) & 0xffffffffu));
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+    for (size_t v = 0; v < parent.size(); v++) {
+        if (find((uint32_t)v) == v) check.components++;
+    }
+
+    // Volume de cada componente: negativo numa casca interna (bolha vazia
+    // cercada de vasos, orientada para dentro)
+    std::vector<double> component_volume(parent.size(), 0.0);
+    for (size_t t = 0; t < n_triangles; t++) {
+        const uint32_t* v = &mesh.indices[3 * t];
+        component_volume[find(v[0])] += tetVolume(p + 3 * v[0], p + 3 * v[1], p + 3 * v[2]);
+    }
+    for (size_t v = 0; v < parent.size(); v++) {
+        if (parent[v] == v && component_volume[v] < 0.0) check.cavities++;
+    }
+    for (size_t k = 0; k < half_edges.size(); ) {
+        size_t end = k;
+        while (end < half_edges.size() && (half_edges[end] >> 1) == (half_edges[k] >> 1)) end++;
+        size_t uses = end - k;
+        check.edges++;
+        if (uses == 1) {
+            check.boundary_edges++;
+        } else if (uses > 2) {
+            check.nonmanifold_edges++;
+        } else if ((half_edges[k] & 1) == (half_edges[k + 1] & 1)) {
+            check.misoriented_edges++;
+        }
+        k = end;
+    }
+    check.euler = (long)mesh.vertexCount() - (long)check.edges + (long)n_triangles;
+}
+
+// ============================================================
+// EXPORTAÇÃO
+// ============================================================
+
+// Formatos binários em little-endian, independente da máquina
+static void putUint32(std::vector<unsigned char>& out, uint32_t u) {
+    for (int k = 0; k < 4; k++) out.push_back((unsigned char)(u >> (8 * k)));
+}
+
+static void putFloat(std::vector<unsigned char>& out, float f) {
+    uint32_t u;
+    std::memcpy(&u, &f, sizeof(u));
+    putUint32(out, u);
+}
+
+static bool writeSTL(std::ofstream& file, const SurfaceMesh& mesh) {
+    char header[80] = {0};
+    snprintf(header, sizeof(header), "tp2 superficie dos vasos (%lu triangulos)", (unsigned long)mesh.triangleCount());
+    file.write(header, sizeof(header));
+    std::vector<unsigned char> buffer;
+    putUint32(buffer, (uint32_t)mesh.triangleCount());
+    const float* p = mesh.positions.data();
+    for (size_t t = 0; t < mesh.triangleCount(); t++) {
+        const float* v[3] = {p + 3 * mesh.indices[3 * t], p + 3 * mesh.indices[3 * t + 1], p + 3 * mesh.indices[3 * t + 2]};
+        Point3D e1(v[1][0] - v[0][0], v[1][1] - v[0][1], v[1][2] - v[0][2]);
+        Point3D e2(v[2][0] - v[0][0], v[2][1] - v[0][1], v[2][2] - v[0][2]);
+        Point3D n(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+        float len = n.length();
+        if (len > 0.0f) n = n * (1.0f / len);
+        putFloat(buffer, n.x);
+        putFloat(buffer, n.y);
+        putFloat(buffer, n.z);
+        for (int k = 0; k < 3; k++) {
+            for (int a = 0; a < 3; a++) putFloat(buffer, v[k][a]);
+        }
+        buffer.push_back(0);
+        buffer.push_back(0);
+        if (buffer.size() >= (1 << 20)) {
+            file.write((const char*)buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    file.write((const char*)buffer.data(), buffer.size());
+    return file.good();
+}
+
+static bool writePLY(std::ofstream& file, const SurfaceMesh& mesh) {
+    file << "ply\n";
+    file << "format binary_little_endian 1.0\n";
+    file << "comment tp2 superficie dos vasos\n";
+    file << "element vertex " << mesh.vertexCount() << "\n";
+    file << "property float x\n";
+    file << "property float y\n";
+    file << "property float z\n";
+    file << "element face " << mesh.triangleCount() << "\n";
+    file << "property list uchar int vertex_indices\n";
+    file << "end_header\n";
+    std::vector<unsigned char> buffer;
+    for (size_t k = 0; k < mesh.positions.size(); k++) {
+        putFloat(buffer, mesh.positions[k]);
+        if (buffer.size() >= (1 << 20)) {
+            file.write((const char*)buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    for (size_t t = 0; t < mesh.triangleCount(); t++) {
+        buffer.push_back(3);
+        for (int k = 0; k < 3; k++) putUint32(buffer, mesh.indices[3 * t + k]);
+        if (buffer.size() >= (1 << 20)) {
+            file.write((const char*)buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    file.write((const char*)buffer.data(), buffer.size());
+    return file.good();
+}
+
+bool writeSurfaceMesh(const std::string& filename, const SurfaceMesh& mesh) {
+    std::string ext = filename.size() >= 4 ? filename.substr(filename.size() - 4) : std::string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (ext != ".stl" && ext != ".ply") {
+        std::cerr << "Erro: a superfície é gravada em .stl ou .ply (" << filename << ")" << std::endl;
+        return false;
+    }
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Erro: Não foi possível criar o arquivo " << filename << std::endl;
+        return false;
+    }
+    return (ext == ".stl") ? writeSTL(file, mesh) : writePLY(file, mesh);
+}
@@ -0,0 +1,83 @@
+/*
+ * surface.h
+ * Superfície fechada dos vasos (marching cubes em blocos esparsos) - TP2 (3D)
+ */
+
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Lado dos blocos de células: a unidade de trabalho das threads
+static const int SURFACE_BLOCK = 16;
+
+// Malha soldada: cada vértice é o cruzamento da superfície com uma aresta
+// da grade e aparece uma vez só, compartilhado pelos triângulos vizinhos
+struct SurfaceMesh {
+    std::vector<float> positions;       // x, y, z por vértice
+    std::vector<uint32_t> indices;      // 3 por triângulo, anti-horário visto de fora
+
+    int resolution;                     // Células no maior eixo
+    int cells[3];
+    float origin[3];                    // Vértice (0, 0, 0) da grade
+    float cell;                         // Aresta da célula
+    float min_radius;                   // Raio mínimo aplicado às cápsulas
+    size_t thickened;                   // Segmentos engrossados até min_radius
+
+    size_t blocks;                      // Blocos de SURFACE_BLOCK³ células
+    size_t blocks_near;                 // Blocos com alguma cápsula por perto (BVH)
+    size_t blocks_crossed;              // Blocos que a superfície atravessa
+    size_t capsule_tests;               // Pares bloco × cápsula avaliados
+    double bvh_ms;
+    double march_ms;                    // Campo + marching cubes (paralelo)
+    double weld_ms;                     // Solda dos vértices entre blocos
+
+    SurfaceMesh() : resolution(0), cell(0.0f), min_radius(0.0f), thickened(0), blocks(0), blocks_near(0), blocks_crossed(0), capsule_tests(0),
+                    bvh_ms(0.0), march_ms(0.0), weld_ms(0.0) {
+        cells[0] = cells[1] = cells[2] = 0;
+        origin[0] = origin[1] = origin[2] = 0.0f;
+    }
+
+    size_t vertexCount() const { return positions.size() / 3; }
+    size_t triangleCount() const { return indices.size() / 3; }
+};
+
+// Conferência da malha: cada aresta em exatamente dois triângulos, com
+// sentidos opostos, é uma superfície fechada e orientada
+struct SurfaceCheck {
+    size_t edges;
+    size_t boundary_edges;              // Em um triângulo só (buracos)
+    size_t nonmanifold_edges;           // Em mais de dois
+    size_t misoriented_edges;           // Dois triângulos no mesmo sentido
+    size_t degenerate_triangles;        // Área nula (vértice em cima de um canto)
+    size_t components;                  // Partes desconexas
+    size_t cavities;                    // Delas, cascas internas (volume negativo)
+    long euler;                         // V - A + F (2 por componente sem alças)
+    double area;
+    double volume;                      // Pelo teorema da divergência (> 0 se orientada para fora)
+};
+
+// Campo implícito: distância assinada à união das cápsulas (eixo do
+// segmento, raio capsule_radii[s]), amostrada nos vértices de uma grade
+// de `resolution` células no maior eixo, uma célula além da caixa das
+// cápsulas. A grade é dividida em blocos de SURFACE_BLOCK³ células entre
+// as threads; cada bloco pega da BVH só as cápsulas a até 1,25 célula
+// da sua caixa e pula tudo se não houver nenhuma. O marching cubes usa uma
+// tabela de casos gerada pela mesma regra em todas as faces (cantos
+// internos sempre separados nas faces ambíguas), então células vizinhas
+// cortam a face comum da mesma forma e a malha fecha sem buracos.
+// Vasos mais finos que a grade se partiriam em pedaços soltos: o raio de
+// cada cápsula é levado a pelo menos min_radius_cells células.
+void buildVesselSurface(const std::vector<float>& capsule_radii, int resolution, float min_radius_cells,
+                        SurfaceMesh& mesh);
+
+void checkSurface(const SurfaceMesh& mesh, SurfaceCheck& check);
+
+// STL binário (normais por face) ou PLY binário (vértices compartilhados),
+// pela extensão do arquivo
+bool writeSurfaceMesh(const std::string& filename, const SurfaceMesh& mesh);
+
+#endif // SURFACE_H
@@ -0,0 +1,271 @@
+/*
+ * territories.cpp
+ * Territórios de perfusão dos terminais (jump flooding em voxels) - TP2 (3D)
+ */
+
+#include "territories.h"
+#include "globals.h"
+#include "topology.h"
+#include "point_store.h"
+#include "parallel.h"
+#include "memstats.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+TerritoryMap territory_map;
+int territory_view = TERRITORY_OFF;
+int territory_resolution = 128;
+int territory_slice = -1;
+
+// Linhas da grade (y e z fixos) por bloco do laço paralelo
+static const size_t FLOOD_ROWS = 16;
+
+// ============================================================
+// DISTÂNCIAS
+// ============================================================
+
+static inline float seedDistance2(const float* seeds, int t, float x, float y, float z) {
+    float dx = seeds[3 * t] - x, dy = seeds[3 * t + 1] - y, dz = seeds[3 * t + 2] - z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// Menor distância; no empate, o menor índice (resultado independente da
+// ordem em que os candidatos aparecem)
+static inline bool closer(float d, int t, float best_d, int best) {
+    return d < best_d || (d == best_d && t < best);
+}
+
+float territorySeedDistance2(const TerritoryMap& map, int t, int x, int y, int z) {
+    return seedDistance2(map.seeds.data(), t, (float)x, (float)y, (float)z);
+}
+
+int nearestTerminal(const TerritoryMap& map, int x, int y, int z) {
+    int best = -1;
+    float best_d = HUGE_VALF;
+    for (int t = 0; t < (int)map.terminals.size(); t++) {
+        float d = territorySeedDistance2(map, t, x, y, z);
+        if (closer(d, t, best_d, best)) {
+            best = t;
+            best_d = d;
+        }
+    }
+    return best;
+}
+
+// ============================================================
+// JUMP FLOODING
+// ============================================================
+
+// Uma passada de passo `step` ao longo de `axis`: cada voxel de dst fica
+// com o terminal mais próximo entre o seu e os dos dois vizinhos a `step`
+// voxels em src. As linhas vizinhas em y e z também são contíguas, então
+// os três eixos leem a memória em sequência.
+static void floodPass(const TerritoryMap& map, int step, int axis, const int* src, int* dst) {
+    const int nx = map.dims[0], ny = map.dims[1], nz = map.dims[2];
+    const float* seeds = map.seeds.data();
+    parallelFor((size_t)ny * nz, FLOOD_ROWS, [&](size_t first, size_t last) {
+        for (size_t row = first; row < last; row++) {
+            int y = (int)(row % ny), z = (int)(row / ny);
+            const int* self = src + row * nx;
+            int* out = dst + row * nx;
+
+            // Vizinhos em x: na mesma linha, deslocados; em y e z: o mesmo x
+            // nas linhas a ±step (nulas fora da grade)
+            const int* before = nullptr;
+            const int* after = nullptr;
+            int shift = 0;
+            if (axis == 0) {
+                before = after = self;
+                shift = step;
+            } else {
+                size_t stride = (axis == 1) ? (size_t)nx : (size_t)nx * ny;
+                int coord = (axis == 1) ? y : z, size = (axis == 1) ? ny : nz;
+                if (coord >= step) before = self - step * stride;
+                if (coord + step < size) after = self + step * stride;
+            }
+
+            for (int x = 0; x < nx; x++) {
+                int candidates[2] = {-1, -1};
+                if (before && x >= shift) candidates[0] = before[x - shift];
+                if (after && x + shift < nx) candidates[1] = after[x + shift];
+
+                int best = self[x];
+                float best_d = (best >= 0) ? seedDistance2(seeds, best, (float)x, (float)y, (float)z) : HUGE_VALF;
+                for (int k = 0; k < 2; k++) {
+                    int t = candidates[k];
+                    if (t < 0 || t == best) continue;
+                    float d = seedDistance2(seeds, t, (float)x, (float)y, (float)z);
+                    if (closer(d, t, best_d, best)) {
+                        best = t;
+                        best_d = d;
+                    }
+                }
+                out[x] = best;
+            }
+        }
+    });
+}
+
+void computeTerritories(int resolution, TerritoryMap& map) {
+    auto start = std::chrono::steady_clock::now();
+    map = TerritoryMap();
+    map.resolution = std::max(1, resolution);
+    if (points.empty() || topology.terminals.empty() || topology.distal_node.size() != lines.size()) {
+        map.valid = true;
+        return;
+    }
+
+    // Grade de voxels cúbicos sobre a caixa envolvente
+    float bmin[3], bmax[3];
+    pointBounds(points, bmin, bmax);
+    float extent = std::max(bmax[0] - bmin[0], std::max(bmax[1] - bmin[1], bmax[2] - bmin[2]));
+    map.voxel = (extent > 0.0f) ? extent / map.resolution : 1.0f;
+    for (int a = 0; a < 3; a++) {
+        int cells = (int)std::ceil((bmax[a] - bmin[a]) / map.voxel);
+        map.dims[a] = std::max(1, std::min(map.resolution, cells));
+        map.origin[a] = bmin[a] + 0.5f * map.voxel;
+    }
+
+    // Sementes: o ponto distal de cada terminal, em coordenadas de voxel; um
+    // voxel com mais de uma semente fica com a mais próxima do centro
+    size_t n_terminals = topology.terminals.size();
+    map.terminals = topology.terminals;
+    map.seeds.resize(3 * n_terminals);
+    map.labels.assign(map.voxelCount(), -1);
+    for (size_t t = 0; t < n_terminals; t++) {
+        const Point3D& p = points[topology.distal_node[map.terminals[t]]];
+        float c[3] = {p.x, p.y, p.z};
+        int v[3];
+        for (int a = 0; a < 3; a++) {
+            map.seeds[3 * t + a] = (c[a] - map.origin[a]) / map.voxel;
+            v[a] = std::max(0, std::min(map.dims[a] - 1, (int)std::lround(map.seeds[3 * t + a])));
+        }
+        int& label = map.labels[map.index(v[0], v[1], v[2])];
+        float d = territorySeedDistance2(map, (int)t, v[0], v[1], v[2]);
+        if (label < 0 || closer(d, (int)t, territorySeedDistance2(map, label, v[0], v[1], v[2]), label)) {
+            label = (int)t;
+        }
+    }
+    auto seeded = std::chrono::steady_clock::now();
+    map.seed_ms = std::chrono::duration<double, std::milli>(seeded - start).count();
+
+    // Passos N/2, N/4, ..., 1 e mais um de passo 1 (JFA+1), cada um com
+    // uma passada por eixo
+    int largest = std::max(map.dims[0], std::max(map.dims[1], map.dims[2]));
+    int step = 1;
+    while (2 * step < largest) step *= 2;
+    std::vector<int> buffer(map.voxelCount());
+    int* src = map.labels.data();
+    int* dst = buffer.data();
+    for (bool extra = false; ; ) {
+        for (int axis = 0; axis < 3; axis++) {
+            floodPass(map, step, axis, src, dst);
+            std::swap(src, dst);
+        }
+        map.passes++;
+        if (step > 1) {
+            step /= 2;
+        } else if (!extra) {
+            extra = true;
+        } else {
+            break;
+        }
+    }
+    if (src != map.labels.data()) map.labels.swap(buffer);
+
+    map.voxel_counts.assign(n_terminals, 0);
+    for (int t : map.labels) {
+        if (t >= 0) map.voxel_counts[t]++;
+    }
+    map.valid = true;
+    map.flood_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - seeded).count();
+}
+
+void invalidateTerritories() {
+    territory_map.valid = false;
+}
+
+const char* territoryViewName(int view) {
+    switch (view) {
+        case TERRITORY_SLICE:    return "fatia";
+        case TERRITORY_BOUNDARY: return "fronteiras";
+        default:                 return "desligados";
+    }
+}
+
+// ============================================================
+// CORES
+// ============================================================
+
+void getTerritoryColor(int territory, float& r, float& g, float& b) {
+    if (territory < 0) {
+        r = g = b = 0.55f;
+        return;
+    }
+    // Matizes pela razão áurea: territórios de índices próximos (vizinhos
+    // na pré-ordem, em geral vizinhos no espaço) ficam com cores distantes
+    float h = std::fmod((territory % 255) * 0.618034f, 1.0f) * 6.0f;
+    float s = 0.65f, v = 0.95f;
+    int sector = (int)h;
+    float f = h - sector;
+    float p = v * (1.0f - s), q = v * (1.0f - s * f), u = v * (1.0f - s * (1.0f - f));
+    switch (sector) {
+        case 0:  r = v; g = u; b = p; break;
+        case 1:  r = q; g = v; b = p; break;
+        case 2:  r = p; g = v; b = u; break;
+        case 3:  r = p; g = q; b = v; break;
+        case 4:  r = u; g = p; b = v; break;
+        default: r = v; g = p; b = q; break;
+    }
+}
+
+// ============================================================
+// EXPORTAÇÃO
+// ============================================================
+
+bool writeTerritoryVolume(const std::string& filename, const TerritoryMap& map) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Erro: Não foi possível criar o arquivo " << filename << std::endl;
+        return false;
+    }
+
+    // Rótulo de cada voxel = índice do segmento terminal no arquivo lido
+    const std::vector<int>& source = topology.source_segment;
+    file << "# vtk DataFile Version 3.0\n";
+    file << "territorios de perfusao (terminal mais proximo)\n";
+    file << "BINARY\n";
+    file << "DATASET STRUCTURED_POINTS\n";
+    file << "DIMENSIONS " << map.dims[0] << " " << map.dims[1] << " " << map.dims[2] << "\n";
+    file << "ORIGIN " << map.origin[0] << " " << map.origin[1] << " " << map.origin[2] << "\n";
+    file << "SPACING " << map.voxel << " " << map.voxel << " " << map.voxel << "\n";
+    file << "POINT_DATA " << map.voxelCount() << "\n";
+    file << "SCALARS terminal int 1\n";
+    file << "LOOKUP_TABLE default\n";
+
+    // VTK legado binário é big-endian; escrito uma linha de voxels por vez
+    std::vector<unsigned char> row(4 * (size_t)map.dims[0]);
+    for (size_t first = 0; first < map.voxelCount(); first += map.dims[0]) {
+        for (int x = 0; x < map.dims[0]; x++) {
+            int t = map.labels[first + x];
+            int label = (t < 0) ? -1 : (source.size() == lines.size() ? source[map.terminals[t]] : map.terminals[t]);
+            uint32_t u = (uint32_t)label;
+            row[4 * x] = (unsigned char)(u >> 24);
+            row[4 * x + 1] = (unsigned char)(u >> 16);
+            row[4 * x + 2] = (unsigned char)(u >> 8);
+            row[4 * x + 3] = (unsigned char)u;
+        }
+        file.write((const char*)row.data(), row.size());
+    }
+    file << "\n";
+    return file.good();
+}
+
+void appendTerritoryMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Caches", "territory_map.labels", territory_map.labels);
+    addMemoryEntry(entries, "Caches", "territory_map.seeds", territory_map.seeds);
+    addMemoryEntry(entries, "Caches", "territory_map.voxel_counts", territory_map.voxel_counts);
+}
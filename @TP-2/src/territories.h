@@ -0,0 +1,85 @@
+/*
+ * territories.h
+ * Territórios de perfusão dos terminais (jump flooding em voxels) - TP2 (3D)
+ */
+
+#ifndef TERRITORIES_H
+#define TERRITORIES_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+struct MemoryEntry;
+
+// Exibição dos territórios (tecla F)
+enum TerritoryView {
+    TERRITORY_OFF = 0,
+    TERRITORY_SLICE,        // Fatia z da grade, colorida por território
+    TERRITORY_BOUNDARY,     // Nuvem de pontos nas fronteiras entre territórios
+    TERRITORY_VIEWS
+};
+
+// Território de cada voxel = terminal mais próximo (ponto distal, por onde
+// o sangue sai para o tecido). Grade de voxels cúbicos sobre a caixa
+// envolvente da árvore, com `resolution` voxels no maior eixo.
+struct TerritoryMap {
+    bool valid;
+    int resolution;
+    int dims[3];
+    float origin[3];                  // Centro do voxel (0, 0, 0)
+    float voxel;                      // Aresta do voxel (unidades das coordenadas)
+    std::vector<int> terminals;       // Segmento terminal de cada território
+    std::vector<float> seeds;         // Ponto distal de cada terminal, em voxels (x, y, z)
+    std::vector<int> labels;          // Território de cada voxel (x varia mais rápido); -1 sem terminais
+    std::vector<uint32_t> voxel_counts;  // Voxels por território
+    int passes;
+    double seed_ms;
+    double flood_ms;
+
+    TerritoryMap() : valid(false), resolution(0), voxel(0.0f), passes(0), seed_ms(0.0), flood_ms(0.0) {
+        dims[0] = dims[1] = dims[2] = 0;
+        origin[0] = origin[1] = origin[2] = 0.0f;
+    }
+
+    size_t voxelCount() const { return (size_t)dims[0] * dims[1] * dims[2]; }
+    size_t index(int x, int y, int z) const { return ((size_t)z * dims[1] + y) * dims[0] + x; }
+};
+
+extern TerritoryMap territory_map;
+extern int territory_view;        // TerritoryView (tecla F)
+extern int territory_resolution;  // Voxels no maior eixo na janela
+extern int territory_slice;       // Fatia z exibida (teclas + e -)
+
+// Jump flooding (Rong e Tan, 2006): cada voxel guarda o terminal mais
+// próximo entre os que já conhece e, a cada passo k (metade da grade, depois
+// a metade disso, até 1), olha os vizinhos a k voxels. Na forma separável
+// usada aqui, cada passo são três passadas (x, y, z) com dois vizinhos cada,
+// em vez de uma com 26 vizinhos: 6 distâncias por voxel em vez de 26. São log2(N) + 1
+// passos (o último repete k = 1), cada passada dividida em blocos de linhas
+// entre as threads, com dois buffers. Erros só onde duas sementes caem no
+// mesmo voxel (a de menor distância ao centro fica; a outra não se propaga).
+void computeTerritories(int resolution, TerritoryMap& map);
+
+// Chamada quando os pontos mudam (os raios não entram no território)
+void invalidateTerritories();
+
+const char* territoryViewName(int view);
+
+// Referência por força bruta (conferência no --territories)
+int nearestTerminal(const TerritoryMap& map, int x, int y, int z);
+
+// Distância ao quadrado, em voxels, do centro do voxel ao terminal t
+float territorySeedDistance2(const TerritoryMap& map, int t, int x, int y, int z);
+
+// Cor de um território (paleta de 255 matizes, a mesma das cores dos terminais)
+void getTerritoryColor(int territory, float& r, float& g, float& b);
+
+// Volume de rótulos em VTK legado (STRUCTURED_POINTS, binário)
+bool writeTerritoryVolume(const std::string& filename, const TerritoryMap& map);
+
+// Grade de rótulos e sementes (--memstats)
+void appendTerritoryMemory(std::vector<MemoryEntry>& entries);
+
+#endif // TERRITORIES_H
@@ -0,0 +1,261 @@
+/*
+ * topology.cpp
+ * Construção da topologia CSR da árvore - TP2 (3D)
+ */
+
+#include "topology.h"
+#include "globals.h"
+#include <cmath>
+#include <algorithm>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+TreeTopology topology;
+
+// ============================================================
+// CONSTRUÇÃO
+// ============================================================
+
+static void buildNodeAdjacency() {
+    size_t npoints = points.size();
+    size_t nlines = lines.size();
+
+    // Contagem de grau, soma de prefixos e preenchimento
+    topology.node_offsets.assign(npoints + 1, 0);
+    for (size_t s = 0; s < nlines; s++) {
+        topology.node_offsets[lines[s].p0 + 1]++;
+        topology.node_offsets[lines[s].p1 + 1]++;
+    }
+    for (size_t v = 0; v < npoints; v++) {
+        topology.node_offsets[v + 1] += topology.node_offsets[v];
+    }
+
+    std::vector<int> cursor(topology.node_offsets.begin(), topology.node_offsets.end() - 1);
+    topology.node_segments.resize(2 * nlines);
+    for (size_t s = 0; s < nlines; s++) {
+        topology.node_segments[cursor[lines[s].p0]++] = (int)s;
+        topology.node_segments[cursor[lines[s].p1]++] = (int)s;
+    }
+}
+
+// Raiz: ponto de grau 1 que nunca aparece como destino (p1) de um segmento.
+// Nos arquivos do CCO é o ponto 0; sem orientação no arquivo, cai no
+// primeiro ponto de grau 1.
+static int findRootNode() {
+    size_t npoints = points.size();
+    std::vector<unsigned char> is_target(npoints, 0);
+    for (const Line3D& L : lines) {
+        is_target[L.p1] = 1;
+    }
+
+    int first_leaf = -1;
+    for (size_t v = 0; v < npoints; v++) {
+        if (topology.nodeDegree((int)v) != 1) continue;
+        if (!is_target[v]) return (int)v;
+        if (first_leaf < 0) first_leaf = (int)v;
+    }
+    return first_leaf;
+}
+
+// Busca em largura a partir de um ponto: cada segmento ainda não orientado
+// que toca o ponto da vez sai dele (proximal) em direção ao outro (distal)
+static void orientFrom(int start_node, std::vector<int>& queue) {
+    queue.clear();
+    queue.push_back(start_node);
+    for (size_t head = 0; head < queue.size(); head++) {
+        int v = queue[head];
+        for (int k = topology.node_offsets[v]; k < topology.node_offsets[v + 1]; k++) {
+            int s = topology.node_segments[k];
+            if (topology.proximal_node[s] >= 0) continue;
+            int other = (lines[s].p0 == (uint32_t)v) ? lines[s].p1 : lines[s].p0;
+            topology.proximal_node[s] = v;
+            topology.distal_node[s] = other;
+            queue.push_back(other);
+        }
+    }
+}
+
+void buildTopology() {
+    topology.clear();
+    size_t nlines = lines.size();
+    if (nlines == 0 || points.empty()) return;
+
+    for (const Line3D& L : lines) {
+        if (L.p0 >= points.size() || L.p1 >= points.size()) {
+            return;  // índices inválidos: sem topologia
+        }
+    }
+
+    buildNodeAdjacency();
+
+    // Orientação por BFS a partir da raiz (e de cada componente solta)
+    topology.proximal_node.assign(nlines, -1);
+    topology.distal_node.assign(nlines, -1);
+    topology.root_node = findRootNode();
+    std::vector<int> queue;
+    if (topology.root_node >= 0) {
+        orientFrom(topology.root_node, queue);
+    }
+    for (size_t s = 0; s < nlines; s++) {
+        if (topology.proximal_node[s] < 0) {
+            orientFrom(lines[s].p0, queue);
+        }
+    }
+
+    // Pai: o segmento cujo ponto distal é o ponto proximal deste
+    std::vector<int> arriving(points.size(), -1);
+    for (size_t s = 0; s < nlines; s++) {
+        arriving[topology.distal_node[s]] = (int)s;
+    }
+    topology.parent.resize(nlines);
+    for (size_t s = 0; s < nlines; s++) {
+        topology.parent[s] = arriving[topology.proximal_node[s]];
+    }
+
+    // Filhos em CSR (mesma contagem + prefixo + preenchimento)
+    topology.child_offsets.assign(nlines + 1, 0);
+    for (size_t s = 0; s < nlines; s++) {
+        if (topology.parent[s] >= 0) topology.child_offsets[topology.parent[s] + 1]++;
+    }
+    for (size_t s = 0; s < nlines; s++) {
+        topology.child_offsets[s + 1] += topology.child_offsets[s];
+    }
+    std::vector<int> cursor(topology.child_offsets.begin(), topology.child_offsets.end() - 1);
+    topology.children.resize(topology.child_offsets[nlines]);
+    for (size_t s = 0; s < nlines; s++) {
+        if (topology.parent[s] >= 0) topology.children[cursor[topology.parent[s]]++] = (int)s;
+    }
+
+    // Raiz, terminais e bifurcações
+    if (topology.root_node >= 0 && topology.nodeDegree(topology.root_node) > 0) {
+        topology.root_segment = topology.node_segments[topology.node_offsets[topology.root_node]];
+    }
+    for (size_t s = 0; s < nlines; s++) {
+        int c = topology.childCount((int)s);
+        if (c == 0) topology.terminals.push_back((int)s);
+        if (c >= 2) topology.bifurcations++;
+    }
+}
+
+// ============================================================
+// LAYOUT EM PROFUNDIDADE
+// ============================================================
+
+// Pré-ordem a partir das raízes (pilha explícita: árvores profundas)
+static void depthFirstOrder(std::vector<int>& order) {
+    size_t nlines = lines.size();
+    order.clear();
+    order.reserve(nlines);
+
+    std::vector<int> stack;
+    for (size_t r = 0; r < nlines; r++) {
+        if (topology.parent[r] >= 0) continue;
+        stack.push_back((int)r);
+        while (!stack.empty()) {
+            int s = stack.back();
+            stack.pop_back();
+            order.push_back(s);
+            // Filhos empilhados ao contrário para manter a ordem do arquivo
+            for (const int* c = topology.childrenEnd(s); c != topology.childrenBegin(s); ) {
+                stack.push_back(*--c);
+            }
+        }
+    }
+}
+
+static void computeSubtreeRanges() {
+    size_t nlines = lines.size();
+
+    // Em pré-ordem, o fim da subárvore de s é o fim da subárvore do último
+    // filho; percorrendo de trás para frente os filhos já estão prontos
+    topology.subtree_end.resize(nlines);
+    for (size_t k = nlines; k-- > 0; ) {
+        int s = (int)k;
+        int end = s + 1;
+        for (const int* c = topology.childrenBegin(s); c != topology.childrenEnd(s); ++c) {
+            end = std::max(end, topology.subtree_end[*c]);
+        }
+        topology.subtree_end[s] = end;
+    }
+
+    topology.length_prefix.assign(nlines + 1, 0.0);
+    topology.terminal_prefix.assign(nlines + 1, 0);
+    for (size_t s = 0; s < nlines; s++) {
+        float length = (points[lines[s].p1] - points[lines[s].p0]).length();
+        topology.length_prefix[s + 1] = topology.length_prefix[s] + length;
+        topology.terminal_prefix[s + 1] = topology.terminal_prefix[s] + (topology.isTerminal((int)s) ? 1 : 0);
+    }
+    updateTopologyRadii();
+}
+
+void updateTopologyRadii() {
+    size_t nlines = lines.size();
+    topology.volume_prefix.assign(nlines + 1, 0.0);
+    for (size_t s = 0; s < nlines; s++) {
+        double length = topology.length_prefix[s + 1] - topology.length_prefix[s];
+        double r = radii[s];
+        topology.volume_prefix[s + 1] = topology.volume_prefix[s] + M_PI * r * r * length;
+    }
+}
+
+// Busca em largura a partir das raízes: os segmentos saem agrupados por
+// geração, do tronco para os terminais (a ordem em que a árvore cresce)
+static void computeGenerations() {
+    size_t nlines = lines.size();
+    topology.generation.assign(nlines, 0);
+    topology.generation_order.clear();
+    topology.generation_order.reserve(nlines);
+    for (size_t s = 0; s < nlines; s++) {
+        if (topology.parent[s] < 0) topology.generation_order.push_back((int)s);
+    }
+    for (size_t head = 0; head < topology.generation_order.size(); head++) {
+        int s = topology.generation_order[head];
+        for (const int* c = topology.childrenBegin(s); c != topology.childrenEnd(s); ++c) {
+            topology.generation[*c] = topology.generation[s] + 1;
+            topology.generation_order.push_back(*c);
+        }
+    }
+
+    topology.generation_rank.resize(nlines);
+    topology.max_generation = 0;
+    for (size_t k = 0; k < topology.generation_order.size(); k++) {
+        int s = topology.generation_order[k];
+        topology.generation_rank[s] = (int)k;
+        topology.max_generation = std::max(topology.max_generation, topology.generation[s]);
+    }
+}
+
+void reorderSegmentsDepthFirst() {
+    if (topology.parent.empty()) return;
+
+    std::vector<int> order;
+    depthFirstOrder(order);
+
+    // Só permuta (e refaz a topologia) se o arquivo não estiver já em pré-ordem
+    bool identity = true;
+    for (size_t k = 0; k < order.size(); k++) {
+        if (order[k] != (int)k) {
+            identity = false;
+            break;
+        }
+    }
+    if (!identity) {
+        std::vector<Line3D> new_lines;
+        std::vector<float> new_radii;
+        new_lines.reserve(lines.size());
+        new_radii.reserve(lines.size());
+        for (int s : order) {
+            new_lines.push_back(lines[s]);
+            new_radii.push_back(radii[s]);
+        }
+        lines.swap(new_lines);
+        radii.swap(new_radii);
+        buildTopology();
+    }
+    topology.source_segment.swap(order);
+
+    computeSubtreeRanges();
+    computeGenerations();
+}
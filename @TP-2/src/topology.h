@@ -0,0 +1,106 @@
+/*
+ * topology.h
+ * Topologia da árvore em formato CSR (pais, filhos, raiz, terminais) - TP2 (3D)
+ */
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <vector>
+
+// Adjacências em CSR (compressed sparse row): os vizinhos de v ficam em
+// items[offsets[v] .. offsets[v+1]). Construídas uma vez por carga, em tempo
+// linear; cada consulta estrutural custa O(grau).
+struct TreeTopology {
+    // Ponto -> segmentos incidentes
+    std::vector<int> node_offsets;
+    std::vector<int> node_segments;
+
+    // Orientação de cada segmento a partir da raiz
+    std::vector<int> proximal_node;  // Ponto mais próximo da raiz
+    std::vector<int> distal_node;    // Ponto mais distante da raiz
+    std::vector<int> parent;         // Segmento pai (-1 nas raízes)
+
+    // Segmento -> filhos
+    std::vector<int> child_offsets;
+    std::vector<int> children;
+
+    // Layout em profundidade (ver reorderSegmentsDepthFirst): a subárvore de s
+    // ocupa o intervalo contíguo [s, subtree_end[s])
+    std::vector<int> subtree_end;
+    std::vector<int> source_segment;  // Índice do segmento no arquivo lido
+
+    // Somas de prefixo na ordem dos segmentos: estatísticas de qualquer
+    // intervalo (e portanto de qualquer subárvore) em O(1)
+    std::vector<double> length_prefix;
+    std::vector<double> volume_prefix;
+    std::vector<int> terminal_prefix;
+
+    // Ordem de crescimento: geração = profundidade (em segmentos) a partir da
+    // raiz; generation_order lista os segmentos por geração (busca em largura)
+    std::vector<int> generation;
+    std::vector<int> generation_order;
+    std::vector<int> generation_rank;  // Posição de cada segmento em generation_order
+    int max_generation;
+
+    int root_node;                   // Ponto de entrada da árvore (-1 se vazia)
+    int root_segment;                // Segmento que sai do ponto raiz
+    std::vector<int> terminals;      // Segmentos sem filhos
+    int bifurcations;                // Segmentos com 2 ou mais filhos
+
+    TreeTopology() : max_generation(0), root_node(-1), root_segment(-1), bifurcations(0) {}
+
+    int childCount(int s) const { return child_offsets[s + 1] - child_offsets[s]; }
+    const int* childrenBegin(int s) const { return children.data() + child_offsets[s]; }
+    const int* childrenEnd(int s) const { return children.data() + child_offsets[s + 1]; }
+
+    int nodeDegree(int v) const { return node_offsets[v + 1] - node_offsets[v]; }
+
+    bool isTerminal(int s) const { return childCount(s) == 0; }
+
+    bool hasSubtreeLayout() const { return !subtree_end.empty(); }
+    int subtreeSize(int s) const { return subtree_end[s] - s; }
+    double subtreeLength(int s) const { return length_prefix[subtree_end[s]] - length_prefix[s]; }
+    double subtreeVolume(int s) const { return volume_prefix[subtree_end[s]] - volume_prefix[s]; }
+    int subtreeTerminals(int s) const { return terminal_prefix[subtree_end[s]] - terminal_prefix[s]; }
+
+    void clear() {
+        node_offsets.clear();
+        node_segments.clear();
+        proximal_node.clear();
+        distal_node.clear();
+        parent.clear();
+        child_offsets.clear();
+        children.clear();
+        subtree_end.clear();
+        source_segment.clear();
+        length_prefix.clear();
+        volume_prefix.clear();
+        terminal_prefix.clear();
+        generation.clear();
+        generation_order.clear();
+        generation_rank.clear();
+        max_generation = 0;
+        terminals.clear();
+        root_node = -1;
+        root_segment = -1;
+        bifurcations = 0;
+    }
+};
+
+extern TreeTopology topology;
+
+// Monta a topologia a partir de points/lines (chamada por readVTKFile3D)
+void buildTopology();
+
+// Permuta lines/radii para a pré-ordem da busca em profundidade a partir da
+// raiz, refaz a topologia e calcula subtree_end, as somas de prefixo e a
+// ordem por geração.
+// Deve ser chamada antes de qualquer estrutura indexada por segmento.
+void reorderSegmentsDepthFirst();
+
+// Refaz só o que depende dos raios (volume_prefix) quando a topologia é a
+// mesma da carga anterior (ver loadCurrentGrowthFile)
+void updateTopologyRadii();
+
+#endif // TOPOLOGY_H
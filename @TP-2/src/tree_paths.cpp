@@ -0,0 +1,233 @@
+/*
+ * tree_paths.cpp
+ * Índice de caminhos na árvore (ancestral comum em O(1)) - TP2 (3D)
+ */
+
+#include "tree_paths.h"
+#include "globals.h"
+#include "topology.h"
+#include "hemodynamics.h"
+#include "memstats.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+PathIndex path_index;
+
+// Segmentos por bloco do RMQ: um bit de máscara por posição
+static const int RMQ_BLOCK = 32;
+static const int RMQ_SHIFT = 5;
+
+// ============================================================
+// BITS
+// ============================================================
+
+static inline int lowestSetBit(uint32_t x) {
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#else
+    int b = 0;
+    while (!(x & 1u)) { x >>= 1; b++; }
+    return b;
+#endif
+}
+
+static inline int floorLog2(uint32_t x) {
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(x);
+#else
+    int b = -1;
+    while (x) { x >>= 1; b++; }
+    return b;
+#endif
+}
+
+// ============================================================
+// MÍNIMO POR INTERVALO (RMQ) SOBRE A GERAÇÃO
+// ============================================================
+
+static inline int shallower(int a, int b) {
+    return topology.generation[b] < topology.generation[a] ? b : a;
+}
+
+// Dentro de um bloco: a máscara de r guarda a pilha de mínimos de
+// [início do bloco, r]; o bit mais baixo a partir de l é o mínimo de [l, r]
+static inline int blockMin(int l, int r) {
+    int base = l & ~(RMQ_BLOCK - 1);
+    uint32_t mask = path_index.block_masks[r] & (~0u << (l - base));
+    return base + lowestSetBit(mask);
+}
+
+// Blocos inteiros [bl, br]: duas consultas sobrepostas na tabela esparsa
+static inline int tableMin(int bl, int br) {
+    int blocks = ((int)lines.size() + RMQ_BLOCK - 1) >> RMQ_SHIFT;
+    int k = floorLog2((uint32_t)(br - bl + 1));
+    const int* level = path_index.block_table.data() + (size_t)k * blocks;
+    return shallower(level[bl], level[br - (1 << k) + 1]);
+}
+
+static int rangeMin(int l, int r) {
+    int bl = l >> RMQ_SHIFT, br = r >> RMQ_SHIFT;
+    if (bl == br) return blockMin(l, r);
+    int best = shallower(blockMin(l, (bl << RMQ_SHIFT) + RMQ_BLOCK - 1), blockMin(br << RMQ_SHIFT, r));
+    if (br - bl > 1) best = shallower(best, tableMin(bl + 1, br - 1));
+    return best;
+}
+
+static void buildRangeMin() {
+    int n = (int)lines.size();
+    int blocks = (n + RMQ_BLOCK - 1) >> RMQ_SHIFT;
+
+    // Pilha de mínimos por bloco: ao entrar i saem as posições de geração
+    // maior ou igual; a máscara de i é a pilha resultante
+    path_index.block_masks.assign(n, 0u);
+    int stack[RMQ_BLOCK];
+    for (int b = 0; b < blocks; b++) {
+        int base = b << RMQ_SHIFT;
+        int end = std::min(n, base + RMQ_BLOCK);
+        int top = 0;
+        uint32_t mask = 0u;
+        for (int i = base; i < end; i++) {
+            while (top > 0 && topology.generation[stack[top - 1]] >= topology.generation[i]) {
+                mask &= ~(1u << (stack[--top] - base));
+            }
+            stack[top++] = i;
+            mask |= 1u << (i - base);
+            path_index.block_masks[i] = mask;
+        }
+    }
+
+    // Tabela esparsa sobre o mínimo de cada bloco
+    path_index.levels = floorLog2((uint32_t)blocks) + 1;
+    path_index.block_table.assign((size_t)path_index.levels * blocks, 0);
+    for (int b = 0; b < blocks; b++) {
+        int base = b << RMQ_SHIFT;
+        path_index.block_table[b] = blockMin(base, std::min(n, base + RMQ_BLOCK) - 1);
+    }
+    for (int k = 1; k < path_index.levels; k++) {
+        const int* prev = path_index.block_table.data() + (size_t)(k - 1) * blocks;
+        int* level = path_index.block_table.data() + (size_t)k * blocks;
+        int half = 1 << (k - 1);
+        for (int b = 0; b + (1 << k) <= blocks; b++) {
+            level[b] = shallower(prev[b], prev[b + half]);
+        }
+    }
+}
+
+// ============================================================
+// CONSTRUÇÃO
+// ============================================================
+
+static double segmentLength(int s) {
+    return topology.length_prefix[s + 1] - topology.length_prefix[s];
+}
+
+void buildPathIndex() {
+    auto start = std::chrono::steady_clock::now();
+    path_index = PathIndex();
+    int n = (int)lines.size();
+    if (n == 0 || !topology.hasSubtreeLayout() || topology.generation.size() != (size_t)n) return;
+
+    // Acumulados da raiz: na pré-ordem o pai vem antes do filho
+    path_index.root_length.resize(n);
+    path_index.root_bifurcations.resize(n);
+    for (int s = 0; s < n; s++) {
+        int parent = topology.parent[s];
+        double length = segmentLength(s);
+        int bifurcation = topology.childCount(s) >= 2 ? 1 : 0;
+        path_index.root_length[s] = (parent >= 0 ? path_index.root_length[parent] : 0.0) + length;
+        path_index.root_bifurcations[s] = (parent >= 0 ? path_index.root_bifurcations[parent] : 0) + bifurcation;
+    }
+    updatePathIndexRadii();
+    buildRangeMin();
+
+    path_index.valid = true;
+    path_index.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void updatePathIndexRadii() {
+    int n = (int)lines.size();
+    if (topology.parent.size() != (size_t)n || topology.length_prefix.size() != (size_t)n + 1) return;
+    path_index.root_resistance.resize(n);
+    for (int s = 0; s < n; s++) {
+        int parent = topology.parent[s];
+        path_index.root_resistance[s] = (parent >= 0 ? path_index.root_resistance[parent] : 0.0) +
+                                        poiseuilleResistance(segmentLength(s), radii[s]);
+    }
+}
+
+// ============================================================
+// CONSULTAS
+// ============================================================
+
+int lowestCommonAncestor(int a, int b) {
+    if (!path_index.valid) return -1;
+    if (a == b) return a;
+    int lo = std::min(a, b), hi = std::max(a, b);
+    if (hi < topology.subtree_end[lo]) return lo;  // lo é ancestral de hi
+
+    // Os segmentos mais rasos de (lo, hi] são filhos do LCA (ou raízes, se
+    // lo e hi estão em árvores diferentes)
+    return topology.parent[rangeMin(lo + 1, hi)];
+}
+
+// Valor acumulado da raiz até o pai de s (0 nas raízes)
+template <typename T>
+static inline T aboveSegment(const std::vector<T>& root_values, int s) {
+    int parent = topology.parent[s];
+    return parent >= 0 ? root_values[parent] : T(0);
+}
+
+TreePath queryPath(int a, int b) {
+    TreePath path;
+    int w = lowestCommonAncestor(a, b);
+    if (w < 0) return path;
+    path.lca = w;
+
+    const PathIndex& px = path_index;
+    const std::vector<int>& gen = topology.generation;
+    if (w == a || w == b) {
+        // Cadeia do ancestral w até o descendente d, com os dois extremos
+        int d = (w == a) ? b : a;
+        path.segments = gen[d] - gen[w] + 1;
+        path.length = px.root_length[d] - aboveSegment(px.root_length, w);
+        path.resistance = px.root_resistance[d] - aboveSegment(px.root_resistance, w);
+        // Pontos internos: os distais de w até o pai de d
+        path.bifurcations = (d != w) ? aboveSegment(px.root_bifurcations, d) - aboveSegment(px.root_bifurcations, w) : 0;
+    } else {
+        // Dois ramos abaixo de w que se encontram no ponto distal de w
+        path.segments = gen[a] + gen[b] - 2 * gen[w];
+        path.length = px.root_length[a] + px.root_length[b] - 2.0 * px.root_length[w];
+        path.resistance = px.root_resistance[a] + px.root_resistance[b] - 2.0 * px.root_resistance[w];
+        path.bifurcations = aboveSegment(px.root_bifurcations, a) + aboveSegment(px.root_bifurcations, b) -
+                            2 * px.root_bifurcations[w] + 1;
+    }
+    // Raio nulo acima do caminho deixa a diferença indefinida (∞ - ∞); a
+    // vazão por ele é nula de qualquer forma
+    if (std::isnan(path.resistance)) path.resistance = HUGE_VAL;
+    return path;
+}
+
+void collectPathSegments(int a, int b, std::vector<int>& out) {
+    out.clear();
+    int w = lowestCommonAncestor(a, b);
+    if (w < 0) return;
+
+    for (int s = a; s != w; s = topology.parent[s]) {
+        out.push_back(s);
+    }
+    if (w == a || w == b) out.push_back(w);
+    size_t junction = out.size();
+    for (int s = b; s != w; s = topology.parent[s]) {
+        out.push_back(s);
+    }
+    std::reverse(out.begin() + junction, out.end());
+}
+
+void appendPathIndexMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Derivados", "path_index.root_length", path_index.root_length);
+    addMemoryEntry(entries, "Derivados", "path_index.root_resistance", path_index.root_resistance);
+    addMemoryEntry(entries, "Derivados", "path_index.root_bifurcations", path_index.root_bifurcations);
+    addMemoryEntry(entries, "Derivados", "path_index.block_masks", path_index.block_masks);
+    addMemoryEntry(entries, "Derivados", "path_index.block_table", path_index.block_table);
+}
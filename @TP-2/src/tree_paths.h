@@ -0,0 +1,71 @@
+/*
+ * tree_paths.h
+ * Índice de caminhos na árvore (ancestral comum em O(1)) - TP2 (3D)
+ */
+
+#ifndef TREE_PATHS_H
+#define TREE_PATHS_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct MemoryEntry;
+
+// Consultas de caminho em O(1) sobre o layout em profundidade. O menor
+// ancestral comum (LCA) de a < b é o pai do segmento de menor geração em
+// (a, b] da pré-ordem: a pré-ordem faz o papel do passeio de Euler, com n
+// posições em vez de 2n - 1. O mínimo por intervalo (RMQ) usa uma tabela
+// esparsa sobre blocos de 32 segmentos e, dentro do bloco, máscaras da pilha
+// de mínimos (um bit por posição).
+struct PathIndex {
+    bool valid;
+
+    // Da entrada da raiz até o ponto distal de cada segmento, inclusive
+    std::vector<double> root_length;
+    std::vector<double> root_resistance;  // Poiseuille em série (ver hemodynamics.h)
+    std::vector<int> root_bifurcations;   // Segmentos com 2+ filhos no caminho
+
+    std::vector<uint32_t> block_masks;    // Pilha de mínimos do bloco até cada posição
+    std::vector<int> block_table;         // Tabela esparsa: levels × blocos
+    int levels;
+    double build_ms;
+
+    PathIndex() : valid(false), levels(0), build_ms(0.0) {}
+};
+
+// Caminho entre dois segmentos: a cadeia de a até o LCA e do LCA até b. O
+// LCA só entra quando é o próprio a ou b (um é ancestral do outro); senão
+// o caminho passa pelo ponto distal dele sem percorrê-lo.
+struct TreePath {
+    int lca;              // -1: segmentos em árvores diferentes
+    int segments;         // Segmentos no caminho, incluindo a e b
+    double length;
+    double resistance;
+    int bifurcations;     // Bifurcações atravessadas (pontos internos do caminho)
+
+    TreePath() : lca(-1), segments(0), length(0.0), resistance(0.0), bifurcations(0) {}
+};
+
+extern PathIndex path_index;
+
+// Monta o índice após reorderSegmentsDepthFirst, em tempo O(n)
+void buildPathIndex();
+
+// Mesma topologia, raios novos: refaz só root_resistance
+void updatePathIndexRadii();
+
+int lowestCommonAncestor(int a, int b);
+
+// Comprimento da entrada da raiz até o ponto distal de s
+inline double rootPathLength(int s) { return path_index.root_length[s]; }
+
+TreePath queryPath(int a, int b);
+
+// Segmentos do caminho de a até b, em ordem (custo proporcional ao caminho)
+void collectPathSegments(int a, int b, std::vector<int>& out);
+
+// Estruturas do índice (--memstats)
+void appendPathIndexMemory(std::vector<MemoryEntry>& entries);
+
+#endif // TREE_PATHS_H
@@ -5,12 +5,30 @@
 
 #include "globals.h"
 #include "utils.h"
+#include "bvh.h"
+#include "topology.h"
+#include "spatial_order.h"
+#include "point_store.h"
+#include "growth_diff.h"
+#include "morphometry.h"
+#include "tree_paths.h"
+#include "collision.h"
+#include "territories.h"
+#include "voxelizer.h"
+#include "ambient_occlusion.h"
+#include "shadow_map.h"
+#include "range_filter.h"
+#include "occlusion.h"
+#include "mesh.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <dirent.h>
 #include <cmath>
+#include <iomanip>
+#include <random>
+#include <unordered_map>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -107,20 +125,152 @@ bool findGrowthFiles(const std::string& initial_file) {
     return growth_files.size() > 1;
 }
 
+// ============================================================
+// PASSOS COM A MESMA TOPOLOGIA
+// ============================================================
+
+// Assinatura da carga atual: pontos e conectividade na ordem do arquivo
+// (antes das renumerações) e o estado da renumeração de Hilbert
+static uint64_t loaded_fingerprint = 0;
+static bool loaded_hilbert = false;
+static bool loaded_valid = false;
+
+// FNV-1a de 64 bits sobre os bytes dos pontos e dos pares de índices
+static uint64_t topologyFingerprint(const std::vector<Point3D>& pts, const std::vector<Line3D>& lns) {
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&h](const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; i++) {
+            h ^= p[i];
+            h *= 1099511628211ULL;
+        }
+    };
+    uint64_t counts[2] = {pts.size(), lns.size()};
+    mix(counts, sizeof(counts));
+    for (const Point3D& p : pts) {
+        float xyz[3] = {p.x, p.y, p.z};
+        mix(xyz, sizeof(xyz));
+    }
+    for (const Line3D& L : lns) {
+        uint32_t ends[2] = {L.p0, L.p1};
+        mix(ends, sizeof(ends));
+    }
+    return h;
+}
+
+static void computeRadiusStats();
+
+// Mesma topologia da carga anterior: troca só a coluna de raios (na ordem do
+// arquivo, permutada para o layout em profundidade) e o que depende dela.
+// Pontos, segmentos, topologia, câmera e seleção continuam valendo.
+static void applyRadiiUpdate(const std::vector<float>& file_radii) {
+    const std::vector<int>& source = topology.source_segment;
+    if (source.size() == radii.size()) {
+        for (size_t k = 0; k < radii.size(); k++) {
+            radii[k] = file_radii[source[k]];
+        }
+    } else {
+        radii = file_radii;
+    }
+
+    computeRadiusStats();
+    updateTopologyRadii();
+    updatePathIndexRadii();
+    refitSegmentBVH();
+    invalidateCollisions();
+    invalidateVoxels();
+    invalidateAmbientOcclusion();
+    invalidateShadowMap();
+    invalidateRangeFilter();
+    invalidateGrowthDiff();
+
+    // Posições e cores das malhas são refeitas sobre os índices e normais atuais
+    dirty_flags |= DIRTY_RADII | DIRTY_CAMERA | DIRTY_HUD;
+}
+
+// Passo que estende o carregado: o CCO só acrescenta pontos, então os dois
+// arquivos têm um prefixo de pontos em comum, e um segmento com as duas
+// extremidades nele e o mesmo par de índices é o mesmo tubo (só o raio pode
+// ter mudado). previous[i] é o segmento de `lines` (layout atual) casado com
+// o segmento i do arquivo novo, ou -1. Vale só sem a renumeração de Hilbert,
+// quando `points` e os índices de `lines` ainda estão na ordem do arquivo.
+// Retorna quantos segmentos casaram.
+static size_t matchGrowthPrefix(const std::vector<Point3D>& next_points, const std::vector<Line3D>& next_lines,
+                                std::vector<int>& previous) {
+    size_t limit = std::min(points.size(), next_points.size());
+    size_t shared = 0;
+    while (shared < limit && points[shared].x == next_points[shared].x && points[shared].y == next_points[shared].y &&
+           points[shared].z == next_points[shared].z) {
+        shared++;
+    }
+    previous.assign(next_lines.size(), -1);
+    if (shared == 0) return 0;
+
+    std::unordered_map<uint64_t, int> by_ends;
+    by_ends.reserve(lines.size());
+    for (size_t s = 0; s < lines.size(); s++) {
+        if (lines[s].p0 < shared && lines[s].p1 < shared) {
+            by_ends.emplace(((uint64_t)lines[s].p0 << 32) | lines[s].p1, (int)s);
+        }
+    }
+    size_t matched = 0;
+    for (size_t i = 0; i < next_lines.size(); i++) {
+        const Line3D& L = next_lines[i];
+        if (L.p0 >= shared || L.p1 >= shared) continue;
+        auto it = by_ends.find(((uint64_t)L.p0 << 32) | L.p1);
+        if (it == by_ends.end()) continue;
+        previous[i] = it->second;
+        matched++;
+    }
+    return matched;
+}
+
+static bool finishVTKLoad(const std::string& filename, bool update_camera);
+
 bool loadCurrentGrowthFile() {
     if (growth_files.empty() || current_growth_index < 0 || 
         current_growth_index >= (int)growth_files.size()) {
         return false;
     }
+    const std::string& filename = growth_files[current_growth_index];
+
+    std::vector<Point3D> next_points;
+    std::vector<Line3D> next_lines;
+    std::vector<float> next_radii;
+    if (!parseVTKFile3D(filename, next_points, next_lines, next_radii)) {
+        return false;
+    }
+
+    // Passo com os mesmos pontos e segmentos (só os raios mudaram): atualiza
+    // em vez de recarregar
+    if (loaded_valid && loaded_hilbert == hilbert_reorder_enabled &&
+        topologyFingerprint(next_points, next_lines) == loaded_fingerprint) {
+        applyRadiiUpdate(next_radii);
+        invalidateMorphometry(filename, true);
+        std::cout << "Arquivo VTK 3D carregado (mesma topologia, só raios): " << filename << std::endl;
+        return true;
+    }
+
+    // Só se as malhas ainda forem as da carga atual (sem outra carga
+    // pendente de reconstrução)
+    std::vector<int> previous_of_file;
+    size_t matched = 0;
+    if (loaded_valid && !loaded_hilbert && !hilbert_reorder_enabled && !(dirty_flags & DIRTY_GEOMETRY)) {
+        matched = matchGrowthPrefix(next_points, next_lines, previous_of_file);
+    }
+
+    points.swap(next_points);
+    lines.swap(next_lines);
+    radii.swap(next_radii);
     
     // Preservar a distância e ângulos da câmera ao carregar novo arquivo
-    // O centro será atualizado automaticamente no readVTKFile3D
+    // O centro será atualizado automaticamente no finishVTKLoad
     float saved_distance = camera.distance;
     float saved_azimuth = camera.azimuth;
     float saved_elevation = camera.elevation;
     
     // Carregar arquivo sem resetar distância e ângulos da câmera
-    bool result = readVTKFile3D(growth_files[current_growth_index], false);
+    bool result = finishVTKLoad(filename, false);
     
     if (result) {
         // Restaurar distância e ângulos, mantendo o novo centro
@@ -130,25 +280,96 @@ bool loadCurrentGrowthFile() {
         camera.updateEye();
         
         std::cout << "Câmera preservada - distância: " << camera.distance << std::endl;
+
+        // Segmentos casados levados para o layout em profundidade
+        if (matched > 0) {
+            const std::vector<int>& source = topology.source_segment;
+            mesh_previous_segment.resize(lines.size());
+            for (size_t k = 0; k < lines.size(); k++) {
+                mesh_previous_segment[k] = previous_of_file[source.size() == lines.size() ? source[k] : k];
+            }
+            std::cout << "  Passo seguinte: " << matched << " segmentos do passo anterior reaproveitados" << std::endl;
+        }
     }
     
     return result;
 }
 
+// ============================================================
+// RAIOS
+// ============================================================
+
+static void computeRadiusStats() {
+    radius_min = 1e9f;
+    radius_max = -1e9f;
+    for (float r : radii) {
+        if (r < radius_min) radius_min = r;
+        if (r > radius_max) radius_max = r;
+    }
+    if (lines.empty()) {
+        radius_min = radius_max = 0.0f;
+    }
+
+    segments_by_radius.resize(lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        segments_by_radius[i] = (int)i;
+    }
+    std::stable_sort(segments_by_radius.begin(), segments_by_radius.end(), [](int a, int b) {
+        return radii[a] > radii[b];
+    });
+}
+
+float scaleRadiusForDisplay(float segment_radius) {
+    // Escala dos raios para corresponder aos exemplos Nterm:
+    // Referência: raio máximo do tronco em ~2.5% do data_scale (tubos mais finos)
+    float display_radius = segment_radius;
+    float avg_radius = (radius_min + radius_max) / 2.0f;
+
+    if (data_scale > 0.001f) {
+        float ref_r = (radius_max > 0.0001f) ? radius_max : avg_radius;
+        if (ref_r > 0.0001f) {
+            // Fator para que o raio MÁXIMO fique em ~2.5% do tamanho da cena
+            float scale_factor = (data_scale * 0.025f) / ref_r;
+            display_radius = segment_radius * scale_factor;
+        }
+    }
+
+    // Limites de segurança (tubos visíveis, sem extremos)
+    float min_radius = data_scale * 0.0015f;  // Mínimo: 0.15% do tamanho
+    float max_radius = data_scale * 0.04f;    // Máximo: 4% do tamanho (preserva proporção tronco/ramos)
+
+    if (display_radius < min_radius) display_radius = min_radius;
+    if (display_radius > max_radius) display_radius = max_radius;
+
+    return display_radius;
+}
+
+float getDisplayRadius(size_t segment) {
+    // Modo (a): raio fixo - raio médio para todos os segmentos
+    // Modo (b): raio variável - raio original do arquivo VTK
+    float avg_radius = (radius_min + radius_max) / 2.0f;
+    if (radius_mode_fixed && avg_radius > 0.0001f) {
+        return scaleRadiusForDisplay(avg_radius);
+    }
+    return scaleRadiusForDisplay(radii[segment]);
+}
+
 // ============================================================
 // LEITURA DE ARQUIVOS VTK 3D
 // ============================================================
 
-bool readVTKFile3D(const std::string& filename, bool update_camera) {
+// Lê pontos, segmentos e raios na ordem do arquivo
+bool parseVTKFile3D(const std::string& filename, std::vector<Point3D>& pts,
+                    std::vector<Line3D>& lns, std::vector<float>& rds) {
     std::ifstream file(filename);
     if (!file.is_open()) {
         std::cerr << "Erro: Não foi possível abrir o arquivo " << filename << std::endl;
         return false;
     }
 
-    points.clear();
-    lines.clear();
-    radii.clear();
+    pts.clear();
+    lns.clear();
+    rds.clear();
 
     std::string line;
     int npoints = 0;
@@ -169,6 +390,7 @@ bool readVTKFile3D(const std::string& filename, bool update_camera) {
             iss >> npoints;
             std::string type;
             iss >> type;
+            if (npoints > 0) pts.reserve(npoints);
             reading_points = true;
             reading_lines = false;
             reading_radii = false;
@@ -179,8 +401,10 @@ bool readVTKFile3D(const std::string& filename, bool update_camera) {
         // Ler número de linhas
         if (token == "LINES") {
             iss >> nlines;
-            int total_indices;
+            int total_indices = 0;
             iss >> total_indices;
+            // Cada célula de k pontos ocupa k+1 inteiros e gera k-1 segmentos
+            if (total_indices > 2 * nlines) lns.reserve(total_indices - 2 * nlines);
             reading_points = false;
             reading_lines = true;
             reading_radii = false;
@@ -199,6 +423,7 @@ bool readVTKFile3D(const std::string& filename, bool update_camera) {
             reading_radii = true;
             reading_points = false;
             reading_lines = false;
+            rds.reserve(lns.size());
             // Pular linha "LOOKUP_TABLE default"
             std::getline(file, line);
             continue;
@@ -209,7 +434,7 @@ bool readVTKFile3D(const std::string& filename, bool update_camera) {
             float x, y, z;
             std::istringstream iss_line(line);
             if (iss_line >> x >> y >> z) {
-                points.push_back(Point3D(x, y, z));
+                pts.push_back(Point3D(x, y, z));
                 points_read++;
             }
         }
@@ -226,7 +451,7 @@ bool readVTKFile3D(const std::string& filename, bool update_camera) {
                     }
                     // Criar segmentos entre pontos consecutivos
                     for (int i = 0; i < k - 1; i++) {
-                        lines.push_back(Line3D(indices[i], indices[i+1]));
+                        lns.push_back(Line3D((uint32_t)indices[i], (uint32_t)indices[i+1]));
                     }
                 }
                 lines_read++;
@@ -238,47 +463,67 @@ bool readVTKFile3D(const std::string& filename, bool update_camera) {
             float r;
             std::istringstream iss_line(line);
             if (iss_line >> r) {
-                radii.push_back(r);
+                rds.push_back(r);
             }
         }
     }
 
     file.close();
 
-    // Se não há raios, criar valores padrão
-    if (radii.empty()) {
-        radii.resize(lines.size(), 0.5f);
-    }
+    // Um raio por segmento: faltantes recebem o valor padrão, excedentes
+    // são descartados
+    rds.resize(lns.size(), 0.5f);
+    return true;
+}
 
-    // Ajustar raios para corresponder ao número de linhas
-    if (radii.size() < lines.size()) {
-        while (radii.size() < lines.size()) {
-            radii.push_back(0.5f);
-        }
+bool readVTKFile3D(const std::string& filename, bool update_camera) {
+    if (!parseVTKFile3D(filename, points, lines, radii)) {
+        return false;
     }
+    return finishVTKLoad(filename, update_camera);
+}
+
+// Tudo o que deriva de points/lines/radii recém-lidos (ordem do arquivo)
+static bool finishVTKLoad(const std::string& filename, bool update_camera) {
+    selected_segment = -1;  // Índices de segmento mudam a cada arquivo
+    path_target_segment = -1;
+    invalidateGrowthDiff();
+    invalidateMorphometry(filename, false);
+    invalidateCollisions();
+    invalidateTerritories();
+    invalidateVoxels();
+    invalidateAmbientOcclusion();
+    invalidateShadowMap();
+    invalidateRangeFilter();
+    resetOcclusionProbe();
+    mesh_previous_segment.clear();
+    loaded_fingerprint = topologyFingerprint(points, lines);
+    loaded_hilbert = hilbert_reorder_enabled;
+    loaded_valid = true;
 
-    // Atualizar raios nas linhas
-    for (size_t i = 0; i < lines.size() && i < radii.size(); i++) {
-        lines[i].radius = radii[i];
+    // Renumeração opcional dos pontos (tecla H): muda só os índices p0/p1,
+    // por isso vem antes de tudo o que é indexado por ponto
+    if (hilbert_reorder_enabled) {
+        reorderPointsHilbert();
     }
 
+    // Topologia primeiro: o layout em profundidade permuta os segmentos,
+    // e tudo o que é indexado por segmento vem depois
+    buildTopology();
+    reorderSegmentsDepthFirst();
+    buildPathIndex();
+    computeRadiusStats();
+
     max_segments = lines.size();
     n_segments_draw = max_segments;
 
     // Calcular bounding box e ajustar câmera automaticamente
     if (!points.empty()) {
-        float min_x = points[0].x, max_x = points[0].x;
-        float min_y = points[0].y, max_y = points[0].y;
-        float min_z = points[0].z, max_z = points[0].z;
-        
-        for (const auto& p : points) {
-            if (p.x < min_x) min_x = p.x;
-            if (p.x > max_x) max_x = p.x;
-            if (p.y < min_y) min_y = p.y;
-            if (p.y > max_y) max_y = p.y;
-            if (p.z < min_z) min_z = p.z;
-            if (p.z > max_z) max_z = p.z;
-        }
+        float bmin[3], bmax[3];
+        pointBounds(points, bmin, bmax);
+        float min_x = bmin[0], max_x = bmax[0];
+        float min_y = bmin[1], max_y = bmax[1];
+        float min_z = bmin[2], max_z = bmax[2];
         
         // Calcular centro
         float center_x = (min_x + max_x) / 2.0f;
@@ -302,6 +547,9 @@ bool readVTKFile3D(const std::string& filename, bool update_camera) {
             camera.distance = max_size * 1.8f;  // Distância proporcional ao tamanho (aumentada para melhor visão geral)
             camera.azimuth = 45.0f;  // Reset ângulo horizontal
             camera.elevation = 30.0f;  // Reset ângulo vertical
+            // Plano near proporcional aos dados (árvores com tamanho < 0.1
+            // ficavam cortadas pelo near fixo em 0.1)
+            camera.znear = std::min(0.1f, max_size * 0.01f);
             camera.updateEye();
             
             std::cout << "Bounding box: [" << min_x << ", " << max_x << "] x ["
@@ -318,14 +566,184 @@ bool readVTKFile3D(const std::string& filename, bool update_camera) {
         }
     }
 
+    // Estruturas de aceleração dependem do data_scale (raio de exibição)
+    buildSegmentBVH();
+
+    // Malhas retidas são refeitas no próximo quadro
+    dirty_flags |= DIRTY_GEOMETRY | DIRTY_CAMERA | DIRTY_HUD;
+
     std::cout << "Arquivo VTK 3D carregado: " << filename << std::endl;
     std::cout << "  Pontos: " << points.size() << std::endl;
     std::cout << "  Segmentos: " << lines.size() << std::endl;
     std::cout << "  Raios: " << radii.size() << std::endl;
+    if (topology.root_segment >= 0) {
+        std::cout << "  Topologia: raiz no ponto " << topology.root_node
+                  << " (segmento " << topology.root_segment << "), "
+                  << topology.terminals.size() << " terminais, "
+                  << topology.bifurcations << " bifurcações, "
+                  << (topology.max_generation + 1) << " gerações" << std::endl;
+    }
 
     return true;
 }
 
+// ============================================================
+// ESCRITA DE ARQUIVOS VTK 3D
+// ============================================================
+
+bool writeVTKFile3D(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Erro: Não foi possível criar o arquivo " << filename << std::endl;
+        return false;
+    }
+
+    // Mesmo layout dos arquivos gerados pelo CCO
+    file << "# vtk DataFile Version 3.0\n";
+    file << "vtk output\n";
+    file << "ASCII\n";
+    file << "DATASET POLYDATA\n";
+    file << std::fixed << std::setprecision(7);
+
+    file << "POINTS  " << points.size() << "  float\n";
+    for (const auto& p : points) {
+        file << p.x << "  " << p.y << "  " << p.z << "\n";
+    }
+
+    file << "LINES  " << lines.size() << "  " << lines.size() * 3 << "\n";
+    for (const auto& L : lines) {
+        file << "2  " << L.p0 << "  " << L.p1 << "\n";
+    }
+
+    file << "CELL_DATA  " << lines.size() << "\n";
+    file << "scalars raio float\n";
+    file << "LOOKUP_TABLE default\n";
+    for (float r : radii) {
+        file << r << "\n";
+    }
+
+    return file.good();
+}
+
+// ============================================================
+// ÁRVORE SINTÉTICA
+// ============================================================
+
+static float pointSegmentDistance2(const Point3D& p, const Point3D& a, const Point3D& b) {
+    Point3D ab = b - a;
+    float len2 = dotProduct(ab, ab);
+    float t = (len2 > 0.0f) ? dotProduct(p - a, ab) / len2 : 0.0f;
+    t = std::max(0.0f, std::min(1.0f, t));
+    Point3D d = p - (a + ab * t);
+    return dotProduct(d, d);
+}
+
+void generateSyntheticTree(int n_terminals, unsigned int seed) {
+    // Árvore binária no estilo CCO dentro de uma esfera unitária: cada novo
+    // terminal sorteia um ponto no domínio, conecta-se ao segmento mais
+    // próximo entre alguns candidatos e os raios seguem a lei de Murray
+    const int CANDIDATES = 16;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::vector<Point3D> pts;
+    std::vector<int> seg_p0, seg_p1, parent;
+    std::vector<int> child_a, child_b;
+    int n_seg_max = 2 * std::max(1, n_terminals) - 1;
+    pts.reserve(n_seg_max + 1);
+    seg_p0.reserve(n_seg_max);
+    seg_p1.reserve(n_seg_max);
+    parent.reserve(n_seg_max);
+    child_a.reserve(n_seg_max);
+    child_b.reserve(n_seg_max);
+
+    pts.push_back(Point3D(0.0f, 1.0f, 0.0f));
+    pts.push_back(Point3D(0.0f, 0.5f, 0.0f));
+    seg_p0.push_back(0); seg_p1.push_back(1); parent.push_back(-1);
+    child_a.push_back(-1); child_b.push_back(-1);
+
+    for (int k = 1; k < n_terminals; k++) {
+        Point3D x;
+        do {
+            x = Point3D(uni(rng), uni(rng), uni(rng));
+        } while (dotProduct(x, x) > 1.0f);
+
+        int n_seg = (int)seg_p0.size();
+        int best = 0;
+        float best_d2 = 1e30f;
+        for (int c = 0; c < CANDIDATES; c++) {
+            int s = (int)(unit(rng) * n_seg) % n_seg;
+            float d2 = pointSegmentDistance2(x, pts[seg_p0[s]], pts[seg_p1[s]]);
+            if (d2 < best_d2) {
+                best_d2 = d2;
+                best = s;
+            }
+        }
+
+        // Divide o segmento escolhido no ponto de bifurcação
+        float t = 0.3f + 0.4f * unit(rng);
+        Point3D a = pts[seg_p0[best]];
+        Point3D b = pts[seg_p1[best]];
+        int m = (int)pts.size();
+        pts.push_back(a + (b - a) * t);
+        int q = (int)pts.size();
+        pts.push_back(x);
+
+        int c1 = (int)seg_p0.size();
+        seg_p0.push_back(m); seg_p1.push_back(seg_p1[best]); parent.push_back(best);
+        child_a.push_back(child_a[best]); child_b.push_back(child_b[best]);
+        if (child_a[c1] >= 0) parent[child_a[c1]] = c1;
+        if (child_b[c1] >= 0) parent[child_b[c1]] = c1;
+
+        int c2 = (int)seg_p0.size();
+        seg_p0.push_back(m); seg_p1.push_back(q); parent.push_back(best);
+        child_a.push_back(-1); child_b.push_back(-1);
+
+        seg_p1[best] = m;
+        child_a[best] = c1;
+        child_b[best] = c2;
+    }
+
+    // Pré-ordem (como nos arquivos CCO) e raios de Murray em pós-ordem
+    int n_seg = (int)seg_p0.size();
+    std::vector<int> order;
+    order.reserve(n_seg);
+    std::vector<int> stack(1, 0);
+    while (!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        order.push_back(s);
+        if (child_b[s] >= 0) stack.push_back(child_b[s]);
+        if (child_a[s] >= 0) stack.push_back(child_a[s]);
+    }
+
+    std::vector<float> r(n_seg, 0.1f);
+    for (int k = n_seg - 1; k >= 0; k--) {
+        int s = order[k];
+        if (child_a[s] >= 0) {
+            float ra = r[child_a[s]], rb = r[child_b[s]];
+            r[s] = cbrtf(ra * ra * ra + rb * rb * rb);
+        }
+    }
+
+    points = pts;
+    lines.clear();
+    radii.clear();
+    loaded_valid = false;
+    invalidateMorphometry("", false);
+    lines.reserve(n_seg);
+    radii.reserve(n_seg);
+    for (int k = 0; k < n_seg; k++) {
+        int s = order[k];
+        lines.push_back(Line3D((uint32_t)seg_p0[s], (uint32_t)seg_p1[s]));
+        radii.push_back(r[s]);
+    }
+
+    std::cout << "Árvore sintética: " << n_terminals << " terminais, "
+              << points.size() << " pontos, " << lines.size() << " segmentos" << std::endl;
+}
+
 // ============================================================
 // FUNÇÕES DE CÁLCULO VETORIAL 3D
 // ============================================================
@@ -7,16 +7,28 @@
 #define UTILS_H
 
 #include <string>
+#include <vector>
+#include <cstddef>
 
 // Forward declaration
 struct Point3D;
+struct Line3D;
 
 // Funções auxiliares
 std::string getDirectory(const std::string& filepath);
 std::string getFilename(const std::string& filepath);
 bool readVTKFile3D(const std::string& filename, bool update_camera = true);
+// Só a leitura (ordem do arquivo), sem tocar nos dados carregados
+bool parseVTKFile3D(const std::string& filename, std::vector<Point3D>& pts,
+                    std::vector<Line3D>& lns, std::vector<float>& rds);
 bool findGrowthFiles(const std::string& initial_file);
 bool loadCurrentGrowthFile();
+bool writeVTKFile3D(const std::string& filename);
+void generateSyntheticTree(int n_terminals, unsigned int seed = 1);
+
+// Raio de exibição (escala relativa ao data_scale, com limites de segurança)
+float scaleRadiusForDisplay(float segment_radius);
+float getDisplayRadius(size_t segment);
 
 // Funções de cálculo vetorial 3D
 float dotProduct(const Point3D& a, const Point3D& b);
@@ -0,0 +1,335 @@
+/*
+ * voxelizer.cpp
+ * Voxelização das cápsulas dos vasos (ocupação e volume parcial) - TP2 (3D)
+ */
+
+#include "voxelizer.h"
+#include "globals.h"
+#include "bvh.h"
+#include "parallel.h"
+#include "memstats.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+VoxelGrid voxel_grid;
+bool voxel_view_enabled = false;
+int voxel_resolution = 128;
+int voxel_slice = -1;
+
+// Amostras por eixo dentro de um voxel no volume parcial (4³ = 64 bits)
+static const int VOXEL_SUBSAMPLES = 4;
+static const uint64_t FULL_MASK = ~(uint64_t)0;
+
+// Bits das 2³ amostras de cada octante do voxel (bit = (k·4 + j)·4 + i)
+static uint64_t octantMask(int o) {
+    uint64_t bits = 0;
+    int oi = 2 * (o & 1), oj = 2 * ((o >> 1) & 1), ok = 2 * (o >> 2);
+    for (int k = ok; k < ok + 2; k++) {
+        for (int j = oj; j < oj + 2; j++) {
+            for (int i = oi; i < oi + 2; i++) bits |= (uint64_t)1 << ((k * VOXEL_SUBSAMPLES + j) * VOXEL_SUBSAMPLES + i);
+        }
+    }
+    return bits;
+}
+
+static const uint64_t octant_masks[8] = {octantMask(0), octantMask(1), octantMask(2), octantMask(3),
+                                         octantMask(4), octantMask(5), octantMask(6), octantMask(7)};
+
+static inline int popCount(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int c = 0;
+    for (; x; x &= x - 1) c++;
+    return c;
+#endif
+}
+
+// ============================================================
+// RASTERIZAÇÃO DE UM BLOCO
+// ============================================================
+
+// Eixo da cápsula com o que a distância ponto-segmento precisa
+struct AxisSegment {
+    Point3D p0;
+    Point3D d;
+    float inv_len2;
+    float radius;
+};
+
+static inline float distance2(const AxisSegment& a, float x, float y, float z) {
+    float px = x - a.p0.x, py = y - a.p0.y, pz = z - a.p0.z;
+    float t = (px * a.d.x + py * a.d.y + pz * a.d.z) * a.inv_len2;
+    t = std::max(0.0f, std::min(1.0f, t));
+    float qx = px - a.d.x * t, qy = py - a.d.y * t, qz = pz - a.d.z * t;
+    return qx * qx + qy * qy + qz * qz;
+}
+
+// Intervalo de voxels do bloco [lo, hi) cujas células tocam [a, b] no eixo
+static inline void voxelRange(const VoxelGrid& grid, int axis, float a, float b, int lo, int hi, int& first,
+                              int& last) {
+    first = std::max(lo, (int)std::ceil((a - grid.origin[axis]) / grid.voxel - 0.5f));
+    last = std::min(hi, (int)std::floor((b - grid.origin[axis]) / grid.voxel + 0.5f) + 1);
+}
+
+// Trecho t ∈ [t0, t1] do eixo em que coord(t) = p + d·t fica a até `reach`
+// de c; falso se nenhum
+static inline bool clipAxis(float p, float d, float c, float reach, float& t0, float& t1) {
+    if (std::fabs(d) < 1e-20f) return std::fabs(p - c) <= reach;
+    float a = (c - reach - p) / d, b = (c + reach - p) / d;
+    if (a > b) std::swap(a, b);
+    t0 = std::max(t0, a);
+    t1 = std::min(t1, b);
+    return t0 <= t1;
+}
+
+struct TileResult {
+    double covered;       // Voxels cobertos (frações somadas)
+    uint32_t capsules;    // Cápsulas da BVH que tocam o bloco
+};
+
+// Um bloco inteiro: máscaras de amostras locais, cápsula por cápsula, e a
+// escrita dos valores finais; nenhuma escrita fora do bloco
+static TileResult rasterizeTile(const VoxelGrid& grid, const SegmentBVH& bvh, const std::vector<float>& capsule_radii,
+                                size_t tile, std::vector<int>& candidates, std::vector<uint64_t>& masks,
+                                std::vector<unsigned char>& values) {
+    TileResult result = {0.0, 0};
+    int tx = (int)(tile % grid.tiles[0]);
+    int ty = (int)(tile / grid.tiles[0] % grid.tiles[1]);
+    int tz = (int)(tile / ((size_t)grid.tiles[0] * grid.tiles[1]));
+    int lo[3] = {tx * VOXEL_TILE, ty * VOXEL_TILE, tz * VOXEL_TILE};
+    int hi[3];
+    float bmin[3], bmax[3];
+    for (int a = 0; a < 3; a++) {
+        hi[a] = std::min(grid.dims[a], lo[a] + VOXEL_TILE);
+        bmin[a] = grid.origin[a] + (lo[a] - 0.5f) * grid.voxel;
+        bmax[a] = grid.origin[a] + (hi[a] - 0.5f) * grid.voxel;
+    }
+    collectSegmentsInBox(bvh, bmin, bmax, candidates);
+    result.capsules = (uint32_t)candidates.size();
+    if (candidates.empty()) return result;
+
+    int sx = hi[0] - lo[0], sy = hi[1] - lo[1], sz = hi[2] - lo[2];
+    masks.assign((size_t)sx * sy * sz, 0);
+    bool partial = grid.mode == VOXEL_PARTIAL;
+    float half_diagonal = 0.5f * std::sqrt(3.0f) * grid.voxel;
+    float sub = grid.voxel / VOXEL_SUBSAMPLES;
+    float sub0 = -0.5f * grid.voxel + 0.5f * sub;
+    // Amostras de um octante distam do seu centro até √3/2 · sub
+    float octant_reach = 0.5f * std::sqrt(3.0f) * sub;
+
+    for (int s : candidates) {
+        AxisSegment axis;
+        axis.p0 = points[lines[s].p0];
+        axis.d = points[lines[s].p1] - axis.p0;
+        float len2 = axis.d.x * axis.d.x + axis.d.y * axis.d.y + axis.d.z * axis.d.z;
+        axis.inv_len2 = (len2 > 0.0f) ? 1.0f / len2 : 0.0f;
+        axis.radius = capsule_radii[s];
+        float r = axis.radius;
+        float r2 = r * r;
+        float inner = std::max(0.0f, r - half_diagonal), outer = r + half_diagonal;
+        float inner2 = inner * inner, outer2 = outer * outer;
+        float octant_inner = std::max(0.0f, r - octant_reach), octant_outer = r + octant_reach;
+        float octant_inner2 = octant_inner * octant_inner, octant_outer2 = octant_outer * octant_outer;
+
+        const Point3D& p1 = points[lines[s].p1];
+        float cmin[3] = {std::min(axis.p0.x, p1.x) - r, std::min(axis.p0.y, p1.y) - r, std::min(axis.p0.z, p1.z) - r};
+        float cmax[3] = {std::max(axis.p0.x, p1.x) + r, std::max(axis.p0.y, p1.y) + r, std::max(axis.p0.z, p1.z) + r};
+        int first[3], last[3];
+        for (int a = 0; a < 3; a++) voxelRange(grid, a, cmin[a], cmax[a], lo[a], hi[a], first[a], last[a]);
+
+        // Em cada linha de voxels (y, z), só o trecho do eixo que alcança a
+        // linha importa: o intervalo em x sai dele, em vez da caixa inteira
+        // da cápsula (bem menor nos segmentos longos e diagonais)
+        float reach = (partial ? outer : r) + 0.5f * grid.voxel;
+        for (int z = first[2]; z < last[2]; z++) {
+            float cz = grid.origin[2] + z * grid.voxel;
+            float tz0 = 0.0f, tz1 = 1.0f;
+            if (!clipAxis(axis.p0.z, axis.d.z, cz, reach, tz0, tz1)) continue;
+            for (int y = first[1]; y < last[1]; y++) {
+                float cy = grid.origin[1] + y * grid.voxel;
+                float t0 = tz0, t1 = tz1;
+                if (!clipAxis(axis.p0.y, axis.d.y, cy, reach, t0, t1)) continue;
+                float xa = axis.p0.x + axis.d.x * t0, xb = axis.p0.x + axis.d.x * t1;
+                int row_first, row_last;
+                voxelRange(grid, 0, std::min(xa, xb) - r, std::max(xa, xb) + r, first[0], last[0], row_first, row_last);
+                uint64_t* row = masks.data() + ((size_t)(z - lo[2]) * sy + (y - lo[1])) * sx;
+                for (int x = row_first; x < row_last; x++) {
+                    uint64_t& mask = row[x - lo[0]];
+                    if (mask == FULL_MASK) continue;
+                    float cx = grid.origin[0] + x * grid.voxel;
+                    float d2 = distance2(axis, cx, cy, cz);
+                    if (!partial) {
+                        if (d2 <= r2) mask = FULL_MASK;
+                        continue;
+                    }
+                    // Voxel inteiro dentro ou fora pela distância do centro;
+                    // só a casca de um voxel em volta da superfície é amostrada
+                    if (d2 <= inner2 && inner > 0.0f) {
+                        mask = FULL_MASK;
+                        continue;
+                    }
+                    if (d2 >= outer2) continue;
+                    // Octantes de 2³ amostras decididos pela distância do seu
+                    // centro; só os que cortam a superfície são amostrados
+                    for (int o = 0; o < 8; o++) {
+                        uint64_t bits = octant_masks[o];
+                        if ((mask & bits) == bits) continue;
+                        int oi = 2 * (o & 1), oj = 2 * ((o >> 1) & 1), ok = 2 * (o >> 2);
+                        float ox = cx + sub0 + (oi + 0.5f) * sub, oy = cy + sub0 + (oj + 0.5f) * sub,
+                              oz = cz + sub0 + (ok + 0.5f) * sub;
+                        float od2 = distance2(axis, ox, oy, oz);
+                        if (od2 <= octant_inner2 && octant_inner > 0.0f) {
+                            mask |= bits;
+                            continue;
+                        }
+                        if (od2 >= octant_outer2) continue;
+                        for (int k = ok; k < ok + 2; k++) {
+                            for (int j = oj; j < oj + 2; j++) {
+                                for (int i = oi; i < oi + 2; i++) {
+                                    if (distance2(axis, cx + sub0 + i * sub, cy + sub0 + j * sub, cz + sub0 + k * sub) <= r2) {
+                                        mask |= (uint64_t)1 << ((k * VOXEL_SUBSAMPLES + j) * VOXEL_SUBSAMPLES + i);
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Fração de cada voxel = amostras cobertas / 64
+    for (int z = lo[2]; z < hi[2]; z++) {
+        for (int y = lo[1]; y < hi[1]; y++) {
+            const uint64_t* row = &masks[((size_t)(z - lo[2]) * sy + (y - lo[1])) * sx];
+            unsigned char* out = &values[grid.index(lo[0], y, z)];
+            for (int x = 0; x < sx; x++) {
+                int count = popCount(row[x]);
+                out[x] = (unsigned char)((count * 255 + 32) / 64);
+                result.covered += count / 64.0;
+            }
+        }
+    }
+    return result;
+}
+
+// ============================================================
+// GRADE
+// ============================================================
+
+void voxelizeCapsules(const std::vector<float>& capsule_radii, int resolution, int mode, VoxelGrid& grid) {
+    auto start = std::chrono::steady_clock::now();
+    grid = VoxelGrid();
+    grid.mode = mode;
+    grid.resolution = std::max(1, resolution);
+    if (lines.empty() || capsule_radii.size() != lines.size()) {
+        grid.valid = true;
+        return;
+    }
+
+    // BVH das cápsulas com os raios pedidos; a raiz é a caixa da grade
+    SegmentBVH bvh;
+    buildCapsuleBVH(bvh, capsule_radii, 0.0f);
+    const BVHNode& root = bvh.nodes[0];
+    float extent = std::max(root.bmax[0] - root.bmin[0], std::max(root.bmax[1] - root.bmin[1], root.bmax[2] - root.bmin[2]));
+    grid.voxel = (extent > 0.0f) ? extent / grid.resolution : 1.0f;
+    for (int a = 0; a < 3; a++) {
+        int cells = (int)std::ceil((root.bmax[a] - root.bmin[a]) / grid.voxel);
+        grid.dims[a] = std::max(1, std::min(grid.resolution, cells));
+        grid.origin[a] = root.bmin[a] + 0.5f * grid.voxel;
+        grid.tiles[a] = (grid.dims[a] + VOXEL_TILE - 1) / VOXEL_TILE;
+    }
+    for (size_t s = 0; s < lines.size(); s++) {
+        double r = capsule_radii[s];
+        grid.capsule_volume += M_PI * r * r * (points[lines[s].p1] - points[lines[s].p0]).length();
+    }
+    auto bvh_end = std::chrono::steady_clock::now();
+    grid.bvh_ms = std::chrono::duration<double, std::milli>(bvh_end - start).count();
+
+    // Um bloco por vez em cada thread; cada um escreve só nos seus voxels
+    grid.values.assign(grid.voxelCount(), 0);
+    std::vector<TileResult> results(grid.tileCount());
+    parallelFor(grid.tileCount(), 1, [&](size_t first, size_t last) {
+        std::vector<int> candidates;
+        std::vector<uint64_t> masks;
+        for (size_t t = first; t < last; t++) {
+            results[t] = rasterizeTile(grid, bvh, capsule_radii, t, candidates, masks, grid.values);
+        }
+    });
+
+    // Densidade por bloco (na ordem dos blocos: soma independente das threads)
+    grid.tile_fraction.resize(grid.tileCount());
+    double covered = 0.0;
+    for (size_t t = 0; t < results.size(); t++) {
+        int tx = (int)(t % grid.tiles[0]);
+        int ty = (int)(t / grid.tiles[0] % grid.tiles[1]);
+        int tz = (int)(t / ((size_t)grid.tiles[0] * grid.tiles[1]));
+        double tile_voxels = (double)std::min(VOXEL_TILE, grid.dims[0] - tx * VOXEL_TILE) *
+                             std::min(VOXEL_TILE, grid.dims[1] - ty * VOXEL_TILE) *
+                             std::min(VOXEL_TILE, grid.dims[2] - tz * VOXEL_TILE);
+        grid.tile_fraction[t] = (float)(results[t].covered / tile_voxels);
+        if (results[t].capsules == 0) grid.tiles_empty++;
+        grid.capsule_tests += results[t].capsules;
+        covered += results[t].covered;
+    }
+    grid.occupied_volume = covered * grid.voxel * grid.voxel * grid.voxel;
+    grid.valid = true;
+    grid.raster_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - bvh_end).count();
+}
+
+void invalidateVoxels() {
+    voxel_grid.valid = false;
+}
+
+const char* voxelModeName(int mode) {
+    return mode == VOXEL_OCCUPANCY ? "ocupação" : "volume parcial";
+}
+
+// ============================================================
+// EXPORTAÇÃO
+// ============================================================
+
+bool writeVoxelVolume(const std::string& raw_filename, const VoxelGrid& grid) {
+    std::ofstream raw(raw_filename, std::ios::binary);
+    if (!raw.is_open()) {
+        std::cerr << "Erro: Não foi possível criar o arquivo " << raw_filename << std::endl;
+        return false;
+    }
+    raw.write((const char*)grid.values.data(), grid.values.size());
+    if (!raw.good()) return false;
+
+    // Cabeçalho MetaImage com o mesmo nome e extensão .mhd
+    std::string base = raw_filename;
+    size_t dot = base.find_last_of('.');
+    size_t slash = base.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) base.erase(dot);
+    std::string header_filename = base + ".mhd";
+    std::ofstream header(header_filename);
+    if (!header.is_open()) {
+        std::cerr << "Erro: Não foi possível criar o arquivo " << header_filename << std::endl;
+        return false;
+    }
+    std::string data_file = (slash == std::string::npos) ? raw_filename : raw_filename.substr(slash + 1);
+    header << "ObjectType = Image\n";
+    header << "NDims = 3\n";
+    header << "DimSize = " << grid.dims[0] << " " << grid.dims[1] << " " << grid.dims[2] << "\n";
+    header << "ElementSpacing = " << grid.voxel << " " << grid.voxel << " " << grid.voxel << "\n";
+    header << "Offset = " << grid.origin[0] << " " << grid.origin[1] << " " << grid.origin[2] << "\n";
+    header << "ElementType = MET_UCHAR\n";
+    header << "ElementDataFile = " << data_file << "\n";
+    return header.good();
+}
+
+void appendVoxelMemory(std::vector<MemoryEntry>& entries) {
+    addMemoryEntry(entries, "Caches", "voxel_grid.values", voxel_grid.values);
+    addMemoryEntry(entries, "Caches", "voxel_grid.tile_fraction", voxel_grid.tile_fraction);
+}
@@ -0,0 +1,85 @@
+/*
+ * voxelizer.h
+ * Voxelização das cápsulas dos vasos (ocupação e volume parcial) - TP2 (3D)
+ */
+
+#ifndef VOXELIZER_H
+#define VOXELIZER_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+struct MemoryEntry;
+
+// Valor de cada voxel
+enum VoxelMode {
+    VOXEL_OCCUPANCY = 0,    // Centro do voxel dentro de alguma cápsula (0 ou 255)
+    VOXEL_PARTIAL,          // Fração do voxel dentro da união das cápsulas (0 a 255)
+    VOXEL_MODES
+};
+
+// Lado dos blocos de voxels: a unidade de trabalho das threads e as
+// regiões da densidade vascular
+static const int VOXEL_TILE = 16;
+
+struct VoxelGrid {
+    bool valid;
+    int mode;                           // VoxelMode
+    int resolution;                     // Voxels no maior eixo
+    int dims[3];
+    float origin[3];                    // Centro do voxel (0, 0, 0)
+    float voxel;                        // Aresta do voxel
+    std::vector<unsigned char> values;  // Fração × 255 (x varia mais rápido)
+
+    // Blocos de VOXEL_TILE³ voxels (os da borda podem ser menores)
+    int tiles[3];
+    std::vector<float> tile_fraction;   // Fração de volume vascular de cada bloco
+    size_t tiles_empty;                 // Blocos sem nenhuma cápsula (BVH)
+    size_t capsule_tests;               // Pares bloco × cápsula rasterizados
+
+    double occupied_volume;             // Σ fração × volume do voxel
+    double capsule_volume;              // Σ π r² L (sem descontar sobreposições)
+    double bvh_ms;
+    double raster_ms;
+
+    VoxelGrid() : valid(false), mode(VOXEL_PARTIAL), resolution(0), voxel(0.0f), tiles_empty(0), capsule_tests(0),
+                  occupied_volume(0.0), capsule_volume(0.0), bvh_ms(0.0), raster_ms(0.0) {
+        dims[0] = dims[1] = dims[2] = 0;
+        tiles[0] = tiles[1] = tiles[2] = 0;
+        origin[0] = origin[1] = origin[2] = 0.0f;
+    }
+
+    size_t voxelCount() const { return (size_t)dims[0] * dims[1] * dims[2]; }
+    size_t index(int x, int y, int z) const { return ((size_t)z * dims[1] + y) * dims[0] + x; }
+    size_t tileCount() const { return (size_t)tiles[0] * tiles[1] * tiles[2]; }
+};
+
+extern VoxelGrid voxel_grid;
+extern bool voxel_view_enabled;   // Fatia de volume parcial na janela (tecla Y)
+extern int voxel_resolution;      // Voxels no maior eixo na janela
+extern int voxel_slice;           // Fatia z exibida (teclas + e -)
+
+// Rasteriza as cápsulas (eixo do segmento, raio capsule_radii[s]) numa
+// grade de voxels cúbicos sobre a caixa da árvore aumentada pelo maior
+// raio. A grade é dividida em blocos de VOXEL_TILE³ voxels, distribuídos
+// entre as threads; cada bloco pega da BVH das cápsulas só as que o tocam
+// e escreve apenas nos seus voxels. No volume parcial cada voxel tem 4³
+// amostras (uma máscara de 64 bits, para a união das cápsulas): voxels
+// inteiros dentro ou fora de uma cápsula são decididos pela distância do
+// centro, e na casca o mesmo teste vale para cada octante de 2³ amostras.
+void voxelizeCapsules(const std::vector<float>& capsule_radii, int resolution, int mode, VoxelGrid& grid);
+
+// Chamada quando pontos, raios ou o raio de exibição mudam
+void invalidateVoxels();
+
+const char* voxelModeName(int mode);
+
+// Volume em .raw (unsigned char, sem cabeçalho) mais um .mhd (MetaImage)
+// ao lado com dimensões, origem e espaçamento
+bool writeVoxelVolume(const std::string& raw_filename, const VoxelGrid& grid);
+
+// Grade e frações por bloco (--memstats)
+void appendVoxelMemory(std::vector<MemoryEntry>& entries);
+
+#endif // VOXELIZER_H